@@ -0,0 +1,19 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Compiled to TextureBindless-frag.spv by the CMake build, see VulkanBindlessSet.h for the bindings
+
+layout(set = 0, binding = 1) uniform sampler2D textures[];	// BINDLESS_TEXTURE_BINDING
+
+// BindlessIndices, the index is the same for the whole draw
+layout(push_constant) uniform drawIndices {
+    uint bufferIndex;
+    uint textureIndex;
+} indices;
+
+layout(location = 0) in vec2 uv;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	outColor = texture(textures[indices.textureIndex], uv);
+}
@@ -0,0 +1,25 @@
+#version 450
+
+// Compiled to TextureBindless-vert.spv by the CMake build, see VulkanBindlessSet.h for the bindings
+
+// The uniform buffers of all the drawables, bound as storage buffers
+layout (std430, set = 0, binding = 0) readonly buffer bufferVals {	// BINDLESS_BUFFER_BINDING
+    mat4 mvp;
+} myBufferVals[];
+
+// BindlessIndices
+layout (push_constant) uniform drawIndices {
+    uint bufferIndex;
+    uint textureIndex;
+} indices;
+
+layout (location = 0) in vec4 pos;
+layout (location = 1) in vec2 inUV;
+layout (location = 0) out vec2 outUV;
+
+void main()
+{
+   outUV 		 = inUV;
+   gl_Position 	 = myBufferVals[indices.bufferIndex].mvp * pos;
+   gl_Position.z = (gl_Position.z + gl_Position.w) / 2.0;
+}
@@ -0,0 +1,170 @@
+#include "VulkanPixelConverter.h"
+#include <chrono>
+#include <random>
+
+// Throughput of the pixel conversions, for each instruction set and with and without the
+// streaming stores. The output of the SIMD kernels is checked against the scalar one.
+
+#define BENCHMARK_WIDTH			2048
+#define BENCHMARK_HEIGHT		2048
+#define BENCHMARK_ITERATIONS	20
+
+// Rows of the staging buffers are aligned like the linear images usually are
+#define BENCHMARK_ROW_ALIGNMENT	256
+
+struct ConversionInfo
+{
+	PixelConversion		_conversion;
+	const char*			_name;
+};
+
+static const ConversionInfo conversions[] =
+{
+	{ PIXEL_COPY,					"Copy RGBA8" },
+	{ PIXEL_RGB8_TO_RGBA8,			"RGB8 to RGBA8" },
+	{ PIXEL_BGR8_TO_RGBA8,			"BGR8 to RGBA8" },
+	{ PIXEL_BGRA8_TO_RGBA8,			"BGRA8 to RGBA8" },
+	{ PIXEL_PREMULTIPLY_ALPHA,		"Premultiply alpha" },
+	{ PIXEL_SRGB8_TO_LINEAR_HALF,	"sRGB8 to linear RGBA16F" },
+	{ PIXEL_RGBA16_TO_RGBA8,		"RGBA16 to RGBA8" },
+	{ PIXEL_FLOAT_TO_HALF,			"RGBA32F to RGBA16F" },
+};
+
+static const char* simdLevelNames[] = { "Scalar", "SSE4.1", "AVX2" };
+
+// Buffer whose start is aligned, the rows are aligned through their pitch
+struct AlignedBuffer
+{
+	std::vector<uint8_t>	_storage;
+	uint8_t*				_data;
+
+	explicit AlignedBuffer(size_t size) : _storage(size + BENCHMARK_ROW_ALIGNMENT)
+	{
+		const uintptr_t address = reinterpret_cast<uintptr_t>(_storage.data());
+		_data = _storage.data() + ((BENCHMARK_ROW_ALIGNMENT - (address % BENCHMARK_ROW_ALIGNMENT)) % BENCHMARK_ROW_ALIGNMENT);
+	}
+};
+
+// Random source texels, the float ones are kept in the range of the half floats
+static void FillSource(PixelConversion conversion, uint8_t* source, size_t size)
+{
+	std::mt19937 generator(1234);
+	if (conversion == PIXEL_FLOAT_TO_HALF)
+	{
+		std::uniform_real_distribution<float> distribution(-70000.0f, 70000.0f);
+		float* values = reinterpret_cast<float*>(source);
+		for (size_t i = 0; i < size / sizeof(float); i++)
+		{
+			// Some of the values are tiny, to go through the denormals
+			values[i] = distribution(generator) * ((i % 3) == 0 ? 1e-9f : 1.0f);
+		}
+		return;
+	}
+
+	std::uniform_int_distribution<int> distribution(0, 255);
+	for (size_t i = 0; i < size; i++)
+	{
+		source[i] = static_cast<uint8_t>(distribution(generator));
+	}
+}
+
+static size_t AlignPitch(size_t pitch)
+{
+	return (pitch + BENCHMARK_ROW_ALIGNMENT - 1) & ~static_cast<size_t>(BENCHMARK_ROW_ALIGNMENT - 1);
+}
+
+// Returns the throughput in megabytes of destination texels per second
+static double Measure(PixelConversion conversion, const uint8_t* source, size_t sourcePitch, uint8_t* destination, size_t destinationPitch, bool stream)
+{
+	const size_t rowSize = BENCHMARK_WIDTH * VulkanPixelConverter::GetDestinationTexelSize(conversion);
+
+	// Warm up, and fault in the pages of the destination
+	VulkanPixelConverter::Convert(conversion, source, sourcePitch, destination, destinationPitch, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++)
+	{
+		if (stream)
+		{
+			VulkanPixelConverter::Convert(conversion, source, sourcePitch, destination, destinationPitch, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+		}
+		else
+		{
+			// Row by row, so the regular stores are used whatever the size
+			for (uint32_t y = 0; y < BENCHMARK_HEIGHT; y++)
+			{
+				VulkanPixelConverter::ConvertRow(conversion, source + y * sourcePitch, destination + y * destinationPitch, BENCHMARK_WIDTH, false);
+			}
+		}
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	return (static_cast<double>(rowSize) * BENCHMARK_HEIGHT * BENCHMARK_ITERATIONS) / (elapsed.count() * 1024.0 * 1024.0);
+}
+
+static bool Compare(const uint8_t* expected, const uint8_t* result, size_t pitch, size_t rowSize)
+{
+	for (uint32_t y = 0; y < BENCHMARK_HEIGHT; y++)
+	{
+		if (memcmp(expected + y * pitch, result + y * pitch, rowSize) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	const PixelSimdLevel maxLevel = VulkanPixelConverter::GetSimdLevel();
+	std::cout << "Image of " << BENCHMARK_WIDTH << "x" << BENCHMARK_HEIGHT << ", best instruction set: " << simdLevelNames[maxLevel] << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+
+	bool failed = false;
+	for (const ConversionInfo& info : conversions)
+	{
+		// The source rows are packed, like the ones of the image files
+		const size_t sourcePitch		= BENCHMARK_WIDTH * VulkanPixelConverter::GetSourceTexelSize(info._conversion);
+		const size_t rowSize			= BENCHMARK_WIDTH * VulkanPixelConverter::GetDestinationTexelSize(info._conversion);
+		const size_t destinationPitch	= AlignPitch(rowSize);
+
+		AlignedBuffer source(sourcePitch * BENCHMARK_HEIGHT);
+		AlignedBuffer destination(destinationPitch * BENCHMARK_HEIGHT);
+		FillSource(info._conversion, source._data, sourcePitch * BENCHMARK_HEIGHT);
+
+		std::cout << info._name << std::endl;
+
+		// The scalar reference is computed last and the other results are compared with it
+		std::vector<std::vector<uint8_t>> results;
+		for (int level = maxLevel; level >= PIXEL_SIMD_NONE; level--)
+		{
+			VulkanPixelConverter::LimitSimdLevel(static_cast<PixelSimdLevel>(level));
+
+			const double regular = Measure(info._conversion, source._data, sourcePitch, destination._data, destinationPitch, false);
+			std::cout << "\t" << std::setw(8) << simdLevelNames[level] << ": " << std::setw(8) << regular << " MB/s";
+			if (level != PIXEL_SIMD_NONE)
+			{
+				const double streamed = Measure(info._conversion, source._data, sourcePitch, destination._data, destinationPitch, true);
+				std::cout << ", streamed " << std::setw(8) << streamed << " MB/s";
+			}
+			std::cout << std::endl;
+
+			results.push_back(std::vector<uint8_t>(destination._data, destination._data + destinationPitch * BENCHMARK_HEIGHT));
+		}
+
+		const std::vector<uint8_t>& reference = results.back();
+		for (size_t i = 0; i + 1 < results.size(); i++)
+		{
+			if (!Compare(reference.data(), results[i].data(), destinationPitch, rowSize))
+			{
+				std::cout << "\tMismatch between " << simdLevelNames[maxLevel - i] << " and the scalar kernel" << std::endl;
+				failed = true;
+			}
+		}
+
+		// Next conversion starts again from the best instruction set
+		VulkanPixelConverter::LimitSimdLevel(maxLevel);
+	}
+
+	return failed ? 1 : 0;
+}
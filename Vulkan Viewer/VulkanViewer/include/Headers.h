@@ -35,6 +35,11 @@
 #else  // _WIN32
 #define VK_USE_PLATFORM_XCB_KHR
 #include <unistd.h>
+
+// Header files for the memory mapped files
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif // _WIN32
 
 /*********** C/C++ HEADER FILES ***********/
@@ -49,6 +54,29 @@
 #include <memory>
 #include <mutex>
 
+// Header files for multithreaded command buffer recording
+#include <algorithm>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+
+// Header files for draw sorting
+#include <unordered_map>
+
+// Header files for the sampler cache keys
+#include <array>
+
+// Header files for the pixel conversions
+#include <cstring>
+#include <cmath>
+
+// Header files for the pipeline cache timings
+#include <chrono>
+
+// Header files for the pipeline compile threads
+#include <atomic>
+
 /*********** GLM HEADER FILES ***********/
 #define GLM_FORCE_RADIANS
 #include "glm/glm.hpp"
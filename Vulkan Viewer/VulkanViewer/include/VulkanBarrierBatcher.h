@@ -0,0 +1,60 @@
+#pragma once
+#include "Headers.h"
+
+class VulkanDevice;
+
+// Collects buffer and image barriers and issues them with a single pipeline barrier.
+// Uses vkCmdPipelineBarrier2KHR with per barrier stage masks when the device supports
+// VK_KHR_synchronization2, otherwise falls back to one vkCmdPipelineBarrier whose
+// stage masks are the union of the collected barriers.
+class VulkanBarrierBatcher
+{
+public:
+	VulkanBarrierBatcher();
+
+	// Load the synchronization2 entry point when the device has enabled the extension
+	void Initialize(VulkanDevice* deviceObj);
+
+	// Layout transition, the stage and access masks are deduced from the layouts
+	void AddImageTransition(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout);
+
+	// Image barrier with explicit masks, e.g. for a queue family ownership transfer
+	void AddImageBarrier(VkImage image, const VkImageSubresourceRange& subresourceRange,
+		                 VkImageLayout oldLayout, VkImageLayout newLayout,
+		                 VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+		                 VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+		                 uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+	void AddBufferBarrier(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+		                  VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+		                  VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+		                  uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+	// Record all the pending barriers in one call, does nothing when none is pending
+	void Flush(VkCommandBuffer cmd);
+
+	bool IsEmpty() const { return _imageBarriers.empty() && _bufferBarriers.empty(); }
+
+	// Stages and accesses which must be synchronized with an image in the given layout
+	static void GetLayoutStageAccess(VkImageLayout layout, bool isSource, VkPipelineStageFlags* stages, VkAccessFlags* access);
+
+	// Statistics, the number of barrier calls recorded and the barriers they carried
+	uint32_t _flushCount;
+	uint32_t _barrierCount;
+
+private:
+	struct StageMasks
+	{
+		VkPipelineStageFlags _src;
+		VkPipelineStageFlags _dst;
+	};
+
+	std::vector<VkImageMemoryBarrier>	_imageBarriers;
+	std::vector<StageMasks>				_imageStages;
+	std::vector<VkBufferMemoryBarrier>	_bufferBarriers;
+	std::vector<StageMasks>				_bufferStages;
+
+#ifdef VK_KHR_synchronization2
+	PFN_vkCmdPipelineBarrier2KHR		fpCmdPipelineBarrier2KHR;
+#endif
+};
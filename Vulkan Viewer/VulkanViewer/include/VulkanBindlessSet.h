@@ -0,0 +1,82 @@
+#pragma once
+#include "Headers.h"
+#include "Wrappers.h"
+#include "VulkanShaderReflection.h"
+
+class VulkanDevice;
+
+// Slots of the bindless set, clamped to the limits of the device
+#define BINDLESS_MAX_TEXTURES	4096
+#define BINDLESS_MAX_BUFFERS	1024
+
+// Bindings of the bindless set, the variable sized one must be the last
+#define BINDLESS_BUFFER_BINDING		0
+#define BINDLESS_TEXTURE_BINDING	1
+
+// Indices of the draw in the bindless set, passed as push constants
+struct BindlessIndices
+{
+	uint32_t	_bufferIndex;	// Storage buffer holding the transform of the draw
+	uint32_t	_textureIndex;
+};
+
+// A single descriptor set holding every texture and storage buffer, through
+// VK_EXT_descriptor_indexing. The set and the pipeline layout are shared by all the
+// draws, so the set is bound once per command buffer and each draw only pushes the
+// indices of its resources. The slots are partially bound and written after bind, the
+// slot of a removed resource is reused once the submissions already made are done.
+class VulkanBindlessSet
+{
+public:
+	VulkanBindlessSet();
+	~VulkanBindlessSet();
+
+	// Returns false when the device does not support the descriptor indexing features
+	bool Initialize(VulkanDevice* deviceObj);
+	void Destroy();
+	bool IsInitialized() const { return _descriptorSet != VK_NULL_HANDLE; }
+
+	// The layouts of the set are not built from the shaders, they need flags the SPIR-V does
+	// not carry. Returns false when the shaders use resources the set does not have.
+	bool IsCompatible(const VulkanShaderReflection& reflection) const;
+
+	// The textures are shared between the drawables, adding one again returns its slot
+	uint32_t AddTexture(const TextureData* texture);
+	void RemoveTexture(const TextureData* texture);
+
+	// Write the current view and sampler of the texture and return its slot. The slot read by
+	// the submitted frames is left as it is, a changed view moves the texture to a new slot and
+	// the old one is reused once they are done. The draws push the slot returned.
+	uint32_t UpdateTexture(const TextureData* texture);
+
+	uint32_t AddBuffer(const VkDescriptorBufferInfo& bufferInfo);
+	void RemoveBuffer(uint32_t index);
+
+	VkDescriptorSet GetDescriptorSet() const { return _descriptorSet; }
+	VkPipelineLayout GetPipelineLayout() const { return _pipelineLayout; }
+
+private:
+	struct TextureSlot
+	{
+		uint32_t	_index;
+		uint32_t	_refCount;
+		VkImageView	_view;		// View written in the slot
+	};
+
+	void WriteTexture(uint32_t index, const TextureData* texture);
+	static uint32_t AllocateSlot(std::vector<uint32_t>& freeSlots, uint32_t& slotCount, uint32_t maxSlots);
+	void ReleaseSlot(std::vector<uint32_t>& freeSlots, uint32_t index);
+
+	VulkanDevice*										_deviceObj;
+	VkDescriptorSetLayout								_descLayout;
+	VkPipelineLayout									_pipelineLayout;
+	VkDescriptorPool									_descriptorPool;
+	VkDescriptorSet										_descriptorSet;
+	uint32_t											_maxTextures;
+	uint32_t											_maxBuffers;
+	std::unordered_map<const TextureData*, TextureSlot>	_textureSlots;
+	std::vector<uint32_t>								_freeTextureSlots;
+	std::vector<uint32_t>								_freeBufferSlots;
+	uint32_t											_textureSlotCount;	// Slots handed out at least once
+	uint32_t											_bufferSlotCount;
+};
@@ -12,33 +12,29 @@ public:
 	// Destructor
 	virtual ~VulkanDescriptor();
 
-	// Creates descriptor pool and allocate descriptor set from it
+	// Creates the descriptor resources and allocate descriptor set from the allocator of the device
 	void CreateDescriptor(bool useTexture);
 	// Deletes the created descriptor set object
-	void DestroyDescriptor();
+	virtual void DestroyDescriptor();
 
 	// Defines the sescriptor sets layout binding and create descriptor layout
 	virtual void CreateDescriptorSetLayout(bool useTexture) = 0;
-	// Destroy the valid descriptor layout object
+	// Release the descriptor layouts, they belong to the layout cache of the device
 	void DestroyDescriptorLayout();
 
-	// Creates the descriptor pool that is used to allocate descriptor sets
-	virtual void CreateDescriptorPool(bool useTexture) = 0;
-	// Deletes the descriptor pool
-	void DestroyDescriptorPool() const;
-
 	// Create Descriptor set associated resources before creating the descriptor set
 	virtual void CreateDescriptorResources() = 0;
 
-	// Create the descriptor set from the descriptor pool allocated 
-	// memory and update the descriptor set information into it.
+	// Create the descriptor set from the shared descriptor allocator
+	// and update the descriptor set information into it.
 	virtual void CreateDescriptorSet(bool useTexture) = 0;
+	// Give the sets back to the allocator, the GPU must be done with them
 	void DestroyDescriptorSet();
 
 	// Creates the pipeline layout to inject into the pipeline
 	virtual void CreatePipelineLayout() = 0;
-	// Destroys the create pipelineLayout
-	void DestroyPipelineLayouts() const;
+	// Release the pipeline layout, it belongs to the layout cache of the device
+	void DestroyPipelineLayouts();
 	
 	// Pipeline layout object
 	VkPipelineLayout _pipelineLayout;
@@ -46,9 +42,6 @@ public:
 	// List of all the VkDescriptorSetLayouts 
 	std::vector<VkDescriptorSetLayout> _descLayout;
 	
-	// Decriptor pool object that will be used for allocating VkDescriptorSet object
-	VkDescriptorPool _descriptorPool;
-	
 	// List of all created VkDescriptorSet
 	std::vector<VkDescriptorSet> _descriptorSet;
 
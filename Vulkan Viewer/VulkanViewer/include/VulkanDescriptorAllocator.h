@@ -0,0 +1,84 @@
+#pragma once
+#include "Headers.h"
+
+class VulkanDevice;
+
+// Sets held by the first pool of a chain, each pool added to the chain holds twice as many
+// as the previous one up to the maximum
+#define DESCRIPTOR_POOL_INITIAL_SETS	64
+#define DESCRIPTOR_POOL_MAX_SETS		4096
+
+// Descriptors a template can write
+#define DESCRIPTOR_TEMPLATE_MAX_ENTRIES	8
+
+// Descriptor written by a template, its info is read from the structure given to the update
+struct DescriptorTemplateEntry
+{
+	uint32_t			_binding;
+	VkDescriptorType	_type;
+	size_t				_offset;		// Of the VkDescriptorBufferInfo or VkDescriptorImageInfo in the structure
+};
+
+// Writes of a descriptor set layout, done by vkUpdateDescriptorSetWithTemplateKHR when
+// the device supports it, by vkUpdateDescriptorSets otherwise
+struct DescriptorTemplate
+{
+	uint32_t					_entryCount;
+	DescriptorTemplateEntry		_entries[DESCRIPTOR_TEMPLATE_MAX_ENTRIES];
+#ifdef VK_KHR_descriptor_update_template
+	VkDescriptorUpdateTemplateKHR	_template;		// Null without the extension
+#endif
+};
+
+// Allocates the descriptor sets of all the drawables from shared pools. The pools are chained,
+// a full pool is followed by a larger one, and are kept once created: the sets given back are
+// reused for their layout, so the descriptor sets are allocated without any call to the driver
+// once the chain is grown.
+class VulkanDescriptorAllocator
+{
+public:
+	VulkanDescriptorAllocator();
+	~VulkanDescriptorAllocator();
+
+	void Initialize(VulkanDevice* deviceObj);
+
+	// Destroy the pools and all the sets allocated from them, the GPU must be idle
+	void Destroy();
+
+	// Allocate a set kept until it is freed
+	bool Allocate(VkDescriptorSetLayout layout, VkDescriptorSet* set);
+
+	// Give a set back, like vkFreeDescriptorSets the GPU must be done with it. The pools are
+	// reset once no set is in use anymore.
+	void Free(VkDescriptorSetLayout layout, VkDescriptorSet set);
+
+	// The entries are written at the binding of the set, one descriptor each
+	void CreateTemplate(VkDescriptorSetLayout layout, const DescriptorTemplateEntry* entries, uint32_t entryCount, DescriptorTemplate* descriptorTemplate);
+	void DestroyTemplate(DescriptorTemplate* descriptorTemplate);
+
+	// Write the descriptors of the set from the structure the entries of the template point in
+	void UpdateSet(VkDescriptorSet set, const DescriptorTemplate& descriptorTemplate, const void* data) const;
+
+private:
+	struct PoolChain
+	{
+		std::vector<VkDescriptorPool>	_pools;
+		uint32_t						_current;		// Pool the sets are allocated from, the previous ones are full
+	};
+
+	bool AllocateFromChain(PoolChain& chain, VkDescriptorSetLayout layout, VkDescriptorSet* set);
+	void ResetChain(PoolChain& chain);
+	void DestroyChain(PoolChain& chain);
+	VkDescriptorPool CreatePool(uint32_t maxSets);
+
+	VulkanDevice*			_deviceObj;
+	PoolChain				_chain;			// Sets kept until freed
+	uint32_t				_liveSetCount;	// Allocated from the chain and not freed
+	std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>>	_freeSets;
+
+#ifdef VK_KHR_descriptor_update_template
+	PFN_vkCreateDescriptorUpdateTemplateKHR		fpCreateDescriptorUpdateTemplateKHR;
+	PFN_vkDestroyDescriptorUpdateTemplateKHR	fpDestroyDescriptorUpdateTemplateKHR;
+	PFN_vkUpdateDescriptorSetWithTemplateKHR	fpUpdateDescriptorSetWithTemplateKHR;
+#endif
+};
@@ -2,6 +2,10 @@
 
 #include "Headers.h"
 #include "VulkanLED.h"
+#include "VulkanTimeline.h"
+#include "VulkanSamplerCache.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanLayoutCache.h"
 
 // Vulkan exposes one or more devices, each of which exposes one or more queues which may process 
 // work asynchronously to one another.The queues supported by a device are divided into families, 
@@ -25,9 +29,32 @@ public:
 	// Query physical device to retrive queue properties
 	uint32_t GetGraphicsQueueHandle();
 
+	// Pick a transfer only (DMA) family and an async compute family, both fall
+	// back to the graphics family when the device exposes no such family
+	void GetTransferAndComputeQueueHandles();
+	bool HasDedicatedTransferQueue() const	{ return _transferQueueIndex != _graphicsQueueIndex; }
+	bool HasAsyncComputeQueue() const		{ return _computeQueueIndex != _graphicsQueueIndex; }
+
+	// Timelines of the transfer and compute queues, the graphics one when they share its family
+	VulkanTimeline& GetTransferTimeline()	{ return HasDedicatedTransferQueue() ? _transferTimeline : _graphicsTimeline; }
+	VulkanTimeline& GetComputeTimeline();
+
+	// Run the deferred deletions of all the queues
+	void CollectGarbage();
+
 	// Queue related member functions.
 	void GetDeviceQueue();
 
+	// Extensions exposed by the device implementation, queried at device creation
+	void GetSupportedExtensions();
+	bool IsExtensionSupported(const char* extensionName) const;
+
+	// Check the descriptor indexing features used by the bindless set, and read its limits
+	bool QueryDescriptorIndexingSupport();
+
+	// Check the graphics pipeline library feature, and whether its links are fast
+	bool QueryGraphicsPipelineLibrarySupport();
+
 	VkDevice							_device;	// Logical device
 	VkPhysicalDevice*					_gpu;		// Physical device
 	VkPhysicalDeviceProperties			_gpuProps;	// Physical device attributes
@@ -39,8 +66,38 @@ public:
 	uint32_t								_graphicsQueueIndex;			// Stores graphics queue index
 	uint32_t								_graphicsQueueWithPresentIndex;  // Number of queue family exposed by device
 	uint32_t								_queueFamilyCount;				// Device specificc layer and extensions
+	uint32_t								_transferQueueIndex;			// Transfer only family, or the graphics family
+	uint32_t								_computeQueueIndex;				// Compute family without graphics, or the graphics family
+	VkQueue									_transferQueue;
+	VkQueue									_computeQueue;
 	
 	// Layer and extensions
 	VulkanLayerAndExtension		_layerExtension;
 	VkPhysicalDeviceFeatures	_deviceFeatures;
+
+	// Optional extensions, enabled only when the device supports them
+	std::vector<VkExtensionProperties>	_supportedExtensions;
+	std::vector<const char *>			_enabledExtensions;		// Requested plus optional extensions
+	bool								_synchronization2Enabled;
+	bool								_timelineSemaphoreEnabled;
+	bool								_descriptorIndexingEnabled;
+	uint32_t							_maxUpdateAfterBindSampledImages;	// Limits of the update after bind descriptors
+	uint32_t							_maxUpdateAfterBindStorageBuffers;
+	bool								_graphicsPipelineLibraryEnabled;
+	bool								_graphicsPipelineLibraryFastLinking;	// The links without optimization are cheap enough for the first use
+	bool								_descriptorUpdateTemplateEnabled;
+
+	// Submission tickets of each queue
+	VulkanTimeline				_graphicsTimeline;
+	VulkanTimeline				_transferTimeline;
+	VulkanTimeline				_computeTimeline;
+
+	// Samplers shared by all the textures
+	VulkanSamplerCache			_samplerCache;
+
+	// Descriptor set and pipeline layouts shared by the drawables
+	VulkanLayoutCache			_layoutCache;
+
+	// Descriptor sets of all the drawables
+	VulkanDescriptorAllocator	_descriptorAllocator;
 };
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include "Headers.h"
+
+class VulkanDrawable;
+
+// Layout of the 64 bit draw sort key, from the most to the least significant bits:
+// | pass (4) | pipeline (12) | material (12) | mesh (12) | depth (24) |
+// Sorting the keys groups the draws sharing the most expensive state together,
+// and orders the draws sharing all the state front to back.
+#define SORT_KEY_PASS_BITS		4
+#define SORT_KEY_PIPELINE_BITS	12
+#define SORT_KEY_MATERIAL_BITS	12
+#define SORT_KEY_MESH_BITS		12
+#define SORT_KEY_DEPTH_BITS		24
+
+// Render passes a draw can be submitted to, it is the first sort criteria
+enum DrawPass
+{
+	DRAW_PASS_OPAQUE = 0,
+	DRAW_PASS_TRANSPARENT,
+};
+
+// One entry of the sorted draw list
+struct DrawItem
+{
+	uint64_t		_key;
+	VulkanDrawable*	_drawable;
+};
+
+// Tracks the state bound in a command buffer and skips the binds
+// which would set it to the value it already has.
+class VulkanBindState
+{
+public:
+	VulkanBindState();
+
+	// Forget the bound state, the next binds are always issued.
+	// Must be called when starting to record a new command buffer.
+	void Reset();
+
+	void BindPipeline(VkCommandBuffer cmd, VkPipeline pipeline);
+	void BindDescriptorSet(VkCommandBuffer cmd, VkPipelineLayout layout, VkDescriptorSet descriptorSet);
+	void BindVertexBuffer(VkCommandBuffer cmd, VkBuffer buffer);
+
+	// Bind statistics, a draw without elimination issues one bind of each kind
+	uint32_t _bindsIssued;
+	uint32_t _bindsSkipped;
+
+private:
+	VkPipeline			_pipeline;
+	VkPipelineLayout	_pipelineLayout;
+	VkDescriptorSet		_descriptorSet;
+	VkBuffer			_vertexBuffer;
+};
+
+// Builds the sort key of each draw and radix sorts them. The pipeline,
+// material and mesh handles are mapped to small ids which fit in the key,
+// the ids are given again by each sort so only the handles of one list count.
+class VulkanDrawSorter
+{
+public:
+	VulkanDrawSorter();
+
+	// Sort the drawables in place in the key order, the list
+	// is expected to be rebuilt and sorted every frame.
+	void Sort(std::vector<VulkanDrawable*>& drawables, DrawPass pass);
+
+	// Depth beyond this distance all falls in the last depth bucket
+	void SetMaxDepth(float maxDepth) { _maxDepth = maxDepth; }
+
+private:
+	// Forget the registered ids, the handles of the previous lists may have been reused
+	void ResetRegistry();
+	uint64_t BuildKey(DrawPass pass, VulkanDrawable* drawable);
+	static uint32_t GetId(std::unordered_map<uint64_t, uint32_t>& registry, uint64_t handle, uint32_t bits);
+	static void RadixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch);
+
+	std::unordered_map<uint64_t, uint32_t> _pipelineIds;
+	std::unordered_map<uint64_t, uint32_t> _materialIds;
+	std::unordered_map<uint64_t, uint32_t> _meshIds;
+	std::vector<DrawItem>                  _items;
+	std::vector<DrawItem>                  _scratch;	// Ping-pong buffer of the radix sort
+	float                                  _maxDepth;
+};
@@ -1,64 +1,113 @@
 #pragma once
 #include "Headers.h"
 #include "VulkanDescriptor.h"
+#include "VulkanDescriptorAllocator.h"
 #include "Wrappers.h"
 #include "VulkanSwapChain.h"
+#include "VulkanDrawSorter.h"
+#include "VulkanBindlessSet.h"
+#include "VulkanShader.h"
+#include "VulkanTextureAtlas.h"
 
 class VulkanRenderer;
 
 class VulkanDrawable : public VulkanDescriptor
 {
 public:
-	VulkanDrawable(VkDevice* device,
-	               VkCommandPool* commandPool,
-	               VkRenderPass* renderPass,
-	               VkQueue* queue,
-	               std::vector<VkDescriptorSetLayout>* framebuffers,
-	               VulkanSwapChain* swapChainObj,
-	               int* width,
-	               int* height);
+	VulkanDrawable(VkDevice* device);
 	~VulkanDrawable();
 
-	void CreateVertexBuffer(const void *vertexData, uint32_t dataSize, uint32_t dataStride, bool useTexture);
-	void Prepare();
-	void Render();
+	// The attributes of the vertices are not given, they are the inputs the vertex shader declares
+	void CreateVertexBuffer(const void *vertexData, uint32_t dataSize, uint32_t dataStride);
 	void Update();
 
-	void SetPipeline(VkPipeline* vulkanPipeline) { _pipeline = vulkanPipeline; }
-	VkPipeline* GetPipeline() { return _pipeline; }
+	// Record the write of the matrix computed by Update() into the uniform buffer. The
+	// data is copied into the command buffer, so the frames in flight never share it: the
+	// buffer is written by the GPU once the previous frame has drawn from it. Must be recorded
+	// outside a render pass.
+	void RecordUniformUpdate(VkCommandBuffer cmd) const;
+
+	// Record the bind and draw commands of this drawable. The command buffer
+	// must be inside a render pass instance, with viewport and scissor set.
+	// Binds of the state already set by the previous drawable are skipped.
+	void RecordDrawCommands(VkCommandBuffer cmdDraw, VulkanBindState& bindState);
+
+	void SetPipeline(VkPipeline* vulkanPipeline) { _pipeline = vulkanPipeline; _stateVersion++; }
+	VkPipeline* GetPipeline() const { return _pipeline; }
+
+	// State used to build the draw sort key
+	VkDescriptorSet GetDescriptorSet() const;
+	VkBuffer GetVertexBuffer() const { return _vertexBuffer._buf; }
+	float GetViewDepth() const;
+
+	// Height in pixels the faces of the model cover on screen, used to pick the
+	// texture level whose texel density matches the screen
+	float GetProjectedSize(float viewportHeight) const;
+
+	// Static drawables are recorded once and their command buffers are cached by the
+	// renderer, dynamic drawables are re-recorded every frame.
+	void SetStatic(bool isStatic) { _isStatic = isStatic; _stateVersion++; }
+	bool IsStatic() const { return _isStatic; }
+
+	// Invisible drawables are not recorded at all
+	void SetVisible(bool isVisible) { _isVisible = isVisible; _stateVersion++; }
+	bool IsVisible() const { return _isVisible; }
+
+	// Bumped whenever a change requires the drawable to be recorded again
+	uint32_t GetStateVersion() const { return _stateVersion; }
+
+	// Shader whose reflected interface gives the descriptor set layouts, the pipeline layout
+	// and the vertex attributes of the drawable. Set before creating the descriptors.
+	void SetShader(VulkanShader* shader) { _shader = shader; }
+	VulkanShader* GetShader() const { return _shader; }
+
+	// Variant of the shader registered for the material of the drawable, its pipeline is built
+	// with the specialization constants of the variant
+	void SetShaderVariant(uint32_t variant) { _shaderVariant = variant; _stateVersion++; }
+	uint32_t GetShaderVariant() const { return _shaderVariant; }
 
 	void CreateUniformBuffer();
-	void CreateDescriptorPool(bool useTexture) override;
 	void CreateDescriptorResources() override;
 	void CreateDescriptorSet(bool useTexture) override;
 	void CreateDescriptorSetLayout(bool useTexture) override;
 	void CreatePipelineLayout() override;
+	void DestroyDescriptor() override;
+
+	// Use the shared bindless set instead of a descriptor set of its own. The uniform buffer
+	// and the texture are added to the set, the draws push their indices.
+	void CreateBindlessDescriptor(VulkanBindlessSet* bindlessSet);
 
 	void DestroyVertexBuffer();
-	void DestroyCommandBuffer();
-	void DestroySynchronizationObjects();
 	void DestroyUniformBuffer();
 
 	void SetTextures(TextureData* tex);
+	TextureData* GetTextures() const { return _textures; }
+
+	// File of the image the drawable shows, its texture is created by the renderer
+	void SetTextureFile(const std::string& filename) { _textureFile = filename; }
+	const std::string& GetTextureFile() const { return _textureFile; }
+
+	// Region of the image in the texture atlas, the texture coordinates of the vertex buffer
+	// are remapped to it. ATLAS_NO_REGION when the texture is the image alone.
+	void SetAtlasRegion(uint32_t region) { _atlasRegion = region; }
+	uint32_t GetAtlasRegion() const { return _atlasRegion; }
+
+	// Write the current view and sampler of the texture into a new descriptor set. The set
+	// bound by the frames in flight is given back once they are done with it.
+	void UpdateTextureDescriptor();
 
 	// Stores the vertex input rate
 	VkVertexInputBindingDescription		_viIpBind;
-	// Store metadata helpful in data interpretation
-	VkVertexInputAttributeDescription	_viIpAttrb[2];
 
 private:
-	void InitViewports(VkCommandBuffer* cmd);
-	void InitScissors(VkCommandBuffer* cmd);
-	void RecordCommandBuffer(int currentImage, VkCommandBuffer* cmdDraw);
+	// Write the uniform buffer and the texture into the descriptor set with the template
+	void WriteDescriptorSet();
 
 	struct
 	{
 		VkBuffer						_buffer;			// Buffer resource object
 		VkDeviceMemory					_memory;			// Buffer resourece object's allocated device memory
 		VkDescriptorBufferInfo			_bufferInfo;		// Buffer info that need to supplied into write descriptor set (VkWriteDescriptorSet)
-		VkMemoryRequirements			_memRqrmnt;		// Store the queried memory requirement of the uniform buffer
-		std::vector<VkMappedMemoryRange>_mappedRange;	// Metadata of memory mapped objects
-		uint8_t*						_pData;			// Host pointer containing the mapped device address which is used to write data into.
 	} _uniformData;
 
 	// Structure storing vertex buffer metadata
@@ -69,12 +118,22 @@ private:
 		VkDescriptorBufferInfo _bufferInfo;
 	} _vertexBuffer;
 
-	std::vector<VkCommandBuffer> _vecCmdDraw;			// Command buffer for drawing
-	VkViewport                   _viewport;
-	VkRect2D                     _scissor;
-	VkSemaphore                  _presentCompleteSemaphore;
-	VkSemaphore                  _drawingCompleteSemaphore;
 	TextureData*                 _textures;
+	std::string                  _textureFile;
+	uint32_t                     _atlasRegion;
+	VulkanShader*                _shader;
+	uint32_t                     _shaderVariant;
+	VulkanBindlessSet*           _bindlessSet;		// Null when the drawable owns its descriptor set
+	BindlessIndices              _bindlessIndices;
+
+	// Infos the descriptor template reads, at the offsets of its entries
+	struct DescriptorData
+	{
+		VkDescriptorBufferInfo	_uniform;
+		VkDescriptorImageInfo	_texture;
+	};
+	DescriptorData               _descriptorData;
+	DescriptorTemplate           _descriptorTemplate;
 
 	glm::mat4                    _projectionMatrix;
 	glm::mat4                    _viewMatrix;
@@ -83,11 +142,7 @@ private:
 
 	VkPipeline*		                    _pipeline;
 	VkDevice*                           _device;
-	VkCommandPool*                      _commandPool;
-	VkRenderPass*                       _renderPass;
-	VkQueue*                            _queue;
-	std::vector<VkDescriptorSetLayout>* _framebuffers;
-	VulkanSwapChain*                    _swapChainObj;
-	int*                                _width;
-	int*                                _height;
+	bool                                _isStatic;
+	bool                                _isVisible;
+	uint32_t                            _stateVersion;
 };
\ No newline at end of file
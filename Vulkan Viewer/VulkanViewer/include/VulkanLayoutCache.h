@@ -0,0 +1,42 @@
+#pragma once
+#include "Headers.h"
+
+// Hands out one shared VkDescriptorSetLayout per distinct set of bindings and one shared
+// VkPipelineLayout per distinct list of set layouts and push constant ranges. The drawables
+// built from the same shaders then use the same layouts, so their pipeline states match and
+// the sets bound for one stay bound for the next draws. The layouts live as long as the device.
+class VulkanLayoutCache
+{
+public:
+	VulkanLayoutCache();
+	~VulkanLayoutCache();
+
+	void Initialize(VkDevice device);
+
+	// Destroy all the layouts, the GPU must be idle
+	void Destroy();
+
+	// Return the layout of the bindings, creating it on the first request. The immutable
+	// samplers are part of the key by their handle, they come from the sampler cache.
+	VkDescriptorSetLayout GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+	// Return the pipeline layout of the set layouts and push constant ranges, creating it on the first request
+	VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+
+	uint32_t GetDescriptorSetLayoutCount() const	{ return static_cast<uint32_t>(_setLayouts.size()); }
+	uint32_t GetPipelineLayoutCount() const			{ return static_cast<uint32_t>(_pipelineLayouts.size()); }
+
+private:
+	// Every field of the create infos, the handles by their value
+	typedef std::vector<uint64_t> LayoutKey;
+
+	struct LayoutKeyHash
+	{
+		size_t operator()(const LayoutKey& key) const;
+	};
+
+	VkDevice												_device;
+	std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash>	_setLayouts;
+	std::unordered_map<LayoutKey, VkPipelineLayout, LayoutKeyHash>		_pipelineLayouts;
+	std::mutex												_mutex;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include "Headers.h"
+
+// Read only view of a whole file mapped in the address space. The pages are read from
+// the disk on first access and belong to the page cache, so parsing the header of a
+// large file does not read the rest of it, and no heap copy of the file is made.
+class VulkanMappedFile
+{
+public:
+	VulkanMappedFile();
+	~VulkanMappedFile();
+
+	bool Open(const char* filename);
+	void Close();
+
+	bool IsOpen() const { return _data != nullptr; }
+	const uint8_t* GetData() const { return _data; }
+	size_t GetSize() const { return _size; }
+
+private:
+	VulkanMappedFile(const VulkanMappedFile&) = delete;
+	VulkanMappedFile& operator=(const VulkanMappedFile&) = delete;
+
+#ifdef _WIN32
+	HANDLE			_file;
+	HANDLE			_mapping;
+#endif
+	const uint8_t*	_data;
+	size_t			_size;
+};
@@ -1,6 +1,6 @@
 #pragma once
 #include "Headers.h"
-class VulkanShader;
+#include "VulkanShader.h"
 class VulkanDrawable;
 
 // While creating the pipeline the number of viewports and number 
@@ -8,6 +8,54 @@ class VulkanDrawable;
 #define NUMBER_OF_VIEWPORTS 1
 #define NUMBER_OF_SCISSORS NUMBER_OF_VIEWPORTS
 
+// File the pipeline cache is kept in between the runs, and the seconds
+// between two saves while new pipelines are being created.
+#define PIPELINE_CACHE_FILE				"VulkanViewer.pipelinecache"
+#define PIPELINE_CACHE_SAVE_INTERVAL	30
+
+// Vertex attributes a pipeline state can describe, the vertex shaders may declare as many inputs
+#define PIPELINE_MAX_VERTEX_ATTRIBUTES	8
+
+// Parts of a graphics pipeline, each of them can be built on its own as a
+// library with VK_EXT_graphics_pipeline_library and linked with the others
+enum PipelinePart
+{
+	PIPELINE_PART_VERTEX_INPUT		= 0x1,
+	PIPELINE_PART_PRE_RASTERIZATION	= 0x2,
+	PIPELINE_PART_FRAGMENT_SHADER	= 0x4,
+	PIPELINE_PART_FRAGMENT_OUTPUT	= 0x8,
+	PIPELINE_PART_ALL				= 0xF,
+};
+#define PIPELINE_PART_COUNT 4
+
+// Full state of a graphics pipeline. The states are hashed and compared as raw bytes,
+// so they are zero initialized, padding included, by VulkanPipeline::DescribePipeline().
+struct PipelineState
+{
+	VkShaderModule						_vertexShader;
+	VkShaderModule						_fragmentShader;
+	ShaderVariantKey					_vertexSpecialization;		// Constants the shaders are specialized with
+	ShaderVariantKey					_fragmentSpecialization;
+	VkPipelineLayout					_layout;
+	VkRenderPass						_renderPass;
+	uint32_t							_subpass;
+	uint32_t							_vertexBindingCount;
+	VkVertexInputBindingDescription		_vertexBinding;
+	uint32_t							_vertexAttributeCount;
+	VkVertexInputAttributeDescription	_vertexAttributes[PIPELINE_MAX_VERTEX_ATTRIBUTES];
+	VkPrimitiveTopology					_topology;
+	VkPolygonMode						_polygonMode;
+	VkCullModeFlags						_cullMode;
+	VkFrontFace							_frontFace;
+	VkBool32							_depthClamp;
+	VkBool32							_depthTest;
+	VkBool32							_depthWrite;
+	VkCompareOp							_depthCompareOp;
+	VkBool32							_blendEnable;
+	VkColorComponentFlags				_colorWriteMask;
+	VkSampleCountFlagBits				_samples;
+};
+
 class VulkanPipeline
 {
 public:
@@ -15,8 +63,19 @@ public:
 
 	~VulkanPipeline();
 	
-	// Creates the pipeline cache object and stores pipeline object
+	// Creates the pipeline cache object and stores pipeline object. The cache is
+	// initialized from the file of the previous runs when it was made by the same
+	// driver and device, and is kept as it is when it already exists.
 	void CreatePipelineCache();
+
+	// Write the cache to its file, merged with what other processes saved meanwhile
+	void SavePipelineCache();
+
+	// Save the cache periodically while new pipelines are created
+	void Update();
+
+	// Whether the pipelines come from a cache, filled by a previous run or earlier in this one
+	bool IsPipelineCacheWarm() const { return _cacheWarm; }
 	
 	// Returns the created pipeline object, it takes the drawable object which 
 	// contains the vertex input rate and data interpretation information, 
@@ -24,11 +83,43 @@ public:
 	// if the vertex input are available. 	
 	bool CreatePipeline(VulkanDrawable* drawableObj, VkPipeline* pipeline, VulkanShader* shaderObj, VkBool32 includeDepth, VkBool32 includeVi = true);
 
-	// Destruct the pipeline cache object
+	// Fill the state of the pipeline the drawable is drawn with
+	void DescribePipeline(VulkanDrawable* drawableObj, VulkanShader* shaderObj, VkBool32 includeDepth, VkBool32 includeVi, PipelineState* state) const;
+
+	// Compile the pipeline of the state. It can be called from any thread, the
+	// pipeline cache is synchronized by the driver.
+	bool CreatePipeline(const PipelineState& state, VkPipeline* pipeline);
+
+	// Build one part of the pipeline of the state as a library. The device must
+	// have enabled VK_EXT_graphics_pipeline_library.
+	bool CreatePipelineLibrary(const PipelineState& state, PipelinePart part, VkPipeline* library);
+
+	// Link the libraries of the PIPELINE_PART_COUNT parts into a pipeline. The fast link is
+	// cheap enough for the first use, the optimized one gives the pipeline a monolithic
+	// compile would. Both can be called from any thread.
+	bool LinkPipeline(const VkPipeline* libraries, VkPipelineLayout layout, bool optimize, VkPipeline* pipeline);
+
+	// Keep only the fields of the state the library of the part is built from, the
+	// parts are shared between the pipelines whose part states are identical
+	static void GetPartState(const PipelineState& state, PipelinePart part, PipelineState* partState);
+
+	// Save and destruct the pipeline cache object
 	void DestroyPipelineCache();
 
+	VkDevice GetDevice() const { return *_device; }
+
 private:
+	// Build a whole pipeline, or a library of some of its parts
+	bool CreatePipelinePart(const PipelineState& state, uint32_t parts, VkPipeline* pipeline);
+
+	// Whether the data was made by this driver and device, from the header of the cache
+	bool IsPipelineCacheCompatible(const uint8_t* data, size_t size) const;
+
 	VkPipelineCache _pipelineCache;
 	VkDevice*       _device;
 	VkRenderPass*   _renderPass;
-};
\ No newline at end of file
+	bool			_cacheWarm;
+	std::atomic<uint32_t> _pipelinesSinceSave;	// Pipelines created since the cache was last saved
+	uint64_t		_savedFileHash;			// Hash of the file as last loaded or saved, to spot the saves of other processes
+	std::chrono::steady_clock::time_point _lastSaveTime;
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanPipeline.h"
+#include "VulkanThreadPool.h"
+
+class VulkanDevice;
+
+// Worker threads compiling the pipelines. They are not shared with the command buffer
+// recording, whose ParallelFor() would otherwise wait behind the compiles.
+#define PIPELINE_COMPILE_THREADS 2
+
+// Shares the pipelines between the drawables whose pipeline state is identical, and
+// compiles the new states on worker threads. Until a pipeline is compiled its handle is
+// null, and the draws using it are skipped, so the frame loop never waits on a compile.
+//
+// With VK_EXT_graphics_pipeline_library the pipelines are linked from libraries of their
+// parts, shared between all the states using them. A state whose parts are all built
+// already is linked at once, without optimizations, then the optimized link runs on the
+// worker threads and replaces it once done.
+class VulkanPipelineManager
+{
+public:
+	VulkanPipelineManager(VulkanDevice* deviceObj, VulkanPipeline* pipelineObj);
+	~VulkanPipelineManager();
+
+	// Returns the storage of the pipeline of the state, shared by every caller asking for
+	// the same state. The compiled handle is written there by Update(), on the calling thread.
+	VkPipeline* GetPipeline(const PipelineState& state);
+
+	// Publish the pipelines compiled since the last call, returns true when some became
+	// ready or were replaced by their optimized version. Their storages are added to the list.
+	bool Update(std::vector<VkPipeline*>* published);
+
+	bool IsCompiling();
+
+	// Compile again the pipelines using the previous module with the new one, e.g. when a
+	// shader is reloaded. Their storages are kept, so the drawables draw with the previous
+	// pipelines until the new ones are published by Update(). The libraries built from the
+	// previous module are evicted, and destroyed once no compile may still link them.
+	void ReplaceShaderModule(VkShaderModule previous, VkShaderModule module);
+
+	// Wait for the compiles in flight and destroy every pipeline and library
+	void DestroyPipelines();
+
+	uint32_t GetPipelineCount() const { return static_cast<uint32_t>(_pipelines.size()); }
+
+private:
+	// The states are zero initialized, so they are hashed and compared as raw bytes
+	struct StateHash
+	{
+		size_t operator()(const PipelineState& state) const;
+	};
+	struct StateEqual
+	{
+		bool operator()(const PipelineState& a, const PipelineState& b) const { return memcmp(&a, &b, sizeof(PipelineState)) == 0; }
+	};
+	typedef std::unordered_map<PipelineState, VkPipeline, StateHash, StateEqual> LibraryMap;
+
+	struct CompiledPipeline
+	{
+		VkPipeline*	_storage;
+		VkPipeline	_pipeline;
+		uint32_t	_generation;	// Of the storage when the job was scheduled
+		bool		_succeeded;
+		bool		_optimized;		// Replaces the fast linked pipeline
+	};
+
+	// Run the job on a worker thread, it counts as a new pipeline for the compile time log
+	void Schedule(const std::function<void()>& job, bool newPipeline);
+
+	// Find the libraries of the parts of the state, the missing ones are built when asked
+	bool GetLibraries(const PipelineState& state, bool build, VkPipeline libraries[PIPELINE_PART_COUNT]);
+
+	void CompilePipeline(const PipelineState& state, VkPipeline* storage, uint32_t generation);
+	void OptimizePipeline(const PipelineState& state, VkPipeline* storage, uint32_t generation);
+	void AddCompiled(VkPipeline* storage, VkPipeline pipeline, uint32_t generation, bool succeeded, bool optimized);
+	uint32_t GetGeneration(VkPipeline* storage) const;
+	void WaitIdle();
+
+	VulkanDevice*														_deviceObj;
+	VulkanPipeline*														_pipelineObj;
+	std::unordered_map<PipelineState, std::unique_ptr<VkPipeline>, StateHash, StateEqual> _pipelines;	// Only used by the calling thread
+	std::unordered_map<VkPipeline*, uint32_t>							_generations;		// Bumped when the state of a storage changes, only used by the calling thread
+	std::mutex															_mutex;
+	std::condition_variable												_compileDone;
+	LibraryMap															_libraries[PIPELINE_PART_COUNT];	// Guarded by the mutex
+	std::vector<VkShaderModule>											_retiredModules;	// Replaced while compiles were in flight, guarded by the mutex
+	std::vector<VkPipeline>												_retiredLibraries;	// Evicted, destroyed once the worker threads are idle, guarded by the mutex
+	std::vector<CompiledPipeline>										_compiled;			// Compiled and not published yet
+	uint32_t															_pendingCount;		// Jobs queued or running
+	uint32_t															_batchCount;		// New pipelines since the worker threads were last idle
+	std::chrono::steady_clock::time_point								_batchStart;
+	VulkanThreadPool													_compileThreads;	// Last, so the workers are joined first
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include "Headers.h"
+
+// Destination size from which the conversions write with streaming stores. The staging
+// memory is write-combined and never read back, so large images bypass the caches.
+#define PIXEL_STREAMING_THRESHOLD (1024 * 1024)
+
+// Conversions from the texel layouts of the image files to the ones of the textures
+enum PixelConversion
+{
+	PIXEL_COPY,						// 4 byte texels copied as they are
+	PIXEL_RGB8_TO_RGBA8,			// Opaque alpha added
+	PIXEL_BGR8_TO_RGBA8,
+	PIXEL_BGRA8_TO_RGBA8,			// Red and blue swapped, which also converts RGBA8 to BGRA8
+	PIXEL_PREMULTIPLY_ALPHA,		// RGBA8 color multiplied by its alpha
+	PIXEL_SRGB8_TO_LINEAR_HALF,		// RGBA8 sRGB color to RGBA16F linear color, the alpha is linear already
+	PIXEL_RGBA16_TO_RGBA8,			// 16 bit UNORM channels rounded to 8 bits
+	PIXEL_FLOAT_TO_HALF,			// RGBA32F to RGBA16F, rounded to nearest even
+};
+
+// Instruction sets of the conversion kernels, each level includes the previous ones
+enum PixelSimdLevel
+{
+	PIXEL_SIMD_NONE,
+	PIXEL_SIMD_SSE41,
+	PIXEL_SIMD_AVX2,				// With F16C for the half floats
+};
+
+// Converts the texels of the images on the way into the staging memory. The kernels use
+// SSE4.1 or AVX2 when the CPU supports them, picked at runtime, with a scalar fallback
+// giving the same results. The rows are written at the pitch of the destination.
+class VulkanPixelConverter
+{
+public:
+	// Convert the rows of the image, each side has its own row pitch in bytes
+	static void Convert(PixelConversion conversion, const void* source, size_t sourceRowPitch, void* destination, size_t destinationRowPitch, uint32_t width, uint32_t height);
+
+	// Convert a row of texels. With streaming stores the destination must be 16 byte aligned,
+	// and the caller issues the store fence once all the rows are written.
+	static void ConvertRow(PixelConversion conversion, const void* source, void* destination, uint32_t texelCount, bool stream);
+
+	// Bytes per texel on each side of the conversion
+	static uint32_t GetSourceTexelSize(PixelConversion conversion);
+	static uint32_t GetDestinationTexelSize(PixelConversion conversion);
+
+	// Instruction set used by the kernels. The limit is clamped to what the CPU supports,
+	// e.g. to benchmark the kernels against each other.
+	static PixelSimdLevel GetSimdLevel();
+	static void LimitSimdLevel(PixelSimdLevel level);
+
+	static uint16_t FloatToHalf(float value);
+};
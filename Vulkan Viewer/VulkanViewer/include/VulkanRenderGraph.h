@@ -0,0 +1,194 @@
+#pragma once
+#include "Headers.h"
+
+class VulkanDevice;
+
+// Index of an image or buffer resource inside the render graph
+typedef uint32_t RenderGraphResource;
+
+// How a pass uses a resource, each access implies the pipeline
+// stages, the memory access types and the image layout involved.
+enum RenderGraphAccess
+{
+	RG_ACCESS_COLOR_ATTACHMENT_WRITE = 0,
+	RG_ACCESS_DEPTH_ATTACHMENT_WRITE,
+	RG_ACCESS_DEPTH_ATTACHMENT_READ,
+	RG_ACCESS_VERTEX_SHADER_READ,
+	RG_ACCESS_FRAGMENT_SHADER_READ,
+	RG_ACCESS_COMPUTE_SHADER_READ,
+	RG_ACCESS_COMPUTE_SHADER_WRITE,
+	RG_ACCESS_TRANSFER_READ,
+	RG_ACCESS_TRANSFER_WRITE,
+	RG_ACCESS_PRESENT,
+};
+
+// Queue a pass is scheduled on. Async compute passes run on the compute queue when the
+// device has one, otherwise, or when they depend on the graphics work of the same frame,
+// they are recorded with the graphics passes.
+enum RenderGraphQueue
+{
+	RG_QUEUE_GRAPHICS = 0,
+	RG_QUEUE_ASYNC_COMPUTE,
+};
+
+// Number of frames between two reports of the GPU pass timings
+#define RENDER_GRAPH_TIMING_INTERVAL 1000
+
+// Description of a transient image, the graph owns its memory
+struct RenderGraphImageDesc
+{
+	VkFormat			_format;
+	uint32_t			_width;
+	uint32_t			_height;
+	VkImageUsageFlags	_usage;
+	VkImageAspectFlags	_aspect;
+};
+
+// Frame graph: the passes declare the resources they read and write, the graph
+// culls the passes which do not contribute to an output, inserts one batched
+// pipeline barrier in front of each pass, and aliases the memory of the
+// transient images whose lifetimes do not overlap.
+class VulkanRenderGraph
+{
+public:
+	VulkanRenderGraph(VulkanDevice* deviceObj);
+	~VulkanRenderGraph();
+
+	// Image created outside the graph, like a swapchain image. Its layout is assumed to be
+	// initialLayout at the start of every frame. The image can be changed between frames.
+	RenderGraphResource ImportImage(const char* name, VkImage image, VkImageAspectFlags aspect, VkImageLayout initialLayout);
+	void SetImportedImage(RenderGraphResource resource, VkImage image);
+
+	// Buffers created outside the graph, one resource may stand for a group of buffers used
+	// together. The graph only tracks their hazards, carried from one frame to the next, and
+	// synchronizes them with memory barriers. Async compute passes may use them, in which case
+	// the buffers must be shared concurrently by the graphics and the compute queue families.
+	RenderGraphResource ImportBuffer(const char* name);
+
+	// Image created and owned by the graph, it lives only between its first and last use
+	RenderGraphResource CreateTransientImage(const char* name, const RenderGraphImageDesc& desc);
+	VkImage GetImage(RenderGraphResource resource) const;
+	VkImageView GetImageView(RenderGraphResource resource) const;
+
+	// Resources which must be produced every frame, the passes not leading to one are culled.
+	// An output left in another layout than finalLayout is transitioned at the end of the frame.
+	void MarkOutput(RenderGraphResource resource, VkImageLayout finalLayout);
+
+	// Add a pass, execute is called with the command buffer of its queue when the pass is recorded
+	uint32_t AddPass(const char* name, const std::function<void(VkCommandBuffer cmd)>& execute, RenderGraphQueue queue = RG_QUEUE_GRAPHICS);
+	void Read(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access);
+	void Write(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access);
+
+	// Attachment of the VkRenderPass begun by the pass. The render pass transitions it to
+	// finalLayout itself, so the graph only tracks the layout and emits no layout transition.
+	void WriteAttachment(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access, VkImageLayout finalLayout);
+
+	// Cull the passes, compute the transient lifetimes, then create and alias their memory.
+	// Must be called after declaring the passes and before the first Execute().
+	void Compile();
+
+	// Record the surviving passes and their barriers. The async compute passes go into computeCmd,
+	// which must be submitted on the compute queue before cmd and signal a semaphore waited on by
+	// the graphics submission at GetAsyncWaitStages(). When the query pool is not null, each pass
+	// writes a begin and an end timestamp at the queries 2 * pass and 2 * pass + 1.
+	void Execute(VkCommandBuffer cmd, VkCommandBuffer computeCmd = VK_NULL_HANDLE, VkQueryPool queryPool = VK_NULL_HANDLE);
+
+	// True when some surviving pass runs on the async compute queue
+	bool HasAsyncWork() const { return _hasAsyncWork; }
+
+	// Graphics stages consuming the results of the async compute passes
+	VkPipelineStageFlags GetAsyncWaitStages() const { return _asyncWaitStages; }
+
+	// Size of the timestamp query pool given to Execute(), 0 when the device has no usable timestamps
+	uint32_t GetTimestampQueryCount() const;
+
+	// Accumulate the timestamps of a completed frame, the per pass GPU times and the
+	// overlap of the async compute and graphics work are printed at regular intervals
+	void ReadTimestamps(VkQueryPool queryPool);
+
+	// Destroy the transient resources and forget all the passes and resources
+	void Reset();
+
+private:
+	struct ResourceUse
+	{
+		RenderGraphResource	_resource;
+		RenderGraphAccess	_access;
+		bool				_isWrite;
+		bool				_isAttachment;		// Transitioned by the pass's render pass
+		VkImageLayout		_finalLayout;		// Layout after the render pass, attachments only
+	};
+
+	struct Pass
+	{
+		std::string									_name;
+		std::function<void(VkCommandBuffer cmd)>	_execute;
+		std::vector<ResourceUse>					_uses;
+		bool										_culled;
+		RenderGraphQueue							_queue;			// Requested queue
+		bool										_runsAsync;		// Scheduled on the compute queue
+		double										_gpuTime;		// Accumulated GPU time in milliseconds
+	};
+
+	struct Resource
+	{
+		std::string				_name;
+		bool					_isTransient;
+		bool					_isBuffer;		// Imported buffers, no layout and no image
+		RenderGraphImageDesc	_desc;
+		VkImage					_image;
+		VkImageView				_view;
+		VkImageLayout			_initialLayout;
+		bool					_isOutput;
+		VkImageLayout			_finalLayout;
+		uint32_t				_firstPass;		// Lifetime of a transient, in surviving pass order
+		uint32_t				_lastPass;
+		VkMemoryRequirements	_memRqrmnt;
+		uint32_t				_memoryBlock;
+		bool					_isAsync;		// Used by an async compute pass, shared by both queues
+
+		// State tracked while recording
+		VkImageLayout			_layout;
+		VkPipelineStageFlags	_writeStages;
+		VkAccessFlags			_writeAccess;
+		VkPipelineStageFlags	_readStages;	// Stages which read the resource since the last write
+		bool					_onComputeQueue;	// Last accessed by the compute queue
+	};
+
+	// Memory shared by the transient images whose lifetimes do not overlap
+	struct MemoryBlock
+	{
+		VkDeviceMemory						_memory;
+		VkDeviceSize						_size;
+		uint32_t							_memoryTypeIndex;
+		bool								_isAsync;		// Holds an image of the async passes, never aliased
+		std::vector<std::pair<uint32_t, uint32_t>> _intervals;
+	};
+
+	struct AccessInfo
+	{
+		VkPipelineStageFlags	_stages;
+		VkAccessFlags			_access;
+		VkImageLayout			_layout;
+	};
+	static AccessInfo GetAccessInfo(RenderGraphAccess access);
+
+	void AddUse(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access, bool isWrite, bool isAttachment, VkImageLayout finalLayout);
+	void CullPasses();
+	void ScheduleAsyncPasses();
+	void AllocateTransients();
+	void CreateTransientView(Resource& resource);
+
+	VulkanDevice*					_deviceObj;
+	std::vector<Pass>				_passes;
+	std::vector<Resource>			_resources;
+	std::vector<MemoryBlock>		_memoryBlocks;
+	bool							_compiled;
+	bool							_hasAsyncWork;
+	VkPipelineStageFlags			_asyncWaitStages;
+
+	// GPU timings
+	bool							_timestampsSupported;
+	uint32_t						_timedFrames;
+	double							_overlapTime;		// Accumulated overlap of the two queues in milliseconds
+};
@@ -4,11 +4,47 @@
 #include "VulkanDrawable.h"
 #include "VulkanShader.h"
 #include "VulkanPipeline.h"
+#include "VulkanThreadPool.h"
+#include "VulkanRenderGraph.h"
+#include "VulkanBarrierBatcher.h"
+#include "VulkanUploader.h"
+#include "VulkanTextureStreamer.h"
+#include "VulkanTextureManager.h"
+#include "VulkanTextureAtlas.h"
+#include "VulkanBindlessSet.h"
+#include "VulkanPipelineManager.h"
+#include "VulkanShaderReloader.h"
 
 // Number of samples needs to be the same at image creation
 // Used at renderpass creation (in attachment) and pipeline creation
 #define NUM_SAMPLES VK_SAMPLE_COUNT_1_BIT
 
+// Number of frames the CPU may record ahead of the GPU. Every frame in
+// flight owns its command pools, so it can be reset as soon as its ticket completes.
+#define MAX_FRAMES_IN_FLIGHT 2
+
+// Number of frames between two reports of the bind statistics
+#define BIND_STATS_REPORT_INTERVAL 1000
+
+// Resources owned by one frame in flight
+struct FrameData
+{
+	uint64_t					 _ticket;						// Graphics timeline value of the last submission of the frame
+	VkSemaphore					 _presentCompleteSemaphore;		// Swapchain image acquired
+	VkSemaphore					 _drawingCompleteSemaphore;		// Drawing finished, the image can be presented
+	VkCommandPool				 _cmdPool;						// Transient pool of the primary command buffer
+	VkCommandBuffer				 _cmdDraw;						// Primary command buffer, re-recorded every frame
+	std::vector<VkCommandPool>	 _threadCmdPools;				// Transient pool per recording thread
+	std::vector<VkCommandBuffer> _threadCmdDraw;				// Secondary command buffer per recording thread
+	VkCommandPool				 _computeCmdPool;				// Transient pool of the async compute family, null without one
+	VkCommandBuffer				 _cmdCompute;					// Async compute passes of the render graph
+	VkSemaphore					 _computeCompleteSemaphore;		// Async compute passes finished, waited on by the graphics submission
+	VkSemaphore					 _graphicsDoneSemaphore;		// Graphics work finished, waited on by the compute submission of the next frame
+	bool						 _graphicsDoneSignaled;			// Signaled and not waited on yet
+	VkQueryPool					 _queryPool;					// Timestamps of the render graph passes
+	bool						 _timestampsWritten;			// The queries hold the timestamps of an executed frame
+};
+
 // The Vulkan Renderer is custom class, it is not a Vulkan specific class.
 // It works as a presentation manager.
 // It manages the presentation windows and drawing surfaces.
@@ -24,6 +60,13 @@ public:
 	void Update();
 	bool Render();
 
+	// Wait for the oldest frame in flight, reset its command pools, re-record
+	// it for the next swapchain image, then submit and present it
+	void RenderFrame();
+
+	// Force the command buffers of the static drawables to be re-recorded
+	void InvalidateStaticCommands() { _staticCommandsDirty = true; }
+
 	// Create an empty window
 	void CreatePresentationWindow(const int& windowWidth = 500, const int& windowHeight = 500);
 	void SetImageLayout(VkImage image, VkImageAspectFlags aspectMask, VkImageLayout oldImageLayout, VkImageLayout newImageLayout, const VkImageSubresourceRange& subresourceRange, const VkCommandBuffer& cmdBuf);
@@ -50,22 +93,45 @@ public:
 	void CreateRenderPass(bool includeDepth, bool clear = true);	// Render Pass creation
 	void CreateFrameBuffer(bool includeDepth);
 	void CreateShaders();
+
+	// Swap in the shaders whose source changed, the pipelines using them are compiled again
+	// in the background and the drawables keep the previous ones meanwhile
+	void ReloadShaders();
+	void DestroyRetiredShaderModules();
 	void CreatePipelineStateManagement();
 	void CreateDescriptors();
-	void CreateTextureLinear (const char* filename, TextureData *texture, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
-	void CreateTextureOptimal(const char* filename, TextureData *texture, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
+	// Upload an image already in memory, files without mips get a full chain
+	void CreateTextureFromImage(TextureImage& image, TextureData* texture, VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT, VkFormat format = VK_FORMAT_UNDEFINED);
+
+	// Pack the small images of the files into a single texture. The region of each file is
+	// returned in the order of the files, ATLAS_NO_REGION for the ones left out of the atlas.
+	// Returns false when no image is packed.
+	bool CreateTextureAtlas(const std::vector<std::string>& filenames, TextureData* texture, VulkanTextureAtlas* atlas, std::vector<uint32_t>* regions);
+
+	// Stream the texture of the file, its levels become resident as the drawables need them
+	void CreateTexture(const char* filename, TextureData* texture);
+
+	// Give the drawables without a texture the one of their file. The small images are packed
+	// into the atlas, the other files get a streamed texture of their own.
+	void CreateTextures();
+
+	// The optimal textures created between these calls are uploaded together
+	void BeginTextureUploads();
+	void EndTextureUploads();
 
 	void DestroyCommandBuffer();
+	void DestroyDrawCommandBuffers();
 	void DestroyCommandPool();
 	void DestroyDepthBuffer();
 	void DestroyDrawableVertexBuffer();
 	void DestroyRenderpass(); // Destroy the render pass object when no more required
 	void DestroyFramebuffers();
 	void DestroyPipeline();
-	void DestroyDrawableCommandBuffer();
-	void DestroyDrawableSynchronizationObjects();
+	void DestroySynchronizationObjects();
 	void DestroyDrawableUniformBuffer();
 	void DestroyTextureResource();
+	void DestroyBindlessSet();
+	void DestroyRenderGraph();
 public:
 #ifdef _WIN32
 #define APP_NAME_STR_LEN 80
@@ -90,16 +156,59 @@ public:
 	VkCommandBuffer		_cmdDepthImage;			// Command buffer for depth image layout
 	VkCommandPool		_cmdPool;				// Command pool
 	VkCommandBuffer		_cmdVertexBuffer;		// Command buffer for vertex buffer - Triangle geometry
-	VkCommandBuffer		_cmdTexture;				// Command buffer for creating the texture
 
 	VkRenderPass		       _renderPass;		// Render pass created object
 	std::vector<VkFramebuffer> _framebuffers;	// Number of frame buffer corresponding to each swap chain
-	std::vector<VkPipeline*>   _pipelineList;	// List of pipelines
 
 	int					_width, _height;
-	TextureData			_texture;
 
 private:
+	// Records the primary command buffer of the frame. Dynamic drawables are split
+	// in chunks which are recorded in parallel into secondary command buffers,
+	// static drawables reuse the secondary command buffers cached by RecordStaticCommands().
+	void RecordCommandBuffer(FrameData& frame, uint32_t currentImage);
+	// Declares the passes of the frame and the images they use
+	void BuildRenderGraph();
+	void RecordStaticCommands();
+	void CreateStaticCommandPools();
+	// True when a static drawable draws with one of the pipelines or textures
+	bool UsedByStaticDrawables(const std::vector<VkPipeline*>& pipelines, const std::vector<TextureData*>& textures) const;
+	// Write the matrices of the drawables into their uniform buffers, before the passes read them
+	void RecordUniformUpdates(VkCommandBuffer cmd);
+	void RecordSecondaryCommandBuffer(VkCommandBuffer cmdDraw, const std::vector<VulkanDrawable*>& drawables, uint32_t first, uint32_t last, VkFramebuffer framebuffer, VkCommandBufferUsageFlags usage, VulkanBindState& bindState);
+	// Accumulate the binds of the frame, the dynamic chunks and the executed static cache
+	void ReportBindStatistics(const std::vector<VulkanBindState>& chunkBindStates, uint32_t drawCount);
+	uint64_t GetStaticStateVersion() const;
+	void InitViewports(VkCommandBuffer cmd) const;
+	void InitScissors(VkCommandBuffer cmd) const;
+
+	VulkanThreadPool              _threadPool;				// Worker threads recording the secondary command buffers
+	FrameData                     _frames[MAX_FRAMES_IN_FLIGHT];
+	uint32_t                      _currentFrame;			// Index of the frame in flight being recorded
+	std::vector<VkCommandPool>    _staticCmdPools;			// Per recording thread pools owning the static command cache
+	std::vector<VkCommandBuffer>  _staticCmdDraw;			// Cached secondary command buffers of the static drawables
+	uint32_t                      _staticCmdCount;			// Number of recorded buffers at the front of _staticCmdDraw
+	uint32_t                      _staticDrawCount;			// Draws recorded in the static command cache
+	std::vector<VulkanBindState>  _staticBindStates;		// Binds recorded in each buffer of the static cache
+	bool                          _staticCommandsDirty;		// The cache must be re-recorded before the next frame
+	uint64_t                      _staticStateVersion;		// State version of the static drawables when they were recorded
+	std::vector<VulkanDrawable*>  _dynamicDrawables;		// Dynamic and visible drawables of the frame being recorded
+	VulkanBarrierBatcher          _barrierBatcher;			// Collects the image and buffer barriers recorded together
+	VulkanUploader                _uploader;				// Batches the texture uploads
+	VulkanTextureStreamer         _textureStreamer;			// Streams the texture levels in the background
+	VulkanTextureManager          _textureManager;			// Shares the textures between the drawables
+	VulkanTextureAtlas            _textureAtlas;			// Regions of the images packed into the atlas texture
+	TextureData*                  _atlasTexture;			// Shared by the drawables in the atlas, null without one
+	VulkanBindlessSet             _bindlessSet;				// Textures and transforms of all the draws, when the device supports it
+	VulkanRenderGraph             _renderGraph;				// Passes of the frame, their barriers and transient images
+	RenderGraphResource           _swapchainResource;		// Swapchain image acquired for the frame
+	VulkanDrawSorter              _drawSorter;				// Orders the drawables to minimize the state changes
+	std::vector<VulkanBindState>  _chunkBindStates;			// Bind state tracker of each recording thread
+	uint64_t                      _statsFrameCount;			// Frames accumulated in the bind statistics
+	uint64_t                      _statsDrawCount;
+	uint64_t                      _statsBindsIssued;
+	uint64_t                      _statsBindsSkipped;
+
 	VulkanApplication*           _application;
 	// The device object associated with this Presentation layer.
 	VulkanDevice*	             _deviceObj;
@@ -107,4 +216,7 @@ private:
 	std::vector<VulkanDrawable*> _drawableList;
 	VulkanShader 	             _shaderObj;
 	VulkanPipeline 	             _pipelineObj;
+	VulkanPipelineManager        _pipelineManager;	// Shares and compiles the pipelines of the drawables
+	VulkanShaderReloader         _shaderReloader;	// Compiles the shader sources changed while running
+	std::vector<VkShaderModule>  _retiredShaderModules;	// Replaced by a reload, destroyed once no compile reads them
 };
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include "Headers.h"
+
+// Hands out one shared VkSampler per distinct sampler state, instead of one sampler per
+// texture, so large scenes stay far below maxSamplerAllocationCount. The samplers live as
+// long as the device, which lets the descriptor set layouts use them as immutable samplers.
+class VulkanSamplerCache
+{
+public:
+	VulkanSamplerCache();
+	~VulkanSamplerCache();
+
+	void Initialize(VkDevice device, bool anisotropySupported);
+
+	// Destroy all the samplers, the GPU must be idle
+	void Destroy();
+
+	// Return the sampler of the state, creating it on the first request. Chained
+	// structures are not supported, the pNext of the create info must be null.
+	VkSampler GetSampler(const VkSamplerCreateInfo& samplerCI);
+
+	// Trilinear, clamped to the edges, anisotropic when supported. The levels the
+	// sampler reaches are limited by the view of each texture, not by the sampler.
+	VkSampler GetDefaultSampler();
+
+	uint32_t GetSamplerCount() const { return static_cast<uint32_t>(_samplers.size()); }
+
+private:
+	// Every field of the create info, the floats by their bits
+	typedef std::array<uint32_t, 16> SamplerKey;
+
+	struct SamplerKeyHash
+	{
+		size_t operator()(const SamplerKey& key) const;
+	};
+
+	static SamplerKey BuildKey(const VkSamplerCreateInfo& samplerCI);
+	VkSamplerCreateInfo GetDefaultSamplerInfo() const;
+
+	VkDevice												_device;
+	bool													_anisotropySupported;
+	std::unordered_map<SamplerKey, VkSampler, SamplerKeyHash>	_samplers;
+	std::mutex												_mutex;		// The load threads may request samplers too
+};
@@ -1,5 +1,33 @@
 #pragma once
 #include "Headers.h"
+#include "VulkanShaderReflection.h"
+
+// Specialization constants a variant can set, their IDs are the indices of the values in the key
+#define SHADER_MAX_SPECIALIZATION_CONSTANTS	8
+
+// constant_id of the specialization constants the shaders declare for the material variations.
+// They are folded when the pipelines are built, the branches on them cost nothing at run time.
+enum ShaderConstantId
+{
+	SHADER_CONSTANT_TEXTURED		= 0,	// bool, sample the texture or use the vertex color
+	SHADER_CONSTANT_ALPHA_TEST		= 1,	// bool, discard the fragments under the cutoff
+	SHADER_CONSTANT_ALPHA_CUTOFF	= 2,	// float
+	SHADER_CONSTANT_LIGHT_COUNT		= 3,	// uint
+};
+
+// Values of the specialization constants of a variant. The constants not set keep the default
+// of the shaders. The keys are part of the pipeline states, hashed and compared as raw bytes,
+// so they are zero initialized, e.g. ShaderVariantKey key = {}.
+struct ShaderVariantKey
+{
+	void Set(ShaderConstantId id, uint32_t value)	{ _mask |= 1u << id; _values[id] = value; }
+	void SetFloat(ShaderConstantId id, float value)	{ uint32_t bits; memcpy(&bits, &value, sizeof(bits)); Set(id, bits); }
+
+	bool operator==(const ShaderVariantKey& other) const { return memcmp(this, &other, sizeof(ShaderVariantKey)) == 0; }
+
+	uint32_t	_mask;										// Bit i set when the constant of ID i is
+	uint32_t	_values[SHADER_MAX_SPECIALIZATION_CONSTANTS];	// Booleans as a VkBool32, floats by their bits
+};
 
 // Shader class managing the shader conversion, compilation, linking
 class VulkanShader
@@ -14,27 +42,57 @@ public:
 	// Use .spv and build shader module
 	void BuildShaderModuleWithSpv(uint32_t *vertShaderText, size_t vertexSPVSize, uint32_t *fragShaderText, size_t fragmentSPVSize);
 
+	// Create the module of a stage from new SPIR-V, e.g. when the shader is reloaded. The
+	// previous module is returned, the caller destroys it once no compile uses it anymore.
+	// The SPIR-V is refused when its interface does not fit the layouts built from the current one,
+	// or when it declares other specialization constants than the current one.
+	bool ReplaceShaderModule(uint32_t stageIndex, const uint32_t* spirv, size_t spirvSize, VkShaderModule* previous);
+
+	// Add a variant of the shaders, returns its index. A key already registered gets the
+	// index it was given then. Variant 0 is the shaders with the defaults of their constants.
+	uint32_t RegisterVariant(const ShaderVariantKey& key);
+	const ShaderVariantKey& GetVariantKey(uint32_t variant) const { return _variants[variant]; }
+
+	// Constants of the variant the SPIR-V of the stage declares. The other ones would only
+	// make pipelines that compile to the same code, they are left out so those are shared.
+	void GetSpecialization(uint32_t variant, uint32_t stageIndex, ShaderVariantKey* key) const;
+
 	// Kill the shader when not required
 	void DestroyShaders();
 
 #ifdef AUTO_COMPILE_GLSL_TO_SPV
-	// Convert GLSL shader to SPIR-V shader
-	bool GLSLtoSPV(const VkShaderStageFlagBits shaderType, const char *pshader, std::vector<unsigned int> &spirv);
+	// Initialize glslang on the first call, it is done once per process. The compiles
+	// may then run on any thread.
+	static void InitializeCompiler();
+	static void FinalizeCompiler();
+
+	// Convert GLSL shader to SPIR-V shader, the preamble is inserted before the source, e.g. for the defines
+	static bool GLSLtoSPV(const VkShaderStageFlagBits shaderType, const char *pshader, std::vector<unsigned int> &spirv, const char* preamble = nullptr);
 
 	// Entry point to build the shaders
 	void buildShader(const char *vertShaderText, const char *fragShaderText);
 
 	// Type of shader language. This could be - EShLangVertex,Tessellation Control, 
 	// Tessellation Evaluation, Geometry, Fragment and Compute
-	EShLanguage getLanguage(const VkShaderStageFlagBits shader_type);
+	static EShLanguage getLanguage(const VkShaderStageFlagBits shader_type);
 
 	// Initialize the TBuitInResource
-	void initializeResources(TBuiltInResource &Resources);
+	static void initializeResources(TBuiltInResource &Resources);
 #endif
 
 	// Vk structure storing vertex & fragment shader information
 	VkPipelineShaderStageCreateInfo _shaderStages[2];
 
+	// Interface of both stages together, the layouts and vertex attributes are built from it
+	VulkanShaderReflection _reflection;
+
 private:
+	// Reflect the SPIR-V of a stage and merge the interfaces of the stages again
+	void ReflectStage(uint32_t stageIndex, const uint32_t* spirv, size_t spirvSize);
+
 	VkDevice* _device;
+	VulkanShaderReflection _stageReflections[2];
+
+	// The variants share the modules, only their pipelines differ. A few per shader, looked up linearly.
+	std::vector<ShaderVariantKey> _variants;
 };
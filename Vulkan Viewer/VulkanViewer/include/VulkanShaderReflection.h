@@ -0,0 +1,67 @@
+#pragma once
+#include "Headers.h"
+
+// Descriptor binding used by a shader
+struct ShaderBinding
+{
+	uint32_t			_set;
+	uint32_t			_binding;
+	VkDescriptorType	_type;
+	uint32_t			_count;			// Zero for a runtime sized array
+	VkShaderStageFlags	_stages;
+};
+
+// Vertex attribute read by the vertex shader
+struct ShaderVertexInput
+{
+	uint32_t			_location;
+	VkFormat			_format;
+	uint32_t			_size;			// Bytes taken in a packed vertex
+};
+
+struct ShaderSpecializationConstant
+{
+	uint32_t			_constantId;
+	uint32_t			_size;			// Of the value in VkSpecializationInfo, booleans take a VkBool32
+};
+
+// Resource interface of the shaders, read from their SPIR-V. The layouts, descriptor pools
+// and vertex attributes are built from it, so they always match what the shaders declare.
+class VulkanShaderReflection
+{
+public:
+	// Read the interface of one stage, returns false when the SPIR-V is malformed
+	bool Reflect(const uint32_t* spirv, size_t spirvSize, VkShaderStageFlagBits stage);
+
+	// Add the interface of another stage, the bindings and push constant ranges declared
+	// by both are merged and used by the stages of both
+	void Merge(const VulkanShaderReflection& other);
+
+	void Clear();
+
+	// Same bindings, push constants and vertex inputs, the pipeline layouts and vertex
+	// attributes built from one fit the other
+	bool IsCompatible(const VulkanShaderReflection& other) const;
+
+	// Number of descriptor sets, up to the highest set used
+	uint32_t GetSetCount() const;
+
+	// First binding of the type, or null when the shaders declare none
+	const ShaderBinding* FindBinding(VkDescriptorType type) const;
+
+	// Bindings of a set, ready for VkDescriptorSetLayoutCreateInfo. When given, the sampler
+	// is baked as immutable in the combined image samplers.
+	void GetSetLayoutBindings(uint32_t set, const VkSampler* immutableSampler, std::vector<VkDescriptorSetLayoutBinding>* bindings) const;
+
+	// Descriptors of each type needed by one descriptor set of every set of the shaders
+	void GetPoolSizes(std::vector<VkDescriptorPoolSize>* poolSizes) const;
+
+	// Attributes of the vertex inputs, packed in the order of their locations. Returns the
+	// size of the packed vertex.
+	uint32_t GetVertexAttributes(uint32_t binding, std::vector<VkVertexInputAttributeDescription>* attributes) const;
+
+	std::vector<ShaderBinding>					_bindings;					// Sorted by set, then binding
+	std::vector<VkPushConstantRange>			_pushConstantRanges;
+	std::vector<ShaderVertexInput>				_vertexInputs;				// Sorted by location
+	std::vector<ShaderSpecializationConstant>	_specializationConstants;	// Sorted by constant ID
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanThreadPool.h"
+
+// Directory of the SPIR-V compiled by the reloader. The files are named after the hash of
+// their source and defines, so going back to a previous version of a shader is not compiled again.
+#define SHADER_CACHE_DIRECTORY		"ShaderCache"
+
+// Milliseconds between two checks of the modification times of the shader sources
+#define SHADER_RELOAD_POLL_INTERVAL	500
+
+// SPIR-V of a reloaded shader, ready to replace the module of its stage
+struct ShaderReload
+{
+	uint32_t				_stageIndex;	// Index in the stages of VulkanShader
+	std::string				_sourceFile;
+	std::vector<uint32_t>	_spirv;
+};
+
+// Watches the GLSL sources of the shaders in use and compiles them again on a worker thread
+// when they change, so they can be swapped in while the application runs. The compiles use
+// glslang when the application is built with it, the glslangValidator of the SDK otherwise.
+class VulkanShaderReloader
+{
+public:
+	VulkanShaderReloader();
+	~VulkanShaderReloader();
+
+	// Watch the source of a stage, compiled with the defines. The SPIR-V in use is assumed
+	// up to date with the source as it is now, only the later changes are compiled.
+	void Watch(uint32_t stageIndex, VkShaderStageFlagBits stage, const char* sourceFile, const std::vector<std::string>& defines);
+
+	// Stop watching, the compiles in flight are waited for
+	void Clear();
+
+	// Queue the compiles of the sources changed since the last check, cheap enough to call every frame
+	void Update();
+
+	// Take the next shader compiled since the last call, returns false when there is none
+	bool GetReload(ShaderReload* reload);
+
+private:
+	struct WatchedShader
+	{
+		uint32_t					_stageIndex;
+		VkShaderStageFlagBits		_stage;
+		std::string					_sourceFile;
+		std::vector<std::string>	_defines;
+		int64_t						_modificationTime;
+		uint64_t					_hash;			// Of the source and defines last compiled
+	};
+
+	static bool GetModificationTime(const std::string& filename, int64_t* time);
+	static bool ReadSource(const std::string& filename, std::string* source);
+	static uint64_t HashSource(const WatchedShader& shader, const std::string& source);
+	static std::string GetCacheFilename(uint64_t hash);
+	static bool LoadSpirv(const std::string& filename, std::vector<uint32_t>* spirv);
+
+	// Runs on the worker thread, the compiled SPIR-V is stored in the cache
+	static bool Compile(const WatchedShader& shader, const std::string& source, uint64_t hash, std::vector<uint32_t>* spirv);
+
+	void WaitIdle();
+
+	std::vector<WatchedShader>				_shaders;			// Only used by the calling thread
+	std::chrono::steady_clock::time_point	_lastPoll;
+	std::mutex								_mutex;
+	std::condition_variable					_compileDone;
+	std::deque<ShaderReload>				_reloads;			// Compiled and not taken yet, guarded by the mutex
+	uint32_t								_pendingCount;		// Compiles queued or running, guarded by the mutex
+	VulkanThreadPool						_compileThread;		// Last, so the worker is joined first
+};
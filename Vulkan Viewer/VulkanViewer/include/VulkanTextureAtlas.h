@@ -0,0 +1,66 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanTextureLoader.h"
+
+class VulkanThreadPool;
+
+// Largest atlas the packer tries before giving up
+#define ATLAS_MAX_SIZE 4096
+
+// Largest side of the images packed into the atlas. The larger ones keep a texture of
+// their own, streamed with the mips of their file.
+#define ATLAS_MAX_IMAGE_SIZE 256
+
+// Mip levels of an atlas. The images are placed on multiples of 2^(ATLAS_MIP_LEVELS - 1)
+// texels, so every level of the atlas starts each image on a whole texel.
+#define ATLAS_MIP_LEVELS 4
+
+// Texels of the image edges replicated around each image. At the last mip level the
+// gutter is still one texel wide, so the filtering never reads a neighbouring image.
+#define ATLAS_GUTTER 8
+
+// Region index of the images which are not in an atlas
+#define ATLAS_NO_REGION UINT32_MAX
+
+// Where an image of the atlas lives, in normalized texture coordinates
+struct AtlasRegion
+{
+	glm::vec2	_uvOffset;
+	glm::vec2	_uvScale;
+};
+
+// Packs many small images into a single texture at import time, so the draws using them
+// share one image, one sampler and one descriptor write instead of one per image. The
+// rectangles are placed by stb_rect_pack, and the texture coordinates of the meshes are
+// remapped to the region of their image.
+class VulkanTextureAtlas
+{
+public:
+	VulkanTextureAtlas();
+	~VulkanTextureAtlas();
+
+	// Queue the base level of the image. All the images must share one 8 bit format, the
+	// first image added picks it, and be at most ATLAS_MAX_IMAGE_SIZE large. Returns false
+	// when the image cannot join the atlas.
+	bool Add(const TextureImage& image, uint32_t* index);
+
+	// Place the queued images in the smallest square atlas they fit in, then build its
+	// mip chain. Returns false when they do not fit in ATLAS_MAX_SIZE.
+	bool Pack(VulkanThreadPool& threadPool);
+
+	const TextureImage& GetImage() const { return _atlas; }
+	const AtlasRegion& GetRegion(uint32_t index) const { return _regions[index]; }
+	uint32_t GetImageCount() const { return static_cast<uint32_t>(_regions.size()); }
+
+	// Remap the texture coordinates of the vertices from the image to its region. The
+	// stride and offset locate the two floats of the coordinates in each vertex, in bytes.
+	void RewriteUVs(uint32_t index, void* vertices, uint32_t vertexCount, uint32_t stride, uint32_t uvOffset) const;
+
+private:
+	// Copy the image into its rectangle and replicate its edges into the gutter
+	void Blit(const TextureImage& image, uint32_t x, uint32_t y, uint32_t texelSize);
+
+	std::vector<TextureImage>	_images;		// Base level of the queued images
+	std::vector<AtlasRegion>	_regions;
+	TextureImage				_atlas;
+};
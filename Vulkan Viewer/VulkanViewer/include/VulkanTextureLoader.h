@@ -0,0 +1,77 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanMappedFile.h"
+
+class VulkanThreadPool;
+
+// CPU side of a 2D texture. The levels of KTX and KTX2 files stay in the mapped file and
+// _levelOffsets locate them in it. Otherwise the levels are stored one after the other in
+// _data, which is also the case once they have been decoded or generated on the CPU.
+struct TextureImage
+{
+	VkFormat							_format;
+	uint32_t							_width;
+	uint32_t							_height;
+	uint32_t							_mipLevels;
+	std::shared_ptr<VulkanMappedFile>	_file;
+	std::vector<uint8_t>				_data;
+	std::vector<VkDeviceSize>			_levelOffsets;
+	std::vector<VkDeviceSize>			_levelSizes;
+
+	const uint8_t* GetLevelData(uint32_t level) const { return (_file ? _file->GetData() : _data.data()) + _levelOffsets[level]; }
+
+	// Unmap the file and free the levels, the description of the image is kept
+	void ReleaseData() { _file.reset(); std::vector<uint8_t>().swap(_data); }
+};
+
+// Loads KTX and DDS files through gli and KTX2 files directly. Block-compressed payloads
+// (BC1-BC7, ETC2/EAC, ASTC) are kept compressed, so they take 4 to 8 times less memory and
+// bandwidth than RGBA8. When the device cannot sample the format of a file, the blocks are
+// decoded on the worker threads into an uncompressed format the device supports.
+class VulkanTextureLoader
+{
+public:
+	// Load the file, the format is VK_FORMAT_UNDEFINED when it has no Vulkan equivalent.
+	// Only the header and the level index of KTX and KTX2 files are read, their levels are
+	// copied from the mapped file when staged. DDS files and the KTX formats without a
+	// Vulkan equivalent are parsed by gli into _data.
+	static bool Load(const char* filename, TextureImage* image);
+	static bool LoadKTX(const std::shared_ptr<VulkanMappedFile>& file, TextureImage* image);
+	static bool LoadKTX2(const std::shared_ptr<VulkanMappedFile>& file, TextureImage* image);
+
+	static VkFormat GetVulkanFormat(gli::format format);
+
+	// True when an optimally tiled image of the format can be sampled
+	static bool IsFormatSampleable(VkPhysicalDevice gpu, VkFormat format);
+
+	// Keep the format of the image when the device samples it, otherwise decode it into the
+	// closest sampleable format. Returns false when the image cannot be used on this device.
+	static bool SelectDeviceFormat(VkPhysicalDevice gpu, TextureImage* image, VulkanThreadPool& threadPool);
+
+	// Texel block dimensions and size in bytes, 1x1 for the uncompressed formats
+	static void GetFormatBlockInfo(VkFormat format, uint32_t* blockWidth, uint32_t* blockHeight, uint32_t* blockSize);
+
+	// Size of the staging memory holding the levels [firstLevel, endLevel) and the offset of
+	// each of them in it, aligned for the buffer to image copies of the format
+	static VkDeviceSize GetStagingLayout(const TextureImage& image, uint32_t firstLevel, uint32_t endLevel, std::vector<VkDeviceSize>* offsets);
+
+	// Copy the levels straight from the mapped file or _data into the mapped staging memory
+	static void CopyLevels(const TextureImage& image, uint32_t firstLevel, uint32_t endLevel, const std::vector<VkDeviceSize>& offsets, uint8_t* staging);
+
+	// Number of levels of a full mip chain, down to 1x1
+	static uint32_t GetFullMipLevelCount(uint32_t width, uint32_t height);
+
+	// Uncompressed formats with 8 bit channels
+	static bool Is8BitFormat(VkFormat format, bool* isSRGB);
+
+	// CPU fallback for the formats the device cannot blit. Builds the mip chain of a single
+	// level image with 8 bit channels, averaging sRGB texels in linear space. A level count
+	// of 0 builds the full chain. Returns false when the format is not supported.
+	static bool GenerateMipmaps(TextureImage* image, VulkanThreadPool& threadPool, uint32_t levelCount = 0);
+
+private:
+	// Uncompressed format the blocks of the format are decoded into, VK_FORMAT_UNDEFINED if none
+	static VkFormat GetDecodedFormat(VkFormat format);
+	static void Decode(TextureImage* image, VkFormat decodedFormat, VulkanThreadPool& threadPool);
+	static void DecodeBlock(VkFormat format, const uint8_t* block, uint8_t texels[16][4]);
+};
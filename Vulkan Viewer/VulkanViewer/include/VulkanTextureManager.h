@@ -0,0 +1,52 @@
+#pragma once
+#include "Headers.h"
+#include "Wrappers.h"
+
+class VulkanDevice;
+
+// Shares the textures between the drawables. A texture is looked up by its path, then by
+// the hash of the file contents, so identical images stored under different paths are only
+// loaded once. Every Acquire() takes a reference, and the texture is destroyed through the
+// graphics timeline once its last reference is released and the GPU is done with it.
+class VulkanTextureManager
+{
+public:
+	// Creates the image, view and sampler of a texture from its file
+	typedef std::function<void(const char* filename, TextureData* texture)> CreateFunc;
+
+	// Called before a texture is destroyed, to let go of the work still referencing it
+	typedef std::function<void(TextureData* texture)> ReleaseFunc;
+
+	VulkanTextureManager();
+	~VulkanTextureManager();
+
+	void Initialize(VulkanDevice* deviceObj, const CreateFunc& createFunc, const ReleaseFunc& releaseFunc);
+
+	// Destroy all the textures at once, the GPU must be idle
+	void Destroy();
+
+	// Return the texture of the file, loading it on the first request
+	TextureData* Acquire(const char* filename);
+	void Release(TextureData* texture);
+
+	uint32_t GetTextureCount() const { return static_cast<uint32_t>(_textures.size()); }
+
+private:
+	struct TextureEntry
+	{
+		TextureData*				_texture;
+		uint64_t					_hash;			// FNV-1a of the file contents, 0 when unreadable
+		uint32_t					_refCount;
+		std::vector<std::string>	_paths;			// Every path resolved to this texture
+	};
+
+	static bool HashFile(const char* filename, uint64_t* hash);
+	void DestroyTexture(TextureData* texture);
+
+	VulkanDevice*									_deviceObj;
+	CreateFunc										_createFunc;
+	ReleaseFunc										_releaseFunc;
+	std::unordered_map<std::string, TextureEntry*>	_pathLookup;
+	std::unordered_map<uint64_t, TextureEntry*>		_hashLookup;
+	std::unordered_map<TextureData*, TextureEntry*>	_textures;		// Owns the entries
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include "Headers.h"
+#include "Wrappers.h"
+#include "VulkanThreadPool.h"
+#include "VulkanTextureLoader.h"
+
+class VulkanDevice;
+class VulkanDrawable;
+class VulkanUploader;
+
+// Background threads reading and staging the texture files
+#define STREAMING_LOAD_THREAD_COUNT 2
+
+// The levels at most this large are uploaded together as soon as the file is loaded
+#define STREAMING_TAIL_SIZE 64
+
+// Textures whose next level may be staged or uploaded at the same time
+#define STREAMING_MAX_UPLOADS_IN_FLIGHT 2
+
+// Streams the mip levels of textures in, coarsest first. A streamed texture is usable
+// immediately through a 1x1 placeholder. The file is read and staged on the load
+// threads, the mip tail is uploaded first, then the finer levels one by one in the order
+// of the texel density the drawables need on screen. The uploads go through the
+// uploader, so they run on the transfer queue when the device has one. The view of the
+// texture only exposes the resident levels, its base level follows the streamed ones.
+// The files without mips are uploaded whole, the uploader blits their chain on the GPU.
+class VulkanTextureStreamer
+{
+public:
+	VulkanTextureStreamer();
+	~VulkanTextureStreamer();
+
+	void Initialize(VulkanDevice* deviceObj, VulkanUploader* uploader, VulkanThreadPool* threadPool);
+
+	// Wait for the load threads and release the textures which are not resident yet.
+	// The images owned by the TextureData are left to their owner.
+	void Destroy();
+
+	// Create the placeholder of the texture and start loading the file in the background
+	void StreamTexture(const char* filename, TextureData* texture);
+
+	// Stop streaming the texture before it is destroyed. The image it has not swapped in
+	// yet is destroyed once the submissions already made are done with it.
+	void Release(TextureData* texture);
+
+	// Called once per frame. Update the levels the drawables need, submit the staged
+	// levels, and start staging the next level of the textures needing it most.
+	void Update(const std::vector<VulkanDrawable*>& drawables, uint32_t viewportHeight);
+
+	// Some textures have new resident levels which their view does not expose yet
+	bool HasResidencyChanges() const { return _residencyChanged; }
+
+	// Point the views of the textures at their resident levels and return the textures changed,
+	// the descriptors using them must be updated after. The previous views and placeholders are
+	// destroyed once the frames already submitted are done with them.
+	void ApplyResidencyChanges(std::vector<TextureData*>* changedTextures);
+
+private:
+	enum StreamState
+	{
+		STREAM_LOADING,		// The load thread reads the file and stages the mip tail
+		STREAM_STAGING,		// The load thread copies the next level into a staging buffer
+		STREAM_STAGED,		// The staging buffer is ready to be uploaded
+		STREAM_UPLOADING,	// The copy has been submitted
+		STREAM_IDLE,		// Nothing in flight
+		STREAM_FAILED
+	};
+
+	struct StreamedTexture
+	{
+		std::string		_filename;
+		TextureData*	_texture;
+		TextureImage	_source;			// Levels of the file, released once all of them are resident
+		uint32_t		_levelCount;		// Levels of the image, more than the file has when they are blitted
+		bool			_generateMips;		// The levels after the first are blitted by the uploader
+		VkImage			_image;				// Image being streamed, swapped into the texture with its tail
+		VkDeviceMemory	_memory;
+		StreamState		_state;
+		uint32_t		_residentLevel;		// First level of the image whose data is on the GPU
+		uint32_t		_visibleLevel;		// First level exposed by the view of the texture
+		uint32_t		_requestedLevel;	// Finest level the drawables need
+		uint32_t		_uploadLevel;		// Levels [_uploadLevel, _uploadEnd) staged or in flight
+		uint32_t		_uploadEnd;
+		uint64_t		_uploadTicket;
+		VkBuffer		_stagingBuffer;
+		VkDeviceMemory	_stagingMemory;
+		std::vector<VkDeviceSize>	_stagingOffsets;	// Offset of each staged level in the staging buffer
+	};
+
+	// Run on the load threads
+	void LoadTexture(StreamedTexture* stream);
+	void StageLevels(StreamedTexture* stream, uint32_t firstLevel, uint32_t endLevel);
+	void FinishJob(StreamedTexture* stream, StreamState state);
+
+	// Returns the mapped memory of the buffer, the caller unmaps it once filled
+	uint8_t* CreateStagingBuffer(VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory);
+	void CreateImage(StreamedTexture* stream);
+	void CreatePlaceholder(TextureData* texture);
+
+	// Level of the texture whose texel density matches the screen size of the drawables
+	void UpdateRequestedLevels(const std::vector<VulkanDrawable*>& drawables, uint32_t viewportHeight);
+
+	VulkanDevice*					_deviceObj;
+	VulkanUploader*					_uploader;
+	VulkanThreadPool*				_threadPool;		// Decodes the blocks and generates the CPU mips
+	VulkanThreadPool				_loadThreads;
+	std::deque<StreamedTexture>		_streams;
+	bool							_residencyChanged;
+
+	// Guards the state of the streams and the job counter, the load threads update them
+	std::mutex						_mutex;
+	std::condition_variable			_jobsDone;
+	uint32_t						_jobsInFlight;
+};
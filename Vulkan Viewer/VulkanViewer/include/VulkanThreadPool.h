@@ -0,0 +1,32 @@
+#pragma once
+#include "Headers.h"
+
+// Fixed size pool of worker threads. It is used to spread CPU heavy
+// work, like recording the secondary command buffers, across cores.
+class VulkanThreadPool
+{
+public:
+	// Creates the worker threads, zero picks one worker per hardware thread
+	explicit VulkanThreadPool(uint32_t threadCount = 0);
+	~VulkanThreadPool();
+
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(_workers.size()); }
+
+	// Queue a job, it will be picked up by the first idle worker
+	void Enqueue(const std::function<void()>& job);
+
+	// Split the range [0, count) in at most GetThreadCount() contiguous chunks
+	// and run them in parallel, the call returns once every chunk is done.
+	// The chunk index is unique among the chunks of one call, which makes it
+	// safe to use for selecting per-thread resources like command pools.
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t chunkIndex, uint32_t begin, uint32_t end)>& func);
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread>          _workers;
+	std::deque<std::function<void()>> _jobs;
+	std::mutex                        _mutex;
+	std::condition_variable           _jobAvailable;
+	bool                              _stop;
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include "Headers.h"
+
+class VulkanDevice;
+
+// Nanoseconds a fence is waited on before checking again whether the ticket completed,
+// the fence may have been recycled by another thread in the meantime
+#define TIMELINE_FENCE_WAIT_TIMEOUT	1000000
+
+// Monotonic submission counter of one queue. Every submission returns a ticket, and the
+// CPU can poll or wait for a ticket instead of creating a fence for each submission.
+// Backed by a timeline semaphore when VK_KHR_timeline_semaphore is enabled, otherwise
+// by a ring of recycled fences, one per submission still in flight.
+class VulkanTimeline
+{
+public:
+	VulkanTimeline();
+	~VulkanTimeline();
+
+	void Initialize(VulkanDevice* deviceObj, VkQueue queue);
+	void Destroy();
+	bool IsInitialized() const { return _queue != VK_NULL_HANDLE; }
+
+	// Submit the work and return its ticket. The semaphores and command
+	// buffers of the submit info are used as they are, the timeline
+	// signal is added to them.
+	uint64_t Submit(const VkSubmitInfo& submitInfo);
+
+	// Submit the command buffer without any semaphore
+	uint64_t Submit(VkCommandBuffer cmd);
+
+	// Poll or block until the GPU has executed the submission of the ticket
+	bool IsComplete(uint64_t ticket);
+	void Wait(uint64_t ticket);
+	void WaitIdle() { Wait(_lastSubmitted); }
+
+	uint64_t GetLastSubmitted() const { return _lastSubmitted; }
+	uint64_t GetCompletedValue();
+
+	// Run the function once the ticket has completed, typically to destroy
+	// the resources which were still in use by that submission
+	void DeferUntil(uint64_t ticket, const std::function<void()>& func);
+
+	// Run the deferred functions whose ticket has completed
+	void CollectGarbage();
+
+	VkQueue GetQueue() const { return _queue; }
+
+	// Timeline semaphore of the queue, VK_NULL_HANDLE in the fence fallback
+	VkSemaphore GetSemaphore() const { return _semaphore; }
+
+private:
+	void PollFences();
+
+	VulkanDevice*	_deviceObj;
+	VkQueue			_queue;
+	VkSemaphore		_semaphore;			// Timeline semaphore, the fence ring is used when null
+	std::atomic<uint64_t>	_lastSubmitted;	// Incremented under the lock, read without it
+	uint64_t		_lastCompleted;		// Cached completed value
+
+	std::deque<std::pair<uint64_t, VkFence>>			_fencesInFlight;
+	std::vector<VkFence>								_freeFences;
+	std::deque<std::pair<uint64_t, std::function<void()>>>	_deferred;
+
+	// Submissions may come from the loading threads
+	std::mutex		_mutex;
+
+#ifdef VK_KHR_timeline_semaphore
+	PFN_vkGetSemaphoreCounterValueKHR	fpGetSemaphoreCounterValueKHR;
+	PFN_vkWaitSemaphoresKHR				fpWaitSemaphoresKHR;
+#endif
+};
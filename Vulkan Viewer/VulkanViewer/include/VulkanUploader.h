@@ -0,0 +1,69 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanBarrierBatcher.h"
+
+class VulkanDevice;
+
+// Batches the staging buffer to image copies of many textures in one command buffer.
+// All the images are moved to the transfer layout with one barrier call, copied,
+// then moved to their final layout with a second barrier call. The staging buffers
+// are destroyed through the graphics timeline once the copies have completed.
+// When the device has a transfer only family the copies run on its queue, and the
+// images are handed over to the graphics family with ownership transfer barriers.
+// Images whose copies only fill the first mip level get the rest of their chain
+// blitted on the graphics queue, one barrier call per level for all the images.
+class VulkanUploader
+{
+public:
+	VulkanUploader();
+
+	// The command pool belongs to the graphics family, the transfer pool is created here
+	void Initialize(VulkanDevice* deviceObj, VkCommandPool cmdPool, VulkanBarrierBatcher* barrierBatcher);
+	void Destroy();
+
+	// Start collecting the uploads
+	void Begin();
+	bool IsRecording() const { return _isRecording; }
+
+	// Queue the copy of the staging buffer into the image. The staging buffer and its memory
+	// are owned by the uploader from now on, and destroyed once the upload has completed.
+	// When the range has more levels than the copies fill, the copies must only target the
+	// first level, and the others are generated from it. The image needs the transfer source
+	// usage and a format with the blit and linear filter features in that case.
+	void UploadImage(VkImage image, const VkImageSubresourceRange& subresourceRange,
+		             VkBuffer stagingBuffer, VkDeviceMemory stagingMemory,
+		             const std::vector<VkBufferImageCopy>& copies, VkImageLayout finalLayout);
+
+	// Record and submit all the queued uploads without waiting for them. Returns the
+	// graphics timeline ticket of the submission, 0 when there was nothing to upload.
+	uint64_t End();
+
+private:
+	struct PendingUpload
+	{
+		VkImage							_image;
+		VkImageSubresourceRange			_subresourceRange;
+		VkBuffer						_stagingBuffer;
+		VkDeviceMemory					_stagingMemory;
+		std::vector<VkBufferImageCopy>	_copies;
+		VkImageLayout					_finalLayout;
+		VkExtent3D						_extent;			// Extent of the first level
+		bool							_generateMips;
+	};
+
+	void RecordCopies(VkCommandBuffer cmd);
+	void RecordMipGeneration(VkCommandBuffer cmd);
+
+	// Move the image from the layouts left by the copies or the blits to its final layout
+	void AddFinalTransition(const PendingUpload& upload);
+
+	uint64_t SubmitOnGraphicsQueue();
+	uint64_t SubmitOnTransferQueue();
+
+	VulkanDevice*				_deviceObj;
+	VkCommandPool				_cmdPool;
+	VkCommandPool				_transferCmdPool;		// Pool of the transfer family, null without a dedicated queue
+	VulkanBarrierBatcher*		_barrierBatcher;
+	std::vector<PendingUpload>	_uploads;
+	bool						_isRecording;
+};
@@ -52,9 +52,27 @@ struct TextureData{
 	VkDescriptorImageInfo	descsImgInfo;
 };
 
+/***************HASH WRAPPERS***************/
+#define HASH_SEED	14695981039346656037ull
+
+// 64 bit FNV-1a of the bytes. Passing the hash of the previous bytes as the seed
+// combines several ranges, hashing them one after the other gives the same value.
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HASH_SEED)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
 /***************PPM PARSER CLASS***************/
 #include "Headers.h"
+#include "VulkanMappedFile.h"
 
+// Binary PPM (P6) images with 8 bit channels. The file is mapped, only its header is
+// parsed up front, and the rows are expanded to RGBA straight into the destination.
 class PpmParser
 {
 public:
@@ -72,5 +90,5 @@ private:
 	int32_t imageHeight;
 	int32_t dataPosition;
 	std::string ppmFile;
-	gli::texture2D* tex2D;
+	VulkanMappedFile file;
 };
\ No newline at end of file
@@ -78,6 +78,9 @@ VkResult VulkanApplication::HandShakeWithDevice(VkPhysicalDevice* gpu, std::vect
 	// Retrive the queue which support graphics pipeline.
 	_deviceObj->GetGraphicsQueueHandle();
 
+	// Look for the queue families running the uploads and the compute work asynchronously
+	_deviceObj->GetTransferAndComputeQueueHandles();
+
 	// Create Logical Device, ensure that this device is connecte to graphics queue
 	return _deviceObj->CreateDevice(layers, extensions);
 }
@@ -147,10 +150,10 @@ void VulkanApplication::Resize()
 	_isResizing = true;
 
 	vkDeviceWaitIdle(_deviceObj->_device);
+	_rendererObj->DestroyRenderGraph();
 	_rendererObj->DestroyFramebuffers();
 	_rendererObj->DestroyCommandPool();
 	_rendererObj->DestroyPipeline();
-	_rendererObj->GetPipelineObject()->DestroyPipelineCache();
 	for (auto drawableObj : *_rendererObj->GetDrawingItems())
 	{
 		drawableObj->DestroyDescriptor();
@@ -159,7 +162,6 @@ void VulkanApplication::Resize()
 	_rendererObj->GetSwapChain()->DestroySwapChain();
 	_rendererObj->DestroyDrawableVertexBuffer();
 	_rendererObj->DestroyDrawableUniformBuffer();
-	_rendererObj->DestroyTextureResource();
 	_rendererObj->DestroyDepthBuffer();
 	_rendererObj->Initialize();
 	Prepare();
@@ -169,28 +171,33 @@ void VulkanApplication::Resize()
 
 void VulkanApplication::DeInitialize()
 {
+	// Let the frames in flight finish before destroying their resources
+	vkDeviceWaitIdle(_deviceObj->_device);
+
 	// Destroy all the pipeline objects
 	_rendererObj->DestroyPipeline();
 
-	// Destroy the associate pipeline cache
+	// Save and destroy the associate pipeline cache, it is kept across the resizes
 	_rendererObj->GetPipelineObject()->DestroyPipelineCache();
 
 	for (VulkanDrawable* drawableObj : *_rendererObj->GetDrawingItems())
 	{
 		drawableObj->DestroyDescriptor();
 	}
+	_rendererObj->DestroyBindlessSet();
 
 	_rendererObj->GetShader()->DestroyShaders();
+	_rendererObj->DestroyRenderGraph();
 	_rendererObj->DestroyFramebuffers();
 	_rendererObj->DestroyRenderpass();
 	_rendererObj->DestroyDrawableVertexBuffer();
 	_rendererObj->DestroyDrawableUniformBuffer();
 
-	_rendererObj->DestroyDrawableCommandBuffer();
+	_rendererObj->DestroyDrawCommandBuffers();
 	_rendererObj->DestroyDepthBuffer();
 	_rendererObj->GetSwapChain()->DestroySwapChain();
 	_rendererObj->DestroyCommandBuffer();
-	_rendererObj->DestroyDrawableSynchronizationObjects();
+	_rendererObj->DestroySynchronizationObjects();
 	_rendererObj->DestroyCommandPool();
 	_rendererObj->DestroyPresentationWindow();
 	_rendererObj->DestroyTextureResource();
@@ -0,0 +1,226 @@
+#include "VulkanBarrierBatcher.h"
+#include "VulkanDevice.h"
+
+VulkanBarrierBatcher::VulkanBarrierBatcher() :
+	_flushCount(0),
+	_barrierCount(0)
+{
+#ifdef VK_KHR_synchronization2
+	fpCmdPipelineBarrier2KHR = nullptr;
+#endif
+}
+
+void VulkanBarrierBatcher::Initialize(VulkanDevice* deviceObj)
+{
+#ifdef VK_KHR_synchronization2
+	fpCmdPipelineBarrier2KHR = nullptr;
+	if (deviceObj->_synchronization2Enabled)
+	{
+		// A missing entry point is not fatal, the batcher falls back to vkCmdPipelineBarrier
+		fpCmdPipelineBarrier2KHR = (PFN_vkCmdPipelineBarrier2KHR) vkGetDeviceProcAddr(deviceObj->_device, "vkCmdPipelineBarrier2KHR");
+	}
+#endif
+}
+
+void VulkanBarrierBatcher::GetLayoutStageAccess(VkImageLayout layout, bool isSource, VkPipelineStageFlags* stages, VkAccessFlags* access)
+{
+	// A source only has to make its writes available, the reads done in
+	// the old layout just need the execution dependency of the stages.
+	switch (layout)
+	{
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+		*stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		*access = 0;
+		break;
+	case VK_IMAGE_LAYOUT_PREINITIALIZED:
+		*stages = VK_PIPELINE_STAGE_HOST_BIT;
+		*access = VK_ACCESS_HOST_WRITE_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		*stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		*access = VK_ACCESS_TRANSFER_WRITE_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		*stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		*access = isSource ? 0 : VK_ACCESS_TRANSFER_READ_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		*stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		*access = isSource ? 0 : VK_ACCESS_SHADER_READ_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		*stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		*access = isSource ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : (VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+		break;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		*stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		*access = isSource ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : (VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+		break;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		*stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		*access = isSource ? 0 : (VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+		break;
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		// The presentation engine synchronizes through the semaphores
+		*stages = isSource ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		*access = 0;
+		break;
+	case VK_IMAGE_LAYOUT_GENERAL:
+	default:
+		// Any use is possible, stay conservative
+		*stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		*access = isSource ? VK_ACCESS_MEMORY_WRITE_BIT : (VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+		break;
+	}
+}
+
+void VulkanBarrierBatcher::AddImageTransition(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+	VkPipelineStageFlags srcStages, dstStages;
+	VkAccessFlags		 srcAccess, dstAccess;
+	GetLayoutStageAccess(oldLayout, true, &srcStages, &srcAccess);
+	GetLayoutStageAccess(newLayout, false, &dstStages, &dstAccess);
+
+	AddImageBarrier(image, subresourceRange, oldLayout, newLayout, srcStages, srcAccess, dstStages, dstAccess);
+}
+
+void VulkanBarrierBatcher::AddImageBarrier(VkImage image, const VkImageSubresourceRange& subresourceRange,
+	                                       VkImageLayout oldLayout, VkImageLayout newLayout,
+	                                       VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+	                                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+	                                       uint32_t srcQueueFamily, uint32_t dstQueueFamily)
+{
+	VkImageMemoryBarrier imgMemoryBarrier = {};
+	imgMemoryBarrier.sType				 = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imgMemoryBarrier.pNext				 = nullptr;
+	imgMemoryBarrier.srcAccessMask		 = srcAccess;
+	imgMemoryBarrier.dstAccessMask		 = dstAccess;
+	imgMemoryBarrier.oldLayout			 = oldLayout;
+	imgMemoryBarrier.newLayout			 = newLayout;
+	imgMemoryBarrier.srcQueueFamilyIndex = srcQueueFamily;
+	imgMemoryBarrier.dstQueueFamilyIndex = dstQueueFamily;
+	imgMemoryBarrier.image				 = image;
+	imgMemoryBarrier.subresourceRange	 = subresourceRange;
+	_imageBarriers.push_back(imgMemoryBarrier);
+
+	StageMasks stages = { srcStages, dstStages };
+	_imageStages.push_back(stages);
+}
+
+void VulkanBarrierBatcher::AddBufferBarrier(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+	                                        VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+	                                        VkPipelineStageFlags dstStages, VkAccessFlags dstAccess,
+	                                        uint32_t srcQueueFamily, uint32_t dstQueueFamily)
+{
+	VkBufferMemoryBarrier bufMemoryBarrier = {};
+	bufMemoryBarrier.sType				 = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	bufMemoryBarrier.pNext				 = nullptr;
+	bufMemoryBarrier.srcAccessMask		 = srcAccess;
+	bufMemoryBarrier.dstAccessMask		 = dstAccess;
+	bufMemoryBarrier.srcQueueFamilyIndex = srcQueueFamily;
+	bufMemoryBarrier.dstQueueFamilyIndex = dstQueueFamily;
+	bufMemoryBarrier.buffer				 = buffer;
+	bufMemoryBarrier.offset				 = offset;
+	bufMemoryBarrier.size				 = size;
+	_bufferBarriers.push_back(bufMemoryBarrier);
+
+	StageMasks stages = { srcStages, dstStages };
+	_bufferStages.push_back(stages);
+}
+
+void VulkanBarrierBatcher::Flush(VkCommandBuffer cmd)
+{
+	if (IsEmpty())
+	{
+		return;
+	}
+
+	_flushCount++;
+	_barrierCount += static_cast<uint32_t>(_imageBarriers.size() + _bufferBarriers.size());
+
+#ifdef VK_KHR_synchronization2
+	if (fpCmdPipelineBarrier2KHR)
+	{
+		// Every barrier keeps its own stage masks, nothing waits longer than needed.
+		// The legacy stage and access bits have the same values in the 64 bit masks.
+		std::vector<VkImageMemoryBarrier2KHR> imageBarriers2(_imageBarriers.size());
+		for (size_t i = 0; i < _imageBarriers.size(); i++)
+		{
+			const VkImageMemoryBarrier& barrier = _imageBarriers[i];
+			VkImageMemoryBarrier2KHR& barrier2	= imageBarriers2[i];
+			barrier2.sType					= VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+			barrier2.pNext					= nullptr;
+			barrier2.srcStageMask			= _imageStages[i]._src;
+			barrier2.srcAccessMask			= barrier.srcAccessMask;
+			barrier2.dstStageMask			= _imageStages[i]._dst;
+			barrier2.dstAccessMask			= barrier.dstAccessMask;
+			barrier2.oldLayout				= barrier.oldLayout;
+			barrier2.newLayout				= barrier.newLayout;
+			barrier2.srcQueueFamilyIndex	= barrier.srcQueueFamilyIndex;
+			barrier2.dstQueueFamilyIndex	= barrier.dstQueueFamilyIndex;
+			barrier2.image					= barrier.image;
+			barrier2.subresourceRange		= barrier.subresourceRange;
+		}
+
+		std::vector<VkBufferMemoryBarrier2KHR> bufferBarriers2(_bufferBarriers.size());
+		for (size_t i = 0; i < _bufferBarriers.size(); i++)
+		{
+			const VkBufferMemoryBarrier& barrier = _bufferBarriers[i];
+			VkBufferMemoryBarrier2KHR& barrier2	 = bufferBarriers2[i];
+			barrier2.sType					= VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR;
+			barrier2.pNext					= nullptr;
+			barrier2.srcStageMask			= _bufferStages[i]._src;
+			barrier2.srcAccessMask			= barrier.srcAccessMask;
+			barrier2.dstStageMask			= _bufferStages[i]._dst;
+			barrier2.dstAccessMask			= barrier.dstAccessMask;
+			barrier2.srcQueueFamilyIndex	= barrier.srcQueueFamilyIndex;
+			barrier2.dstQueueFamilyIndex	= barrier.dstQueueFamilyIndex;
+			barrier2.buffer					= barrier.buffer;
+			barrier2.offset					= barrier.offset;
+			barrier2.size					= barrier.size;
+		}
+
+		VkDependencyInfoKHR dependencyInfo = {};
+		dependencyInfo.sType					= VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+		dependencyInfo.pNext					= nullptr;
+		dependencyInfo.dependencyFlags			= 0;
+		dependencyInfo.memoryBarrierCount		= 0;
+		dependencyInfo.pMemoryBarriers			= nullptr;
+		dependencyInfo.bufferMemoryBarrierCount	= static_cast<uint32_t>(bufferBarriers2.size());
+		dependencyInfo.pBufferMemoryBarriers	= bufferBarriers2.empty() ? nullptr : bufferBarriers2.data();
+		dependencyInfo.imageMemoryBarrierCount	= static_cast<uint32_t>(imageBarriers2.size());
+		dependencyInfo.pImageMemoryBarriers		= imageBarriers2.empty() ? nullptr : imageBarriers2.data();
+		fpCmdPipelineBarrier2KHR(cmd, &dependencyInfo);
+
+		_imageBarriers.clear();
+		_imageStages.clear();
+		_bufferBarriers.clear();
+		_bufferStages.clear();
+		return;
+	}
+#endif
+
+	// Without synchronization2 the stage masks are shared by all the barriers of the call
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+	for (const StageMasks& stages : _imageStages)
+	{
+		srcStages |= stages._src;
+		dstStages |= stages._dst;
+	}
+	for (const StageMasks& stages : _bufferStages)
+	{
+		srcStages |= stages._src;
+		dstStages |= stages._dst;
+	}
+
+	vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0,
+		                 0, nullptr,
+		                 static_cast<uint32_t>(_bufferBarriers.size()), _bufferBarriers.empty() ? nullptr : _bufferBarriers.data(),
+		                 static_cast<uint32_t>(_imageBarriers.size()), _imageBarriers.empty() ? nullptr : _imageBarriers.data());
+
+	_imageBarriers.clear();
+	_imageStages.clear();
+	_bufferBarriers.clear();
+	_bufferStages.clear();
+}
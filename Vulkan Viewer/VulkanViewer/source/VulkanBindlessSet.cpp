@@ -0,0 +1,272 @@
+#include "VulkanBindlessSet.h"
+#include "VulkanDevice.h"
+
+VulkanBindlessSet::VulkanBindlessSet() :
+	_deviceObj(nullptr),
+	_descLayout(VK_NULL_HANDLE),
+	_pipelineLayout(VK_NULL_HANDLE),
+	_descriptorPool(VK_NULL_HANDLE),
+	_descriptorSet(VK_NULL_HANDLE),
+	_maxTextures(0),
+	_maxBuffers(0),
+	_textureSlotCount(0),
+	_bufferSlotCount(0)
+{
+}
+
+VulkanBindlessSet::~VulkanBindlessSet()
+{
+}
+
+bool VulkanBindlessSet::Initialize(VulkanDevice* deviceObj)
+{
+	_deviceObj = deviceObj;
+	if (!_deviceObj->_descriptorIndexingEnabled)
+	{
+		return false;
+	}
+
+#ifdef VK_EXT_descriptor_indexing
+	_maxTextures	= std::min(static_cast<uint32_t>(BINDLESS_MAX_TEXTURES), _deviceObj->_maxUpdateAfterBindSampledImages);
+	_maxBuffers		= std::min(static_cast<uint32_t>(BINDLESS_MAX_BUFFERS), _deviceObj->_maxUpdateAfterBindStorageBuffers);
+
+	// The texture array is sized by the device limit in the layout, and by the number of
+	// slots when the set is allocated, so a larger set would not need new pipelines
+	VkDescriptorSetLayoutBinding layoutBindings[2] = {};
+	layoutBindings[0].binding				= BINDLESS_BUFFER_BINDING;
+	layoutBindings[0].descriptorType		= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	layoutBindings[0].descriptorCount		= _maxBuffers;
+	layoutBindings[0].stageFlags			= VK_SHADER_STAGE_VERTEX_BIT;
+	layoutBindings[0].pImmutableSamplers	= nullptr;
+	layoutBindings[1].binding				= BINDLESS_TEXTURE_BINDING;
+	layoutBindings[1].descriptorType		= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	layoutBindings[1].descriptorCount		= _deviceObj->_maxUpdateAfterBindSampledImages;
+	layoutBindings[1].stageFlags			= VK_SHADER_STAGE_FRAGMENT_BIT;
+	layoutBindings[1].pImmutableSamplers	= nullptr;
+
+	// The unused slots are never accessed, and the slots are written while the set is bound
+	const VkDescriptorBindingFlagsEXT bindingFlags[2] =
+	{
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT,
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT
+	};
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+	bindingFlagsInfo.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	bindingFlagsInfo.bindingCount	= 2;
+	bindingFlagsInfo.pBindingFlags	= bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo descriptorLayout = {};
+	descriptorLayout.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorLayout.pNext			= &bindingFlagsInfo;
+	descriptorLayout.flags			= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	descriptorLayout.bindingCount	= 2;
+	descriptorLayout.pBindings		= layoutBindings;
+
+	VkResult result = vkCreateDescriptorSetLayout(_deviceObj->_device, &descriptorLayout, nullptr, &_descLayout);
+	assert(result == VK_SUCCESS);
+
+	// The indices of the draw are the only per draw state
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags	= VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset		= 0;
+	pushConstantRange.size			= sizeof(BindlessIndices);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.pNext					= nullptr;
+	pipelineLayoutCreateInfo.pushConstantRangeCount	= 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges	= &pushConstantRange;
+	pipelineLayoutCreateInfo.setLayoutCount			= 1;
+	pipelineLayoutCreateInfo.pSetLayouts			= &_descLayout;
+
+	result = vkCreatePipelineLayout(_deviceObj->_device, &pipelineLayoutCreateInfo, nullptr, &_pipelineLayout);
+	assert(result == VK_SUCCESS);
+
+	const VkDescriptorPoolSize poolSizes[2] =
+	{
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _maxBuffers },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _maxTextures }
+	};
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+	descriptorPoolCreateInfo.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolCreateInfo.pNext			= nullptr;
+	descriptorPoolCreateInfo.flags			= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	descriptorPoolCreateInfo.maxSets		= 1;
+	descriptorPoolCreateInfo.poolSizeCount	= 2;
+	descriptorPoolCreateInfo.pPoolSizes		= poolSizes;
+
+	result = vkCreateDescriptorPool(_deviceObj->_device, &descriptorPoolCreateInfo, nullptr, &_descriptorPool);
+	assert(result == VK_SUCCESS);
+
+	VkDescriptorSetVariableDescriptorCountAllocateInfoEXT variableCountInfo = {};
+	variableCountInfo.sType					= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT;
+	variableCountInfo.descriptorSetCount	= 1;
+	variableCountInfo.pDescriptorCounts		= &_maxTextures;
+
+	VkDescriptorSetAllocateInfo dsAllocInfo = {};
+	dsAllocInfo.sType				= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	dsAllocInfo.pNext				= &variableCountInfo;
+	dsAllocInfo.descriptorPool		= _descriptorPool;
+	dsAllocInfo.descriptorSetCount	= 1;
+	dsAllocInfo.pSetLayouts			= &_descLayout;
+
+	result = vkAllocateDescriptorSets(_deviceObj->_device, &dsAllocInfo, &_descriptorSet);
+	assert(result == VK_SUCCESS);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void VulkanBindlessSet::Destroy()
+{
+	if (!IsInitialized())
+	{
+		return;
+	}
+
+	// The set is freed with its pool
+	vkDestroyDescriptorPool(_deviceObj->_device, _descriptorPool, nullptr);
+	vkDestroyPipelineLayout(_deviceObj->_device, _pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(_deviceObj->_device, _descLayout, nullptr);
+	_descriptorPool		= VK_NULL_HANDLE;
+	_pipelineLayout		= VK_NULL_HANDLE;
+	_descLayout			= VK_NULL_HANDLE;
+	_descriptorSet		= VK_NULL_HANDLE;
+
+	_textureSlots.clear();
+	_freeTextureSlots.clear();
+	_freeBufferSlots.clear();
+	_textureSlotCount	= 0;
+	_bufferSlotCount	= 0;
+}
+
+bool VulkanBindlessSet::IsCompatible(const VulkanShaderReflection& reflection) const
+{
+	for (const ShaderBinding& binding : reflection._bindings)
+	{
+		const bool buffers	= binding._binding == BINDLESS_BUFFER_BINDING && binding._type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		const bool textures	= binding._binding == BINDLESS_TEXTURE_BINDING && binding._type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		if (binding._set != 0 || (!buffers && !textures))
+		{
+			return false;
+		}
+	}
+
+	// The push constants hold the indices of the draw
+	for (const VkPushConstantRange& range : reflection._pushConstantRanges)
+	{
+		if (range.offset + range.size > sizeof(BindlessIndices))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t VulkanBindlessSet::AddTexture(const TextureData* texture)
+{
+	auto it = _textureSlots.find(texture);
+	if (it != _textureSlots.end())
+	{
+		it->second._refCount++;
+		return it->second._index;
+	}
+
+	TextureSlot slot;
+	slot._index		= AllocateSlot(_freeTextureSlots, _textureSlotCount, _maxTextures);
+	slot._refCount	= 1;
+	slot._view		= texture->view;
+	_textureSlots[texture] = slot;
+
+	WriteTexture(slot._index, texture);
+	return slot._index;
+}
+
+void VulkanBindlessSet::RemoveTexture(const TextureData* texture)
+{
+	auto it = _textureSlots.find(texture);
+	assert(it != _textureSlots.end());
+	if (--it->second._refCount > 0)
+	{
+		return;
+	}
+
+	ReleaseSlot(_freeTextureSlots, it->second._index);
+	_textureSlots.erase(it);
+}
+
+uint32_t VulkanBindlessSet::UpdateTexture(const TextureData* texture)
+{
+	auto it = _textureSlots.find(texture);
+	assert(it != _textureSlots.end());
+
+	// Already moved for another drawable sharing the texture
+	TextureSlot& slot = it->second;
+	if (slot._view == texture->view)
+	{
+		return slot._index;
+	}
+
+	// Written after bind is allowed, rewriting a slot pending command buffers read is not
+	const uint32_t index = AllocateSlot(_freeTextureSlots, _textureSlotCount, _maxTextures);
+	WriteTexture(index, texture);
+	ReleaseSlot(_freeTextureSlots, slot._index);
+	slot._index	= index;
+	slot._view	= texture->view;
+	return index;
+}
+
+void VulkanBindlessSet::WriteTexture(uint32_t index, const TextureData* texture)
+{
+	VkWriteDescriptorSet write	= {};
+	write.sType					= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet				= _descriptorSet;
+	write.dstBinding			= BINDLESS_TEXTURE_BINDING;
+	write.dstArrayElement		= index;
+	write.descriptorCount		= 1;
+	write.descriptorType		= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo			= &texture->descsImgInfo;
+	vkUpdateDescriptorSets(_deviceObj->_device, 1, &write, 0, nullptr);
+}
+
+uint32_t VulkanBindlessSet::AddBuffer(const VkDescriptorBufferInfo& bufferInfo)
+{
+	const uint32_t index = AllocateSlot(_freeBufferSlots, _bufferSlotCount, _maxBuffers);
+
+	VkWriteDescriptorSet write	= {};
+	write.sType					= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet				= _descriptorSet;
+	write.dstBinding			= BINDLESS_BUFFER_BINDING;
+	write.dstArrayElement		= index;
+	write.descriptorCount		= 1;
+	write.descriptorType		= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo			= &bufferInfo;
+	vkUpdateDescriptorSets(_deviceObj->_device, 1, &write, 0, nullptr);
+	return index;
+}
+
+void VulkanBindlessSet::RemoveBuffer(uint32_t index)
+{
+	ReleaseSlot(_freeBufferSlots, index);
+}
+
+uint32_t VulkanBindlessSet::AllocateSlot(std::vector<uint32_t>& freeSlots, uint32_t& slotCount, uint32_t maxSlots)
+{
+	if (!freeSlots.empty())
+	{
+		const uint32_t index = freeSlots.back();
+		freeSlots.pop_back();
+		return index;
+	}
+
+	assert(slotCount < maxSlots);
+	return slotCount++;
+}
+
+void VulkanBindlessSet::ReleaseSlot(std::vector<uint32_t>& freeSlots, uint32_t index)
+{
+	// The frames already submitted may still read the descriptor of the slot
+	VulkanTimeline& timeline = _deviceObj->_graphicsTimeline;
+	timeline.DeferUntil(timeline.GetLastSubmitted(), [&freeSlots, index]() { freeSlots.push_back(index); });
+}
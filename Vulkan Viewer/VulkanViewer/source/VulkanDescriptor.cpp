@@ -3,8 +3,7 @@
 #include "VulkanDevice.h"
 
 VulkanDescriptor::VulkanDescriptor() :
-	_pipelineLayout(0),
-	_descriptorPool(0)
+	_pipelineLayout(0)
 {
 	_deviceObj = VulkanApplication::GetInstance()->_deviceObj;
 }
@@ -18,42 +17,34 @@ void VulkanDescriptor::CreateDescriptor(bool useTexture)
 	// Create the uniform buffer resource 
 	CreateDescriptorResources();
 	
-	// Create the descriptor pool and 
-	// use it for descriptor set allocation
-	CreateDescriptorPool(useTexture);
-
 	// Create descriptor set with uniform buffer data in it
 	CreateDescriptorSet(useTexture);
 }
 
 void VulkanDescriptor::DestroyDescriptor()
 {
-	DestroyDescriptorLayout();
-	DestroyPipelineLayouts();
+	// The sets are given back for their layouts before these are released
 	DestroyDescriptorSet();
-	DestroyDescriptorPool();
+	DestroyPipelineLayouts();
+	DestroyDescriptorLayout();
 }
 
 void VulkanDescriptor::DestroyDescriptorLayout()
 {
-	for (auto i : _descLayout)
-	{
-		vkDestroyDescriptorSetLayout(_deviceObj->_device, i, nullptr);
-	}
+	// Shared with the other drawables, the cache destroys them with the device
 	_descLayout.clear();
 }
 
-void VulkanDescriptor::DestroyPipelineLayouts() const
-{
-	vkDestroyPipelineLayout(_deviceObj->_device, _pipelineLayout, nullptr);
-}
-
-void VulkanDescriptor::DestroyDescriptorPool() const
+void VulkanDescriptor::DestroyPipelineLayouts()
 {
-	vkDestroyDescriptorPool(_deviceObj->_device, _descriptorPool, nullptr);
+	_pipelineLayout = VK_NULL_HANDLE;
 }
 
 void VulkanDescriptor::DestroyDescriptorSet()
 {
-	vkFreeDescriptorSets(_deviceObj->_device, _descriptorPool, static_cast<uint32_t>(_descriptorSet.size()), &_descriptorSet[0]);
+	for (size_t i = 0; i < _descriptorSet.size(); i++)
+	{
+		_deviceObj->_descriptorAllocator.Free(_descLayout[i], _descriptorSet[i]);
+	}
+	_descriptorSet.clear();
 }
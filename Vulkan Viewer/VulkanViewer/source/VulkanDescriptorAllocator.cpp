@@ -0,0 +1,275 @@
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanDevice.h"
+
+namespace
+{
+	// Descriptors of each type a pool holds per set, every type the shader reflection can
+	// return is listed. The layouts needing more of a type than this are served as long as
+	// the pool as a whole has enough.
+	const VkDescriptorPoolSize poolSizesPerSet[] =
+	{
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,			1 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,			1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,	1 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	1 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,				1 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER,					1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,				1 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,		1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,		1 },
+		{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,			1 },
+	};
+
+	bool IsPoolFull(VkResult result)
+	{
+#ifdef VK_KHR_maintenance1
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY_KHR)
+		{
+			return true;
+		}
+#endif
+		// Running out of host or device memory is a real failure, another pool would not help
+		return result == VK_ERROR_FRAGMENTED_POOL;
+	}
+}
+
+VulkanDescriptorAllocator::VulkanDescriptorAllocator() :
+	_deviceObj(nullptr),
+	_liveSetCount(0)
+{
+	_chain._current = 0;
+#ifdef VK_KHR_descriptor_update_template
+	fpCreateDescriptorUpdateTemplateKHR		= nullptr;
+	fpDestroyDescriptorUpdateTemplateKHR	= nullptr;
+	fpUpdateDescriptorSetWithTemplateKHR	= nullptr;
+#endif
+}
+
+VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+{
+}
+
+void VulkanDescriptorAllocator::Initialize(VulkanDevice* deviceObj)
+{
+	_deviceObj = deviceObj;
+
+#ifdef VK_KHR_descriptor_update_template
+	if (_deviceObj->_descriptorUpdateTemplateEnabled)
+	{
+		// The templates are only used when all the entry points are found
+		fpCreateDescriptorUpdateTemplateKHR		= (PFN_vkCreateDescriptorUpdateTemplateKHR) vkGetDeviceProcAddr(_deviceObj->_device, "vkCreateDescriptorUpdateTemplateKHR");
+		fpDestroyDescriptorUpdateTemplateKHR	= (PFN_vkDestroyDescriptorUpdateTemplateKHR) vkGetDeviceProcAddr(_deviceObj->_device, "vkDestroyDescriptorUpdateTemplateKHR");
+		fpUpdateDescriptorSetWithTemplateKHR	= (PFN_vkUpdateDescriptorSetWithTemplateKHR) vkGetDeviceProcAddr(_deviceObj->_device, "vkUpdateDescriptorSetWithTemplateKHR");
+		if (!fpCreateDescriptorUpdateTemplateKHR || !fpDestroyDescriptorUpdateTemplateKHR || !fpUpdateDescriptorSetWithTemplateKHR)
+		{
+			fpCreateDescriptorUpdateTemplateKHR = nullptr;
+		}
+	}
+#endif
+}
+
+void VulkanDescriptorAllocator::Destroy()
+{
+	DestroyChain(_chain);
+	_freeSets.clear();
+	_liveSetCount = 0;
+}
+
+bool VulkanDescriptorAllocator::Allocate(VkDescriptorSetLayout layout, VkDescriptorSet* set)
+{
+	// A set given back for the layout is taken first
+	auto it = _freeSets.find(layout);
+	if (it != _freeSets.end() && !it->second.empty())
+	{
+		*set = it->second.back();
+		it->second.pop_back();
+		_liveSetCount++;
+		return true;
+	}
+
+	if (!AllocateFromChain(_chain, layout, set))
+	{
+		return false;
+	}
+	_liveSetCount++;
+	return true;
+}
+
+void VulkanDescriptorAllocator::Free(VkDescriptorSetLayout layout, VkDescriptorSet set)
+{
+	assert(_liveSetCount > 0);
+	if (--_liveSetCount == 0)
+	{
+		// Nothing uses the pools anymore, e.g. when all the drawables are rebuilt on a resize.
+		// They are emptied at once, the chain is filled from its first pool again.
+		ResetChain(_chain);
+		_freeSets.clear();
+		return;
+	}
+	_freeSets[layout].push_back(set);
+}
+
+bool VulkanDescriptorAllocator::AllocateFromChain(PoolChain& chain, VkDescriptorSetLayout layout, VkDescriptorSet* set)
+{
+	VkDescriptorSetAllocateInfo dsAllocInfo;
+	dsAllocInfo.sType				= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	dsAllocInfo.pNext				= nullptr;
+	dsAllocInfo.descriptorSetCount	= 1;
+	dsAllocInfo.pSetLayouts			= &layout;
+
+	while (true)
+	{
+		bool newPool = false;
+		if (chain._current == chain._pools.size())
+		{
+			const uint32_t maxSets = std::min<uint32_t>(DESCRIPTOR_POOL_INITIAL_SETS << std::min<size_t>(chain._pools.size(), 16), DESCRIPTOR_POOL_MAX_SETS);
+			chain._pools.push_back(CreatePool(maxSets));
+			newPool = true;
+		}
+
+		dsAllocInfo.descriptorPool	= chain._pools[chain._current];
+		const VkResult result		= vkAllocateDescriptorSets(_deviceObj->_device, &dsAllocInfo, set);
+		if (result == VK_SUCCESS)
+		{
+			return true;
+		}
+
+		// A set a whole empty pool cannot hold will not fit in the next one either
+		if (!IsPoolFull(result) || newPool)
+		{
+			std::cout << "Error: failed to allocate a descriptor set (" << result << ")" << std::endl;
+			return false;
+		}
+		chain._current++;
+	}
+}
+
+void VulkanDescriptorAllocator::ResetChain(PoolChain& chain)
+{
+	for (VkDescriptorPool pool : chain._pools)
+	{
+		const VkResult result = vkResetDescriptorPool(_deviceObj->_device, pool, 0);
+		assert(result == VK_SUCCESS);
+	}
+	chain._current = 0;
+}
+
+void VulkanDescriptorAllocator::DestroyChain(PoolChain& chain)
+{
+	for (VkDescriptorPool pool : chain._pools)
+	{
+		vkDestroyDescriptorPool(_deviceObj->_device, pool, nullptr);
+	}
+	chain._pools.clear();
+	chain._current = 0;
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::CreatePool(uint32_t maxSets)
+{
+	VkDescriptorPoolSize poolSizes[sizeof(poolSizesPerSet) / sizeof(poolSizesPerSet[0])];
+	for (uint32_t i = 0; i < sizeof(poolSizesPerSet) / sizeof(poolSizesPerSet[0]); i++)
+	{
+		poolSizes[i].type				= poolSizesPerSet[i].type;
+		poolSizes[i].descriptorCount	= poolSizesPerSet[i].descriptorCount * maxSets;
+	}
+
+	// The sets are never freed one by one, they are recycled or the pool is reset
+	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo;
+	descriptorPoolCreateInfo.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolCreateInfo.pNext			= nullptr;
+	descriptorPoolCreateInfo.flags			= 0;
+	descriptorPoolCreateInfo.maxSets		= maxSets;
+	descriptorPoolCreateInfo.poolSizeCount	= sizeof(poolSizes) / sizeof(poolSizes[0]);
+	descriptorPoolCreateInfo.pPoolSizes		= poolSizes;
+
+	VkDescriptorPool pool;
+	const VkResult result = vkCreateDescriptorPool(_deviceObj->_device, &descriptorPoolCreateInfo, nullptr, &pool);
+	assert(result == VK_SUCCESS);
+	return pool;
+}
+
+void VulkanDescriptorAllocator::CreateTemplate(VkDescriptorSetLayout layout, const DescriptorTemplateEntry* entries, uint32_t entryCount, DescriptorTemplate* descriptorTemplate)
+{
+	assert(entryCount <= DESCRIPTOR_TEMPLATE_MAX_ENTRIES);
+	descriptorTemplate->_entryCount = entryCount;
+	memcpy(descriptorTemplate->_entries, entries, entryCount * sizeof(DescriptorTemplateEntry));
+
+#ifdef VK_KHR_descriptor_update_template
+	descriptorTemplate->_template = VK_NULL_HANDLE;
+	if (!fpCreateDescriptorUpdateTemplateKHR || entryCount == 0)
+	{
+		return;
+	}
+
+	VkDescriptorUpdateTemplateEntryKHR templateEntries[DESCRIPTOR_TEMPLATE_MAX_ENTRIES];
+	for (uint32_t i = 0; i < entryCount; i++)
+	{
+		templateEntries[i].dstBinding		= entries[i]._binding;
+		templateEntries[i].dstArrayElement	= 0;
+		templateEntries[i].descriptorCount	= 1;
+		templateEntries[i].descriptorType	= entries[i]._type;
+		templateEntries[i].offset			= entries[i]._offset;
+		templateEntries[i].stride			= 0;
+	}
+
+	VkDescriptorUpdateTemplateCreateInfoKHR templateInfo = {};
+	templateInfo.sType						= VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+	templateInfo.pNext						= nullptr;
+	templateInfo.flags						= 0;
+	templateInfo.descriptorUpdateEntryCount	= entryCount;
+	templateInfo.pDescriptorUpdateEntries	= templateEntries;
+	templateInfo.templateType				= VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+	templateInfo.descriptorSetLayout		= layout;
+
+	const VkResult result = fpCreateDescriptorUpdateTemplateKHR(_deviceObj->_device, &templateInfo, nullptr, &descriptorTemplate->_template);
+	assert(result == VK_SUCCESS);
+#endif
+}
+
+void VulkanDescriptorAllocator::DestroyTemplate(DescriptorTemplate* descriptorTemplate)
+{
+#ifdef VK_KHR_descriptor_update_template
+	if (descriptorTemplate->_template != VK_NULL_HANDLE)
+	{
+		fpDestroyDescriptorUpdateTemplateKHR(_deviceObj->_device, descriptorTemplate->_template, nullptr);
+		descriptorTemplate->_template = VK_NULL_HANDLE;
+	}
+#endif
+	descriptorTemplate->_entryCount = 0;
+}
+
+void VulkanDescriptorAllocator::UpdateSet(VkDescriptorSet set, const DescriptorTemplate& descriptorTemplate, const void* data) const
+{
+#ifdef VK_KHR_descriptor_update_template
+	// The driver reads the infos straight from the structure, without the write structures to fill and parse
+	if (descriptorTemplate._template != VK_NULL_HANDLE)
+	{
+		fpUpdateDescriptorSetWithTemplateKHR(_deviceObj->_device, set, descriptorTemplate._template, data);
+		return;
+	}
+#endif
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	VkWriteDescriptorSet writes[DESCRIPTOR_TEMPLATE_MAX_ENTRIES];
+	for (uint32_t i = 0; i < descriptorTemplate._entryCount; i++)
+	{
+		const DescriptorTemplateEntry& entry	= descriptorTemplate._entries[i];
+		const bool isImage						= entry._type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+												  entry._type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+												  entry._type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+												  entry._type == VK_DESCRIPTOR_TYPE_SAMPLER;
+
+		VkWriteDescriptorSet& write	= writes[i];
+		write						= {};
+		write.sType					= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet				= set;
+		write.dstBinding			= entry._binding;
+		write.dstArrayElement		= 0;
+		write.descriptorCount		= 1;
+		write.descriptorType		= entry._type;
+		write.pImageInfo			= isImage ? reinterpret_cast<const VkDescriptorImageInfo*>(bytes + entry._offset) : nullptr;
+		write.pBufferInfo			= isImage ? nullptr : reinterpret_cast<const VkDescriptorBufferInfo*>(bytes + entry._offset);
+	}
+	vkUpdateDescriptorSets(_deviceObj->_device, descriptorTemplate._entryCount, writes, 0, nullptr);
+}
@@ -1,5 +1,6 @@
 #include "VulkanDevice.h"
 #include "VulkanInstance.h"
+#include "VulkanApplication.h"
 
 VulkanDevice::VulkanDevice(VkPhysicalDevice* physicalDevice) :
 	_device(nullptr),
@@ -9,7 +10,19 @@ VulkanDevice::VulkanDevice(VkPhysicalDevice* physicalDevice) :
 	_graphicsQueueIndex(0),
 	_graphicsQueueWithPresentIndex(0),
 	_queueFamilyCount(0),
-	_deviceFeatures()
+	_transferQueueIndex(0),
+	_computeQueueIndex(0),
+	_transferQueue(nullptr),
+	_computeQueue(nullptr),
+	_deviceFeatures(),
+	_synchronization2Enabled(false),
+	_timelineSemaphoreEnabled(false),
+	_descriptorIndexingEnabled(false),
+	_maxUpdateAfterBindSampledImages(0),
+	_maxUpdateAfterBindStorageBuffers(0),
+	_graphicsPipelineLibraryEnabled(false),
+	_graphicsPipelineLibraryFastLinking(false),
+	_descriptorUpdateTemplateEnabled(false)
 {
 	_gpu = physicalDevice;
 }
@@ -24,6 +37,94 @@ VkResult VulkanDevice::CreateDevice(std::vector<const char *>& layers, std::vect
 	_layerExtension._appRequestedLayerNames		= layers;
 	_layerExtension._appRequestedExtensionNames	= extensions;
 
+	// Optional features are added at the front of this chain
+	void* featureChain = nullptr;
+	GetSupportedExtensions();
+	_enabledExtensions = extensions;
+
+#ifdef VK_KHR_synchronization2
+	// The feature is mandatory for the devices exposing the extension
+	VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features = {};
+	synchronization2Features.sType				= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+	synchronization2Features.pNext				= featureChain;
+	synchronization2Features.synchronization2	= VK_TRUE;
+	if (IsExtensionSupported(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+	{
+		_enabledExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+		featureChain = &synchronization2Features;
+		_synchronization2Enabled = true;
+	}
+#endif
+
+#ifdef VK_KHR_timeline_semaphore
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures = {};
+	timelineSemaphoreFeatures.sType				= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineSemaphoreFeatures.pNext				= featureChain;
+	timelineSemaphoreFeatures.timelineSemaphore	= VK_TRUE;
+	if (IsExtensionSupported(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+	{
+		_enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		featureChain = &timelineSemaphoreFeatures;
+		_timelineSemaphoreEnabled = true;
+	}
+#endif
+
+#ifdef VK_EXT_descriptor_indexing
+	// Bindless descriptors. Unlike the features above, the ones of this extension are
+	// optional, so they are queried first and only the ones needed are enabled.
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures = {};
+	descriptorIndexingFeatures.sType	= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	descriptorIndexingFeatures.pNext	= featureChain;
+	if (IsExtensionSupported(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+		IsExtensionSupported(VK_KHR_MAINTENANCE3_EXTENSION_NAME) &&
+		QueryDescriptorIndexingSupport())
+	{
+		descriptorIndexingFeatures.runtimeDescriptorArray						= VK_TRUE;
+		descriptorIndexingFeatures.descriptorBindingPartiallyBound				= VK_TRUE;
+		descriptorIndexingFeatures.descriptorBindingVariableDescriptorCount		= VK_TRUE;
+		descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind	= VK_TRUE;
+		descriptorIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind	= VK_TRUE;
+		_enabledExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		_enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		featureChain = &descriptorIndexingFeatures;
+		_descriptorIndexingEnabled = true;
+	}
+#endif
+
+#ifdef VK_EXT_graphics_pipeline_library
+	// The pipelines are linked from libraries of their parts, which are shared between them
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures = {};
+	pipelineLibraryFeatures.sType					= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	pipelineLibraryFeatures.pNext					= featureChain;
+	pipelineLibraryFeatures.graphicsPipelineLibrary	= VK_TRUE;
+	if (IsExtensionSupported(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+		IsExtensionSupported(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+		QueryGraphicsPipelineLibrarySupport())
+	{
+		_enabledExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+		_enabledExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+		featureChain = &pipelineLibraryFeatures;
+		_graphicsPipelineLibraryEnabled = true;
+	}
+#endif
+
+#ifdef VK_KHR_maintenance1
+	// The descriptor pools report when they are full with VK_ERROR_OUT_OF_POOL_MEMORY_KHR
+	if (IsExtensionSupported(VK_KHR_MAINTENANCE1_EXTENSION_NAME))
+	{
+		_enabledExtensions.push_back(VK_KHR_MAINTENANCE1_EXTENSION_NAME);
+	}
+#endif
+
+#ifdef VK_KHR_descriptor_update_template
+	// The descriptor sets are written from the structures of the drawables in one call
+	if (IsExtensionSupported(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME))
+	{
+		_enabledExtensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+		_descriptorUpdateTemplateEnabled = true;
+	}
+#endif
+
 	// Create Device with available queue information.
 	float queuePriorities[1]			= { 0.0 };
 	VkDeviceQueueCreateInfo queueInfo	= {};
@@ -33,6 +134,18 @@ VkResult VulkanDevice::CreateDevice(std::vector<const char *>& layers, std::vect
 	queueInfo.queueCount				= 1;
 	queueInfo.pQueuePriorities			= queuePriorities;
 
+	// One queue of each distinct family
+	std::vector<VkDeviceQueueCreateInfo> queueInfos(1, queueInfo);
+	if (HasDedicatedTransferQueue())
+	{
+		queueInfo.queueFamilyIndex = _transferQueueIndex;
+		queueInfos.push_back(queueInfo);
+	}
+	if (HasAsyncComputeQueue() && _computeQueueIndex != _transferQueueIndex)
+	{
+		queueInfo.queueFamilyIndex = _computeQueueIndex;
+		queueInfos.push_back(queueInfo);
+	}
 
 	vkGetPhysicalDeviceFeatures(*_gpu, &_deviceFeatures);
 
@@ -41,21 +154,129 @@ VkResult VulkanDevice::CreateDevice(std::vector<const char *>& layers, std::vect
 
 	VkDeviceCreateInfo deviceInfo		= {};
 	deviceInfo.sType					= VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	deviceInfo.pNext					= nullptr;
-	deviceInfo.queueCreateInfoCount		= 1;
-	deviceInfo.pQueueCreateInfos		= &queueInfo;
+	deviceInfo.pNext					= featureChain;
+	deviceInfo.queueCreateInfoCount		= static_cast<uint32_t>(queueInfos.size());
+	deviceInfo.pQueueCreateInfos		= queueInfos.data();
 	deviceInfo.enabledLayerCount		= 0;
 	deviceInfo.ppEnabledLayerNames		= nullptr;	// Device layers are deprecated
-	deviceInfo.enabledExtensionCount	= static_cast<uint32_t>(extensions.size());
-	deviceInfo.ppEnabledExtensionNames	= !extensions.empty() ? extensions.data() : nullptr;
+	deviceInfo.enabledExtensionCount	= static_cast<uint32_t>(_enabledExtensions.size());
+	deviceInfo.ppEnabledExtensionNames	= !_enabledExtensions.empty() ? _enabledExtensions.data() : nullptr;
 	deviceInfo.pEnabledFeatures			= &setEnabledFeatures;
 
 	const VkResult result = vkCreateDevice(*_gpu, &deviceInfo, nullptr, &_device);
 	assert(result == VK_SUCCESS);
 
+	_samplerCache.Initialize(_device, setEnabledFeatures.samplerAnisotropy == VK_TRUE);
+	_layoutCache.Initialize(_device);
+	_descriptorAllocator.Initialize(this);
+
 	return result;
 }
 
+void VulkanDevice::GetSupportedExtensions()
+{
+	// A null layer name returns the extensions of the driver itself
+	uint32_t extensionCount = 0;
+	VkResult result = vkEnumerateDeviceExtensionProperties(*_gpu, nullptr, &extensionCount, nullptr);
+	assert(result == VK_SUCCESS);
+
+	_supportedExtensions.resize(extensionCount);
+	result = vkEnumerateDeviceExtensionProperties(*_gpu, nullptr, &extensionCount, _supportedExtensions.data());
+	assert(result == VK_SUCCESS);
+}
+
+bool VulkanDevice::IsExtensionSupported(const char* extensionName) const
+{
+	for (const VkExtensionProperties& extension : _supportedExtensions)
+	{
+		if (strcmp(extension.extensionName, extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool VulkanDevice::QueryDescriptorIndexingSupport()
+{
+#ifdef VK_EXT_descriptor_indexing
+	// The queries come from VK_KHR_get_physical_device_properties2, a Vulkan 1.0 instance extension
+	VkInstance instance = VulkanApplication::GetInstance()->_instanceObj._instance;
+	PFN_vkGetPhysicalDeviceFeatures2KHR fpGetPhysicalDeviceFeatures2KHR		= (PFN_vkGetPhysicalDeviceFeatures2KHR) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+	PFN_vkGetPhysicalDeviceProperties2KHR fpGetPhysicalDeviceProperties2KHR	= (PFN_vkGetPhysicalDeviceProperties2KHR) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR");
+	if (!fpGetPhysicalDeviceFeatures2KHR || !fpGetPhysicalDeviceProperties2KHR)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT supportedFeatures = {};
+	supportedFeatures.sType		= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2KHR features2 = {};
+	features2.sType				= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	features2.pNext				= &supportedFeatures;
+	fpGetPhysicalDeviceFeatures2KHR(*_gpu, &features2);
+
+	if (!supportedFeatures.runtimeDescriptorArray ||
+		!supportedFeatures.descriptorBindingPartiallyBound ||
+		!supportedFeatures.descriptorBindingVariableDescriptorCount ||
+		!supportedFeatures.descriptorBindingSampledImageUpdateAfterBind ||
+		!supportedFeatures.descriptorBindingStorageBufferUpdateAfterBind)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProps = {};
+	indexingProps.sType			= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2KHR properties2 = {};
+	properties2.sType			= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+	properties2.pNext			= &indexingProps;
+	fpGetPhysicalDeviceProperties2KHR(*_gpu, &properties2);
+
+	// The whole set is visible to a single stage, so both limits apply
+	_maxUpdateAfterBindSampledImages	= std::min(indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProps.maxDescriptorSetUpdateAfterBindSampledImages);
+	_maxUpdateAfterBindStorageBuffers	= std::min(indexingProps.maxPerStageDescriptorUpdateAfterBindStorageBuffers, indexingProps.maxDescriptorSetUpdateAfterBindStorageBuffers);
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool VulkanDevice::QueryGraphicsPipelineLibrarySupport()
+{
+#ifdef VK_EXT_graphics_pipeline_library
+	VkInstance instance = VulkanApplication::GetInstance()->_instanceObj._instance;
+	PFN_vkGetPhysicalDeviceFeatures2KHR fpGetPhysicalDeviceFeatures2KHR		= (PFN_vkGetPhysicalDeviceFeatures2KHR) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+	PFN_vkGetPhysicalDeviceProperties2KHR fpGetPhysicalDeviceProperties2KHR	= (PFN_vkGetPhysicalDeviceProperties2KHR) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR");
+	if (!fpGetPhysicalDeviceFeatures2KHR || !fpGetPhysicalDeviceProperties2KHR)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT supportedFeatures = {};
+	supportedFeatures.sType		= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2KHR features2 = {};
+	features2.sType				= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	features2.pNext				= &supportedFeatures;
+	fpGetPhysicalDeviceFeatures2KHR(*_gpu, &features2);
+	if (!supportedFeatures.graphicsPipelineLibrary)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProps = {};
+	libraryProps.sType			= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2KHR properties2 = {};
+	properties2.sType			= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+	properties2.pNext			= &libraryProps;
+	fpGetPhysicalDeviceProperties2KHR(*_gpu, &properties2);
+
+	_graphicsPipelineLibraryFastLinking = libraryProps.graphicsPipelineLibraryFastLinking == VK_TRUE;
+	return true;
+#else
+	return false;
+#endif
+}
+
 bool VulkanDevice::MemoryTypeFromProperties(uint32_t typeBits, VkFlags requirementsMask, uint32_t *typeIndex)
 {
 	// Search memtypes to find first index with those properties
@@ -125,8 +346,47 @@ uint32_t VulkanDevice::GetGraphicsQueueHandle()
 	return 0;
 }
 
+void VulkanDevice::GetTransferAndComputeQueueHandles()
+{
+	// Every family supporting graphics or compute supports transfers too
+	_transferQueueIndex	= _graphicsQueueIndex;
+	_computeQueueIndex	= _graphicsQueueIndex;
+
+	const VkQueueFlags graphicsCompute = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+	bool transferOnlyFound = false;
+	for (uint32_t i = 0; i < _queueFamilyCount; i++)
+	{
+		const VkQueueFlags flags = _queueFamilyProps[i].queueFlags;
+
+		// The DMA family runs copies alongside the rendering
+		if (!transferOnlyFound && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & graphicsCompute))
+		{
+			_transferQueueIndex	= i;
+			transferOnlyFound	= true;
+		}
+
+		if (_computeQueueIndex == _graphicsQueueIndex && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			_computeQueueIndex = i;
+		}
+	}
+
+	// Without a DMA family the async compute family is the next best transfer family
+	if (!transferOnlyFound)
+	{
+		_transferQueueIndex = _computeQueueIndex;
+	}
+}
+
 void VulkanDevice::DestroyDevice()
 {
+	// Runs the pending deferred deletions
+	_transferTimeline.Destroy();
+	_computeTimeline.Destroy();
+	_graphicsTimeline.Destroy();
+	_descriptorAllocator.Destroy();
+	_layoutCache.Destroy();
+	_samplerCache.Destroy();
 	vkDestroyDevice(_device, nullptr);
 }
 
@@ -137,4 +397,57 @@ void VulkanDevice::GetDeviceQueue()
 	// Parminder: this depends on intialiing the SwapChain to 
 	// get the graphics queue with presentation support
 	vkGetDeviceQueue(_device, _graphicsQueueWithPresentIndex, 0, &_queue);
+
+	if (!_graphicsTimeline.IsInitialized())
+	{
+		_graphicsTimeline.Initialize(this, _queue);
+	}
+
+	// The transfer and compute queues alias the graphics queue without a family of their own
+	_transferQueue	= _queue;
+	_computeQueue	= _queue;
+	if (HasDedicatedTransferQueue())
+	{
+		vkGetDeviceQueue(_device, _transferQueueIndex, 0, &_transferQueue);
+		if (!_transferTimeline.IsInitialized())
+		{
+			_transferTimeline.Initialize(this, _transferQueue);
+		}
+	}
+	if (HasAsyncComputeQueue())
+	{
+		vkGetDeviceQueue(_device, _computeQueueIndex, 0, &_computeQueue);
+
+		// A family shared with the transfer queue also shares its queue and timeline
+		if (_computeQueueIndex == _transferQueueIndex)
+		{
+			_computeQueue = _transferQueue;
+		}
+		else if (!_computeTimeline.IsInitialized())
+		{
+			_computeTimeline.Initialize(this, _computeQueue);
+		}
+	}
+}
+
+VulkanTimeline& VulkanDevice::GetComputeTimeline()
+{
+	if (!HasAsyncComputeQueue())
+	{
+		return _graphicsTimeline;
+	}
+	return (_computeQueueIndex == _transferQueueIndex) ? _transferTimeline : _computeTimeline;
+}
+
+void VulkanDevice::CollectGarbage()
+{
+	_graphicsTimeline.CollectGarbage();
+	if (_transferTimeline.IsInitialized())
+	{
+		_transferTimeline.CollectGarbage();
+	}
+	if (_computeTimeline.IsInitialized())
+	{
+		_computeTimeline.CollectGarbage();
+	}
 }
@@ -0,0 +1,180 @@
+#include "VulkanDrawSorter.h"
+#include "VulkanDrawable.h"
+
+// Non dispatchable handles are pointers on 64 bit platforms and 64 bit integers on the others
+template <typename Handle>
+static uint64_t GetHandleValue(Handle handle)
+{
+	uint64_t value = 0;
+	memcpy(&value, &handle, sizeof(handle));
+	return value;
+}
+
+VulkanBindState::VulkanBindState() :
+	_bindsIssued(0),
+	_bindsSkipped(0)
+{
+	Reset();
+}
+
+void VulkanBindState::Reset()
+{
+	_pipeline		= VK_NULL_HANDLE;
+	_pipelineLayout	= VK_NULL_HANDLE;
+	_descriptorSet	= VK_NULL_HANDLE;
+	_vertexBuffer	= VK_NULL_HANDLE;
+}
+
+void VulkanBindState::BindPipeline(VkCommandBuffer cmd, VkPipeline pipeline)
+{
+	if (pipeline == _pipeline)
+	{
+		_bindsSkipped++;
+		return;
+	}
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	_pipeline = pipeline;
+	_bindsIssued++;
+}
+
+void VulkanBindState::BindDescriptorSet(VkCommandBuffer cmd, VkPipelineLayout layout, VkDescriptorSet descriptorSet)
+{
+	// Bound sets stay valid across pipeline binds as long as the layouts are compatible,
+	// so the set only has to be bound again when the set or the layout changes.
+	if (layout == _pipelineLayout && descriptorSet == _descriptorSet)
+	{
+		_bindsSkipped++;
+		return;
+	}
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &descriptorSet, 0, nullptr);
+	_pipelineLayout	= layout;
+	_descriptorSet	= descriptorSet;
+	_bindsIssued++;
+}
+
+void VulkanBindState::BindVertexBuffer(VkCommandBuffer cmd, VkBuffer buffer)
+{
+	if (buffer == _vertexBuffer)
+	{
+		_bindsSkipped++;
+		return;
+	}
+
+	const VkDeviceSize offsets[1] = { 0 };
+	vkCmdBindVertexBuffers(cmd, 0, 1, &buffer, offsets);
+	_vertexBuffer = buffer;
+	_bindsIssued++;
+}
+
+VulkanDrawSorter::VulkanDrawSorter() :
+	_maxDepth(100.0f)
+{
+}
+
+void VulkanDrawSorter::Sort(std::vector<VulkanDrawable*>& drawables, DrawPass pass)
+{
+	ResetRegistry();
+	_items.resize(drawables.size());
+	for (size_t i = 0; i < drawables.size(); i++)
+	{
+		_items[i]._key		= BuildKey(pass, drawables[i]);
+		_items[i]._drawable	= drawables[i];
+	}
+
+	RadixSort(_items, _scratch);
+
+	for (size_t i = 0; i < drawables.size(); i++)
+	{
+		drawables[i] = _items[i]._drawable;
+	}
+}
+
+void VulkanDrawSorter::ResetRegistry()
+{
+	_pipelineIds.clear();
+	_materialIds.clear();
+	_meshIds.clear();
+}
+
+uint64_t VulkanDrawSorter::BuildKey(DrawPass pass, VulkanDrawable* drawable)
+{
+	const VkPipeline pipelineHandle = drawable->GetPipeline() ? *drawable->GetPipeline() : VK_NULL_HANDLE;
+	const uint32_t pipeline	= GetId(_pipelineIds, GetHandleValue(pipelineHandle), SORT_KEY_PIPELINE_BITS);
+	const uint32_t material	= GetId(_materialIds, GetHandleValue(drawable->GetDescriptorSet()), SORT_KEY_MATERIAL_BITS);
+	const uint32_t mesh		= GetId(_meshIds, GetHandleValue(drawable->GetVertexBuffer()), SORT_KEY_MESH_BITS);
+
+	// Quantize the view depth, transparent draws are sorted back to front
+	const uint32_t maxDepthValue = (1u << SORT_KEY_DEPTH_BITS) - 1;
+	const float normalizedDepth  = std::min(std::max(drawable->GetViewDepth() / _maxDepth, 0.0f), 1.0f);
+	uint32_t depth               = static_cast<uint32_t>(normalizedDepth * maxDepthValue);
+	if (pass == DRAW_PASS_TRANSPARENT)
+	{
+		depth = maxDepthValue - depth;
+	}
+
+	uint64_t key = static_cast<uint64_t>(pass);
+	key = (key << SORT_KEY_PIPELINE_BITS) | static_cast<uint64_t>(pipeline);
+	key = (key << SORT_KEY_MATERIAL_BITS) | static_cast<uint64_t>(material);
+	key = (key << SORT_KEY_MESH_BITS)	  | static_cast<uint64_t>(mesh);
+	key = (key << SORT_KEY_DEPTH_BITS)	  | static_cast<uint64_t>(depth);
+	return key;
+}
+
+uint32_t VulkanDrawSorter::GetId(std::unordered_map<uint64_t, uint32_t>& registry, uint64_t handle, uint32_t bits)
+{
+	auto it = registry.find(handle);
+	if (it != registry.end())
+	{
+		return it->second;
+	}
+
+	// The ids are given per sort, so only a list with more distinct handles
+	// than the field holds can run out of them
+	const uint32_t id = static_cast<uint32_t>(registry.size());
+	assert(id < (1u << bits));
+	registry[handle] = id;
+	return id;
+}
+
+void VulkanDrawSorter::RadixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch)
+{
+	// Least significant digit first, 8 bits per pass. Each pass is a stable
+	// counting sort, which keeps the order established by the previous passes.
+	const size_t count = items.size();
+	if (count < 2)
+	{
+		return;
+	}
+	scratch.resize(count);
+
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[256] = {};
+		for (size_t i = 0; i < count; i++)
+		{
+			histogram[(items[i]._key >> shift) & 0xFF]++;
+		}
+
+		// All the keys share this digit, the pass would not move anything
+		if (histogram[(items[0]._key >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+		for (size_t& bucket : histogram)
+		{
+			const size_t bucketSize = bucket;
+			bucket = offset;
+			offset += bucketSize;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			scratch[histogram[(items[i]._key >> shift) & 0xFF]++] = items[i];
+		}
+		items.swap(scratch);
+	}
+}
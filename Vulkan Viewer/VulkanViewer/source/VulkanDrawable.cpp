@@ -2,65 +2,31 @@
 #include "VulkanPipeline.h"
 #include "VulkanDevice.h"
 
-VulkanDrawable::VulkanDrawable(VkDevice* device,
-	                           VkCommandPool* commandPool,
-	                           VkRenderPass* renderPass,
-	                           VkQueue* queue,
-	                           std::vector<VkDescriptorSetLayout>* framebuffers,
-	                           VulkanSwapChain* swapChainObj,
-	                           int* width,
-	                           int* height) :
+VulkanDrawable::VulkanDrawable(VkDevice* device) :
     _device(device),
-    _commandPool(commandPool),
-    _renderPass(renderPass),
-    _queue(queue),
-    _framebuffers(framebuffers),
-    _swapChainObj(swapChainObj),
-    _width(width),
-    _height(height),
 	_viIpBind(),
-	_viIpAttrb{}, 
-	_viewport(), 
-	_scissor(),
 	_textures(nullptr), 
-	_pipeline(nullptr)
+	_atlasRegion(ATLAS_NO_REGION),
+	_shader(nullptr),
+	_shaderVariant(0),
+	_bindlessSet(nullptr),
+	_bindlessIndices(),
+	_descriptorData(),
+	_descriptorTemplate(),
+	_pipeline(nullptr),
+	_isStatic(false),
+	_isVisible(true),
+	_stateVersion(0)
 {
 	// Note: It's very important to initilize the member with 0 or respective value other wise it will break the system
 	memset(&_uniformData, 0, sizeof(_uniformData));
 	memset(&_vertexBuffer, 0, sizeof(_vertexBuffer));
-
-	VkSemaphoreCreateInfo presentCompleteSemaphoreCreateInfo;
-	presentCompleteSemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	presentCompleteSemaphoreCreateInfo.pNext = nullptr;
-	presentCompleteSemaphoreCreateInfo.flags = 0;
-
-	VkSemaphoreCreateInfo drawingCompleteSemaphoreCreateInfo;
-	drawingCompleteSemaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	drawingCompleteSemaphoreCreateInfo.pNext = nullptr;
-	drawingCompleteSemaphoreCreateInfo.flags = 0;
-
-	vkCreateSemaphore(*_device, &presentCompleteSemaphoreCreateInfo, nullptr, &_presentCompleteSemaphore);
-	vkCreateSemaphore(*_device, &drawingCompleteSemaphoreCreateInfo, nullptr, &_drawingCompleteSemaphore);
 }
 
 VulkanDrawable::~VulkanDrawable()
 {
 }
 
-void VulkanDrawable::DestroyCommandBuffer()
-{
-	for (auto& i : _vecCmdDraw)
-	{
-		vkFreeCommandBuffers(*_device, *_commandPool, 1, &i);
-	}
-}
-
-void VulkanDrawable::DestroySynchronizationObjects()
-{
-	vkDestroySemaphore(*_device, _presentCompleteSemaphore, nullptr);
-	vkDestroySemaphore(*_device, _drawingCompleteSemaphore, nullptr);
-}
-
 void VulkanDrawable::CreateUniformBuffer()
 {
 	_projectionMatrix	= glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
@@ -76,7 +42,8 @@ void VulkanDrawable::CreateUniformBuffer()
 	VkBufferCreateInfo bufInfo;
 	bufInfo.sType					= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufInfo.pNext					= nullptr;
-	bufInfo.usage					= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	bufInfo.usage					= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |	// Storage buffer of the bindless set
+		                              VK_BUFFER_USAGE_TRANSFER_DST_BIT;									// Written by vkCmdUpdateBuffer
 	bufInfo.size					= sizeof(_mvpMatrix);
 	bufInfo.queueFamilyIndexCount	= 0;
 	bufInfo.pQueueFamilyIndices  	= nullptr;
@@ -97,10 +64,10 @@ void VulkanDrawable::CreateUniformBuffer()
 	memAllocInfo.memoryTypeIndex	= 0;
 	memAllocInfo.allocationSize     = memRqrmnt.size;
 
-	// Determine the type of memory required 
-	// with the help of memory properties
+	// The matrix is written by the command buffers of the frames, the
+	// host never touches the buffer
 	const bool pass = _deviceObj->MemoryTypeFromProperties(memRqrmnt.memoryTypeBits, 
-		                                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+		                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		                                                   &memAllocInfo.memoryTypeIndex);
 	assert(pass);
 
@@ -108,33 +75,6 @@ void VulkanDrawable::CreateUniformBuffer()
 	result = vkAllocateMemory(*_device, &memAllocInfo, nullptr, &(_uniformData._memory));
 	assert(result == VK_SUCCESS);
 
-	// Map the GPU memory on to local host
-	result = vkMapMemory(*_device, 
-		                 _uniformData._memory,
-		                 0,
-		                 memRqrmnt.size, 
-		                 0, 
-		                 reinterpret_cast<void **>(&_uniformData._pData));
-	assert(result == VK_SUCCESS);
-
-	// Copy computed data in the mapped buffer
-	memcpy(_uniformData._pData, &_mvpMatrix, sizeof(_mvpMatrix));
-
-	// We have only one Uniform buffer object to update
-	_uniformData._mappedRange.resize(1);
-
-	// Populate the VkMappedMemoryRange data structure
-	_uniformData._mappedRange[0].sType	= VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-	_uniformData._mappedRange[0].memory	= _uniformData._memory;
-	_uniformData._mappedRange[0].offset	= 0;
-	_uniformData._mappedRange[0].size	= sizeof(_mvpMatrix);
-
-	// Invalidate the range of mapped buffer in order to make it visible to the host.
-	// If the memory property is set with VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-	// then the driver may take care of this, otherwise for non-coherent 
-	// mapped memory vkInvalidateMappedMemoryRanges() needs to be called explicitly.
-	vkInvalidateMappedMemoryRanges(*_device, 1, &_uniformData._mappedRange[0]);
-
 	// Bind the buffer device memory 
 	result = vkBindBufferMemory(*_device,
 		                        _uniformData._buffer,
@@ -146,10 +86,9 @@ void VulkanDrawable::CreateUniformBuffer()
 	_uniformData._bufferInfo.buffer	= _uniformData._buffer;
 	_uniformData._bufferInfo.offset	= 0;
 	_uniformData._bufferInfo.range	= sizeof(_mvpMatrix);
-	_uniformData._memRqrmnt			= memRqrmnt;
 }
 
-void VulkanDrawable::CreateVertexBuffer(const void *vertexData, uint32_t dataSize, uint32_t dataStride, bool useTexture)
+void VulkanDrawable::CreateVertexBuffer(const void *vertexData, uint32_t dataSize, uint32_t dataStride)
 {
 	// Create the Buffer resourece metadata information
 	VkBufferCreateInfo bufInfo;
@@ -209,58 +148,11 @@ void VulkanDrawable::CreateVertexBuffer(const void *vertexData, uint32_t dataSiz
 	result = vkBindBufferMemory(*_device, _vertexBuffer._buf, _vertexBuffer._mem, 0);
 	assert(result == VK_SUCCESS);
 
-	// Once the buffer resource is implemented, its binding points are 
-	// stored into the(
 	// The VkVertexInputBinding viIpBind, stores the rate at which the information will be
-	// injected for vertex input.
+	// injected for vertex input. The attributes are read from the vertex shader.
 	_viIpBind.binding		= 0;
 	_viIpBind.inputRate		= VK_VERTEX_INPUT_RATE_VERTEX;
 	_viIpBind.stride		= dataStride;
-
-	// The VkVertexInputAttribute - Description) structure, store 
-	// the information that helps in interpreting the data.
-	_viIpAttrb[0].binding	= 0;
-	_viIpAttrb[0].location	= 0;
-	_viIpAttrb[0].format	= VK_FORMAT_R32G32B32A32_SFLOAT;
-	_viIpAttrb[0].offset	= 0;
-	_viIpAttrb[1].binding	= 0;
-	_viIpAttrb[1].location	= 1;
-	_viIpAttrb[1].format	= useTexture ? VK_FORMAT_R32G32_SFLOAT : VK_FORMAT_R32G32B32A32_SFLOAT;
-	_viIpAttrb[1].offset	= 16; // After, 4 components - RGBA  each of 4 bytes(32bits)
-}
-
-// Creates the descriptor pool, this function depends on - 
-// createDescriptorSetLayout()
-void VulkanDrawable::CreateDescriptorPool(bool useTexture)
-{
-	// Define the size of descriptor pool based on the
-	// type of descriptor set being used.
-	std::vector<VkDescriptorPoolSize> descriptorTypePool;
-
-	// The first descriptor pool object is of type Uniform buffer
-	descriptorTypePool.push_back(VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 });
-
-	// If texture is supported then define second object with 
-	// descriptor type to be Image sampler
-	if (useTexture) 
-	{
-		descriptorTypePool.push_back(VkDescriptorPoolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 });
-	}
-
-	// Populate the descriptor pool state information
-	// in the create info structure.
-	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo;
-	descriptorPoolCreateInfo.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	descriptorPoolCreateInfo.pNext			= nullptr;
-	descriptorPoolCreateInfo.maxSets		= 1;
-	descriptorPoolCreateInfo.flags			= VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-	descriptorPoolCreateInfo.poolSizeCount	= static_cast<uint32_t>(descriptorTypePool.size());
-	descriptorPoolCreateInfo.pPoolSizes		= descriptorTypePool.data();
-	
-	// Create the descriptor pool using the descriptor 
-	// pool create info structure
-	const VkResult result = vkCreateDescriptorPool(*_device, &descriptorPoolCreateInfo, nullptr, &_descriptorPool);
-	assert(result == VK_SUCCESS);
 }
 
 // Create the Uniform resource inside. Create Descriptor set associated resources 
@@ -270,77 +162,58 @@ void VulkanDrawable::CreateDescriptorResources()
 	CreateUniformBuffer();
 }
 
-// Creates the descriptor sets using descriptor pool.
-// This function depend on the createDescriptorPool() and createUniformBuffer().
+// Creates the descriptor sets from the allocator shared by the drawables.
+// This function depend on the createDescriptorSetLayout() and createUniformBuffer().
 void VulkanDrawable::CreateDescriptorSet(bool useTexture)
 {
-	// Create the descriptor allocation structure and specify the descriptor 
-	// pool and descriptor layout
-	VkDescriptorSetAllocateInfo dsAllocInfo[1];
-	dsAllocInfo[0].sType				= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	dsAllocInfo[0].pNext				= nullptr;
-	dsAllocInfo[0].descriptorPool		= _descriptorPool;
-	dsAllocInfo[0].descriptorSetCount	= 1;
-	dsAllocInfo[0].pSetLayouts			= _descLayout.data();
-
 	// Allocate the number of descriptor sets needs to be produced
-	_descriptorSet.resize(1);
+	_descriptorSet.resize(_descLayout.size());
+	for (size_t i = 0; i < _descLayout.size(); i++)
+	{
+		const bool allocated = _deviceObj->_descriptorAllocator.Allocate(_descLayout[i], &_descriptorSet[i]);
+		assert(allocated);
+	}
+	if (_descriptorSet.empty())
+	{
+		return;
+	}
 
-	// Allocate descriptor sets
-	const VkResult result = vkAllocateDescriptorSets(*_device, dsAllocInfo, _descriptorSet.data());
-	assert(result == VK_SUCCESS);
+	// The template writes 1. MVP and 2. Texture, at the bindings the shaders declare them.
+	// The draws bind a single set, all the bindings are in it.
+	DescriptorTemplateEntry entries[2];
+	uint32_t entryCount = 0;
 
-	// Allocate two write descriptors for - 1. MVP and 2. Texture
-	VkWriteDescriptorSet writes[2];
-	memset(&writes, 0, sizeof(writes));
-	
-	// Specify the uniform buffer related 
-	// information into first write descriptor
-	writes[0]					= {};
-	writes[0].sType				= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	writes[0].pNext				= nullptr;
-	writes[0].dstSet			= _descriptorSet[0];
-	writes[0].descriptorCount	= 1;
-	writes[0].descriptorType	= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	writes[0].pBufferInfo		= &_uniformData._bufferInfo;
-	writes[0].dstArrayElement	= 0;
-	writes[0].dstBinding		= 0; // DESCRIPTOR_SET_BINDING_INDEX
-
-	// If texture is used then update the second write descriptor structure
-	if (useTexture)
+	const ShaderBinding* uniformBinding = _shader->_reflection.FindBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+	if (uniformBinding)
 	{
-		writes[1]					= {};
-		writes[1].sType				= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writes[1].dstSet			= _descriptorSet[0];
-		writes[1].dstBinding		= 1; // DESCRIPTOR_SET_BINDING_INDEX
-		writes[1].descriptorCount	= 1;
-		writes[1].descriptorType	= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		writes[1].pImageInfo		= &_textures->descsImgInfo;
-		writes[1].dstArrayElement	= 0;
+		entries[entryCount]._binding	= uniformBinding->_binding;
+		entries[entryCount]._type		= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		entries[entryCount]._offset		= offsetof(DescriptorData, _uniform);
+		entryCount++;
 	}
 
-	// Update the uniform buffer into the allocated descriptor set
-	vkUpdateDescriptorSets(*_device, useTexture ? 2 : 1, writes, 0, nullptr);
-}
+	// If texture is used then the template writes it too
+	const ShaderBinding* textureBinding = _shader->_reflection.FindBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	if (useTexture && textureBinding && _textures)
+	{
+		entries[entryCount]._binding	= textureBinding->_binding;
+		entries[entryCount]._type		= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		entries[entryCount]._offset		= offsetof(DescriptorData, _texture);
+		entryCount++;
+	}
 
-void VulkanDrawable::InitViewports(VkCommandBuffer* cmd)
-{
-	_viewport.height	= static_cast<float>(*_height);
-	_viewport.width		= static_cast<float>(*_width);
-	_viewport.minDepth	= static_cast<float>(0.0f);
-	_viewport.maxDepth	= static_cast<float>(1.0f);
-	_viewport.x			= 0;
-	_viewport.y			= 0;
-	vkCmdSetViewport(*cmd, 0, NUMBER_OF_VIEWPORTS, &_viewport);
+	_deviceObj->_descriptorAllocator.CreateTemplate(_descLayout[0], entries, entryCount, &_descriptorTemplate);
+	WriteDescriptorSet();
 }
 
-void VulkanDrawable::InitScissors(VkCommandBuffer* cmd)
+void VulkanDrawable::WriteDescriptorSet()
 {
-	_scissor.extent.width	= *_width;
-	_scissor.extent.height	= *_height;
-	_scissor.offset.x		= 0;
-	_scissor.offset.y		= 0;
-	vkCmdSetScissor(*cmd, 0, NUMBER_OF_SCISSORS, &_scissor);
+	_descriptorData._uniform = _uniformData._bufferInfo;
+	if (_textures)
+	{
+		_descriptorData._texture = _textures->descsImgInfo;
+	}
+	_deviceObj->_descriptorAllocator.UpdateSet(_descriptorSet[0], _descriptorTemplate, &_descriptorData);
 }
 
 void VulkanDrawable::DestroyVertexBuffer()
@@ -351,7 +224,6 @@ void VulkanDrawable::DestroyVertexBuffer()
 
 void VulkanDrawable::DestroyUniformBuffer()
 {
-	vkUnmapMemory(*_device, _uniformData._memory);
 	vkDestroyBuffer(*_device, _uniformData._buffer, nullptr);
 	vkFreeMemory(*_device, _uniformData._memory, nullptr);
 }
@@ -361,79 +233,84 @@ void VulkanDrawable::SetTextures(TextureData * tex)
 	_textures = tex;
 }
 
-void VulkanDrawable::RecordCommandBuffer(int currentImage, VkCommandBuffer* cmdDraw)
+void VulkanDrawable::UpdateTextureDescriptor()
 {
-	// Specify the clear color value
-	VkClearValue clearValues[2];
-	clearValues[0].color.float32[0]		= 1.0f;
-	clearValues[0].color.float32[1]		= 1.0f;
-	clearValues[0].color.float32[2]		= 1.0f;
-	clearValues[0].color.float32[3]		= 1.0f;
-
-	// Specify the depth/stencil clear value
-	clearValues[1].depthStencil.depth	= 1.0f;
-	clearValues[1].depthStencil.stencil	= 0;
-
-	// Define the VkRenderPassBeginInfo control structure
-	VkRenderPassBeginInfo renderPassBegin;
-	renderPassBegin.sType						= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBegin.pNext						= nullptr;
-	renderPassBegin.renderPass					= *_renderPass;
-	renderPassBegin.framebuffer					= (*_framebuffers)[currentImage];
-	renderPassBegin.renderArea.offset.x			= 0;
-	renderPassBegin.renderArea.offset.y			= 0;
-	renderPassBegin.renderArea.extent.width		= *_width;
-	renderPassBegin.renderArea.extent.height	= *_height;
-	renderPassBegin.clearValueCount				= 2;
-	renderPassBegin.pClearValues				= clearValues;
-	
-	// Start recording the render pass instance
-	vkCmdBeginRenderPass(*cmdDraw, &renderPassBegin, VK_SUBPASS_CONTENTS_INLINE);
+	if (_bindlessSet && _textures)
+	{
+		_bindlessIndices._textureIndex = _bindlessSet->UpdateTexture(_textures);
+		return;
+	}
+	if (!_textures || _descriptorSet.empty())
+	{
+		return;
+	}
 
-	// Bound the command buffer with the graphics pipeline
-	vkCmdBindPipeline(*cmdDraw, VK_PIPELINE_BIND_POINT_GRAPHICS, *_pipeline);
-	vkCmdBindDescriptorSets(*cmdDraw, 
-		                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-		                    _pipelineLayout,
-		                    0, 
-		                    1, 
-		                    _descriptorSet.data(),
-		                    0,
-		                    nullptr);
-	// Bound the command buffer with the graphics pipeline
-	const VkDeviceSize offsets[1] = { 0 };
-	vkCmdBindVertexBuffers(*cmdDraw, 0, 1, &_vertexBuffer._buf, offsets);
+	// The frames in flight may still read the set, the new one is written whole, the
+	// template makes it as cheap as the texture alone
+	const VkDescriptorSet previousSet = _descriptorSet[0];
+	const bool allocated = _deviceObj->_descriptorAllocator.Allocate(_descLayout[0], &_descriptorSet[0]);
+	assert(allocated);
+	WriteDescriptorSet();
+
+	VulkanDescriptorAllocator* allocator	= &_deviceObj->_descriptorAllocator;
+	const VkDescriptorSetLayout layout		= _descLayout[0];
+	VulkanTimeline& timeline				= _deviceObj->_graphicsTimeline;
+	timeline.DeferUntil(timeline.GetLastSubmitted(), [allocator, layout, previousSet]()
+	{
+		allocator->Free(layout, previousSet);
+	});
+}
 
-	// Define the dynamic viewport here
-	InitViewports(cmdDraw);
+void VulkanDrawable::RecordDrawCommands(VkCommandBuffer cmdDraw, VulkanBindState& bindState)
+{
+	// Skip the draw until its pipeline is compiled
+	if (!_pipeline || *_pipeline == VK_NULL_HANDLE)
+	{
+		return;
+	}
 
-	// Define the scissoring 
-	InitScissors(cmdDraw);
+	// Bound the command buffer with the graphics pipeline
+	bindState.BindPipeline(cmdDraw, *_pipeline);
+	if (_bindlessSet)
+	{
+		// The set is shared by all the draws, only the indices change
+		bindState.BindDescriptorSet(cmdDraw, _pipelineLayout, _bindlessSet->GetDescriptorSet());
+		vkCmdPushConstants(cmdDraw, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(_bindlessIndices), &_bindlessIndices);
+	}
+	else
+	{
+		bindState.BindDescriptorSet(cmdDraw, _pipelineLayout, _descriptorSet[0]);
+	}
+	// Bound the command buffer with the vertex buffer
+	bindState.BindVertexBuffer(cmdDraw, _vertexBuffer._buf);
 
 	// Issue the draw command 6 faces consisting of 2 triangles each with 3 vertices.
-	vkCmdDraw(*cmdDraw, 3 * 2 * 6, 1, 0, 0);
-
-	// End of render pass instance recording
-	vkCmdEndRenderPass(*cmdDraw);
+	vkCmdDraw(cmdDraw, 3 * 2 * 6, 1, 0, 0);
 }
 
-void VulkanDrawable::Prepare()
+VkDescriptorSet VulkanDrawable::GetDescriptorSet() const
 {
-	_vecCmdDraw.resize(_swapChainObj->_scPublicVars._colorBuffer.size());
-	// For each swapbuffer color surface image buffer 
-	// allocate the corresponding command buffer
-	for (int i = 0; i < _swapChainObj->_scPublicVars._colorBuffer.size(); i++)
+	if (_bindlessSet)
 	{
-		// Allocate, create and start command buffer recording
-		CommandBufferMgr::allocCommandBuffer(_device, *_commandPool, &_vecCmdDraw[i]);
-		CommandBufferMgr::beginCommandBuffer(_vecCmdDraw[i]);
+		return _bindlessSet->GetDescriptorSet();
+	}
+	return _descriptorSet.empty() ? VK_NULL_HANDLE : _descriptorSet[0];
+}
 
-		// Create the render pass instance 
-		RecordCommandBuffer(i, &_vecCmdDraw[i]);
+float VulkanDrawable::GetViewDepth() const
+{
+	// Distance of the model origin along the view direction, the
+	// clip space w of a perspective projection holds the view depth.
+	const glm::vec4 origin = _mvpMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	return origin.w;
+}
 
-		// Finish the command buffer recording
-		CommandBufferMgr::endCommandBuffer(_vecCmdDraw[i]);
-	}
+float VulkanDrawable::GetProjectedSize(float viewportHeight) const
+{
+	// The faces of the cube are 2 units tall and map the whole texture. The perspective
+	// divide by the view depth gives their height in normalized device coordinates.
+	const float depth = std::max(GetViewDepth(), 0.1f);
+	return 2.0f * _projectionMatrix[1][1] / depth * viewportHeight * 0.5f;
 }
 
 void VulkanDrawable::Update()
@@ -449,106 +326,33 @@ void VulkanDrawable::Update()
 	rot += .0005f;
 	_modelMatrix = glm::rotate(_modelMatrix, rot, glm::vec3(0.0, 1.0, 0.0)) * glm::rotate(_modelMatrix, rot, glm::vec3(1.0, 1.0, 1.0));
 
-	glm::mat4 MVP = _projectionMatrix * _viewMatrix * _modelMatrix;
-
-	// Invalidate the range of mapped buffer in order to make it visible to the host.
-	// If the memory property is set with VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-	// then the driver may take care of this, otherwise for non-coherent 
-	// mapped memory vkInvalidateMappedMemoryRanges() needs to be called explicitly.
-	VkResult res = vkInvalidateMappedMemoryRanges(*_device, 1, &_uniformData._mappedRange[0]);
-	assert(res == VK_SUCCESS);
-
-	// Copy updated data into the mapped memory
-	memcpy(_uniformData._pData, &MVP, sizeof(MVP));
-
-	// Flush the range of mapped buffer in order to make it visible to the device
-	// If the memory is coherent (memory property must be beVK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
-	// then the driver may take care of this, otherwise for non-coherent 
-	// mapped memory vkFlushMappedMemoryRanges() needs to be called explicitly to flush out 
-	// the pending writes on the host side.
-	res = vkFlushMappedMemoryRanges(*_device, 1, &_uniformData._mappedRange[0]);
-	assert(res == VK_SUCCESS);
+	_mvpMatrix = _projectionMatrix * _viewMatrix * _modelMatrix;
 }
 
-void VulkanDrawable::Render()
+void VulkanDrawable::RecordUniformUpdate(VkCommandBuffer cmd) const
 {
-	uint32_t& currentColorImage		= _swapChainObj->_scPublicVars._currentColorBuffer;
-	VkSwapchainKHR& swapChain		= _swapChainObj->_scPublicVars._swapChain;
-	
-	// Get the index of the next available swapchain image:
-	VkResult result = _swapChainObj->fpAcquireNextImageKHR(*_device, 
-		                                                   swapChain,
-		                                                   UINT64_MAX, 
-		                                                   _presentCompleteSemaphore,
-		                                                   VK_NULL_HANDLE,
-		                                                   &currentColorImage);
-
-	VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
-	VkSubmitInfo submitInfo;
-	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.pNext				= nullptr;
-	submitInfo.waitSemaphoreCount	= 1;
-	submitInfo.pWaitSemaphores		= &_presentCompleteSemaphore;
-	submitInfo.pWaitDstStageMask	= &submitPipelineStages;
-	submitInfo.commandBufferCount	= static_cast<uint32_t>(sizeof(&_vecCmdDraw[currentColorImage])) / sizeof(VkCommandBuffer);
-	submitInfo.pCommandBuffers		= &_vecCmdDraw[currentColorImage];
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores	= &_drawingCompleteSemaphore;
-
-	// Queue the command buffer for execution
-	CommandBufferMgr::submitCommandBuffer(*_queue, &_vecCmdDraw[currentColorImage], &submitInfo);
-
-	// Present the image in the window
-	VkPresentInfoKHR present;
-	present.sType				= VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	present.pNext				= nullptr;
-	present.swapchainCount		= 1;
-	present.pSwapchains			= &swapChain;
-	present.pImageIndices		= &currentColorImage;
-	present.pWaitSemaphores		= &_drawingCompleteSemaphore;
-	present.waitSemaphoreCount	= 1;
-	present.pResults			= nullptr;
-
-	// Queue the image for presentation,
-	result = _swapChainObj->fpQueuePresentKHR(*_queue, &present);
-	assert(result == VK_SUCCESS);
+	vkCmdUpdateBuffer(cmd, _uniformData._buffer, 0, sizeof(_mvpMatrix), &_mvpMatrix);
 }
 
 void VulkanDrawable::CreateDescriptorSetLayout(bool useTexture)
 {
-	// Define the layout binding information for the descriptor set(before creating it)
-	// Specify binding point, shader type(like vertex shader below), count etc.
-	VkDescriptorSetLayoutBinding layoutBindings[2];
-	layoutBindings[0].binding				= 0; // DESCRIPTOR_SET_BINDING_INDEX
-	layoutBindings[0].descriptorType		= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	layoutBindings[0].descriptorCount		= 1;
-	layoutBindings[0].stageFlags			= VK_SHADER_STAGE_VERTEX_BIT;
-	layoutBindings[0].pImmutableSamplers	= nullptr;
-
-	// If texture is being used then there existing second binding in the fragment shader
-	if (useTexture)
+	// The layout binding information for the descriptor sets comes from the shaders, with
+	// the binding points, descriptor types and stages they declare.
+	// The samplers of the cache live as long as the device, so the one of the texture is
+	// baked in the layout and the descriptor writes only carry the image view.
+	const VkSampler* immutableSampler = useTexture && _textures ? &_textures->sampler : nullptr;
+
+	// The draws bind a single descriptor set
+	_descLayout.resize(_shader->_reflection.GetSetCount());
+	assert(_descLayout.size() <= 1);
+	for (uint32_t set = 0; set < _descLayout.size(); set++)
 	{
-		layoutBindings[1].binding				= 1; // DESCRIPTOR_SET_BINDING_INDEX
-		layoutBindings[1].descriptorType		= VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		layoutBindings[1].descriptorCount		= 1;
-		layoutBindings[1].stageFlags			= VK_SHADER_STAGE_FRAGMENT_BIT;
-		layoutBindings[1].pImmutableSamplers	= nullptr;
-	}
+		std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+		_shader->_reflection.GetSetLayoutBindings(set, immutableSampler, &layoutBindings);
 
-	// Specify the layout bind into the VkDescriptorSetLayoutCreateInfo
-	// and use it to create a descriptor set layout
-	VkDescriptorSetLayoutCreateInfo descriptorLayout = {};
-	descriptorLayout.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	descriptorLayout.pNext			= nullptr;
-	descriptorLayout.bindingCount	= useTexture ? 2 : 1;
-	descriptorLayout.pBindings		= layoutBindings;
-
-	// Allocate required number of descriptor layout objects and  
-	// create them using vkCreateDescriptorSetLayout()
-	_descLayout.resize(1);
-	const VkResult result = vkCreateDescriptorSetLayout(*_device, &descriptorLayout, nullptr, _descLayout.data());
-	assert(result == VK_SUCCESS);
+		// The drawables with the same bindings and sampler share the layout
+		_descLayout[set] = _deviceObj->_layoutCache.GetDescriptorSetLayout(layoutBindings);
+	}
 }
 
 // createPipelineLayout is a virtual function from 
@@ -558,15 +362,43 @@ void VulkanDrawable::CreateDescriptorSetLayout(bool useTexture)
 // Creates the pipeline layout to inject into the pipeline
 void VulkanDrawable::CreatePipelineLayout()
 {
-	// Create the pipeline layout with the help of descriptor layout.
-	VkPipelineLayoutCreateInfo pPipelineLayoutCreateInfo;
-	pPipelineLayoutCreateInfo.sType						= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pPipelineLayoutCreateInfo.pNext						= nullptr;
-	pPipelineLayoutCreateInfo.pushConstantRangeCount	= 0;
-	pPipelineLayoutCreateInfo.pPushConstantRanges		= nullptr;
-	pPipelineLayoutCreateInfo.setLayoutCount			= static_cast<uint32_t>(_descLayout.size());
-	pPipelineLayoutCreateInfo.pSetLayouts				= _descLayout.data();
-
-	const VkResult result = vkCreatePipelineLayout(*_device, &pPipelineLayoutCreateInfo, nullptr, &_pipelineLayout);
-	assert(result == VK_SUCCESS);
+	// The drawables using the bindless set share its pipeline layout
+	if (_bindlessSet)
+	{
+		_pipelineLayout = _bindlessSet->GetPipelineLayout();
+		return;
+	}
+
+	// The pipeline layout of the descriptor layouts and the push constants of the shaders. The
+	// drawables sharing it share their pipelines too, and the sets bound stay bound between them.
+	_pipelineLayout = _deviceObj->_layoutCache.GetPipelineLayout(_descLayout, _shader->_reflection._pushConstantRanges);
+}
+
+void VulkanDrawable::CreateBindlessDescriptor(VulkanBindlessSet* bindlessSet)
+{
+	CreateDescriptorResources();
+
+	_bindlessSet						= bindlessSet;
+	_bindlessIndices._bufferIndex		= _bindlessSet->AddBuffer(_uniformData._bufferInfo);
+	_bindlessIndices._textureIndex		= _textures ? _bindlessSet->AddTexture(_textures) : 0;
+	_stateVersion++;
+}
+
+void VulkanDrawable::DestroyDescriptor()
+{
+	if (!_bindlessSet)
+	{
+		_deviceObj->_descriptorAllocator.DestroyTemplate(&_descriptorTemplate);
+		VulkanDescriptor::DestroyDescriptor();
+		return;
+	}
+
+	// The layouts belong to the bindless set, only the slots of the drawable are released
+	_bindlessSet->RemoveBuffer(_bindlessIndices._bufferIndex);
+	if (_textures)
+	{
+		_bindlessSet->RemoveTexture(_textures);
+	}
+	_bindlessSet	= nullptr;
+	_pipelineLayout	= VK_NULL_HANDLE;
 }
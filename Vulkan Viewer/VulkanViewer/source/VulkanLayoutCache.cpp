@@ -0,0 +1,126 @@
+#include "VulkanLayoutCache.h"
+#include "Wrappers.h"
+
+VulkanLayoutCache::VulkanLayoutCache() :
+	_device(VK_NULL_HANDLE)
+{
+}
+
+VulkanLayoutCache::~VulkanLayoutCache()
+{
+}
+
+void VulkanLayoutCache::Initialize(VkDevice device)
+{
+	_device = device;
+}
+
+void VulkanLayoutCache::Destroy()
+{
+	// The pipeline layouts reference the set layouts, they go first
+	for (auto& pipelineLayout : _pipelineLayouts)
+	{
+		vkDestroyPipelineLayout(_device, pipelineLayout.second, nullptr);
+	}
+	_pipelineLayouts.clear();
+
+	for (auto& setLayout : _setLayouts)
+	{
+		vkDestroyDescriptorSetLayout(_device, setLayout.second, nullptr);
+	}
+	_setLayouts.clear();
+}
+
+VkDescriptorSetLayout VulkanLayoutCache::GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	// The order of the bindings does not change the layout, they are keyed sorted
+	std::vector<VkDescriptorSetLayoutBinding> sortedBindings = bindings;
+	std::sort(sortedBindings.begin(), sortedBindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+	{
+		return a.binding < b.binding;
+	});
+
+	LayoutKey key;
+	key.reserve(sortedBindings.size() * 5);
+	for (const VkDescriptorSetLayoutBinding& binding : sortedBindings)
+	{
+		key.push_back(binding.binding);
+		key.push_back(binding.descriptorType);
+		key.push_back(binding.descriptorCount);
+		key.push_back(binding.stageFlags);
+		key.push_back(binding.pImmutableSamplers ? 1 : 0);
+		if (binding.pImmutableSamplers)
+		{
+			for (uint32_t i = 0; i < binding.descriptorCount; i++)
+			{
+				key.push_back((uint64_t)(binding.pImmutableSamplers[i]));
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _setLayouts.find(key);
+	if (it != _setLayouts.end())
+	{
+		return it->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo descriptorLayout = {};
+	descriptorLayout.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorLayout.pNext			= nullptr;
+	descriptorLayout.bindingCount	= static_cast<uint32_t>(sortedBindings.size());
+	descriptorLayout.pBindings		= sortedBindings.data();
+
+	VkDescriptorSetLayout setLayout;
+	const VkResult result = vkCreateDescriptorSetLayout(_device, &descriptorLayout, nullptr, &setLayout);
+	assert(result == VK_SUCCESS);
+
+	_setLayouts[key] = setLayout;
+	return setLayout;
+}
+
+VkPipelineLayout VulkanLayoutCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+	// The set layouts are shared, equal handles mean equal layouts
+	LayoutKey key;
+	key.reserve(1 + setLayouts.size() + pushConstantRanges.size() * 3);
+	key.push_back(setLayouts.size());
+	for (VkDescriptorSetLayout setLayout : setLayouts)
+	{
+		key.push_back((uint64_t)(setLayout));
+	}
+	for (const VkPushConstantRange& range : pushConstantRanges)
+	{
+		key.push_back(range.stageFlags);
+		key.push_back(range.offset);
+		key.push_back(range.size);
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _pipelineLayouts.find(key);
+	if (it != _pipelineLayouts.end())
+	{
+		return it->second;
+	}
+
+	VkPipelineLayoutCreateInfo pPipelineLayoutCreateInfo;
+	pPipelineLayoutCreateInfo.sType						= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pPipelineLayoutCreateInfo.pNext						= nullptr;
+	pPipelineLayoutCreateInfo.flags						= 0;
+	pPipelineLayoutCreateInfo.pushConstantRangeCount	= static_cast<uint32_t>(pushConstantRanges.size());
+	pPipelineLayoutCreateInfo.pPushConstantRanges		= pushConstantRanges.data();
+	pPipelineLayoutCreateInfo.setLayoutCount			= static_cast<uint32_t>(setLayouts.size());
+	pPipelineLayoutCreateInfo.pSetLayouts				= setLayouts.data();
+
+	VkPipelineLayout pipelineLayout;
+	const VkResult result = vkCreatePipelineLayout(_device, &pPipelineLayoutCreateInfo, nullptr, &pipelineLayout);
+	assert(result == VK_SUCCESS);
+
+	_pipelineLayouts[key] = pipelineLayout;
+	return pipelineLayout;
+}
+
+size_t VulkanLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const
+{
+	return static_cast<size_t>(HashBytes(key.data(), key.size() * sizeof(uint64_t)));
+}
@@ -0,0 +1,115 @@
+#include "VulkanMappedFile.h"
+
+VulkanMappedFile::VulkanMappedFile() :
+#ifdef _WIN32
+	_file(INVALID_HANDLE_VALUE),
+	_mapping(nullptr),
+#endif
+	_data(nullptr),
+	_size(0)
+{
+}
+
+VulkanMappedFile::~VulkanMappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+bool VulkanMappedFile::Open(const char* filename)
+{
+	Close();
+
+	_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_mapping)
+	{
+		Close();
+		return false;
+	}
+
+	_data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data)
+	{
+		Close();
+		return false;
+	}
+	_size = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void VulkanMappedFile::Close()
+{
+	if (_data)
+	{
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping)
+	{
+		CloseHandle(_mapping);
+	}
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+	}
+	_file		= INVALID_HANDLE_VALUE;
+	_mapping	= nullptr;
+	_data		= nullptr;
+	_size		= 0;
+}
+#else
+bool VulkanMappedFile::Open(const char* filename)
+{
+	Close();
+
+	const int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file
+	void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	// The levels are read front to back, once
+	madvise(data, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+
+	_data = static_cast<const uint8_t*>(data);
+	_size = static_cast<size_t>(fileStat.st_size);
+	return true;
+}
+
+void VulkanMappedFile::Close()
+{
+	if (_data)
+	{
+		munmap(const_cast<uint8_t*>(_data), _size);
+	}
+	_data = nullptr;
+	_size = 0;
+}
+#endif
@@ -1,11 +1,74 @@
 #include "VulkanPipeline.h"
 #include "VulkanShader.h"
 #include "VulkanRenderer.h"
+#include "VulkanApplication.h"
+#include "VulkanMappedFile.h"
+#include "Wrappers.h"
+
+// Size of the version one header at the start of the cache data
+#define PIPELINE_CACHE_HEADER_SIZE	(16 + VK_UUID_SIZE)
+
+namespace
+{
+	std::vector<uint8_t> GetPipelineCacheData(VkDevice device, VkPipelineCache pipelineCache)
+	{
+		// The cache may grow between the two calls when other threads create pipelines
+		std::vector<uint8_t> data;
+		VkResult result;
+		do
+		{
+			size_t size = 0;
+			result = vkGetPipelineCacheData(device, pipelineCache, &size, nullptr);
+			assert(result == VK_SUCCESS);
+			data.resize(size);
+			result = vkGetPipelineCacheData(device, pipelineCache, &size, data.data());
+			data.resize(size);
+		} while (result == VK_INCOMPLETE);
+		assert(result == VK_SUCCESS);
+		return data;
+	}
+
+	// The data is written to a file of this process, then renamed over the cache file, so the
+	// other processes read either the previous cache or the new one, never a partial file
+	bool WriteFileAtomically(const std::string& filename, const std::vector<uint8_t>& data)
+	{
+#ifdef _WIN32
+		const std::string tempFilename = filename + "." + std::to_string(GetCurrentProcessId()) + ".tmp";
+#else
+		const std::string tempFilename = filename + "." + std::to_string(getpid()) + ".tmp";
+#endif
+		FILE* fp = fopen(tempFilename.c_str(), "wb");
+		if (!fp)
+		{
+			return false;
+		}
+		const bool written = fwrite(data.data(), 1, data.size(), fp) == data.size();
+		if (fclose(fp) != 0 || !written)
+		{
+			remove(tempFilename.c_str());
+			return false;
+		}
+
+#ifdef _WIN32
+		const bool renamed = MoveFileExA(tempFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		const bool renamed = rename(tempFilename.c_str(), filename.c_str()) == 0;
+#endif
+		if (!renamed)
+		{
+			remove(tempFilename.c_str());
+		}
+		return renamed;
+	}
+}
 
 VulkanPipeline::VulkanPipeline(VkDevice* device, VkRenderPass* renderPass) :
 	_pipelineCache(0),
 	_device(device),
-    _renderPass(renderPass)
+    _renderPass(renderPass),
+	_cacheWarm(false),
+	_pipelinesSinceSave(0),
+	_savedFileHash(0)
 {
 }
 
@@ -15,17 +78,256 @@ VulkanPipeline::~VulkanPipeline()
 
 void VulkanPipeline::CreatePipelineCache()
 {
+	// The cache outlives the pipelines, e.g. when they are recreated on resize
+	if (_pipelineCache != VK_NULL_HANDLE)
+	{
+		_cacheWarm = true;
+		return;
+	}
+
+	// Start from the cache of the previous runs. A cache made by another driver or
+	// device would be ignored anyway, so it is not even passed.
+	VulkanMappedFile file;
+	const bool compatible = file.Open(PIPELINE_CACHE_FILE) && IsPipelineCacheCompatible(file.GetData(), file.GetSize());
+
     VkPipelineCacheCreateInfo pipelineCacheInfo;
 	pipelineCacheInfo.sType				= VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
 	pipelineCacheInfo.pNext				= nullptr;
-	pipelineCacheInfo.initialDataSize	= 0;
-	pipelineCacheInfo.pInitialData		= nullptr;
+	pipelineCacheInfo.initialDataSize	= compatible ? file.GetSize() : 0;
+	pipelineCacheInfo.pInitialData		= compatible ? file.GetData() : nullptr;
 	pipelineCacheInfo.flags				= 0;
-    const VkResult result = vkCreatePipelineCache(*_device, &pipelineCacheInfo, nullptr, &_pipelineCache);
+    VkResult result = vkCreatePipelineCache(*_device, &pipelineCacheInfo, nullptr, &_pipelineCache);
+	if (result != VK_SUCCESS && compatible)
+	{
+		// Start cold when the driver rejects the data anyway
+		pipelineCacheInfo.initialDataSize	= 0;
+		pipelineCacheInfo.pInitialData		= nullptr;
+		result = vkCreatePipelineCache(*_device, &pipelineCacheInfo, nullptr, &_pipelineCache);
+	}
 	assert(result == VK_SUCCESS);
+
+	_cacheWarm			= pipelineCacheInfo.initialDataSize > 0;
+	_savedFileHash		= file.IsOpen() ? HashBytes(file.GetData(), file.GetSize()) : 0;
+	_pipelinesSinceSave	= 0;
+	_lastSaveTime		= std::chrono::steady_clock::now();
+}
+
+void VulkanPipeline::SavePipelineCache()
+{
+	if (_pipelineCache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	// Merge the pipelines other processes saved since this one last read or wrote the
+	// file, so that the instances running side by side do not drop each other's work
+	VulkanMappedFile file;
+	if (file.Open(PIPELINE_CACHE_FILE) &&
+		HashBytes(file.GetData(), file.GetSize()) != _savedFileHash &&
+		IsPipelineCacheCompatible(file.GetData(), file.GetSize()))
+	{
+		VkPipelineCacheCreateInfo pipelineCacheInfo = {};
+		pipelineCacheInfo.sType				= VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		pipelineCacheInfo.initialDataSize	= file.GetSize();
+		pipelineCacheInfo.pInitialData		= file.GetData();
+
+		VkPipelineCache otherCache;
+		if (vkCreatePipelineCache(*_device, &pipelineCacheInfo, nullptr, &otherCache) == VK_SUCCESS)
+		{
+			const VkResult result = vkMergePipelineCaches(*_device, _pipelineCache, 1, &otherCache);
+			assert(result == VK_SUCCESS);
+			vkDestroyPipelineCache(*_device, otherCache, nullptr);
+		}
+	}
+	file.Close();
+
+	const std::vector<uint8_t> data = GetPipelineCacheData(*_device, _pipelineCache);
+	if (WriteFileAtomically(PIPELINE_CACHE_FILE, data))
+	{
+		_savedFileHash = HashBytes(data.data(), data.size());
+	}
+	else
+	{
+		std::cout << "Failed to save the pipeline cache to " << PIPELINE_CACHE_FILE << std::endl;
+	}
+
+	_pipelinesSinceSave	= 0;
+	_lastSaveTime		= std::chrono::steady_clock::now();
+}
+
+void VulkanPipeline::Update()
+{
+	if (_pipelinesSinceSave > 0 &&
+		std::chrono::steady_clock::now() - _lastSaveTime >= std::chrono::seconds(PIPELINE_CACHE_SAVE_INTERVAL))
+	{
+		SavePipelineCache();
+	}
+}
+
+bool VulkanPipeline::IsPipelineCacheCompatible(const uint8_t* data, size_t size) const
+{
+	if (size < PIPELINE_CACHE_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	// VkPipelineCacheHeaderVersionOne: header size, header version, vendor ID, device ID and cache UUID
+	uint32_t header[4];
+	memcpy(header, data, sizeof(header));
+
+	const VkPhysicalDeviceProperties& gpuProps = VulkanApplication::GetInstance()->_deviceObj->_gpuProps;
+	return header[0] >= PIPELINE_CACHE_HEADER_SIZE &&
+		header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		header[2] == gpuProps.vendorID &&
+		header[3] == gpuProps.deviceID &&
+		memcmp(data + 16, gpuProps.pipelineCacheUUID, VK_UUID_SIZE) == 0;
 }
 
 bool VulkanPipeline::CreatePipeline(VulkanDrawable* drawableObj, VkPipeline* pipeline, VulkanShader* shaderObj, VkBool32 includeDepth, VkBool32 includeVi)
+{
+	PipelineState state;
+	DescribePipeline(drawableObj, shaderObj, includeDepth, includeVi, &state);
+	return CreatePipeline(state, pipeline);
+}
+
+void VulkanPipeline::DescribePipeline(VulkanDrawable* drawableObj, VulkanShader* shaderObj, VkBool32 includeDepth, VkBool32 includeVi, PipelineState* state) const
+{
+	// The padding is part of the hashed bytes
+	memset(state, 0, sizeof(PipelineState));
+
+	state->_vertexShader	= shaderObj->_shaderStages[0].module;
+	state->_fragmentShader	= shaderObj->_shaderStages[1].module;
+	state->_layout			= drawableObj->_pipelineLayout;
+	shaderObj->GetSpecialization(drawableObj->GetShaderVariant(), 0, &state->_vertexSpecialization);
+	shaderObj->GetSpecialization(drawableObj->GetShaderVariant(), 1, &state->_fragmentSpecialization);
+	state->_renderPass		= *_renderPass;
+	state->_subpass			= 0;
+
+	if (includeVi)
+	{
+		// The attributes are the inputs the vertex shader declares, packed in the order of
+		// their locations in the vertices of the drawable
+		std::vector<VkVertexInputAttributeDescription> attributes;
+		const uint32_t vertexSize = shaderObj->_reflection.GetVertexAttributes(drawableObj->_viIpBind.binding, &attributes);
+		assert(attributes.size() <= PIPELINE_MAX_VERTEX_ATTRIBUTES);
+		if (vertexSize != drawableObj->_viIpBind.stride)
+		{
+			std::cout << "Error: the vertex shader reads vertices of " << vertexSize << " bytes, the ones of the drawable take "
+				<< drawableObj->_viIpBind.stride << " bytes" << std::endl;
+		}
+
+		state->_vertexBindingCount		= 1;
+		state->_vertexBinding			= drawableObj->_viIpBind;
+		state->_vertexAttributeCount	= std::min(static_cast<uint32_t>(attributes.size()), static_cast<uint32_t>(PIPELINE_MAX_VERTEX_ATTRIBUTES));
+		memcpy(state->_vertexAttributes, attributes.data(), state->_vertexAttributeCount * sizeof(VkVertexInputAttributeDescription));
+	}
+
+	state->_topology		= VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	state->_polygonMode		= VK_POLYGON_MODE_FILL;
+	state->_cullMode		= VK_CULL_MODE_BACK_BIT;
+	state->_frontFace		= VK_FRONT_FACE_CLOCKWISE;
+	state->_depthClamp		= includeDepth;
+	state->_depthTest		= includeDepth;
+	state->_depthWrite		= includeDepth;
+	state->_depthCompareOp	= VK_COMPARE_OP_LESS_OR_EQUAL;
+	state->_blendEnable		= VK_FALSE;
+	state->_colorWriteMask	= 0xf;
+	state->_samples			= NUM_SAMPLES;
+}
+
+bool VulkanPipeline::CreatePipeline(const PipelineState& state, VkPipeline* pipeline)
+{
+	return CreatePipelinePart(state, PIPELINE_PART_ALL, pipeline);
+}
+
+bool VulkanPipeline::CreatePipelineLibrary(const PipelineState& state, PipelinePart part, VkPipeline* library)
+{
+	assert(part != PIPELINE_PART_ALL);
+	return CreatePipelinePart(state, part, library);
+}
+
+bool VulkanPipeline::LinkPipeline(const VkPipeline* libraries, VkPipelineLayout layout, bool optimize, VkPipeline* pipeline)
+{
+#ifdef VK_EXT_graphics_pipeline_library
+	VkPipelineLibraryCreateInfoKHR libraryInfo = {};
+	libraryInfo.sType			= VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+	libraryInfo.libraryCount	= PIPELINE_PART_COUNT;
+	libraryInfo.pLibraries		= libraries;
+
+	// Without the link time optimizations the link only patches the parts together, it is
+	// fast enough to run at first use. The optimized link compiles the whole pipeline again.
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType	= VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext	= &libraryInfo;
+	pipelineInfo.flags	= optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+	pipelineInfo.layout	= layout;
+
+	if (vkCreateGraphicsPipelines(*_device, _pipelineCache, 1, &pipelineInfo, nullptr, pipeline) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	_pipelinesSinceSave++;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void VulkanPipeline::GetPartState(const PipelineState& state, PipelinePart part, PipelineState* partState)
+{
+	// The padding is part of the hashed bytes
+	memset(partState, 0, sizeof(PipelineState));
+
+	if (part & PIPELINE_PART_VERTEX_INPUT)
+	{
+		partState->_vertexBindingCount		= state._vertexBindingCount;
+		partState->_vertexBinding			= state._vertexBinding;
+		partState->_vertexAttributeCount	= state._vertexAttributeCount;
+		memcpy(partState->_vertexAttributes, state._vertexAttributes, sizeof(state._vertexAttributes));
+		partState->_topology				= state._topology;
+	}
+	if (part & PIPELINE_PART_PRE_RASTERIZATION)
+	{
+		partState->_vertexShader			= state._vertexShader;
+		partState->_vertexSpecialization	= state._vertexSpecialization;
+		partState->_polygonMode		= state._polygonMode;
+		partState->_cullMode		= state._cullMode;
+		partState->_frontFace		= state._frontFace;
+		partState->_depthClamp		= state._depthClamp;
+	}
+	if (part & PIPELINE_PART_FRAGMENT_SHADER)
+	{
+		partState->_fragmentShader			= state._fragmentShader;
+		partState->_fragmentSpecialization	= state._fragmentSpecialization;
+		partState->_depthTest		= state._depthTest;
+		partState->_depthWrite		= state._depthWrite;
+		partState->_depthCompareOp	= state._depthCompareOp;
+	}
+	if (part & PIPELINE_PART_FRAGMENT_OUTPUT)
+	{
+		partState->_blendEnable		= state._blendEnable;
+		partState->_colorWriteMask	= state._colorWriteMask;
+	}
+
+	// The shader parts are built against the layout, all but the vertex input against the
+	// render pass, and the sample count is shared by both fragment parts
+	if (part & (PIPELINE_PART_PRE_RASTERIZATION | PIPELINE_PART_FRAGMENT_SHADER))
+	{
+		partState->_layout = state._layout;
+	}
+	if (part & ~PIPELINE_PART_VERTEX_INPUT)
+	{
+		partState->_renderPass	= state._renderPass;
+		partState->_subpass		= state._subpass;
+	}
+	if (part & (PIPELINE_PART_FRAGMENT_SHADER | PIPELINE_PART_FRAGMENT_OUTPUT))
+	{
+		partState->_samples = state._samples;
+	}
+}
+
+bool VulkanPipeline::CreatePipelinePart(const PipelineState& state, uint32_t parts, VkPipeline* pipeline)
 {
 	// Initialize the dynamic states, initially its empty
 	VkDynamicState dynamicStateEnables[VK_DYNAMIC_STATE_RANGE_SIZE];
@@ -44,29 +346,26 @@ bool VulkanPipeline::CreatePipeline(VulkanDrawable* drawableObj, VkPipeline* pip
 	vertexInputStateInfo.pNext = nullptr;
 	vertexInputStateInfo.flags = 0;
 
-	if(includeVi)
-	{
-		vertexInputStateInfo.vertexBindingDescriptionCount	 = sizeof(drawableObj->_viIpBind) / sizeof(VkVertexInputBindingDescription);
-		vertexInputStateInfo.pVertexBindingDescriptions		 = &drawableObj->_viIpBind;
-		vertexInputStateInfo.vertexAttributeDescriptionCount = sizeof(drawableObj->_viIpAttrb)/sizeof(VkVertexInputAttributeDescription);
-		vertexInputStateInfo.pVertexAttributeDescriptions	 = drawableObj->_viIpAttrb;
-	}
+	vertexInputStateInfo.vertexBindingDescriptionCount	 = state._vertexBindingCount;
+	vertexInputStateInfo.pVertexBindingDescriptions		 = &state._vertexBinding;
+	vertexInputStateInfo.vertexAttributeDescriptionCount = state._vertexAttributeCount;
+	vertexInputStateInfo.pVertexAttributeDescriptions	 = state._vertexAttributes;
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
 	inputAssemblyInfo.sType						= VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	inputAssemblyInfo.pNext						= nullptr;
 	inputAssemblyInfo.flags						= 0;
 	inputAssemblyInfo.primitiveRestartEnable	= VK_FALSE;
-	inputAssemblyInfo.topology					= VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssemblyInfo.topology					= state._topology;
 
 	VkPipelineRasterizationStateCreateInfo rasterStateInfo;
 	rasterStateInfo.sType							= VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 	rasterStateInfo.pNext							= nullptr;
 	rasterStateInfo.flags							= 0;
-	rasterStateInfo.polygonMode						= VK_POLYGON_MODE_FILL;
-	rasterStateInfo.cullMode						= VK_CULL_MODE_BACK_BIT;
-	rasterStateInfo.frontFace						= VK_FRONT_FACE_CLOCKWISE;
-	rasterStateInfo.depthClampEnable				= includeDepth;
+	rasterStateInfo.polygonMode						= state._polygonMode;
+	rasterStateInfo.cullMode						= state._cullMode;
+	rasterStateInfo.frontFace						= state._frontFace;
+	rasterStateInfo.depthClampEnable				= state._depthClamp;
 	rasterStateInfo.rasterizerDiscardEnable			= VK_FALSE;
 	rasterStateInfo.depthBiasEnable					= VK_FALSE;
 	rasterStateInfo.depthBiasConstantFactor			= 0;
@@ -78,8 +377,8 @@ bool VulkanPipeline::CreatePipeline(VulkanDrawable* drawableObj, VkPipeline* pip
 	// the number of viewport and scissors being used in the
 	// rendering pipeline.
 	VkPipelineColorBlendAttachmentState colorBlendAttachmentStateInfo[1] = {};
-	colorBlendAttachmentStateInfo[0].colorWriteMask			= 0xf;
-	colorBlendAttachmentStateInfo[0].blendEnable			= VK_FALSE;
+	colorBlendAttachmentStateInfo[0].colorWriteMask			= state._colorWriteMask;
+	colorBlendAttachmentStateInfo[0].blendEnable			= state._blendEnable;
 	colorBlendAttachmentStateInfo[0].alphaBlendOp			= VK_BLEND_OP_ADD;
 	colorBlendAttachmentStateInfo[0].colorBlendOp			= VK_BLEND_OP_ADD;
 	colorBlendAttachmentStateInfo[0].srcColorBlendFactor	= VK_BLEND_FACTOR_ZERO;
@@ -118,9 +417,9 @@ bool VulkanPipeline::CreatePipeline(VulkanDrawable* drawableObj, VkPipeline* pip
 	depthStencilStateInfo.sType								= VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthStencilStateInfo.pNext								= nullptr;
 	depthStencilStateInfo.flags								= 0;
-	depthStencilStateInfo.depthTestEnable					= includeDepth;
-	depthStencilStateInfo.depthWriteEnable					= includeDepth;
-	depthStencilStateInfo.depthCompareOp					= VK_COMPARE_OP_LESS_OR_EQUAL;
+	depthStencilStateInfo.depthTestEnable					= state._depthTest;
+	depthStencilStateInfo.depthWriteEnable					= state._depthWrite;
+	depthStencilStateInfo.depthCompareOp					= state._depthCompareOp;
 	depthStencilStateInfo.depthBoundsTestEnable				= VK_FALSE;
 	depthStencilStateInfo.stencilTestEnable					= VK_FALSE;
 	depthStencilStateInfo.back.failOp						= VK_STENCIL_OP_KEEP;
@@ -140,19 +439,54 @@ bool VulkanPipeline::CreatePipeline(VulkanDrawable* drawableObj, VkPipeline* pip
 	multiSampleStateInfo.pNext					= nullptr;
 	multiSampleStateInfo.flags					= 0;
 	multiSampleStateInfo.pSampleMask			= nullptr;
-	multiSampleStateInfo.rasterizationSamples	= NUM_SAMPLES;
+	multiSampleStateInfo.rasterizationSamples	= state._samples;
 	multiSampleStateInfo.sampleShadingEnable	= VK_FALSE;
 	multiSampleStateInfo.alphaToCoverageEnable	= VK_FALSE;
 	multiSampleStateInfo.alphaToOneEnable		= VK_FALSE;
 	multiSampleStateInfo.minSampleShading		= 0.0;
 
+	// The variants share the modules of the shaders, their constants are folded by the compile of the pipeline
+	VkSpecializationMapEntry specializationEntries[2][SHADER_MAX_SPECIALIZATION_CONSTANTS];
+	VkSpecializationInfo specializationInfos[2];
+	const ShaderVariantKey* specializations[2] = { &state._vertexSpecialization, &state._fragmentSpecialization };
+	for (uint32_t stage = 0; stage < 2; stage++)
+	{
+		VkSpecializationInfo& info = specializationInfos[stage];
+		info.mapEntryCount	= 0;
+		info.pMapEntries	= specializationEntries[stage];
+		info.dataSize		= sizeof(specializations[stage]->_values);
+		info.pData			= specializations[stage]->_values;
+		for (uint32_t id = 0; id < SHADER_MAX_SPECIALIZATION_CONSTANTS; id++)
+		{
+			if (specializations[stage]->_mask & (1u << id))
+			{
+				VkSpecializationMapEntry& entry = specializationEntries[stage][info.mapEntryCount++];
+				entry.constantID	= id;
+				entry.offset		= id * sizeof(uint32_t);
+				entry.size			= sizeof(uint32_t);
+			}
+		}
+	}
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType				= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage				= VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module				= state._vertexShader;
+	shaderStages[0].pName				= "main";
+	shaderStages[0].pSpecializationInfo	= specializationInfos[0].mapEntryCount ? &specializationInfos[0] : nullptr;
+	shaderStages[1].sType				= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage				= VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module				= state._fragmentShader;
+	shaderStages[1].pName				= "main";
+	shaderStages[1].pSpecializationInfo	= specializationInfos[1].mapEntryCount ? &specializationInfos[1] : nullptr;
+
 	// Populate the VkGraphicsPipelineCreateInfo structure to specify 
 	// programmable stages, fixed-function pipeline stages render
 	// pass, sub-passes and pipeline layouts
 	VkGraphicsPipelineCreateInfo pipelineInfo;
 	pipelineInfo.sType					= VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	pipelineInfo.pNext					= nullptr;
-	pipelineInfo.layout					= drawableObj->_pipelineLayout;
+	pipelineInfo.layout					= state._layout;
 	pipelineInfo.basePipelineHandle		= 0;
 	pipelineInfo.basePipelineIndex		= 0;
 	pipelineInfo.flags					= 0;
@@ -165,17 +499,88 @@ bool VulkanPipeline::CreatePipeline(VulkanDrawable* drawableObj, VkPipeline* pip
 	pipelineInfo.pDynamicState			= &dynamicState;
 	pipelineInfo.pViewportState			= &viewportStateInfo;
 	pipelineInfo.pDepthStencilState		= &depthStencilStateInfo;
-	pipelineInfo.pStages				= shaderObj->_shaderStages;
+	pipelineInfo.pStages				= shaderStages;
 	pipelineInfo.stageCount				= 2;
-	pipelineInfo.renderPass				= *_renderPass;
-	pipelineInfo.subpass				= 0;
+	pipelineInfo.renderPass				= state._renderPass;
+	pipelineInfo.subpass				= state._subpass;
+
+#ifdef VK_EXT_graphics_pipeline_library
+	// A library only takes the state of its parts, the state of the others is left out
+	VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo = {};
+	if (parts != PIPELINE_PART_ALL)
+	{
+		libraryInfo.sType	= VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+		libraryInfo.flags	= 0;
+		if (parts & PIPELINE_PART_VERTEX_INPUT)			libraryInfo.flags |= VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+		if (parts & PIPELINE_PART_PRE_RASTERIZATION)	libraryInfo.flags |= VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+		if (parts & PIPELINE_PART_FRAGMENT_SHADER)		libraryInfo.flags |= VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+		if (parts & PIPELINE_PART_FRAGMENT_OUTPUT)		libraryInfo.flags |= VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+		// The libraries keep what the optimized link needs to compile the pipeline as a whole
+		pipelineInfo.pNext	= &libraryInfo;
+		pipelineInfo.flags	= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+
+		const bool preRasterization	= (parts & PIPELINE_PART_PRE_RASTERIZATION) != 0;
+		const bool fragmentShader	= (parts & PIPELINE_PART_FRAGMENT_SHADER) != 0;
+		const bool fragmentOutput	= (parts & PIPELINE_PART_FRAGMENT_OUTPUT) != 0;
+		if (!(parts & PIPELINE_PART_VERTEX_INPUT))
+		{
+			pipelineInfo.pVertexInputState		= nullptr;
+			pipelineInfo.pInputAssemblyState	= nullptr;
+		}
+		if (!preRasterization)
+		{
+			pipelineInfo.pRasterizationState	= nullptr;
+			pipelineInfo.pViewportState			= nullptr;
+		}
+		if (!fragmentShader)
+		{
+			pipelineInfo.pDepthStencilState		= nullptr;
+		}
+		if (!fragmentShader && !fragmentOutput)
+		{
+			pipelineInfo.pMultisampleState		= nullptr;
+		}
+		if (!fragmentOutput)
+		{
+			pipelineInfo.pColorBlendState		= nullptr;
+		}
+		if (!preRasterization && !fragmentShader)
+		{
+			pipelineInfo.layout					= VK_NULL_HANDLE;
+		}
+		if (!preRasterization && !fragmentShader && !fragmentOutput)
+		{
+			pipelineInfo.renderPass				= VK_NULL_HANDLE;
+		}
+
+		// The vertex shader goes with the pre-rasterization part, the fragment one with its own part
+		pipelineInfo.pStages	= preRasterization ? &shaderStages[0] : &shaderStages[1];
+		pipelineInfo.stageCount	= (preRasterization ? 1 : 0) + (fragmentShader ? 1 : 0);
+	}
+#else
+	assert(parts == PIPELINE_PART_ALL);
+#endif
 
 	// Create the pipeline using the meta-data store in the VkGraphicsPipelineCreateInfo object
-    return vkCreateGraphicsPipelines(*_device, _pipelineCache, 1, &pipelineInfo, nullptr, pipeline) == VK_SUCCESS;
+    if (vkCreateGraphicsPipelines(*_device, _pipelineCache, 1, &pipelineInfo, nullptr, pipeline) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	_pipelinesSinceSave++;
+	return true;
 }
 
-// Destroy the pipeline cache object when no more required
+// Save and destroy the pipeline cache object when no more required
 void VulkanPipeline::DestroyPipelineCache()
 {
+	if (_pipelineCache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	SavePipelineCache();
 	vkDestroyPipelineCache(*_device, _pipelineCache, nullptr);
+	_pipelineCache = VK_NULL_HANDLE;
 }
@@ -0,0 +1,359 @@
+#include "VulkanPipelineManager.h"
+#include "VulkanDevice.h"
+#include "Wrappers.h"
+
+namespace
+{
+	const PipelinePart pipelineParts[PIPELINE_PART_COUNT] =
+	{
+		PIPELINE_PART_VERTEX_INPUT,
+		PIPELINE_PART_PRE_RASTERIZATION,
+		PIPELINE_PART_FRAGMENT_SHADER,
+		PIPELINE_PART_FRAGMENT_OUTPUT
+	};
+}
+
+VulkanPipelineManager::VulkanPipelineManager(VulkanDevice* deviceObj, VulkanPipeline* pipelineObj) :
+	_deviceObj(deviceObj),
+	_pipelineObj(pipelineObj),
+	_pendingCount(0),
+	_batchCount(0),
+	_compileThreads(PIPELINE_COMPILE_THREADS)
+{
+}
+
+VulkanPipelineManager::~VulkanPipelineManager()
+{
+	WaitIdle();
+}
+
+size_t VulkanPipelineManager::StateHash::operator()(const PipelineState& state) const
+{
+	// The states are zero initialized, the padding hashes the same for equal states
+	return static_cast<size_t>(HashBytes(&state, sizeof(PipelineState)));
+}
+
+VkPipeline* VulkanPipelineManager::GetPipeline(const PipelineState& state)
+{
+	auto it = _pipelines.find(state);
+	if (it != _pipelines.end())
+	{
+		return it->second.get();
+	}
+
+	VkPipeline* storage = new VkPipeline(VK_NULL_HANDLE);
+	_pipelines[state] = std::unique_ptr<VkPipeline>(storage);
+
+	// When the parts are all built already, e.g. a new vertex layout with known shaders,
+	// the fast link is done here so the first draw is not skipped
+	VkPipeline libraries[PIPELINE_PART_COUNT];
+	if (_deviceObj->_graphicsPipelineLibraryEnabled &&
+		_deviceObj->_graphicsPipelineLibraryFastLinking &&
+		GetLibraries(state, false, libraries) &&
+		_pipelineObj->LinkPipeline(libraries, state._layout, false, storage))
+	{
+		Schedule([this, state, storage]() { OptimizePipeline(state, storage, 0); }, false);
+		return storage;
+	}
+
+	// The state is copied into the job, the storage only changes on the calling thread
+	Schedule([this, state, storage]() { CompilePipeline(state, storage, 0); }, true);
+	return storage;
+}
+
+void VulkanPipelineManager::ReplaceShaderModule(VkShaderModule previous, VkShaderModule module)
+{
+	std::vector<PipelineState> states;
+	for (const auto& pipeline : _pipelines)
+	{
+		if (pipeline.first._vertexShader == previous || pipeline.first._fragmentShader == previous)
+		{
+			states.push_back(pipeline.first);
+		}
+	}
+
+	for (const PipelineState& previousState : states)
+	{
+		auto it = _pipelines.find(previousState);
+		std::unique_ptr<VkPipeline> storage = std::move(it->second);
+		_pipelines.erase(it);
+
+		PipelineState state = previousState;
+		if (state._vertexShader == previous)
+		{
+			state._vertexShader = module;
+		}
+		if (state._fragmentShader == previous)
+		{
+			state._fragmentShader = module;
+		}
+
+		// The jobs of the previous state still in flight are dropped once done, they could
+		// otherwise publish their pipeline after the one of the new state
+		VkPipeline* pipeline		= storage.get();
+		const uint32_t generation	= ++_generations[pipeline];
+		_pipelines[state]			= std::move(storage);
+		Schedule([this, state, pipeline, generation]() { CompilePipeline(state, pipeline, generation); }, true);
+	}
+
+	// The libraries of the previous module would be returned for a later module given the
+	// same handle. The compiles in flight may still link them, or build more of them.
+	std::lock_guard<std::mutex> lock(_mutex);
+	_retiredModules.push_back(previous);
+	for (LibraryMap& libraries : _libraries)
+	{
+		for (auto it = libraries.begin(); it != libraries.end();)
+		{
+			if (it->first._vertexShader == previous || it->first._fragmentShader == previous)
+			{
+				_retiredLibraries.push_back(it->second);
+				it = libraries.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+}
+
+uint32_t VulkanPipelineManager::GetGeneration(VkPipeline* storage) const
+{
+	auto it = _generations.find(storage);
+	return it != _generations.end() ? it->second : 0;
+}
+
+void VulkanPipelineManager::Schedule(const std::function<void()>& job, bool newPipeline)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_pendingCount++ == 0)
+		{
+			_batchCount = 0;
+			_batchStart = std::chrono::steady_clock::now();
+		}
+		if (newPipeline)
+		{
+			_batchCount++;
+		}
+	}
+
+	_compileThreads.Enqueue([this, job]()
+	{
+		job();
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (--_pendingCount == 0)
+		{
+			_compileDone.notify_all();
+		}
+	});
+}
+
+bool VulkanPipelineManager::GetLibraries(const PipelineState& state, bool build, VkPipeline libraries[PIPELINE_PART_COUNT])
+{
+	for (uint32_t i = 0; i < PIPELINE_PART_COUNT; i++)
+	{
+		PipelineState partState;
+		VulkanPipeline::GetPartState(state, pipelineParts[i], &partState);
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto it = _libraries[i].find(partState);
+			if (it != _libraries[i].end())
+			{
+				libraries[i] = it->second;
+				continue;
+			}
+		}
+		if (!build)
+		{
+			return false;
+		}
+
+		// Built outside of the lock, another thread may build the same part meanwhile
+		VkPipeline library;
+		if (!_pipelineObj->CreatePipelineLibrary(partState, pipelineParts[i], &library))
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		// Built for a module replaced meanwhile, it only serves the link of this job
+		if (std::find(_retiredModules.begin(), _retiredModules.end(), partState._vertexShader) != _retiredModules.end() ||
+			std::find(_retiredModules.begin(), _retiredModules.end(), partState._fragmentShader) != _retiredModules.end())
+		{
+			_retiredLibraries.push_back(library);
+			libraries[i] = library;
+			continue;
+		}
+
+		auto inserted = _libraries[i].insert(std::make_pair(partState, library));
+		if (!inserted.second)
+		{
+			vkDestroyPipeline(_deviceObj->_device, library, nullptr);
+		}
+		libraries[i] = inserted.first->second;
+	}
+	return true;
+}
+
+void VulkanPipelineManager::CompilePipeline(const PipelineState& state, VkPipeline* storage, uint32_t generation)
+{
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if (!_deviceObj->_graphicsPipelineLibraryEnabled)
+	{
+		AddCompiled(storage, pipeline, generation, _pipelineObj->CreatePipeline(state, &pipeline), false);
+		return;
+	}
+
+	// The shaders are compiled with their parts, the link only patches them together
+	VkPipeline libraries[PIPELINE_PART_COUNT];
+	const bool succeeded = GetLibraries(state, true, libraries) && _pipelineObj->LinkPipeline(libraries, state._layout, false, &pipeline);
+	AddCompiled(storage, pipeline, generation, succeeded, false);
+	if (succeeded)
+	{
+		// Queued after the compiles already waiting, the pipelines get usable first
+		Schedule([this, state, storage, generation]() { OptimizePipeline(state, storage, generation); }, false);
+	}
+}
+
+void VulkanPipelineManager::OptimizePipeline(const PipelineState& state, VkPipeline* storage, uint32_t generation)
+{
+	VkPipeline libraries[PIPELINE_PART_COUNT];
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	const bool succeeded = GetLibraries(state, false, libraries) && _pipelineObj->LinkPipeline(libraries, state._layout, true, &pipeline);
+	AddCompiled(storage, pipeline, generation, succeeded, true);
+}
+
+void VulkanPipelineManager::AddCompiled(VkPipeline* storage, VkPipeline pipeline, uint32_t generation, bool succeeded, bool optimized)
+{
+	CompiledPipeline compiled;
+	compiled._storage		= storage;
+	compiled._pipeline		= pipeline;
+	compiled._generation	= generation;
+	compiled._succeeded		= succeeded;
+	compiled._optimized		= optimized;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_compiled.push_back(compiled);
+}
+
+bool VulkanPipelineManager::Update(std::vector<VkPipeline*>* published)
+{
+	std::vector<CompiledPipeline> compiled;
+	std::vector<VkPipeline> retiredLibraries;
+	bool batchDone;
+	uint32_t batchCount;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		compiled.swap(_compiled);
+		batchDone	= _pendingCount == 0;
+		batchCount	= _batchCount;
+
+		// No job links the evicted libraries anymore, nor builds new ones for the replaced modules
+		if (batchDone)
+		{
+			retiredLibraries.swap(_retiredLibraries);
+			_retiredModules.clear();
+		}
+	}
+
+	// The pipelines linked from them may still be used by the frames already submitted
+	if (!retiredLibraries.empty())
+	{
+		VulkanTimeline& timeline	= _deviceObj->_graphicsTimeline;
+		VkDevice device				= _deviceObj->_device;
+		timeline.DeferUntil(timeline.GetLastSubmitted(), [device, retiredLibraries]()
+		{
+			for (VkPipeline library : retiredLibraries)
+			{
+				vkDestroyPipeline(device, library, nullptr);
+			}
+		});
+	}
+
+	const size_t publishedCount = published->size();
+	for (const CompiledPipeline& pipeline : compiled)
+	{
+		// Compiled for a state the storage no longer has, it was never used
+		if (pipeline._generation != GetGeneration(pipeline._storage))
+		{
+			if (pipeline._succeeded)
+			{
+				vkDestroyPipeline(_deviceObj->_device, pipeline._pipeline, nullptr);
+			}
+			continue;
+		}
+
+		if (!pipeline._succeeded)
+		{
+			// The draws keep the fast linked pipeline, or stay skipped when there is none
+			std::cout << "Error: failed to " << (pipeline._optimized ? "optimize" : "compile") << " a graphics pipeline" << std::endl;
+			continue;
+		}
+
+		// The frames already submitted may still use the fast linked pipeline
+		VkPipeline replaced = *pipeline._storage;
+		if (replaced != VK_NULL_HANDLE)
+		{
+			VulkanTimeline& timeline	= _deviceObj->_graphicsTimeline;
+			VkDevice device				= _deviceObj->_device;
+			timeline.DeferUntil(timeline.GetLastSubmitted(), [device, replaced]() { vkDestroyPipeline(device, replaced, nullptr); });
+		}
+		*pipeline._storage = pipeline._pipeline;
+		published->push_back(pipeline._storage);
+	}
+
+	// Log the compile times, to compare the startups with and without the cache of the previous runs
+	if (!compiled.empty() && batchDone && batchCount > 0)
+	{
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - _batchStart;
+		std::cout << "Pipelines: " << batchCount << " compiled in " << elapsed.count() << " ms from a "
+			<< (_pipelineObj->IsPipelineCacheWarm() ? "warm" : "cold") << " pipeline cache, "
+			<< _pipelines.size() << " pipelines in total" << std::endl;
+	}
+	return published->size() > publishedCount;
+}
+
+bool VulkanPipelineManager::IsCompiling()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _pendingCount > 0;
+}
+
+void VulkanPipelineManager::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_compileDone.wait(lock, [this]() { return _pendingCount == 0; });
+}
+
+void VulkanPipelineManager::DestroyPipelines()
+{
+	// The compiled pipelines not published yet are destroyed with the others
+	WaitIdle();
+	std::vector<VkPipeline*> published;
+	Update(&published);
+
+	// The device is idle, nothing deferred is still in use
+	_deviceObj->CollectGarbage();
+
+	for (auto& pipeline : _pipelines)
+	{
+		if (*pipeline.second != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(_deviceObj->_device, *pipeline.second, nullptr);
+		}
+	}
+	_pipelines.clear();
+	_generations.clear();
+
+	for (LibraryMap& libraries : _libraries)
+	{
+		for (auto& library : libraries)
+		{
+			vkDestroyPipeline(_deviceObj->_device, library.second, nullptr);
+		}
+		libraries.clear();
+	}
+}
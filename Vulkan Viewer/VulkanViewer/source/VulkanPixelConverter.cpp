@@ -0,0 +1,560 @@
+#include "VulkanPixelConverter.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PIXEL_CONVERTER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PIXEL_TARGET(isa)
+#else
+#include <cpuid.h>
+// The kernels are compiled for their instruction set only, the rest of the file is not
+#define PIXEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace
+{
+	/*********** SCALAR KERNELS ***********/
+
+	void ExpandRGBScalar(const uint8_t* source, uint8_t* destination, uint32_t count, bool isBGR)
+	{
+		const uint32_t r = isBGR ? 2 : 0;
+		const uint32_t b = isBGR ? 0 : 2;
+		for (uint32_t i = 0; i < count; i++, source += 3, destination += 4)
+		{
+			destination[0] = source[r];
+			destination[1] = source[1];
+			destination[2] = source[b];
+			destination[3] = 255;
+		}
+	}
+
+	void SwizzleScalar(const uint8_t* source, uint8_t* destination, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++, source += 4, destination += 4)
+		{
+			const uint8_t red = source[0];
+			destination[0] = source[2];
+			destination[1] = source[1];
+			destination[2] = red;
+			destination[3] = source[3];
+		}
+	}
+
+	// Rounded c * a / 255, exact for all the 8 bit values
+	inline uint8_t MultiplyUnorm8(uint32_t c, uint32_t a)
+	{
+		const uint32_t product = c * a + 128;
+		return static_cast<uint8_t>((product + (product >> 8)) >> 8);
+	}
+
+	void PremultiplyScalar(const uint8_t* source, uint8_t* destination, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++, source += 4, destination += 4)
+		{
+			const uint32_t alpha = source[3];
+			destination[0] = MultiplyUnorm8(source[0], alpha);
+			destination[1] = MultiplyUnorm8(source[1], alpha);
+			destination[2] = MultiplyUnorm8(source[2], alpha);
+			destination[3] = static_cast<uint8_t>(alpha);
+		}
+	}
+
+	// Rounded v * 255 / 65535, the SIMD kernels compute the same rounding
+	inline uint8_t NarrowUnorm16(uint32_t value)
+	{
+		return static_cast<uint8_t>((((value * 0xFF01u) >> 16) + 128) >> 8);
+	}
+
+	void NarrowRGBA16Scalar(const uint16_t* source, uint8_t* destination, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count * 4; i++)
+		{
+			destination[i] = NarrowUnorm16(source[i]);
+		}
+	}
+
+	void FloatToHalfScalar(const float* source, uint16_t* destination, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count * 4; i++)
+		{
+			destination[i] = VulkanPixelConverter::FloatToHalf(source[i]);
+		}
+	}
+
+	// Half float of every 8 bit value, for the sRGB color and for the linear alpha
+	struct HalfTables
+	{
+		uint16_t	_srgbToLinear[256];
+		uint16_t	_unormToFloat[256];
+
+		HalfTables()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				const float value	= i / 255.0f;
+				const float linear	= value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+				_srgbToLinear[i]	= VulkanPixelConverter::FloatToHalf(linear);
+				_unormToFloat[i]	= VulkanPixelConverter::FloatToHalf(value);
+			}
+		}
+	};
+
+	// There are only 256 inputs, the lookups are faster than computing the curve or than
+	// the gather instructions, so this conversion has no SIMD kernel
+	void LinearizeSRGBScalar(const uint8_t* source, uint16_t* destination, uint32_t count)
+	{
+		static const HalfTables tables;
+		for (uint32_t i = 0; i < count; i++, source += 4, destination += 4)
+		{
+			destination[0] = tables._srgbToLinear[source[0]];
+			destination[1] = tables._srgbToLinear[source[1]];
+			destination[2] = tables._srgbToLinear[source[2]];
+			destination[3] = tables._unormToFloat[source[3]];
+		}
+	}
+
+#ifdef PIXEL_CONVERTER_X86
+	/*********** SSE4.1 KERNELS ***********/
+
+	PIXEL_TARGET("sse4.1") inline void Store128(uint8_t* destination, __m128i value, bool stream)
+	{
+		if (stream)
+		{
+			_mm_stream_si128(reinterpret_cast<__m128i*>(destination), value);
+		}
+		else
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination), value);
+		}
+	}
+
+	PIXEL_TARGET("sse4.1") void CopySSE41(const uint8_t* source, uint8_t* destination, uint32_t count, bool stream)
+	{
+		if (!stream)
+		{
+			memcpy(destination, source, count * 4);
+			return;
+		}
+
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			Store128(destination + i * 4, _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4)), true);
+		}
+		memcpy(destination + i * 4, source + i * 4, (count - i) * 4);
+	}
+
+	PIXEL_TARGET("sse4.1") void ExpandRGBSSE41(const uint8_t* source, uint8_t* destination, uint32_t count, bool isBGR, bool stream)
+	{
+		const __m128i shuffle = isBGR ?
+			_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+			_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+		// Each load reads 16 bytes for 4 texels, the 4 last bytes must still be in the row
+		uint32_t i = 0;
+		for (; i + 6 <= count; i += 4)
+		{
+			const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+			Store128(destination + i * 4, _mm_or_si128(_mm_shuffle_epi8(texels, shuffle), alpha), stream);
+		}
+		ExpandRGBScalar(source + i * 3, destination + i * 4, count - i, isBGR);
+	}
+
+	PIXEL_TARGET("sse4.1") void SwizzleSSE41(const uint8_t* source, uint8_t* destination, uint32_t count, bool stream)
+	{
+		const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			Store128(destination + i * 4, _mm_shuffle_epi8(texels, shuffle), stream);
+		}
+		SwizzleScalar(source + i * 4, destination + i * 4, count - i);
+	}
+
+	// Two texels widened to 16 bits, the multiplier of the alpha channel is 255 so it is kept
+	PIXEL_TARGET("sse4.1") inline __m128i PremultiplyWords(__m128i texels)
+	{
+		const __m128i alphaShuffle	= _mm_setr_epi8(6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+		const __m128i alpha			= _mm_blend_epi16(_mm_shuffle_epi8(texels, alphaShuffle), _mm_set1_epi16(255), 0x88);
+		const __m128i product		= _mm_add_epi16(_mm_mullo_epi16(texels, alpha), _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+	}
+
+	PIXEL_TARGET("sse4.1") void PremultiplySSE41(const uint8_t* source, uint8_t* destination, uint32_t count, bool stream)
+	{
+		const __m128i zero = _mm_setzero_si128();
+
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i texels	= _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			const __m128i low		= PremultiplyWords(_mm_unpacklo_epi8(texels, zero));
+			const __m128i high		= PremultiplyWords(_mm_unpackhi_epi8(texels, zero));
+			Store128(destination + i * 4, _mm_packus_epi16(low, high), stream);
+		}
+		PremultiplyScalar(source + i * 4, destination + i * 4, count - i);
+	}
+
+	PIXEL_TARGET("sse4.1") inline __m128i NarrowWords(__m128i values)
+	{
+		return _mm_srli_epi16(_mm_add_epi16(_mm_mulhi_epu16(values, _mm_set1_epi16(static_cast<short>(0xFF01))), _mm_set1_epi16(128)), 8);
+	}
+
+	PIXEL_TARGET("sse4.1") void NarrowRGBA16SSE41(const uint16_t* source, uint8_t* destination, uint32_t count, bool stream)
+	{
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i low	= _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+			const __m128i high	= _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4 + 8));
+			Store128(destination + i * 4, _mm_packus_epi16(NarrowWords(low), NarrowWords(high)), stream);
+		}
+		NarrowRGBA16Scalar(source + i * 4, destination + i * 4, count - i);
+	}
+
+	/*********** AVX2 KERNELS ***********/
+
+	PIXEL_TARGET("avx2") inline void Store256(uint8_t* destination, __m256i value, bool stream)
+	{
+		if (!stream)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), value);
+		}
+		else if ((reinterpret_cast<uintptr_t>(destination) & 31) == 0)
+		{
+			_mm256_stream_si256(reinterpret_cast<__m256i*>(destination), value);
+		}
+		else
+		{
+			// The rows are only guaranteed to be 16 byte aligned
+			_mm_stream_si128(reinterpret_cast<__m128i*>(destination), _mm256_castsi256_si128(value));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(destination + 16), _mm256_extracti128_si256(value, 1));
+		}
+	}
+
+	PIXEL_TARGET("avx2") void ExpandRGBAVX2(const uint8_t* source, uint8_t* destination, uint32_t count, bool isBGR, bool stream)
+	{
+		// The shuffle works within each 128 bit lane, so each lane is loaded with 4 texels
+		const __m256i shuffle = isBGR ?
+			_mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+			_mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+		// The second load reads 16 bytes from the fifth texel
+		uint32_t i = 0;
+		for (; i + 10 <= count; i += 8)
+		{
+			const __m128i low	= _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+			const __m128i high	= _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 12));
+			const __m256i texels = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+			Store256(destination + i * 4, _mm256_or_si256(_mm256_shuffle_epi8(texels, shuffle), alpha), stream);
+		}
+		ExpandRGBSSE41(source + i * 3, destination + i * 4, count - i, isBGR, stream);
+	}
+
+	PIXEL_TARGET("avx2") void SwizzleAVX2(const uint8_t* source, uint8_t* destination, uint32_t count, bool stream)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256i texels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+			Store256(destination + i * 4, _mm256_shuffle_epi8(texels, shuffle), stream);
+		}
+		SwizzleSSE41(source + i * 4, destination + i * 4, count - i, stream);
+	}
+
+	PIXEL_TARGET("avx2") inline __m256i PremultiplyWords256(__m256i texels)
+	{
+		const __m256i alphaShuffle	= _mm256_setr_epi8(6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15, 6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+		const __m256i alpha			= _mm256_blend_epi16(_mm256_shuffle_epi8(texels, alphaShuffle), _mm256_set1_epi16(255), 0x88);
+		const __m256i product		= _mm256_add_epi16(_mm256_mullo_epi16(texels, alpha), _mm256_set1_epi16(128));
+		return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+	}
+
+	PIXEL_TARGET("avx2") void PremultiplyAVX2(const uint8_t* source, uint8_t* destination, uint32_t count, bool stream)
+	{
+		// The unpack and pack instructions both work within the lanes, so the texel order is kept
+		const __m256i zero = _mm256_setzero_si256();
+
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256i texels	= _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+			const __m256i low		= PremultiplyWords256(_mm256_unpacklo_epi8(texels, zero));
+			const __m256i high		= PremultiplyWords256(_mm256_unpackhi_epi8(texels, zero));
+			Store256(destination + i * 4, _mm256_packus_epi16(low, high), stream);
+		}
+		PremultiplySSE41(source + i * 4, destination + i * 4, count - i, stream);
+	}
+
+	PIXEL_TARGET("avx2") void NarrowRGBA16AVX2(const uint16_t* source, uint8_t* destination, uint32_t count, bool stream)
+	{
+		const __m256i multiplier	= _mm256_set1_epi16(static_cast<short>(0xFF01));
+		const __m256i rounding		= _mm256_set1_epi16(128);
+
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i low		= _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+			__m256i high	= _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4 + 16));
+			low				= _mm256_srli_epi16(_mm256_add_epi16(_mm256_mulhi_epu16(low, multiplier), rounding), 8);
+			high			= _mm256_srli_epi16(_mm256_add_epi16(_mm256_mulhi_epu16(high, multiplier), rounding), 8);
+
+			// The pack interleaves the lanes of both sources, the permute restores the texel order
+			const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+			Store256(destination + i * 4, packed, stream);
+		}
+		NarrowRGBA16SSE41(source + i * 4, destination + i * 4, count - i, stream);
+	}
+
+	PIXEL_TARGET("avx2,f16c") void FloatToHalfAVX2(const float* source, uint16_t* destination, uint32_t count, bool stream)
+	{
+		// Two texels per conversion
+		uint32_t i = 0;
+		for (; i + 2 <= count; i += 2)
+		{
+			const __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(source + i * 4), _MM_FROUND_TO_NEAREST_INT);
+			Store128(reinterpret_cast<uint8_t*>(destination + i * 4), halves, stream);
+		}
+		FloatToHalfScalar(source + i * 4, destination + i * 4, count - i);
+	}
+
+	/*********** CPU DETECTION ***********/
+
+	void GetCpuid(uint32_t leaf, uint32_t registers[4])
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuidex(info, static_cast<int>(leaf), 0);
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			registers[i] = static_cast<uint32_t>(info[i]);
+		}
+#else
+		__cpuid_count(leaf, 0, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	// The OS saves the AVX registers across the context switches
+	bool IsAVXStateEnabled()
+	{
+#ifdef _MSC_VER
+		const uint64_t xcr0 = _xgetbv(0);
+#else
+		uint32_t eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		const uint64_t xcr0 = (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+		return (xcr0 & 6) == 6;
+	}
+#endif
+
+	PixelSimdLevel DetectSimdLevel()
+	{
+#ifdef PIXEL_CONVERTER_X86
+		uint32_t registers[4];
+		GetCpuid(0, registers);
+		const uint32_t maxLeaf = registers[0];
+
+		GetCpuid(1, registers);
+		const bool hasSSE41		= (registers[2] & (1u << 19)) != 0;
+		const bool hasOSXSAVE	= (registers[2] & (1u << 27)) != 0;
+		const bool hasAVX		= (registers[2] & (1u << 28)) != 0;
+		const bool hasF16C		= (registers[2] & (1u << 29)) != 0;
+		if (!hasSSE41)
+		{
+			return PIXEL_SIMD_NONE;
+		}
+
+		bool hasAVX2 = false;
+		if (maxLeaf >= 7)
+		{
+			GetCpuid(7, registers);
+			hasAVX2 = (registers[1] & (1u << 5)) != 0;
+		}
+		if (hasAVX2 && hasAVX && hasF16C && hasOSXSAVE && IsAVXStateEnabled())
+		{
+			return PIXEL_SIMD_AVX2;
+		}
+		return PIXEL_SIMD_SSE41;
+#else
+		return PIXEL_SIMD_NONE;
+#endif
+	}
+
+	const PixelSimdLevel supportedSimdLevel = DetectSimdLevel();
+	PixelSimdLevel simdLevel = supportedSimdLevel;
+}
+
+void VulkanPixelConverter::Convert(PixelConversion conversion, const void* source, size_t sourceRowPitch, void* destination, size_t destinationRowPitch, uint32_t width, uint32_t height)
+{
+	// Streaming stores pay off once the image no longer fits in the caches
+	const bool stream = GetSimdLevel() != PIXEL_SIMD_NONE &&
+		destinationRowPitch * height >= PIXEL_STREAMING_THRESHOLD &&
+		(reinterpret_cast<uintptr_t>(destination) & 15) == 0 &&
+		(destinationRowPitch & 15) == 0;
+
+	const uint8_t* sourceRow	= static_cast<const uint8_t*>(source);
+	uint8_t* destinationRow		= static_cast<uint8_t*>(destination);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		ConvertRow(conversion, sourceRow, destinationRow, width, stream);
+		sourceRow		+= sourceRowPitch;
+		destinationRow	+= destinationRowPitch;
+	}
+
+#ifdef PIXEL_CONVERTER_X86
+	// The streamed stores must be visible before the memory is handed to the GPU
+	if (stream)
+	{
+		_mm_sfence();
+	}
+#endif
+}
+
+void VulkanPixelConverter::ConvertRow(PixelConversion conversion, const void* source, void* destination, uint32_t texelCount, bool stream)
+{
+	const uint8_t* sourceBytes	= static_cast<const uint8_t*>(source);
+	uint8_t* destinationBytes	= static_cast<uint8_t*>(destination);
+	const PixelSimdLevel level	= GetSimdLevel();
+
+#ifdef PIXEL_CONVERTER_X86
+	if (level == PIXEL_SIMD_AVX2)
+	{
+		switch (conversion)
+		{
+		case PIXEL_COPY:					CopySSE41(sourceBytes, destinationBytes, texelCount, stream); return;
+		case PIXEL_RGB8_TO_RGBA8:			ExpandRGBAVX2(sourceBytes, destinationBytes, texelCount, false, stream); return;
+		case PIXEL_BGR8_TO_RGBA8:			ExpandRGBAVX2(sourceBytes, destinationBytes, texelCount, true, stream); return;
+		case PIXEL_BGRA8_TO_RGBA8:			SwizzleAVX2(sourceBytes, destinationBytes, texelCount, stream); return;
+		case PIXEL_PREMULTIPLY_ALPHA:		PremultiplyAVX2(sourceBytes, destinationBytes, texelCount, stream); return;
+		case PIXEL_RGBA16_TO_RGBA8:			NarrowRGBA16AVX2(static_cast<const uint16_t*>(source), destinationBytes, texelCount, stream); return;
+		case PIXEL_FLOAT_TO_HALF:			FloatToHalfAVX2(static_cast<const float*>(source), static_cast<uint16_t*>(destination), texelCount, stream); return;
+		default:							break;
+		}
+	}
+	else if (level == PIXEL_SIMD_SSE41)
+	{
+		switch (conversion)
+		{
+		case PIXEL_COPY:					CopySSE41(sourceBytes, destinationBytes, texelCount, stream); return;
+		case PIXEL_RGB8_TO_RGBA8:			ExpandRGBSSE41(sourceBytes, destinationBytes, texelCount, false, stream); return;
+		case PIXEL_BGR8_TO_RGBA8:			ExpandRGBSSE41(sourceBytes, destinationBytes, texelCount, true, stream); return;
+		case PIXEL_BGRA8_TO_RGBA8:			SwizzleSSE41(sourceBytes, destinationBytes, texelCount, stream); return;
+		case PIXEL_PREMULTIPLY_ALPHA:		PremultiplySSE41(sourceBytes, destinationBytes, texelCount, stream); return;
+		case PIXEL_RGBA16_TO_RGBA8:			NarrowRGBA16SSE41(static_cast<const uint16_t*>(source), destinationBytes, texelCount, stream); return;
+		default:							break;
+		}
+	}
+#else
+	(void)level;
+	(void)stream;
+#endif
+
+	switch (conversion)
+	{
+	case PIXEL_COPY:					memcpy(destinationBytes, sourceBytes, texelCount * 4); break;
+	case PIXEL_RGB8_TO_RGBA8:			ExpandRGBScalar(sourceBytes, destinationBytes, texelCount, false); break;
+	case PIXEL_BGR8_TO_RGBA8:			ExpandRGBScalar(sourceBytes, destinationBytes, texelCount, true); break;
+	case PIXEL_BGRA8_TO_RGBA8:			SwizzleScalar(sourceBytes, destinationBytes, texelCount); break;
+	case PIXEL_PREMULTIPLY_ALPHA:		PremultiplyScalar(sourceBytes, destinationBytes, texelCount); break;
+	case PIXEL_SRGB8_TO_LINEAR_HALF:	LinearizeSRGBScalar(sourceBytes, static_cast<uint16_t*>(destination), texelCount); break;
+	case PIXEL_RGBA16_TO_RGBA8:			NarrowRGBA16Scalar(static_cast<const uint16_t*>(source), destinationBytes, texelCount); break;
+	case PIXEL_FLOAT_TO_HALF:			FloatToHalfScalar(static_cast<const float*>(source), static_cast<uint16_t*>(destination), texelCount); break;
+	}
+}
+
+uint32_t VulkanPixelConverter::GetSourceTexelSize(PixelConversion conversion)
+{
+	switch (conversion)
+	{
+	case PIXEL_RGB8_TO_RGBA8:
+	case PIXEL_BGR8_TO_RGBA8:
+		return 3;
+	case PIXEL_RGBA16_TO_RGBA8:
+		return 8;
+	case PIXEL_FLOAT_TO_HALF:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+uint32_t VulkanPixelConverter::GetDestinationTexelSize(PixelConversion conversion)
+{
+	switch (conversion)
+	{
+	case PIXEL_SRGB8_TO_LINEAR_HALF:
+	case PIXEL_FLOAT_TO_HALF:
+		return 8;
+	default:
+		return 4;
+	}
+}
+
+PixelSimdLevel VulkanPixelConverter::GetSimdLevel()
+{
+	return simdLevel;
+}
+
+void VulkanPixelConverter::LimitSimdLevel(PixelSimdLevel level)
+{
+	simdLevel = std::min(supportedSimdLevel, level);
+}
+
+uint16_t VulkanPixelConverter::FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign		= (bits >> 16) & 0x8000;
+	const uint32_t exponent	= (bits >> 23) & 0xFF;
+	uint32_t mantissa		= bits & 0x7FFFFF;
+
+	// Infinity stays infinite, the NaNs stay quiet NaNs
+	if (exponent == 0xFF)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	}
+
+	const int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+	if (halfExponent >= 31)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00);
+	}
+
+	// Denormals, the implicit bit is shifted into the mantissa
+	if (halfExponent <= 0)
+	{
+		if (halfExponent < -10)
+		{
+			return static_cast<uint16_t>(sign);
+		}
+		mantissa |= 0x800000;
+		const uint32_t shift	= static_cast<uint32_t>(14 - halfExponent);
+		const uint32_t halfway	= 1u << (shift - 1);
+		const uint32_t rest		= mantissa & ((1u << shift) - 1);
+		uint32_t half			= mantissa >> shift;
+		if (rest > halfway || (rest == halfway && (half & 1)))
+		{
+			half++;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	// Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+	uint32_t half			= (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+	const uint32_t rest		= mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+	{
+		half++;
+	}
+	return static_cast<uint16_t>(sign | half);
+}
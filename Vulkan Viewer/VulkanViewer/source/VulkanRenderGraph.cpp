@@ -0,0 +1,857 @@
+#include "VulkanRenderGraph.h"
+#include "VulkanDevice.h"
+
+VulkanRenderGraph::VulkanRenderGraph(VulkanDevice* deviceObj) :
+	_deviceObj(deviceObj),
+	_compiled(false),
+	_hasAsyncWork(false),
+	_asyncWaitStages(0),
+	_timestampsSupported(false),
+	_timedFrames(0),
+	_overlapTime(0.0)
+{
+}
+
+VulkanRenderGraph::~VulkanRenderGraph()
+{
+}
+
+RenderGraphResource VulkanRenderGraph::ImportImage(const char* name, VkImage image, VkImageAspectFlags aspect, VkImageLayout initialLayout)
+{
+	Resource resource = {};
+	resource._name			= name;
+	resource._isTransient	= false;
+	resource._isBuffer		= false;
+	resource._desc._aspect	= aspect;
+	resource._image			= image;
+	resource._view			= VK_NULL_HANDLE;
+	resource._initialLayout	= initialLayout;
+	resource._isOutput		= false;
+	resource._finalLayout	= initialLayout;
+	_resources.push_back(resource);
+	return static_cast<RenderGraphResource>(_resources.size() - 1);
+}
+
+void VulkanRenderGraph::SetImportedImage(RenderGraphResource resource, VkImage image)
+{
+	assert(!_resources[resource]._isTransient);
+	_resources[resource]._image = image;
+}
+
+RenderGraphResource VulkanRenderGraph::ImportBuffer(const char* name)
+{
+	Resource resource = {};
+	resource._name			= name;
+	resource._isTransient	= false;
+	resource._isBuffer		= true;
+	resource._image			= VK_NULL_HANDLE;
+	resource._view			= VK_NULL_HANDLE;
+	resource._initialLayout	= VK_IMAGE_LAYOUT_UNDEFINED;
+	resource._isOutput		= false;
+	resource._finalLayout	= VK_IMAGE_LAYOUT_UNDEFINED;
+	_resources.push_back(resource);
+	return static_cast<RenderGraphResource>(_resources.size() - 1);
+}
+
+RenderGraphResource VulkanRenderGraph::CreateTransientImage(const char* name, const RenderGraphImageDesc& desc)
+{
+	Resource resource = {};
+	resource._name			= name;
+	resource._isTransient	= true;
+	resource._isBuffer		= false;
+	resource._desc			= desc;
+	resource._image			= VK_NULL_HANDLE;
+	resource._view			= VK_NULL_HANDLE;
+	resource._initialLayout	= VK_IMAGE_LAYOUT_UNDEFINED;
+	resource._isOutput		= false;
+	resource._finalLayout	= VK_IMAGE_LAYOUT_UNDEFINED;
+	_resources.push_back(resource);
+	return static_cast<RenderGraphResource>(_resources.size() - 1);
+}
+
+VkImage VulkanRenderGraph::GetImage(RenderGraphResource resource) const
+{
+	return _resources[resource]._image;
+}
+
+VkImageView VulkanRenderGraph::GetImageView(RenderGraphResource resource) const
+{
+	return _resources[resource]._view;
+}
+
+void VulkanRenderGraph::MarkOutput(RenderGraphResource resource, VkImageLayout finalLayout)
+{
+	assert(!_resources[resource]._isBuffer);
+	_resources[resource]._isOutput		= true;
+	_resources[resource]._finalLayout	= finalLayout;
+}
+
+uint32_t VulkanRenderGraph::AddPass(const char* name, const std::function<void(VkCommandBuffer cmd)>& execute, RenderGraphQueue queue)
+{
+	Pass pass;
+	pass._name		= name;
+	pass._execute	= execute;
+	pass._culled	= false;
+	pass._queue		= queue;
+	pass._runsAsync	= false;
+	pass._gpuTime	= 0.0;
+	_passes.push_back(pass);
+	return static_cast<uint32_t>(_passes.size() - 1);
+}
+
+void VulkanRenderGraph::Read(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access)
+{
+	AddUse(pass, resource, access, false, false, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+void VulkanRenderGraph::Write(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access)
+{
+	AddUse(pass, resource, access, true, false, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+void VulkanRenderGraph::WriteAttachment(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access, VkImageLayout finalLayout)
+{
+	AddUse(pass, resource, access, true, true, finalLayout);
+}
+
+void VulkanRenderGraph::AddUse(uint32_t pass, RenderGraphResource resource, RenderGraphAccess access, bool isWrite, bool isAttachment, VkImageLayout finalLayout)
+{
+	// The graph has to be compiled again after any change
+	assert(!_compiled);
+
+	ResourceUse use;
+	use._resource		= resource;
+	use._access			= access;
+	use._isWrite		= isWrite;
+	use._isAttachment	= isAttachment;
+	use._finalLayout	= finalLayout;
+	_passes[pass]._uses.push_back(use);
+}
+
+VulkanRenderGraph::AccessInfo VulkanRenderGraph::GetAccessInfo(RenderGraphAccess access)
+{
+	AccessInfo info;
+	switch (access)
+	{
+	case RG_ACCESS_COLOR_ATTACHMENT_WRITE:
+		info._stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		info._access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		info._layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		break;
+	case RG_ACCESS_DEPTH_ATTACHMENT_WRITE:
+		info._stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		info._access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		info._layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		break;
+	case RG_ACCESS_DEPTH_ATTACHMENT_READ:
+		info._stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		info._access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		info._layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		break;
+	case RG_ACCESS_VERTEX_SHADER_READ:
+		info._stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+		info._access = VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		info._layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		break;
+	case RG_ACCESS_FRAGMENT_SHADER_READ:
+		info._stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		info._access = VK_ACCESS_SHADER_READ_BIT;
+		info._layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		break;
+	case RG_ACCESS_COMPUTE_SHADER_READ:
+		info._stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		info._access = VK_ACCESS_SHADER_READ_BIT;
+		info._layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		break;
+	case RG_ACCESS_COMPUTE_SHADER_WRITE:
+		info._stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		info._access = VK_ACCESS_SHADER_WRITE_BIT;
+		info._layout = VK_IMAGE_LAYOUT_GENERAL;
+		break;
+	case RG_ACCESS_TRANSFER_READ:
+		info._stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		info._access = VK_ACCESS_TRANSFER_READ_BIT;
+		info._layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		break;
+	case RG_ACCESS_TRANSFER_WRITE:
+		info._stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		info._access = VK_ACCESS_TRANSFER_WRITE_BIT;
+		info._layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		break;
+	case RG_ACCESS_PRESENT:
+	default:
+		// The presentation engine synchronizes through the semaphores, no access mask is needed
+		info._stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		info._access = 0;
+		info._layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		break;
+	}
+	return info;
+}
+
+void VulkanRenderGraph::Compile()
+{
+	CullPasses();
+	ScheduleAsyncPasses();
+	AllocateTransients();
+
+	// The hazards of the buffers are carried across the frames, starting from none
+	for (Resource& resource : _resources)
+	{
+		if (resource._isBuffer)
+		{
+			resource._layout			= VK_IMAGE_LAYOUT_UNDEFINED;
+			resource._writeStages		= 0;
+			resource._writeAccess		= 0;
+			resource._readStages		= 0;
+			resource._onComputeQueue	= false;
+		}
+	}
+
+	// Every graphics and compute queue supports timestamps when this limit is set
+	const uint32_t graphicsQueueIndex = _deviceObj->_graphicsQueueWithPresentIndex;
+	_timestampsSupported	= _deviceObj->_gpuProps.limits.timestampComputeAndGraphics == VK_TRUE &&
+		                      _deviceObj->_queueFamilyProps[graphicsQueueIndex].timestampValidBits > 0;
+	_timedFrames			= 0;
+	_overlapTime			= 0.0;
+	_compiled				= true;
+}
+
+void VulkanRenderGraph::CullPasses()
+{
+	// Walk the passes backward starting from the outputs, a pass survives
+	// when it writes a resource needed by an output or by a surviving pass.
+	std::vector<bool> needed(_resources.size(), false);
+	for (size_t i = 0; i < _resources.size(); i++)
+	{
+		needed[i] = _resources[i]._isOutput;
+	}
+
+	uint32_t culledCount = 0;
+	for (size_t p = _passes.size(); p-- > 0;)
+	{
+		Pass& pass = _passes[p];
+		pass._culled = true;
+		for (const ResourceUse& use : pass._uses)
+		{
+			if (use._isWrite && needed[use._resource])
+			{
+				pass._culled = false;
+				break;
+			}
+		}
+
+		if (pass._culled)
+		{
+			culledCount++;
+			continue;
+		}
+
+		for (const ResourceUse& use : pass._uses)
+		{
+			if (!use._isWrite)
+			{
+				needed[use._resource] = true;
+			}
+		}
+	}
+
+	if (culledCount > 0)
+	{
+		std::cout << "Render graph culled " << culledCount << " of " << _passes.size() << " passes" << std::endl;
+	}
+}
+
+void VulkanRenderGraph::ScheduleAsyncPasses()
+{
+	_hasAsyncWork		= false;
+	_asyncWaitStages	= 0;
+	for (Resource& resource : _resources)
+	{
+		resource._isAsync = false;
+	}
+
+	// The compute queue only waits for the graphics work of the previous frame. An async pass
+	// touching a resource already used by the graphics passes of the frame, an imported image
+	// or an output would race with the graphics queue, it is recorded with the graphics passes.
+	// The imported buffers are shared by both queues, the previous frame is their only hazard.
+	std::vector<bool> usedByGraphics(_resources.size(), false);
+	uint32_t asyncCount = 0;
+	for (Pass& pass : _passes)
+	{
+		pass._runsAsync = false;
+		if (pass._culled)
+		{
+			continue;
+		}
+
+		if (pass._queue == RG_QUEUE_ASYNC_COMPUTE && _deviceObj->HasAsyncComputeQueue())
+		{
+			pass._runsAsync = true;
+			for (const ResourceUse& use : pass._uses)
+			{
+				const Resource& resource = _resources[use._resource];
+				if (usedByGraphics[use._resource] || (!resource._isTransient && !resource._isBuffer) || resource._isOutput)
+				{
+					pass._runsAsync = false;
+					break;
+				}
+			}
+		}
+
+		for (const ResourceUse& use : pass._uses)
+		{
+			Resource& resource = _resources[use._resource];
+			if (pass._runsAsync)
+			{
+				resource._isAsync = true;
+				continue;
+			}
+
+			// The graphics submission waits for the compute queue at the stages reading its results
+			if (resource._isAsync)
+			{
+				_asyncWaitStages |= GetAccessInfo(use._access)._stages;
+			}
+			usedByGraphics[use._resource] = true;
+		}
+
+		if (pass._runsAsync)
+		{
+			asyncCount++;
+		}
+	}
+
+	_hasAsyncWork = asyncCount > 0;
+	if (_hasAsyncWork)
+	{
+		// The semaphore wait needs a stage even when no graphics pass reads the results,
+		// top of pipe would not block any stage
+		if (_asyncWaitStages == 0)
+		{
+			_asyncWaitStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		}
+		std::cout << "Render graph scheduled " << asyncCount << " passes on the async compute queue" << std::endl;
+	}
+}
+
+void VulkanRenderGraph::AllocateTransients()
+{
+	// Lifetime of each transient, in the order of the surviving passes
+	std::vector<uint32_t> transients;
+	for (size_t i = 0; i < _resources.size(); i++)
+	{
+		Resource& resource = _resources[i];
+		resource._firstPass = UINT32_MAX;
+		resource._lastPass	= 0;
+		if (resource._isTransient)
+		{
+			transients.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	uint32_t passIndex = 0;
+	for (const Pass& pass : _passes)
+	{
+		if (pass._culled)
+		{
+			continue;
+		}
+		for (const ResourceUse& use : pass._uses)
+		{
+			Resource& resource	= _resources[use._resource];
+			resource._firstPass	= std::min(resource._firstPass, passIndex);
+			resource._lastPass	= std::max(resource._lastPass, passIndex);
+		}
+		passIndex++;
+	}
+
+	// Create the images of the transients used by a surviving pass
+	VkDeviceSize unaliasedSize = 0;
+	std::vector<uint32_t> liveTransients;
+	for (uint32_t index : transients)
+	{
+		Resource& resource = _resources[index];
+		if (resource._firstPass == UINT32_MAX)
+		{
+			continue;
+		}
+
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType					= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.pNext					= nullptr;
+		imageInfo.imageType				= VK_IMAGE_TYPE_2D;
+		imageInfo.format				= resource._desc._format;
+		imageInfo.extent.width			= resource._desc._width;
+		imageInfo.extent.height			= resource._desc._height;
+		imageInfo.extent.depth			= 1;
+		imageInfo.mipLevels				= 1;
+		imageInfo.arrayLayers			= 1;
+		imageInfo.samples				= VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling				= VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.queueFamilyIndexCount	= 0;
+		imageInfo.pQueueFamilyIndices	= nullptr;
+		imageInfo.sharingMode			= VK_SHARING_MODE_EXCLUSIVE;
+
+		// The images of the async passes are used by both queues without ownership transfers
+		const uint32_t queueFamilies[] = { _deviceObj->_graphicsQueueWithPresentIndex, _deviceObj->_computeQueueIndex };
+		if (resource._isAsync)
+		{
+			imageInfo.queueFamilyIndexCount	= 2;
+			imageInfo.pQueueFamilyIndices	= queueFamilies;
+			imageInfo.sharingMode			= VK_SHARING_MODE_CONCURRENT;
+		}
+		imageInfo.usage					= resource._desc._usage;
+		imageInfo.initialLayout			= VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.flags					= 0;
+
+		VkResult result = vkCreateImage(_deviceObj->_device, &imageInfo, nullptr, &resource._image);
+		assert(result == VK_SUCCESS);
+
+		vkGetImageMemoryRequirements(_deviceObj->_device, resource._image, &resource._memRqrmnt);
+		unaliasedSize += resource._memRqrmnt.size;
+		liveTransients.push_back(index);
+	}
+
+	// Greedy interval packing, the largest images pick a block first. An image
+	// joins a block when none of the block's images is alive at the same time.
+	std::sort(liveTransients.begin(), liveTransients.end(), [this](uint32_t a, uint32_t b)
+	{
+		return _resources[a]._memRqrmnt.size > _resources[b]._memRqrmnt.size;
+	});
+
+	for (uint32_t index : liveTransients)
+	{
+		Resource& resource = _resources[index];
+
+		uint32_t memoryTypeIndex = 0;
+		const bool pass = _deviceObj->MemoryTypeFromProperties(resource._memRqrmnt.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memoryTypeIndex);
+		assert(pass);
+
+		resource._memoryBlock = UINT32_MAX;
+		for (size_t b = 0; b < _memoryBlocks.size() && resource._memoryBlock == UINT32_MAX; b++)
+		{
+			// The two queues run concurrently, the images of the async passes get their own memory
+			MemoryBlock& block = _memoryBlocks[b];
+			if (block._memoryTypeIndex != memoryTypeIndex || block._isAsync || resource._isAsync)
+			{
+				continue;
+			}
+
+			bool overlaps = false;
+			for (const auto& interval : block._intervals)
+			{
+				if (resource._firstPass <= interval.second && interval.first <= resource._lastPass)
+				{
+					overlaps = true;
+					break;
+				}
+			}
+
+			if (!overlaps)
+			{
+				resource._memoryBlock = static_cast<uint32_t>(b);
+			}
+		}
+
+		if (resource._memoryBlock == UINT32_MAX)
+		{
+			MemoryBlock block;
+			block._memory			= VK_NULL_HANDLE;
+			block._size				= 0;
+			block._memoryTypeIndex	= memoryTypeIndex;
+			block._isAsync			= resource._isAsync;
+			_memoryBlocks.push_back(block);
+			resource._memoryBlock = static_cast<uint32_t>(_memoryBlocks.size() - 1);
+		}
+
+		// Every image is bound at offset 0, so the block only has to be large enough
+		MemoryBlock& block = _memoryBlocks[resource._memoryBlock];
+		block._size = std::max(block._size, resource._memRqrmnt.size);
+		block._intervals.push_back(std::make_pair(resource._firstPass, resource._lastPass));
+	}
+
+	VkDeviceSize aliasedSize = 0;
+	for (MemoryBlock& block : _memoryBlocks)
+	{
+		VkMemoryAllocateInfo memAlloc;
+		memAlloc.sType				= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memAlloc.pNext				= nullptr;
+		memAlloc.allocationSize		= block._size;
+		memAlloc.memoryTypeIndex	= block._memoryTypeIndex;
+
+		const VkResult result = vkAllocateMemory(_deviceObj->_device, &memAlloc, nullptr, &block._memory);
+		assert(result == VK_SUCCESS);
+		aliasedSize += block._size;
+	}
+
+	for (uint32_t index : liveTransients)
+	{
+		Resource& resource = _resources[index];
+		const VkResult result = vkBindImageMemory(_deviceObj->_device, resource._image, _memoryBlocks[resource._memoryBlock]._memory, 0);
+		assert(result == VK_SUCCESS);
+		CreateTransientView(resource);
+	}
+
+	if (!liveTransients.empty())
+	{
+		std::cout << "Render graph transient memory: " << unaliasedSize / 1024 << " KB without aliasing, "
+			      << aliasedSize / 1024 << " KB in " << _memoryBlocks.size() << " aliased blocks" << std::endl;
+	}
+}
+
+void VulkanRenderGraph::CreateTransientView(Resource& resource)
+{
+	VkImageViewCreateInfo imgViewInfo = {};
+	imgViewInfo.sType								= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imgViewInfo.pNext								= nullptr;
+	imgViewInfo.image								= resource._image;
+	imgViewInfo.viewType							= VK_IMAGE_VIEW_TYPE_2D;
+	imgViewInfo.format								= resource._desc._format;
+	imgViewInfo.components							= { VK_COMPONENT_SWIZZLE_IDENTITY };
+	imgViewInfo.subresourceRange.aspectMask			= resource._desc._aspect;
+	imgViewInfo.subresourceRange.baseMipLevel		= 0;
+	imgViewInfo.subresourceRange.levelCount			= 1;
+	imgViewInfo.subresourceRange.baseArrayLayer		= 0;
+	imgViewInfo.subresourceRange.layerCount			= 1;
+	imgViewInfo.flags								= 0;
+
+	const VkResult result = vkCreateImageView(_deviceObj->_device, &imgViewInfo, nullptr, &resource._view);
+	assert(result == VK_SUCCESS);
+}
+
+void VulkanRenderGraph::Execute(VkCommandBuffer cmd, VkCommandBuffer computeCmd, VkQueryPool queryPool)
+{
+	assert(_compiled);
+
+	if (!_timestampsSupported)
+	{
+		queryPool = VK_NULL_HANDLE;
+	}
+
+	// Every frame starts from the initial layouts. Transients have undefined content, which
+	// also makes the first use of an aliased image discard what the previous owner left.
+	// The buffers keep their content, the first use of a frame waits for the previous frame.
+	for (Resource& resource : _resources)
+	{
+		if (resource._isBuffer)
+		{
+			continue;
+		}
+		resource._layout		= resource._initialLayout;
+		resource._writeStages	= 0;
+		resource._writeAccess	= 0;
+		resource._readStages	= 0;
+		resource._onComputeQueue = false;
+	}
+
+	// The queries of each pass are reset by the queue which writes them
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		for (size_t p = 0; p < _passes.size(); p++)
+		{
+			const Pass& pass = _passes[p];
+			if (!pass._culled)
+			{
+				const VkCommandBuffer passCmd = (pass._runsAsync && computeCmd != VK_NULL_HANDLE) ? computeCmd : cmd;
+				vkCmdResetQueryPool(passCmd, queryPool, static_cast<uint32_t>(2 * p), 2);
+			}
+		}
+	}
+
+	// Stages and writes of the images sharing each memory block, the first use of an
+	// aliased image must wait for the image which owned the memory before it.
+	std::vector<VkPipelineStageFlags> blockStages(_memoryBlocks.size(), 0);
+	std::vector<VkAccessFlags>		  blockWriteAccess(_memoryBlocks.size(), 0);
+
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	for (size_t p = 0; p < _passes.size(); p++)
+	{
+		Pass& pass = _passes[p];
+		if (pass._culled)
+		{
+			continue;
+		}
+
+		// Without a compute command buffer the async passes are recorded in order with the others
+		const bool onComputeQueue		= pass._runsAsync && computeCmd != VK_NULL_HANDLE;
+		const VkCommandBuffer passCmd	= onComputeQueue ? computeCmd : cmd;
+
+		if (queryPool != VK_NULL_HANDLE)
+		{
+			vkCmdWriteTimestamp(passCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, static_cast<uint32_t>(2 * p));
+		}
+
+		// All the barriers of the pass are gathered and issued in one call
+		VkPipelineStageFlags srcStages		= 0;
+		VkPipelineStageFlags dstStages		= 0;
+		VkAccessFlags		 globalSrcAccess = 0;
+		VkAccessFlags		 globalDstAccess = 0;
+		imageBarriers.clear();
+
+		for (const ResourceUse& use : pass._uses)
+		{
+			Resource& resource		= _resources[use._resource];
+			const AccessInfo info	= GetAccessInfo(use._access);
+
+			// The semaphore waited on at the async wait stages made the writes of the compute
+			// queue visible, a layout change on the graphics queue only has to chain with it
+			const bool fromComputeQueue = resource._onComputeQueue && !onComputeQueue;
+			if (fromComputeQueue)
+			{
+				resource._writeStages	= 0;
+				resource._writeAccess	= 0;
+				resource._readStages	= 0;
+			}
+
+			// A buffer last used by the graphics queue is used by the compute queue of the next
+			// frame, whose submission waits for the graphics submission of the previous frame
+			if (onComputeQueue && !resource._onComputeQueue)
+			{
+				resource._writeStages	= 0;
+				resource._writeAccess	= 0;
+				resource._readStages	= 0;
+			}
+			resource._onComputeQueue = onComputeQueue;
+
+			// Attachments are transitioned by the render pass, which accepts any current
+			// layout since their initial layout is undefined. Only the hazards are synchronized.
+			const bool layoutChange = !use._isAttachment && !resource._isBuffer && resource._layout != info._layout;
+
+			if (!layoutChange && !use._isWrite)
+			{
+				// Read after read needs nothing, read after write needs
+				// a dependency unless an earlier read stage already got it
+				if (resource._writeStages != 0 && (resource._readStages & info._stages) != info._stages)
+				{
+					srcStages		|= resource._writeStages;
+					dstStages		|= info._stages;
+					globalSrcAccess	|= resource._writeAccess;
+					globalDstAccess	|= info._access;
+				}
+				resource._readStages |= info._stages;
+				continue;
+			}
+
+			// Write after read only needs an execution dependency,
+			// write after write and layout changes need the memory too.
+			VkPipelineStageFlags previousStages = resource._writeStages | resource._readStages;
+			VkAccessFlags		 previousWrites = resource._writeAccess;
+			if (resource._isTransient && resource._layout == VK_IMAGE_LAYOUT_UNDEFINED)
+			{
+				previousStages |= blockStages[resource._memoryBlock];
+				previousWrites |= blockWriteAccess[resource._memoryBlock];
+			}
+			if (fromComputeQueue)
+			{
+				previousStages = info._stages;
+			}
+
+			if (layoutChange)
+			{
+				VkImageMemoryBarrier imgMemoryBarrier = {};
+				imgMemoryBarrier.sType							 = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				imgMemoryBarrier.pNext							 = nullptr;
+				imgMemoryBarrier.srcAccessMask					 = previousWrites;
+				imgMemoryBarrier.dstAccessMask					 = info._access;
+				imgMemoryBarrier.oldLayout						 = resource._layout;
+				imgMemoryBarrier.newLayout						 = info._layout;
+				imgMemoryBarrier.srcQueueFamilyIndex			 = VK_QUEUE_FAMILY_IGNORED;
+				imgMemoryBarrier.dstQueueFamilyIndex			 = VK_QUEUE_FAMILY_IGNORED;
+				imgMemoryBarrier.image							 = resource._image;
+				imgMemoryBarrier.subresourceRange.aspectMask	 = resource._desc._aspect;
+				imgMemoryBarrier.subresourceRange.baseMipLevel	 = 0;
+				imgMemoryBarrier.subresourceRange.levelCount	 = VK_REMAINING_MIP_LEVELS;
+				imgMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+				imgMemoryBarrier.subresourceRange.layerCount	 = VK_REMAINING_ARRAY_LAYERS;
+				imageBarriers.push_back(imgMemoryBarrier);
+
+				srcStages |= previousStages != 0 ? previousStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+				dstStages |= info._stages;
+			}
+			else if (previousStages != 0)
+			{
+				srcStages		|= previousStages;
+				dstStages		|= info._stages;
+				globalSrcAccess	|= previousWrites;
+				globalDstAccess	|= info._access;
+			}
+
+			resource._layout		= use._isAttachment ? use._finalLayout : info._layout;
+			resource._writeStages	= info._stages;
+			resource._writeAccess	= info._access & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+				                                      VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+			resource._readStages	= 0;
+
+			if (resource._isTransient)
+			{
+				blockStages[resource._memoryBlock]		|= info._stages;
+				blockWriteAccess[resource._memoryBlock]	|= resource._writeAccess;
+			}
+		}
+
+		if (dstStages != 0)
+		{
+			VkMemoryBarrier memoryBarrier = {};
+			memoryBarrier.sType			= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.pNext			= nullptr;
+			memoryBarrier.srcAccessMask	= globalSrcAccess;
+			memoryBarrier.dstAccessMask	= globalDstAccess;
+
+			const bool hasMemoryBarrier = globalSrcAccess != 0 || globalDstAccess != 0;
+			vkCmdPipelineBarrier(passCmd, srcStages, dstStages, 0,
+				                 hasMemoryBarrier ? 1 : 0, hasMemoryBarrier ? &memoryBarrier : nullptr,
+				                 0, nullptr,
+				                 static_cast<uint32_t>(imageBarriers.size()), imageBarriers.empty() ? nullptr : imageBarriers.data());
+		}
+
+		pass._execute(passCmd);
+
+		if (queryPool != VK_NULL_HANDLE)
+		{
+			vkCmdWriteTimestamp(passCmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, static_cast<uint32_t>(2 * p + 1));
+		}
+	}
+
+	// Leave the outputs in the layout expected by their consumers
+	imageBarriers.clear();
+	VkPipelineStageFlags srcStages = 0;
+	for (Resource& resource : _resources)
+	{
+		if (!resource._isOutput || resource._layout == resource._finalLayout)
+		{
+			continue;
+		}
+
+		VkImageMemoryBarrier imgMemoryBarrier = {};
+		imgMemoryBarrier.sType							 = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imgMemoryBarrier.pNext							 = nullptr;
+		imgMemoryBarrier.srcAccessMask					 = resource._writeAccess;
+		imgMemoryBarrier.dstAccessMask					 = 0;
+		imgMemoryBarrier.oldLayout						 = resource._layout;
+		imgMemoryBarrier.newLayout						 = resource._finalLayout;
+		imgMemoryBarrier.srcQueueFamilyIndex			 = VK_QUEUE_FAMILY_IGNORED;
+		imgMemoryBarrier.dstQueueFamilyIndex			 = VK_QUEUE_FAMILY_IGNORED;
+		imgMemoryBarrier.image							 = resource._image;
+		imgMemoryBarrier.subresourceRange.aspectMask	 = resource._desc._aspect;
+		imgMemoryBarrier.subresourceRange.baseMipLevel	 = 0;
+		imgMemoryBarrier.subresourceRange.levelCount	 = VK_REMAINING_MIP_LEVELS;
+		imgMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+		imgMemoryBarrier.subresourceRange.layerCount	 = VK_REMAINING_ARRAY_LAYERS;
+		imageBarriers.push_back(imgMemoryBarrier);
+
+		srcStages |= resource._writeStages | resource._readStages;
+		resource._layout = resource._finalLayout;
+	}
+
+	if (!imageBarriers.empty())
+	{
+		vkCmdPipelineBarrier(cmd, srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			                 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+}
+
+uint32_t VulkanRenderGraph::GetTimestampQueryCount() const
+{
+	return _timestampsSupported ? static_cast<uint32_t>(2 * _passes.size()) : 0;
+}
+
+void VulkanRenderGraph::ReadTimestamps(VkQueryPool queryPool)
+{
+	if (!_timestampsSupported || queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	// The queries of a pool are unavailable until a frame has been executed with it
+	std::vector<uint64_t> timestamps(2 * _passes.size(), 0);
+	for (size_t p = 0; p < _passes.size(); p++)
+	{
+		if (_passes[p]._culled)
+		{
+			continue;
+		}
+
+		const VkResult result = vkGetQueryPoolResults(_deviceObj->_device, queryPool, static_cast<uint32_t>(2 * p), 2,
+			                                          2 * sizeof(uint64_t), &timestamps[2 * p], sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result != VK_SUCCESS)
+		{
+			return;
+		}
+	}
+
+	// The timestamps of all the queues share the same time domain
+	const double msPerTick		= _deviceObj->_gpuProps.limits.timestampPeriod / 1000000.0;
+	uint64_t graphicsBegin		= UINT64_MAX;
+	uint64_t graphicsEnd		= 0;
+	uint64_t asyncBegin			= UINT64_MAX;
+	uint64_t asyncEnd			= 0;
+	for (size_t p = 0; p < _passes.size(); p++)
+	{
+		Pass& pass = _passes[p];
+		if (pass._culled)
+		{
+			continue;
+		}
+
+		const uint64_t begin	= timestamps[2 * p];
+		const uint64_t end		= std::max(timestamps[2 * p + 1], begin);
+		pass._gpuTime += (end - begin) * msPerTick;
+
+		uint64_t& spanBegin	= pass._runsAsync ? asyncBegin : graphicsBegin;
+		uint64_t& spanEnd	= pass._runsAsync ? asyncEnd : graphicsEnd;
+		spanBegin			= std::min(spanBegin, begin);
+		spanEnd				= std::max(spanEnd, end);
+	}
+
+	const uint64_t overlapBegin	= std::max(graphicsBegin, asyncBegin);
+	const uint64_t overlapEnd	= std::min(graphicsEnd, asyncEnd);
+	if (asyncEnd > 0 && overlapEnd > overlapBegin)
+	{
+		_overlapTime += (overlapEnd - overlapBegin) * msPerTick;
+	}
+
+	if (++_timedFrames < RENDER_GRAPH_TIMING_INTERVAL)
+	{
+		return;
+	}
+
+	// Formatted apart, so the precision of std::cout is left untouched
+	std::stringstream report;
+	report << std::fixed << std::setprecision(3) << "Render graph GPU time per frame:";
+	for (Pass& pass : _passes)
+	{
+		if (!pass._culled)
+		{
+			report << " " << pass._name << (pass._runsAsync ? " (async) " : " ") << pass._gpuTime / _timedFrames << " ms,";
+		}
+		pass._gpuTime = 0.0;
+	}
+	report << " async compute overlap " << _overlapTime / _timedFrames << " ms";
+	std::cout << report.str() << std::endl;
+
+	_timedFrames = 0;
+	_overlapTime = 0.0;
+}
+
+void VulkanRenderGraph::Reset()
+{
+	for (Resource& resource : _resources)
+	{
+		if (resource._isTransient && resource._image != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(_deviceObj->_device, resource._view, nullptr);
+			vkDestroyImage(_deviceObj->_device, resource._image, nullptr);
+		}
+	}
+
+	for (MemoryBlock& block : _memoryBlocks)
+	{
+		vkFreeMemory(_deviceObj->_device, block._memory, nullptr);
+	}
+
+	_memoryBlocks.clear();
+	_resources.clear();
+	_passes.clear();
+	_compiled = false;
+}
@@ -2,10 +2,24 @@
 #include "VulkanApplication.h"
 #include "Wrappers.h"
 #include "MeshData.h"
+#include "VulkanTextureLoader.h"
 
 VulkanRenderer::VulkanRenderer(VulkanApplication * app, VulkanDevice* deviceObject) :
+	_currentFrame(0),
+	_staticCmdCount(0),
+	_staticDrawCount(0),
+	_staticCommandsDirty(true),
+	_staticStateVersion(0),
+	_atlasTexture(nullptr),
+	_renderGraph(deviceObject),
+	_swapchainResource(0),
+	_statsFrameCount(0),
+	_statsDrawCount(0),
+	_statsBindsIssued(0),
+	_statsBindsSkipped(0),
     _shaderObj(&deviceObject->_device),
-	_pipelineObj(&deviceObject->_device, &_renderPass)
+	_pipelineObj(&deviceObject->_device, &_renderPass),
+	_pipelineManager(deviceObject, &_pipelineObj)
 {
 	// Note: It's very important to initilize the member with 0 or respective value other wise it will break the system
 	memset(&_depth, 0, sizeof(_depth));
@@ -24,19 +38,49 @@ VulkanRenderer::VulkanRenderer(VulkanApplication * app, VulkanDevice* deviceObje
 		                                &_height,
 		                                &_application->_isResizing);
 
-	auto* drawableObj = new VulkanDrawable(&_deviceObj->_device,
-		                                   &_cmdPool,
-		                                   &_renderPass,
-		                                   &_deviceObj->_queue,
-		                                   &_framebuffers,
-		                                   _swapChainObj,
-		                                   &_width,
-		                                   &_height);
+	auto* drawableObj = new VulkanDrawable(&_deviceObj->_device);
+	drawableObj->SetTextureFile("LearningVulkan.ktx");
 	_drawableList.push_back(drawableObj);
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo;
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = nullptr;
+	semaphoreCreateInfo.flags = 0;
+
+	// Ticket 0 is always complete, the first wait on each frame returns immediately
+	for (FrameData& frame : _frames)
+	{
+		frame._cmdPool				= VK_NULL_HANDLE;
+		frame._cmdDraw				= VK_NULL_HANDLE;
+		frame._ticket				= 0;
+		frame._computeCmdPool		= VK_NULL_HANDLE;
+		frame._cmdCompute			= VK_NULL_HANDLE;
+		frame._queryPool			= VK_NULL_HANDLE;
+		frame._timestampsWritten	= false;
+
+		VkResult result = vkCreateSemaphore(_deviceObj->_device, &semaphoreCreateInfo, nullptr, &frame._presentCompleteSemaphore);
+		assert(result == VK_SUCCESS);
+		result = vkCreateSemaphore(_deviceObj->_device, &semaphoreCreateInfo, nullptr, &frame._drawingCompleteSemaphore);
+		assert(result == VK_SUCCESS);
+		result = vkCreateSemaphore(_deviceObj->_device, &semaphoreCreateInfo, nullptr, &frame._computeCompleteSemaphore);
+		assert(result == VK_SUCCESS);
+		result = vkCreateSemaphore(_deviceObj->_device, &semaphoreCreateInfo, nullptr, &frame._graphicsDoneSemaphore);
+		assert(result == VK_SUCCESS);
+		frame._graphicsDoneSignaled = false;
+	}
+
+	_textureManager.Initialize(_deviceObj,
+		[this](const char* filename, TextureData* texture) { CreateTexture(filename, texture); },
+		[this](TextureData* texture) { _textureStreamer.Release(texture); });
 }
 
 VulkanRenderer::~VulkanRenderer()
 {
+	_shaderReloader.Clear();
+#ifdef AUTO_COMPILE_GLSL_TO_SPV
+	VulkanShader::FinalizeCompiler();
+#endif
+
 	delete _swapChainObj;
 	_swapChainObj = nullptr;
 	for (auto d : _drawableList)
@@ -55,6 +99,9 @@ void VulkanRenderer::Initialize()
 	// Let's create the swap chain color images and depth image
 	BuildSwapChainAndDepthImage();
 
+	// The texture coordinates of the vertex buffers depend on the region of the atlas
+	CreateTextures();
+
 	// Build the vertex buffer 	
 	CreateVertexBuffer();
 	
@@ -68,34 +115,334 @@ void VulkanRenderer::Initialize()
 	// Create the vertex and fragment shader
 	CreateShaders();
 
-	const char* filename = "LearningVulkan.ktx";
-	bool renderOptimalTexture = true;
-	if (renderOptimalTexture) 
-    {
-		CreateTextureOptimal(filename, &_texture, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+	// Create descriptor set layout
+	CreateDescriptors();
+
+	// Manage the pipeline state objects
+	CreatePipelineStateManagement();
+}
+
+void VulkanRenderer::Prepare()
+{
+	// Each frame in flight owns one primary command buffer, it is allocated
+	// once and re-recorded every frame after its command pool has been reset.
+	for (FrameData& frame : _frames)
+	{
+		CommandBufferMgr::allocCommandBuffer(&_deviceObj->_device, frame._cmdPool, &frame._cmdDraw);
+		if (frame._computeCmdPool != VK_NULL_HANDLE)
+		{
+			CommandBufferMgr::allocCommandBuffer(&_deviceObj->_device, frame._computeCmdPool, &frame._cmdCompute);
+		}
 	}
-	else {
-		CreateTextureLinear(filename, &_texture, VK_IMAGE_USAGE_SAMPLED_BIT);
+	_currentFrame = 0;
+
+	// The render pass and the framebuffers may have been recreated
+	_staticCommandsDirty = true;
+
+	BuildRenderGraph();
+}
+
+void VulkanRenderer::BuildRenderGraph()
+{
+	DestroyRenderGraph();
+
+	// The swapchain image changes every frame, it is set before executing the graph.
+	// Its content is cleared by the render pass, so the previous layout does not matter.
+	_swapchainResource = _renderGraph.ImportImage("Swapchain", VK_NULL_HANDLE, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+	_renderGraph.MarkOutput(_swapchainResource, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	const RenderGraphResource depth = _renderGraph.ImportImage("Depth", _depth._image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+	// The uniform buffers of all the drawables. Each drawable has a single buffer, so on the
+	// compute queue its writes would wait for the whole previous frame and the draws for them:
+	// the pass stays on the graphics queue, where the barriers order it with the draws.
+	const RenderGraphResource uniforms = _renderGraph.ImportBuffer("Uniforms");
+	const uint32_t uniformPass = _renderGraph.AddPass("Uniforms", [this](VkCommandBuffer cmd)
+	{
+		RecordUniformUpdates(cmd);
+	});
+	_renderGraph.Write(uniformPass, uniforms, RG_ACCESS_TRANSFER_WRITE);
+
+	// Main forward pass, the render pass transitions its attachments itself
+	const uint32_t forwardPass = _renderGraph.AddPass("Forward", [this](VkCommandBuffer)
+	{
+		RecordCommandBuffer(_frames[_currentFrame], _swapChainObj->_scPublicVars._currentColorBuffer);
+	});
+	_renderGraph.WriteAttachment(forwardPass, _swapchainResource, RG_ACCESS_COLOR_ATTACHMENT_WRITE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	_renderGraph.WriteAttachment(forwardPass, depth, RG_ACCESS_DEPTH_ATTACHMENT_WRITE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+	_renderGraph.Read(forwardPass, uniforms, RG_ACCESS_VERTEX_SHADER_READ);
+
+	_renderGraph.Compile();
+
+	// Each frame in flight writes the timestamps of the passes into its own pool
+	const uint32_t queryCount = _renderGraph.GetTimestampQueryCount();
+	if (queryCount > 0)
+	{
+		VkQueryPoolCreateInfo queryPoolInfo = {};
+		queryPoolInfo.sType			= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.pNext			= nullptr;
+		queryPoolInfo.flags			= 0;
+		queryPoolInfo.queryType		= VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount	= queryCount;
+
+		for (FrameData& frame : _frames)
+		{
+			const VkResult result = vkCreateQueryPool(_deviceObj->_device, &queryPoolInfo, nullptr, &frame._queryPool);
+			assert(result == VK_SUCCESS);
+		}
+	}
+}
+
+void VulkanRenderer::RecordCommandBuffer(FrameData& frame, uint32_t currentImage)
+{
+	// Specify the clear color value
+	VkClearValue clearValues[2];
+	clearValues[0].color.float32[0]		= 1.0f;
+	clearValues[0].color.float32[1]		= 1.0f;
+	clearValues[0].color.float32[2]		= 1.0f;
+	clearValues[0].color.float32[3]		= 1.0f;
+
+	// Specify the depth/stencil clear value
+	clearValues[1].depthStencil.depth	= 1.0f;
+	clearValues[1].depthStencil.stencil	= 0;
+
+	// Define the VkRenderPassBeginInfo control structure
+	VkRenderPassBeginInfo renderPassBegin;
+	renderPassBegin.sType						= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBegin.pNext						= nullptr;
+	renderPassBegin.renderPass					= _renderPass;
+	renderPassBegin.framebuffer					= _framebuffers[currentImage];
+	renderPassBegin.renderArea.offset.x			= 0;
+	renderPassBegin.renderArea.offset.y			= 0;
+	renderPassBegin.renderArea.extent.width		= _width;
+	renderPassBegin.renderArea.extent.height	= _height;
+	renderPassBegin.clearValueCount				= 2;
+	renderPassBegin.pClearValues				= clearValues;
+
+	// Start recording the render pass instance, the subpass
+	// content is provided only through secondary command buffers
+	vkCmdBeginRenderPass(frame._cmdDraw, &renderPassBegin, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+	// Static drawables are replayed from the cache
+	if (_staticCmdCount > 0)
+	{
+		vkCmdExecuteCommands(frame._cmdDraw, _staticCmdCount, _staticCmdDraw.data());
 	}
-	// Set the created texture in the drawable object.
+
+	_dynamicDrawables.clear();
 	for (VulkanDrawable* drawableObj : _drawableList)
 	{
-		drawableObj->SetTextures(&_texture);
+		if (drawableObj->IsVisible() && !drawableObj->IsStatic())
+		{
+			_dynamicDrawables.push_back(drawableObj);
+		}
 	}
 
-	// Create descriptor set layout
-	CreateDescriptors();
+	// Group the draws sharing the same state, so that the chunks bind each state as few times as possible
+	_drawSorter.Sort(_dynamicDrawables, DRAW_PASS_OPAQUE);
+
+	// Each chunk of dynamic drawables is recorded by one thread into its own secondary
+	// command buffer, allocated from that thread's command pool. Command pools
+	// are externally synchronized, so they can not be shared between threads.
+	const uint32_t dynamicCount = static_cast<uint32_t>(_dynamicDrawables.size());
+	const uint32_t chunkCount	= std::min(dynamicCount, _threadPool.GetThreadCount());
+	_chunkBindStates.assign(chunkCount, VulkanBindState());
+	_threadPool.ParallelFor(dynamicCount,
+		                    [this, &frame, currentImage](uint32_t chunkIndex, uint32_t first, uint32_t last)
+	{
+		// The buffers survive the pool reset, allocate them only the first time
+		VkCommandBuffer& cmdDraw = frame._threadCmdDraw[chunkIndex];
+		if (cmdDraw == VK_NULL_HANDLE)
+		{
+			VkCommandBufferAllocateInfo cmdInfo = {};
+			cmdInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			cmdInfo.pNext				= nullptr;
+			cmdInfo.commandPool			= frame._threadCmdPools[chunkIndex];
+			cmdInfo.level				= VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			cmdInfo.commandBufferCount	= 1;
+			CommandBufferMgr::allocCommandBuffer(&_deviceObj->_device, frame._threadCmdPools[chunkIndex], &cmdDraw, &cmdInfo);
+		}
 
-	// Manage the pipeline state objects
-	CreatePipelineStateManagement();
+		RecordSecondaryCommandBuffer(cmdDraw, _dynamicDrawables, first, last, _framebuffers[currentImage],
+			                         VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+			                         _chunkBindStates[chunkIndex]);
+	});
+
+	ReportBindStatistics(_chunkBindStates, dynamicCount);
+
+	// Every chunk gets at least one drawable, so the first chunkCount buffers are
+	// the recorded ones. Executing them in the chunk order keeps the draw order.
+	if (chunkCount > 0)
+	{
+		vkCmdExecuteCommands(frame._cmdDraw, chunkCount, frame._threadCmdDraw.data());
+	}
+
+	// End of render pass instance recording
+	vkCmdEndRenderPass(frame._cmdDraw);
 }
 
-void VulkanRenderer::Prepare()
+void VulkanRenderer::RecordStaticCommands()
 {
+	// The frames in flight may still execute the cached command buffers. The cache is recorded
+	// into new pools, the previous ones are destroyed once the submitted frames are done.
+	const bool recorded = std::any_of(_staticCmdDraw.begin(), _staticCmdDraw.end(), [](VkCommandBuffer cmd) { return cmd != VK_NULL_HANDLE; });
+	if (recorded)
+	{
+		VulkanTimeline& timeline	= _deviceObj->_graphicsTimeline;
+		VkDevice device				= _deviceObj->_device;
+		std::vector<VkCommandPool> retiredPools;
+		retiredPools.swap(_staticCmdPools);
+		timeline.DeferUntil(timeline.GetLastSubmitted(), [device, retiredPools]()
+		{
+			for (VkCommandPool pool : retiredPools)
+			{
+				vkDestroyCommandPool(device, pool, nullptr);
+			}
+		});
+		CreateStaticCommandPools();
+	}
+
+	std::vector<VulkanDrawable*> staticDrawables;
 	for (VulkanDrawable* drawableObj : _drawableList)
 	{
-		drawableObj->Prepare();
+		if (drawableObj->IsVisible() && drawableObj->IsStatic())
+		{
+			staticDrawables.push_back(drawableObj);
+		}
+	}
+	_drawSorter.Sort(staticDrawables, DRAW_PASS_OPAQUE);
+
+	const uint32_t staticCount	= static_cast<uint32_t>(staticDrawables.size());
+	_staticCmdCount				= std::min(staticCount, _threadPool.GetThreadCount());
+	_staticDrawCount			= staticCount;
+	_staticBindStates.assign(_staticCmdCount, VulkanBindState());
+	_threadPool.ParallelFor(staticCount,
+		                    [this, &staticDrawables](uint32_t chunkIndex, uint32_t first, uint32_t last)
+	{
+		VkCommandBuffer& cmdDraw = _staticCmdDraw[chunkIndex];
+		if (cmdDraw == VK_NULL_HANDLE)
+		{
+			VkCommandBufferAllocateInfo cmdInfo = {};
+			cmdInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			cmdInfo.pNext				= nullptr;
+			cmdInfo.commandPool			= _staticCmdPools[chunkIndex];
+			cmdInfo.level				= VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			cmdInfo.commandBufferCount	= 1;
+			CommandBufferMgr::allocCommandBuffer(&_deviceObj->_device, _staticCmdPools[chunkIndex], &cmdDraw, &cmdInfo);
+		}
+
+		// The framebuffer is left unspecified, the cache is executed against every
+		// swapchain image, and by more than one frame in flight at a time.
+		RecordSecondaryCommandBuffer(cmdDraw, staticDrawables, first, last, VK_NULL_HANDLE,
+			                         VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
+			                         _staticBindStates[chunkIndex]);
+	});
+
+	_staticStateVersion	 = GetStaticStateVersion();
+	_staticCommandsDirty = false;
+}
+
+void VulkanRenderer::RecordSecondaryCommandBuffer(VkCommandBuffer cmdDraw, const std::vector<VulkanDrawable*>& drawables, uint32_t first, uint32_t last, VkFramebuffer framebuffer, VkCommandBufferUsageFlags usage, VulkanBindState& bindState)
+{
+	// The secondary command buffer continues the render pass
+	// instance begun by the primary command buffer.
+	VkCommandBufferInheritanceInfo cmdBufInheritInfo = {};
+	cmdBufInheritInfo.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	cmdBufInheritInfo.pNext					= nullptr;
+	cmdBufInheritInfo.renderPass			= _renderPass;
+	cmdBufInheritInfo.subpass				= 0;
+	cmdBufInheritInfo.framebuffer			= framebuffer;
+	cmdBufInheritInfo.occlusionQueryEnable	= VK_FALSE;
+	cmdBufInheritInfo.queryFlags			= 0;
+	cmdBufInheritInfo.pipelineStatistics	= 0;
+
+	VkCommandBufferBeginInfo cmdBufInfo = {};
+	cmdBufInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cmdBufInfo.pNext				= nullptr;
+	cmdBufInfo.flags				= usage;
+	cmdBufInfo.pInheritanceInfo		= &cmdBufInheritInfo;
+	CommandBufferMgr::beginCommandBuffer(cmdDraw, &cmdBufInfo);
+
+	// Dynamic states are not inherited from the primary command buffer
+	InitViewports(cmdDraw);
+	InitScissors(cmdDraw);
+
+	// A new command buffer starts with no state bound
+	bindState.Reset();
+	for (uint32_t i = first; i < last; i++)
+	{
+		drawables[i]->RecordDrawCommands(cmdDraw, bindState);
 	}
+
+	CommandBufferMgr::endCommandBuffer(cmdDraw);
+}
+
+void VulkanRenderer::ReportBindStatistics(const std::vector<VulkanBindState>& chunkBindStates, uint32_t drawCount)
+{
+	for (const VulkanBindState& bindState : chunkBindStates)
+	{
+		_statsBindsIssued  += bindState._bindsIssued;
+		_statsBindsSkipped += bindState._bindsSkipped;
+	}
+	_statsDrawCount += drawCount;
+
+	// The static cache is executed every frame, with the binds it was recorded with
+	for (const VulkanBindState& bindState : _staticBindStates)
+	{
+		_statsBindsIssued  += bindState._bindsIssued;
+		_statsBindsSkipped += bindState._bindsSkipped;
+	}
+	_statsDrawCount += _staticDrawCount;
+
+	if (++_statsFrameCount < BIND_STATS_REPORT_INTERVAL)
+	{
+		return;
+	}
+
+	// Without the redundant-bind elimination every draw binds its pipeline, descriptor set and vertex buffer
+	std::cout << "Draws per frame: " << _statsDrawCount / _statsFrameCount
+		      << ", binds per frame without redundant-bind elimination: " << (_statsBindsIssued + _statsBindsSkipped) / _statsFrameCount
+		      << ", with: " << _statsBindsIssued / _statsFrameCount
+		      << " (" << _statsBindsSkipped / _statsFrameCount << " redundant binds skipped)" << std::endl;
+
+	_statsFrameCount	= 0;
+	_statsDrawCount		= 0;
+	_statsBindsIssued	= 0;
+	_statsBindsSkipped	= 0;
+}
+
+uint64_t VulkanRenderer::GetStaticStateVersion() const
+{
+	// Any drawable being added, or changing its static, visible or pipeline
+	// state moves the version, which tells the cache needs to be re-recorded.
+	uint64_t version = static_cast<uint64_t>(_drawableList.size()) << 32;
+	for (const VulkanDrawable* drawableObj : _drawableList)
+	{
+		version += drawableObj->GetStateVersion();
+	}
+	return version;
+}
+
+void VulkanRenderer::InitViewports(VkCommandBuffer cmd) const
+{
+	VkViewport viewport;
+	viewport.height		= static_cast<float>(_height);
+	viewport.width		= static_cast<float>(_width);
+	viewport.minDepth	= static_cast<float>(0.0f);
+	viewport.maxDepth	= static_cast<float>(1.0f);
+	viewport.x			= 0;
+	viewport.y			= 0;
+	vkCmdSetViewport(cmd, 0, NUMBER_OF_VIEWPORTS, &viewport);
+}
+
+void VulkanRenderer::InitScissors(VkCommandBuffer cmd) const
+{
+	VkRect2D scissor;
+	scissor.extent.width	= _width;
+	scissor.extent.height	= _height;
+	scissor.offset.x		= 0;
+	scissor.offset.y		= 0;
+	vkCmdSetScissor(cmd, 0, NUMBER_OF_SCISSORS, &scissor);
 }
 
 void VulkanRenderer::Update()
@@ -104,6 +451,21 @@ void VulkanRenderer::Update()
 	{
 		drawableObj->Update();
 	}
+
+	// Merging into the cache while the workers compile into it is not allowed
+	if (!_pipelineManager.IsCompiling())
+	{
+		_pipelineObj.Update();
+	}
+}
+
+void VulkanRenderer::RecordUniformUpdates(VkCommandBuffer cmd)
+{
+	// The render graph synchronizes the writes with the draws of this frame and the previous one
+	for (VulkanDrawable* drawableObj : _drawableList)
+	{
+		drawableObj->RecordUniformUpdate(cmd);
+	}
 }
 
 bool VulkanRenderer::Render()
@@ -120,6 +482,179 @@ bool VulkanRenderer::Render()
 	return true;
 }
 
+void VulkanRenderer::RenderFrame()
+{
+	// Nothing to present until the draw command buffers are allocated
+	if (_frames[_currentFrame]._cmdDraw == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	FrameData& frame = _frames[_currentFrame];
+
+	VulkanTimeline& timeline = _deviceObj->_graphicsTimeline;
+
+	// Wait until the GPU is done with the commands recorded the last time this frame was used,
+	// then release the resources whose last use has completed
+	timeline.Wait(frame._ticket);
+	_deviceObj->CollectGarbage();
+
+	// The drawables whose pipeline finished compiling are drawn from now on, the static
+	// cache only records them again when it draws with one of these pipelines
+	std::vector<VkPipeline*> publishedPipelines;
+	if (_pipelineManager.Update(&publishedPipelines) && UsedByStaticDrawables(publishedPipelines, std::vector<TextureData*>()))
+	{
+		_staticCommandsDirty = true;
+	}
+	ReloadShaders();
+
+	// Stream the texture levels the drawables need. The textures with new resident levels get
+	// new views, and only the drawables using them get new descriptors. The frames in flight
+	// keep the previous ones, which are released once they are done.
+	_textureStreamer.Update(_drawableList, static_cast<uint32_t>(_height));
+	if (_textureStreamer.HasResidencyChanges())
+	{
+		std::vector<TextureData*> changedTextures;
+		_textureStreamer.ApplyResidencyChanges(&changedTextures);
+		for (VulkanDrawable* drawableObj : _drawableList)
+		{
+			if (std::find(changedTextures.begin(), changedTextures.end(), drawableObj->GetTextures()) != changedTextures.end())
+			{
+				drawableObj->UpdateTextureDescriptor();
+			}
+		}
+		if (UsedByStaticDrawables(std::vector<VkPipeline*>(), changedTextures))
+		{
+			_staticCommandsDirty = true;
+		}
+	}
+
+	// The graphics submission waited for the compute one, so the ticket covers both queues
+	if (frame._timestampsWritten)
+	{
+		_renderGraph.ReadTimestamps(frame._queryPool);
+	}
+
+	// Recycle all the command buffers of the frame at once,
+	// instead of freeing and reallocating them one by one.
+	VkResult result = vkResetCommandPool(_deviceObj->_device, frame._cmdPool, 0);
+	assert(result == VK_SUCCESS);
+	for (auto& threadCmdPool : frame._threadCmdPools)
+	{
+		result = vkResetCommandPool(_deviceObj->_device, threadCmdPool, 0);
+		assert(result == VK_SUCCESS);
+	}
+	if (frame._computeCmdPool != VK_NULL_HANDLE)
+	{
+		result = vkResetCommandPool(_deviceObj->_device, frame._computeCmdPool, 0);
+		assert(result == VK_SUCCESS);
+	}
+
+	uint32_t& currentColorImage		= _swapChainObj->_scPublicVars._currentColorBuffer;
+	VkSwapchainKHR& swapChain		= _swapChainObj->_scPublicVars._swapChain;
+	
+	// Get the index of the next available swapchain image:
+	result = _swapChainObj->fpAcquireNextImageKHR(_deviceObj->_device, 
+		                                          swapChain,
+		                                          UINT64_MAX, 
+		                                          frame._presentCompleteSemaphore,
+		                                          VK_NULL_HANDLE,
+		                                          &currentColorImage);
+
+	// Re-record the static cache only when something it depends on has changed
+	if (_staticCommandsDirty || _staticStateVersion != GetStaticStateVersion())
+	{
+		RecordStaticCommands();
+	}
+
+	VkCommandBufferBeginInfo cmdBufInfo = {};
+	cmdBufInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cmdBufInfo.pNext				= nullptr;
+	cmdBufInfo.flags				= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	cmdBufInfo.pInheritanceInfo		= nullptr;
+	CommandBufferMgr::beginCommandBuffer(frame._cmdDraw, &cmdBufInfo);
+
+	// The async compute passes get a command buffer of their own when the device has a compute queue
+	const VkCommandBuffer cmdCompute = _renderGraph.HasAsyncWork() ? frame._cmdCompute : VK_NULL_HANDLE;
+	if (cmdCompute != VK_NULL_HANDLE)
+	{
+		CommandBufferMgr::beginCommandBuffer(cmdCompute, &cmdBufInfo);
+	}
+
+	// Record the passes of the frame with their barriers
+	_renderGraph.SetImportedImage(_swapchainResource, _swapChainObj->_scPublicVars._colorBuffer[currentColorImage]._image);
+	_renderGraph.Execute(frame._cmdDraw, cmdCompute, frame._queryPool);
+	frame._timestampsWritten = frame._queryPool != VK_NULL_HANDLE;
+
+	CommandBufferMgr::endCommandBuffer(frame._cmdDraw);
+
+	// The second wait and signal are used only with async compute work
+	VkSemaphore waitSemaphores[2]					= { frame._presentCompleteSemaphore, frame._computeCompleteSemaphore };
+	VkPipelineStageFlags submitPipelineStages[2]	= { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, _renderGraph.GetAsyncWaitStages() };
+	VkSemaphore signalSemaphores[2]					= { frame._drawingCompleteSemaphore, frame._graphicsDoneSemaphore };
+
+	VkSubmitInfo submitInfo;
+	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext				= nullptr;
+	submitInfo.waitSemaphoreCount	= 1;
+	submitInfo.pWaitSemaphores		= waitSemaphores;
+	submitInfo.pWaitDstStageMask	= submitPipelineStages;
+	submitInfo.commandBufferCount	= 1;
+	submitInfo.pCommandBuffers		= &frame._cmdDraw;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores	= signalSemaphores;
+
+	if (cmdCompute != VK_NULL_HANDLE)
+	{
+		CommandBufferMgr::endCommandBuffer(cmdCompute);
+
+		// The compute passes reuse the transient images and the buffers of the previous frame,
+		// they start once its graphics work is done and overlap this frame's.
+		FrameData& previousFrame = _frames[(_currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+		const VkPipelineStageFlags computeWaitStages = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		VkSubmitInfo computeSubmitInfo			= {};
+		computeSubmitInfo.sType					= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		computeSubmitInfo.pNext					= nullptr;
+		computeSubmitInfo.waitSemaphoreCount	= previousFrame._graphicsDoneSignaled ? 1 : 0;
+		computeSubmitInfo.pWaitSemaphores		= &previousFrame._graphicsDoneSemaphore;
+		computeSubmitInfo.pWaitDstStageMask		= &computeWaitStages;
+		computeSubmitInfo.commandBufferCount	= 1;
+		computeSubmitInfo.pCommandBuffers		= &cmdCompute;
+		computeSubmitInfo.signalSemaphoreCount	= 1;
+		computeSubmitInfo.pSignalSemaphores		= &frame._computeCompleteSemaphore;
+		_deviceObj->GetComputeTimeline().Submit(computeSubmitInfo);
+		previousFrame._graphicsDoneSignaled = false;
+
+		// The graphics queue waits for the compute results only at the stages consuming them,
+		// and signals the compute submission of the next frame when it is done with the resources
+		submitInfo.waitSemaphoreCount	= 2;
+		submitInfo.signalSemaphoreCount = 2;
+		frame._graphicsDoneSignaled		= true;
+	}
+
+	// Queue the command buffer for execution, the frame can be recycled once its ticket
+	// completes. The queue is not waited on, the CPU goes on recording the next frame.
+	frame._ticket = timeline.Submit(submitInfo);
+
+	// Present the image in the window
+	VkPresentInfoKHR present;
+	present.sType				= VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	present.pNext				= nullptr;
+	present.swapchainCount		= 1;
+	present.pSwapchains			= &swapChain;
+	present.pImageIndices		= &currentColorImage;
+	present.pWaitSemaphores		= &frame._drawingCompleteSemaphore;
+	present.waitSemaphoreCount	= 1;
+	present.pResults			= nullptr;
+
+	// Queue the image for presentation,
+	result = _swapChainObj->fpQueuePresentKHR(_deviceObj->_queue, &present);
+	assert(result == VK_SUCCESS);
+
+	_currentFrame = (_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
 #ifdef _WIN32
 
 // MS-Windows event handling function:
@@ -132,11 +667,7 @@ LRESULT CALLBACK VulkanRenderer::WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LP
 		PostQuitMessage(0);
 		break;
 	case WM_PAINT:
-		for (VulkanDrawable* drawableObj : appObj->_rendererObj->_drawableList)
-		{
-			drawableObj->Render();
-		}
-
+		appObj->_rendererObj->RenderFrame();
 		return 0;
 	
 	case WM_SIZE:
@@ -298,8 +829,44 @@ void VulkanRenderer::CreateCommandPool()
 	cmdPoolInfo.queueFamilyIndex = deviceObj->_graphicsQueueWithPresentIndex;
 	cmdPoolInfo.flags = 0;
 
-    const VkResult res = vkCreateCommandPool(deviceObj->_device, &cmdPoolInfo, nullptr, &_cmdPool);
+    VkResult res = vkCreateCommandPool(deviceObj->_device, &cmdPoolInfo, nullptr, &_cmdPool);
 	assert(res == VK_SUCCESS);
+
+	_barrierBatcher.Initialize(deviceObj);
+	_uploader.Initialize(deviceObj, _cmdPool, &_barrierBatcher);
+	_textureStreamer.Initialize(deviceObj, &_uploader, &_threadPool);
+
+	CreateStaticCommandPools();
+
+	// The per frame pools hold short lived command buffers,
+	// they are reset as a whole every time the frame is reused.
+	VkCommandPoolCreateInfo frameCmdPoolInfo = cmdPoolInfo;
+	frameCmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	const uint32_t threadCount = _threadPool.GetThreadCount();
+	for (FrameData& frame : _frames)
+	{
+		res = vkCreateCommandPool(deviceObj->_device, &frameCmdPoolInfo, nullptr, &frame._cmdPool);
+		assert(res == VK_SUCCESS);
+
+		frame._threadCmdPools.resize(threadCount);
+		frame._threadCmdDraw.assign(threadCount, VK_NULL_HANDLE);
+		for (auto& threadCmdPool : frame._threadCmdPools)
+		{
+			res = vkCreateCommandPool(deviceObj->_device, &frameCmdPoolInfo, nullptr, &threadCmdPool);
+			assert(res == VK_SUCCESS);
+		}
+
+		// The async compute passes of the render graph are recorded for the compute family
+		if (deviceObj->HasAsyncComputeQueue())
+		{
+			VkCommandPoolCreateInfo computeCmdPoolInfo = frameCmdPoolInfo;
+			computeCmdPoolInfo.queueFamilyIndex = deviceObj->_computeQueueIndex;
+
+			res = vkCreateCommandPool(deviceObj->_device, &computeCmdPoolInfo, nullptr, &frame._computeCmdPool);
+			assert(res == VK_SUCCESS);
+		}
+	}
 }
 
 void VulkanRenderer::CreateDepthImage()
@@ -398,7 +965,10 @@ void VulkanRenderer::CreateDepthImage()
                        _cmdDepthImage);
 	}
 	CommandBufferMgr::endCommandBuffer(_cmdDepthImage);
-	CommandBufferMgr::submitCommandBuffer(_deviceObj->_queue, &_cmdDepthImage);
+
+	// Only this submission is waited on, not the whole queue
+	VulkanTimeline& timeline = _deviceObj->_graphicsTimeline;
+	timeline.Wait(timeline.Submit(_cmdDepthImage));
 
 	// Create the image view and allow the application to use the images.
 	imgViewInfo.image = _depth._image;
@@ -406,24 +976,83 @@ void VulkanRenderer::CreateDepthImage()
 	assert(result == VK_SUCCESS);
 }
 
-void VulkanRenderer::CreateTextureOptimal(const char* filename, TextureData *texture, VkImageUsageFlags imageUsageFlags, VkFormat format)
+bool VulkanRenderer::CreateTextureAtlas(const std::vector<std::string>& filenames, TextureData* texture, VulkanTextureAtlas* atlas, std::vector<uint32_t>* regions)
 {
-	// Load the image 
-	gli::texture2D image2D(gli::load(filename)); assert(!image2D.empty());
+	// Each image joins the atlas on its own, the files are mapped and only the small
+	// ones are decoded here, the others are left to the streamer
+	regions->assign(filenames.size(), ATLAS_NO_REGION);
+	bool added = false;
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		TextureImage image;
+		if (!VulkanTextureLoader::Load(filenames[i].c_str(), &image) ||
+			std::max(image._width, image._height) > ATLAS_MAX_IMAGE_SIZE ||
+			!VulkanTextureLoader::SelectDeviceFormat(*_deviceObj->_gpu, &image, _threadPool))
+		{
+			continue;
+		}
+
+		uint32_t index;
+		if (atlas->Add(image, &index))
+		{
+			(*regions)[i]	= index;
+			added			= true;
+		}
+	}
+
+	if (!added || !atlas->Pack(_threadPool))
+	{
+		regions->assign(filenames.size(), ATLAS_NO_REGION);
+		return false;
+	}
+
+	// The atlas carries its own mip chain, nothing is generated for it
+	TextureImage image = atlas->GetImage();
+	CreateTextureFromImage(image, texture);
+	return true;
+}
+
+void VulkanRenderer::CreateTextureFromImage(TextureImage& image, TextureData* texture, VkImageUsageFlags imageUsageFlags, VkFormat format)
+{
+	// An undefined format takes the one of the file
+	if (format == VK_FORMAT_UNDEFINED)
+	{
+		format = image._format;
+	}
 
 	// Get the image dimensions
-	texture->textureWidth	= uint32_t(image2D[0].dimensions().x);
-	texture->textureHeight	= uint32_t(image2D[0].dimensions().y);
+	texture->textureWidth	= image._width;
+	texture->textureHeight	= image._height;
 
 	// Get number of mip-map levels
-	texture->mipMapLevels	= uint32_t(image2D.levels());
+	texture->mipMapLevels	= image._mipLevels;
+
+	VkFormatProperties formatProps;
+	vkGetPhysicalDeviceFormatProperties(*_deviceObj->_gpu, format, &formatProps);
+
+	// Files without mips get a full chain, blitted by the uploader after the copy of the first
+	// level. The formats the device cannot blit with a linear filter are downsampled on the CPU.
+	if (image._mipLevels == 1 && std::max(image._width, image._height) > 1)
+	{
+		const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		if ((formatProps.optimalTilingFeatures & blitFeatures) == blitFeatures)
+		{
+			texture->mipMapLevels	= VulkanTextureLoader::GetFullMipLevelCount(image._width, image._height);
+			imageUsageFlags			|= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		}
+		else if (VulkanTextureLoader::GenerateMipmaps(&image, _threadPool))
+		{
+			texture->mipMapLevels	= image._mipLevels;
+		}
+	}
 
 	// Create a staging buffer resource states using.
 	// Indicate it be the source of the transfer command.
 	// .usage	= VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+	std::vector<VkDeviceSize> stagingOffsets;
 	VkBufferCreateInfo bufferCreateInfo = {};
 	bufferCreateInfo.sType	= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferCreateInfo.size	= image2D.size();
+	bufferCreateInfo.size	= VulkanTextureLoader::GetStagingLayout(image, 0, image._mipLevels, &stagingOffsets);
 	bufferCreateInfo.usage	= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -460,9 +1089,16 @@ void VulkanRenderer::CreateTextureOptimal(const char* filename, TextureData *tex
 	error = vkMapMemory(_deviceObj->_device, devMemory, 0, memRqrmnt.size, 0, reinterpret_cast<void **>(&data));
 	assert(!error);
 
-	memcpy(data, image2D.data(), image2D.size());
+	// The levels of KTX files are read from the mapped file, there is no other copy of them
+	VulkanTextureLoader::CopyLevels(image, 0, image._mipLevels, stagingOffsets, data);
 	vkUnmapMemory(_deviceObj->_device, devMemory);
 
+	// Compressed formats can rarely be written as storage images
+	if (!(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+	{
+		imageUsageFlags &= ~VK_IMAGE_USAGE_STORAGE_BIT;
+	}
+
 	// Create image info with optimal tiling support (.tiling = VK_IMAGE_TILING_OPTIMAL) -
 	VkImageCreateInfo imageCreateInfo = {};
 	imageCreateInfo.sType			= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -513,127 +1149,47 @@ void VulkanRenderer::CreateTextureOptimal(const char* filename, TextureData *tex
 	subresourceRange.levelCount				= texture->mipMapLevels;
 	subresourceRange.layerCount				= 1;
 
-	// Use a separate command buffer for texture loading
-	// Start command buffer recording
-	CommandBufferMgr::allocCommandBuffer(&_deviceObj->_device, _cmdPool, &_cmdTexture);
-	CommandBufferMgr::beginCommandBuffer(_cmdTexture);
-
-	// set the image layout to be 
-	// VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-	// since it is destination for copying buffer 
-	// into image using vkCmdCopyBufferToImage -
-	SetImageLayout(texture->image,
-                   VK_IMAGE_ASPECT_COLOR_BIT,
-                   VK_IMAGE_LAYOUT_UNDEFINED,
-		           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
-                   subresourceRange,
-                   _cmdTexture);
-
 	// List contains the buffer image copy for each mipLevel -
 	std::vector<VkBufferImageCopy> bufferImgCopyList;
 
 
-	uint32_t bufferOffset = 0;
-	// Iterater through each mip level and set buffer image copy -
-	for (uint32_t i = 0; i < texture->mipMapLevels; i++)
+	// Iterater through each mip level and set buffer image copy. The extent is in
+	// texels, for the compressed formats the copy covers whole blocks of the level.
+	// The levels which are not in the image are generated by the uploader.
+	for (uint32_t i = 0; i < image._mipLevels; i++)
 	{
 		VkBufferImageCopy bufImgCopyItem = {};
 		bufImgCopyItem.imageSubresource.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
 		bufImgCopyItem.imageSubresource.mipLevel		= i;
 		bufImgCopyItem.imageSubresource.layerCount		= 1;
 		bufImgCopyItem.imageSubresource.baseArrayLayer	= 0;
-		bufImgCopyItem.imageExtent.width				= uint32_t(image2D[i].dimensions().x);
-		bufImgCopyItem.imageExtent.height				= uint32_t(image2D[i].dimensions().y);
+		bufImgCopyItem.imageExtent.width				= std::max(image._width >> i, 1u);
+		bufImgCopyItem.imageExtent.height				= std::max(image._height >> i, 1u);
 		bufImgCopyItem.imageExtent.depth				= 1;
-		bufImgCopyItem.bufferOffset						= bufferOffset;
+		bufImgCopyItem.bufferOffset						= stagingOffsets[i];
 
 		bufferImgCopyList.push_back(bufImgCopyItem);
-
-		// adjust buffer offset
-		bufferOffset += uint32_t(image2D[i].size());
 	}
 
-	// Copy the staging buffer memory data contain
-	// the stage raw data(with mip levels) into image object
-	vkCmdCopyBufferToImage(_cmdTexture,
-                           buffer,
-                           texture->image,	
-		                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		                   uint32_t(bufferImgCopyList.size()),
-                           bufferImgCopyList.data());
-
-	// Advised to change the image layout to shader read
-	// after staged buffer copied into image memory -
+	// Hand the staging buffer over to the uploader. Between BeginTextureUploads()
+	// and EndTextureUploads() the copies of all the textures share the same
+	// command buffer and their layout transitions share two barrier calls.
 	texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	SetImageLayout(texture->image, 
-                   VK_IMAGE_ASPECT_COLOR_BIT, 
-                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		           texture->imageLayout, 
-                   subresourceRange,
-                   _cmdTexture);
-
-	// Submit command buffer containing copy and image layout commands-
-	CommandBufferMgr::endCommandBuffer(_cmdTexture);
-
-	// Create a fence object to ensure that the command buffer is executed,
-	// coping our staged raw data from the buffers to image memory with
-	// respective image layout and attributes into consideration -
-	VkFence fence;
-	VkFenceCreateInfo fenceCI	= {};
-	fenceCI.sType				= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceCI.flags				= 0;
-
-	error = vkCreateFence(_deviceObj->_device, &fenceCI, nullptr, &fence);
-	assert(!error);
-
-	VkSubmitInfo submitInfo			= {};
-	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.pNext				= nullptr;
-	submitInfo.commandBufferCount	= 1;
-	submitInfo.pCommandBuffers		= &_cmdTexture;
-
-	CommandBufferMgr::submitCommandBuffer(_deviceObj->_queue, &_cmdTexture, &submitInfo, fence);
-
-	error = vkWaitForFences(_deviceObj->_device, 1, &fence, VK_TRUE, 10000000000);
-	assert(!error);
-
-	vkDestroyFence(_deviceObj->_device, fence, nullptr);
-
-	// destroy the allocated resoureces
-	vkFreeMemory(_deviceObj->_device, devMemory, nullptr);
-	vkDestroyBuffer(_deviceObj->_device, buffer, nullptr);
+	const bool isBatched = _uploader.IsRecording();
+	if (!isBatched)
+	{
+		_uploader.Begin();
+	}
+	_uploader.UploadImage(texture->image, subresourceRange, buffer, devMemory, bufferImgCopyList, texture->imageLayout);
+	if (!isBatched)
+	{
+		_uploader.End();
+	}
 
 	///////////////////////////////////////////////////////////////////////////////////////
 
-	// Create sampler
-	VkSamplerCreateInfo samplerCI = {};
-	samplerCI.sType						= VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	samplerCI.pNext						= nullptr;
-	samplerCI.magFilter					= VK_FILTER_LINEAR;
-	samplerCI.minFilter					= VK_FILTER_LINEAR;
-	samplerCI.mipmapMode				= VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	samplerCI.addressModeU				= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-	samplerCI.addressModeV				= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-	samplerCI.addressModeW				= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-	samplerCI.mipLodBias				= 0.0f;
-	if (_deviceObj->_deviceFeatures.samplerAnisotropy == VK_TRUE)
-	{
-		samplerCI.anisotropyEnable		= VK_TRUE;
-		samplerCI.maxAnisotropy			= 8;
-	}
-	else
-	{
-		samplerCI.anisotropyEnable		= VK_FALSE;
-		samplerCI.maxAnisotropy			= 1;
-	}
-	samplerCI.compareOp					= VK_COMPARE_OP_NEVER;
-	samplerCI.minLod					= 0.0f;
-	samplerCI.maxLod					= static_cast<float>(texture->mipMapLevels);
-	samplerCI.borderColor				= VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-	samplerCI.unnormalizedCoordinates	= VK_FALSE;
-
-	error = vkCreateSampler(_deviceObj->_device, &samplerCI, nullptr, &texture->sampler);
-	assert(!error);
+	// The textures share their sampler, the view limits the levels it reaches
+	texture->sampler = _deviceObj->_samplerCache.GetDefaultSampler();
 
 	// Create image view to allow shader to access the texture information -
 	VkImageViewCreateInfo viewCI = {};
@@ -655,200 +1211,7 @@ void VulkanRenderer::CreateTextureOptimal(const char* filename, TextureData *tex
 	// Fill descriptor image info that can be used for setting up descriptor sets
 	texture->descsImgInfo.imageView = texture->view;
 	texture->descsImgInfo.sampler = texture->sampler;
-	texture->descsImgInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-}
-
-void VulkanRenderer::CreateTextureLinear(const char* filename, TextureData *texture, VkImageUsageFlags imageUsageFlags, VkFormat format)
-{
-	// Load the image 
-	gli::texture2D image2D(gli::load(filename)); assert(!image2D.empty());
-
-	// Get the image dimensions
-	texture->textureWidth	= uint32_t(image2D[0].dimensions().x);
-	texture->textureHeight	= uint32_t(image2D[0].dimensions().y);
-
-	// Get number of mip-map levels
-	texture->mipMapLevels	= uint32_t(image2D.levels());
-
-	// Create image resource states using VkImageCreateInfo
-	VkImageCreateInfo imageCreateInfo;
-	imageCreateInfo.sType				    = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	imageCreateInfo.pNext				    = nullptr;
-	imageCreateInfo.imageType			    = VK_IMAGE_TYPE_2D;
-	imageCreateInfo.format				    = format;
-	imageCreateInfo.extent.width		    = uint32_t(image2D[0].dimensions().x);
-	imageCreateInfo.extent.height		    = uint32_t(image2D[0].dimensions().y);
-	imageCreateInfo.extent.depth		    = 1;
-	imageCreateInfo.mipLevels			    = texture->mipMapLevels;
-	imageCreateInfo.arrayLayers			    = 1;
-	imageCreateInfo.samples				    = VK_SAMPLE_COUNT_1_BIT;
-	imageCreateInfo.queueFamilyIndexCount	= 0;
-	imageCreateInfo.pQueueFamilyIndices	    = nullptr;
-	imageCreateInfo.sharingMode			    = VK_SHARING_MODE_EXCLUSIVE;
-	imageCreateInfo.usage				    = imageUsageFlags;
-	imageCreateInfo.flags				    = 0;
-	imageCreateInfo.initialLayout		    = VK_IMAGE_LAYOUT_PREINITIALIZED,
-	imageCreateInfo.tiling				    = VK_IMAGE_TILING_LINEAR;
-
-	VkResult  error;
-	// Use create image info and create the image objects
-	error = vkCreateImage(_deviceObj->_device, &imageCreateInfo, nullptr, &texture->image);
-	assert(!error);
-
-	// Get the buffer memory requirements
-	VkMemoryRequirements memoryRequirements;
-	vkGetImageMemoryRequirements(_deviceObj->_device, texture->image, &memoryRequirements);
-
-	// Create memory allocation metadata information
-	VkMemoryAllocateInfo& memAlloc	= texture->memoryAlloc;
-	memAlloc.sType					= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memAlloc.pNext					= nullptr;
-	memAlloc.allocationSize			= memoryRequirements.size;
-	memAlloc.memoryTypeIndex		= 0;
-
-	// Determine the type of memory required 
-	// with the help of memory properties
-	bool pass = _deviceObj->MemoryTypeFromProperties(memoryRequirements.memoryTypeBits,
-		                                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                                                     &texture->memoryAlloc.memoryTypeIndex);
-	assert(pass);
-
-	// Allocate the memory for buffer objects
-	error = vkAllocateMemory(_deviceObj->_device, &texture->memoryAlloc, nullptr, &(texture->mem));
-	assert(!error);
-
-	// Bind the image device memory 
-	error = vkBindImageMemory(_deviceObj->_device, texture->image, texture->mem, 0);
-	assert(!error);
-
-	VkImageSubresource subresource;
-	subresource.aspectMask			= VK_IMAGE_ASPECT_COLOR_BIT;
-	subresource.mipLevel			= 0;
-	subresource.arrayLayer			= 0;
-
-	VkSubresourceLayout layout;
-	uint8_t *data;
-
-	vkGetImageSubresourceLayout(_deviceObj->_device, texture->image, &subresource, &layout);
-
-	// Map the GPU memory on to local host
-	error = vkMapMemory(_deviceObj->_device, texture->mem, 0, texture->memoryAlloc.allocationSize, 0, reinterpret_cast<void**>(&data));
-	assert(!error);
-
-	// Load image texture data in the mapped buffer
-    auto* dataTemp = static_cast<uint8_t*>(image2D.data());
-	for (int y = 0; y < image2D[0].dimensions().y; y++)
-	{
-	    const size_t imageSize = image2D[0].dimensions().y * 4;
-		memcpy(data, dataTemp, imageSize);
-		dataTemp += imageSize;
-
-		// Advance row by row pitch information
-		data += layout.rowPitch;
-	}
-
-	// UnMap the host memory to push the changes into the device memory
-	vkUnmapMemory(_deviceObj->_device, texture->mem);
-	
-	// Command buffer allocation and recording begins
-	CommandBufferMgr::allocCommandBuffer(&_deviceObj->_device, _cmdPool, &_cmdTexture);
-	CommandBufferMgr::beginCommandBuffer(_cmdTexture);
-
-	VkImageSubresourceRange subresourceRange	= {};
-	subresourceRange.aspectMask					= VK_IMAGE_ASPECT_COLOR_BIT;
-	subresourceRange.baseMipLevel				= 0;
-	subresourceRange.levelCount					= texture->mipMapLevels;
-	subresourceRange.layerCount					= 1;
-
-	texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	SetImageLayout(texture->image, 
-                   VK_IMAGE_ASPECT_COLOR_BIT,
-		           VK_IMAGE_LAYOUT_PREINITIALIZED, 
-                   texture->imageLayout,
-		           subresourceRange, 
-                   _cmdTexture);
-
-	// Stop command buffer recording
-	CommandBufferMgr::endCommandBuffer(_cmdTexture);
-
-	// Ensure that the GPU has finished the submitted job before host takes over again 
-	VkFence fence;
-	VkFenceCreateInfo fenceCI = {};
-	fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceCI.flags = 0;
-
-	vkCreateFence(_deviceObj->_device, &fenceCI, nullptr, &fence);
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.pNext = nullptr;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &_cmdTexture;
-
-	CommandBufferMgr::submitCommandBuffer(_deviceObj->_queue, &_cmdTexture, &submitInfo, fence);
-	vkWaitForFences(_deviceObj->_device, 1, &fence, VK_TRUE, 10000000000);
-	vkDestroyFence(_deviceObj->_device, fence, nullptr);
-
-	// Specify a particular kind of texture using samplers
-	VkSamplerCreateInfo samplerCI	= {};
-	samplerCI.sType					= VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	samplerCI.pNext					= nullptr;
-	samplerCI.magFilter				= VK_FILTER_LINEAR;
-	samplerCI.minFilter				= VK_FILTER_LINEAR;
-	samplerCI.mipmapMode			= VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	samplerCI.addressModeU			= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-	samplerCI.addressModeV			= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-	samplerCI.addressModeW			= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-	samplerCI.mipLodBias			= 0.0f;
-
-	if (_deviceObj->_deviceFeatures.samplerAnisotropy == VK_TRUE)
-	{
-		samplerCI.anisotropyEnable	= VK_TRUE;
-		samplerCI.maxAnisotropy		= 8;
-	}
-	else
-	{
-		samplerCI.anisotropyEnable	= VK_FALSE;
-		samplerCI.maxAnisotropy		= 1;
-	}
-
-	samplerCI.compareOp				= VK_COMPARE_OP_NEVER;
-	samplerCI.minLod				= 0.0f;
-	samplerCI.maxLod				= 0.0f; // Set to texture->mipLevels if Optimal tiling, generally linear does not support mip-maping
-	samplerCI.borderColor			= VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-	samplerCI.unnormalizedCoordinates = VK_FALSE;
-
-	// Create the sampler
-	error = vkCreateSampler(_deviceObj->_device, &samplerCI, nullptr, &texture->sampler);
-	assert(!error);
-
-	// Create image view to allow shader to access the texture information -
-	VkImageViewCreateInfo viewCi	   = {};
-	viewCi.sType					   = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-	viewCi.pNext					   = nullptr;
-	viewCi.viewType					   = VK_IMAGE_VIEW_TYPE_2D;
-	viewCi.format					   = format;
-	viewCi.components.r				   = VK_COMPONENT_SWIZZLE_R;
-	viewCi.components.g				   = VK_COMPONENT_SWIZZLE_G;
-	viewCi.components.b				   = VK_COMPONENT_SWIZZLE_B;
-	viewCi.components.a				   = VK_COMPONENT_SWIZZLE_A;
-	viewCi.subresourceRange			   = subresourceRange;
-	viewCi.subresourceRange.levelCount = 1;
-	viewCi.flags					   = 0;
-	viewCi.image					   = texture->image;
-
-	error = vkCreateImageView(_deviceObj->_device, &viewCi, nullptr, &texture->view);
-	assert(!error);
-
-	texture->descsImgInfo.sampler		= texture->sampler;
-	texture->descsImgInfo.imageView		= texture->view;
-	texture->descsImgInfo.imageLayout	= VK_IMAGE_LAYOUT_GENERAL;
-
-	// Set the created texture in the drawable object.
-	for (VulkanDrawable* drawableObj : _drawableList)
-	{
-		drawableObj->SetTextures(texture);
-	}
+	texture->descsImgInfo.imageLayout = texture->imageLayout;
 }
 
 void VulkanRenderer::CreateRenderPass(bool isDepthSupported, bool clear)
@@ -979,25 +1342,143 @@ void VulkanRenderer::DestroyDrawableUniformBuffer()
 
 void VulkanRenderer::DestroyTextureResource()
 {
-	vkFreeMemory(_deviceObj->_device, _texture.mem, nullptr);
-	vkDestroySampler(_deviceObj->_device, _texture.sampler, nullptr);
-	vkDestroyImage(_deviceObj->_device, _texture.image, nullptr);
-	vkDestroyImageView(_deviceObj->_device, _texture.view, nullptr);
+	for (VulkanDrawable* drawableObj : _drawableList)
+	{
+		drawableObj->SetTextures(nullptr);
+	}
+
+	// Destroys every texture, whatever its references, then the images still being streamed
+	_textureManager.Destroy();
+	_textureStreamer.Destroy();
+
+	// The atlas texture belongs to the renderer, its sampler to the sampler cache
+	if (_atlasTexture)
+	{
+		vkDestroyImageView(_deviceObj->_device, _atlasTexture->view, nullptr);
+		vkDestroyImage(_deviceObj->_device, _atlasTexture->image, nullptr);
+		vkFreeMemory(_deviceObj->_device, _atlasTexture->mem, nullptr);
+		delete _atlasTexture;
+		_atlasTexture = nullptr;
+	}
+}
+
+void VulkanRenderer::DestroyBindlessSet()
+{
+	_bindlessSet.Destroy();
 }
 
-void VulkanRenderer::DestroyDrawableCommandBuffer()
+void VulkanRenderer::DestroyRenderGraph()
 {
-	for (VulkanDrawable* drawableObj : _drawableList)
+	_renderGraph.Reset();
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo;
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = nullptr;
+	semaphoreCreateInfo.flags = 0;
+
+	for (FrameData& frame : _frames)
 	{
-		drawableObj->DestroyCommandBuffer();
+		// The GPU is idle, the next compute submission has nothing to wait for. A binary
+		// semaphore cannot be unsignaled without a wait, the signaled one is replaced.
+		if (frame._graphicsDoneSignaled)
+		{
+			vkDestroySemaphore(_deviceObj->_device, frame._graphicsDoneSemaphore, nullptr);
+			const VkResult result = vkCreateSemaphore(_deviceObj->_device, &semaphoreCreateInfo, nullptr, &frame._graphicsDoneSemaphore);
+			assert(result == VK_SUCCESS);
+			frame._graphicsDoneSignaled = false;
+		}
+
+		if (frame._queryPool != VK_NULL_HANDLE)
+		{
+			vkDestroyQueryPool(_deviceObj->_device, frame._queryPool, nullptr);
+			frame._queryPool = VK_NULL_HANDLE;
+		}
+		frame._timestampsWritten = false;
+	}
+}
+
+void VulkanRenderer::CreateStaticCommandPools()
+{
+	VkCommandPoolCreateInfo cmdPoolInfo;
+	cmdPoolInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cmdPoolInfo.pNext				= nullptr;
+	cmdPoolInfo.queueFamilyIndex	= _deviceObj->_graphicsQueueWithPresentIndex;
+	cmdPoolInfo.flags				= 0;
+
+	// Each recording thread needs a command pool of its own. The static
+	// command cache lives across many frames, its pools are not transient.
+	const uint32_t threadCount = _threadPool.GetThreadCount();
+	_staticCmdPools.resize(threadCount);
+	_staticCmdDraw.assign(threadCount, VK_NULL_HANDLE);
+	for (auto& staticCmdPool : _staticCmdPools)
+	{
+		const VkResult result = vkCreateCommandPool(_deviceObj->_device, &cmdPoolInfo, nullptr, &staticCmdPool);
+		assert(result == VK_SUCCESS);
 	}
 }
 
-void VulkanRenderer::DestroyDrawableSynchronizationObjects()
+bool VulkanRenderer::UsedByStaticDrawables(const std::vector<VkPipeline*>& pipelines, const std::vector<TextureData*>& textures) const
 {
 	for (VulkanDrawable* drawableObj : _drawableList)
 	{
-		drawableObj->DestroySynchronizationObjects();
+		if (!drawableObj->IsStatic())
+		{
+			continue;
+		}
+		if (std::find(pipelines.begin(), pipelines.end(), drawableObj->GetPipeline()) != pipelines.end() ||
+			std::find(textures.begin(), textures.end(), drawableObj->GetTextures()) != textures.end())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void VulkanRenderer::DestroyDrawCommandBuffers()
+{
+	// The secondary command buffers are owned by the per-thread
+	// command pools, resetting the pools releases all of them.
+	for (FrameData& frame : _frames)
+	{
+		if (frame._cmdDraw != VK_NULL_HANDLE)
+		{
+			vkFreeCommandBuffers(_deviceObj->_device, frame._cmdPool, 1, &frame._cmdDraw);
+			frame._cmdDraw = VK_NULL_HANDLE;
+		}
+		if (frame._cmdCompute != VK_NULL_HANDLE)
+		{
+			vkFreeCommandBuffers(_deviceObj->_device, frame._computeCmdPool, 1, &frame._cmdCompute);
+			frame._cmdCompute = VK_NULL_HANDLE;
+		}
+
+		for (auto& threadCmdPool : frame._threadCmdPools)
+		{
+			vkResetCommandPool(_deviceObj->_device, threadCmdPool, VK_COMMAND_POOL_RESET_RELEASE_RESOURCES_BIT);
+		}
+		frame._threadCmdDraw.assign(frame._threadCmdDraw.size(), VK_NULL_HANDLE);
+	}
+
+	for (auto& staticCmdPool : _staticCmdPools)
+	{
+		vkResetCommandPool(_deviceObj->_device, staticCmdPool, VK_COMMAND_POOL_RESET_RELEASE_RESOURCES_BIT);
+	}
+	_staticCmdDraw.assign(_staticCmdDraw.size(), VK_NULL_HANDLE);
+	_staticCmdCount		 = 0;
+	_staticDrawCount	 = 0;
+	_staticBindStates.clear();
+	_staticCommandsDirty = true;
+}
+
+void VulkanRenderer::DestroySynchronizationObjects()
+{
+	for (FrameData& frame : _frames)
+	{
+		frame._ticket = 0;
+		vkDestroySemaphore(_deviceObj->_device, frame._presentCompleteSemaphore, nullptr);
+		vkDestroySemaphore(_deviceObj->_device, frame._drawingCompleteSemaphore, nullptr);
+		vkDestroySemaphore(_deviceObj->_device, frame._computeCompleteSemaphore, nullptr);
+		vkDestroySemaphore(_deviceObj->_device, frame._graphicsDoneSemaphore, nullptr);
+		frame._graphicsDoneSignaled = false;
 	}
 }
 
@@ -1010,7 +1491,7 @@ void VulkanRenderer::DestroyDepthBuffer()
 
 void VulkanRenderer::DestroyCommandBuffer()
 {
-	VkCommandBuffer cmdBufs[] = { _cmdDepthImage, _cmdVertexBuffer, _cmdTexture };
+	VkCommandBuffer cmdBufs[] = { _cmdDepthImage, _cmdVertexBuffer };
 	vkFreeCommandBuffers(_deviceObj->_device, _cmdPool, sizeof(cmdBufs)/sizeof(VkCommandBuffer), cmdBufs);
 }
 
@@ -1018,7 +1499,42 @@ void VulkanRenderer::DestroyCommandPool()
 {
 	VulkanDevice* deviceObj		= _application->_deviceObj;
 
+	// The deferred deletions may free command buffers of these pools
+	vkDeviceWaitIdle(deviceObj->_device);
+	deviceObj->CollectGarbage();
+	_uploader.Destroy();
+
 	vkDestroyCommandPool(deviceObj->_device, _cmdPool, nullptr);
+	for (auto& staticCmdPool : _staticCmdPools)
+	{
+		vkDestroyCommandPool(deviceObj->_device, staticCmdPool, nullptr);
+	}
+	_staticCmdPools.clear();
+	_staticCmdDraw.clear();
+	_staticCmdCount		 = 0;
+	_staticDrawCount	 = 0;
+	_staticBindStates.clear();
+	_staticCommandsDirty = true;
+
+	// Destroying the pools freed all the draw command buffers
+	for (FrameData& frame : _frames)
+	{
+		vkDestroyCommandPool(deviceObj->_device, frame._cmdPool, nullptr);
+		for (auto& threadCmdPool : frame._threadCmdPools)
+		{
+			vkDestroyCommandPool(deviceObj->_device, threadCmdPool, nullptr);
+		}
+		if (frame._computeCmdPool != VK_NULL_HANDLE)
+		{
+			vkDestroyCommandPool(deviceObj->_device, frame._computeCmdPool, nullptr);
+		}
+		frame._cmdPool			= VK_NULL_HANDLE;
+		frame._cmdDraw			= VK_NULL_HANDLE;
+		frame._computeCmdPool	= VK_NULL_HANDLE;
+		frame._cmdCompute		= VK_NULL_HANDLE;
+		frame._threadCmdPools.clear();
+		frame._threadCmdDraw.clear();
+	}
 }
 
 void VulkanRenderer::BuildSwapChainAndDepthImage()
@@ -1038,12 +1554,24 @@ void VulkanRenderer::CreateVertexBuffer()
 	CommandBufferMgr::allocCommandBuffer(&_deviceObj->_device, _cmdPool, &_cmdVertexBuffer);
 	CommandBufferMgr::beginCommandBuffer(_cmdVertexBuffer);
 
+	const uint32_t vertexCount = sizeof(geometryData) / sizeof(geometryData[0]);
 	for (VulkanDrawable* drawableObj : _drawableList)
 	{
-		drawableObj->CreateVertexBuffer(geometryData, sizeof(geometryData), sizeof(geometryData[0]), false);
+		if (drawableObj->GetAtlasRegion() == ATLAS_NO_REGION)
+		{
+			drawableObj->CreateVertexBuffer(geometryData, sizeof(geometryData), sizeof(geometryData[0]));
+			continue;
+		}
+
+		// The coordinates of the image are moved into its region of the atlas
+		std::vector<VertexWithUV> vertices(geometryData, geometryData + vertexCount);
+		_textureAtlas.RewriteUVs(drawableObj->GetAtlasRegion(), vertices.data(), vertexCount, sizeof(VertexWithUV), offsetof(VertexWithUV, u));
+		drawableObj->CreateVertexBuffer(vertices.data(), sizeof(geometryData), sizeof(geometryData[0]));
 	}
 	CommandBufferMgr::endCommandBuffer(_cmdVertexBuffer);
-	CommandBufferMgr::submitCommandBuffer(_deviceObj->_queue, &_cmdVertexBuffer);
+
+	VulkanTimeline& timeline = _deviceObj->_graphicsTimeline;
+	timeline.Wait(timeline.Submit(_cmdVertexBuffer));
 }
 
 void VulkanRenderer::CreateShaders()
@@ -1056,17 +1584,85 @@ void VulkanRenderer::CreateShaders()
 	void* vertShaderCode, *fragShaderCode;
 	size_t sizeVert, sizeFrag;
 
+	// The bindless shaders read the transforms and textures of the bindless set, they
+	// need the descriptor indexing features and their precompiled SPIR-V
+	if (_deviceObj->_descriptorIndexingEnabled)
+	{
+		vertShaderCode = readFile("TextureBindless-vert.spv", &sizeVert);
+		fragShaderCode = readFile("TextureBindless-frag.spv", &sizeFrag);
+		if (vertShaderCode && fragShaderCode && _bindlessSet.Initialize(_deviceObj))
+		{
+			_shaderObj.BuildShaderModuleWithSpv(static_cast<uint32_t*>(vertShaderCode), sizeVert, static_cast<uint32_t*>(fragShaderCode), sizeFrag);
+			if (_bindlessSet.IsCompatible(_shaderObj._reflection))
+			{
+				free(vertShaderCode);
+				free(fragShaderCode);
+
+				_shaderReloader.Clear();
+				_shaderReloader.Watch(0, VK_SHADER_STAGE_VERTEX_BIT, "TextureBindless.vert", std::vector<std::string>());
+				_shaderReloader.Watch(1, VK_SHADER_STAGE_FRAGMENT_BIT, "TextureBindless.frag", std::vector<std::string>());
+				return;
+			}
+
+			std::cout << "Error: the bindless shaders use resources the bindless set does not have, the regular shaders are used" << std::endl;
+			_shaderObj.DestroyShaders();
+			_bindlessSet.Destroy();
+		}
+		free(vertShaderCode);
+		free(fragShaderCode);
+	}
+
 #ifdef AUTO_COMPILE_GLSL_TO_SPV
 	vertShaderCode = readFile("Texture.vert", &sizeVert);
 	fragShaderCode = readFile("Texture.frag", &sizeFrag);
 	
-	shaderObj.buildShader((const char*)vertShaderCode, (const char*)fragShaderCode);
+	_shaderObj.buildShader((const char*)vertShaderCode, (const char*)fragShaderCode);
 #else
 	vertShaderCode = readFile("Texture-vert.spv", &sizeVert);
 	fragShaderCode = readFile("Texture-frag.spv", &sizeFrag);
 
 	_shaderObj.BuildShaderModuleWithSpv(static_cast<uint32_t*>(vertShaderCode), sizeVert, static_cast<uint32_t*>(fragShaderCode), sizeFrag);
 #endif
+	free(vertShaderCode);
+	free(fragShaderCode);
+
+	_shaderReloader.Clear();
+	_shaderReloader.Watch(0, VK_SHADER_STAGE_VERTEX_BIT, "Texture.vert", std::vector<std::string>());
+	_shaderReloader.Watch(1, VK_SHADER_STAGE_FRAGMENT_BIT, "Texture.frag", std::vector<std::string>());
+}
+
+void VulkanRenderer::ReloadShaders()
+{
+	_shaderReloader.Update();
+
+	ShaderReload reload;
+	while (_shaderReloader.GetReload(&reload))
+	{
+		VkShaderModule previous;
+		if (!_shaderObj.ReplaceShaderModule(reload._stageIndex, reload._spirv.data(), reload._spirv.size() * sizeof(uint32_t), &previous))
+		{
+			std::cout << "Error: " << reload._sourceFile << " changes the resources or the specialization constants the shaders use, it is reloaded on the next start" << std::endl;
+			continue;
+		}
+		_pipelineManager.ReplaceShaderModule(previous, _shaderObj._shaderStages[reload._stageIndex].module);
+		_retiredShaderModules.push_back(previous);
+		std::cout << "Shader reloaded: " << reload._sourceFile << std::endl;
+	}
+
+	// The pipelines do not reference their modules once created, only the compiles in flight may
+	if (!_retiredShaderModules.empty() && !_pipelineManager.IsCompiling())
+	{
+		DestroyRetiredShaderModules();
+	}
+}
+
+void VulkanRenderer::DestroyRetiredShaderModules()
+{
+	for (VkShaderModule module : _retiredShaderModules)
+	{
+		vkDestroyShaderModule(_deviceObj->_device, module, nullptr);
+	}
+	_retiredShaderModules.clear();
 }
 
 // Create the descriptor set
@@ -1074,9 +1670,17 @@ void VulkanRenderer::CreateDescriptors()
 {
 	for (VulkanDrawable* drawableObj : _drawableList)
 	{
-		// It is upto an application how it manages the 
-		// creation of descriptor. Descriptors can be cached 
-		// and reuse for all similar objects.
+		drawableObj->SetShader(&_shaderObj);
+
+		// All the drawables share the bindless set when the device supports it
+		if (_bindlessSet.IsInitialized())
+		{
+			drawableObj->CreateBindlessDescriptor(&_bindlessSet);
+			continue;
+		}
+
+		// The layouts follow the bindings the shaders declare, they are cached
+		// by the device and shared by all the drawables declaring the same.
 		drawableObj->CreateDescriptorSetLayout(true);
 
 		// Create the descriptor set
@@ -1095,21 +1699,100 @@ void VulkanRenderer::CreatePipelineStateManagement()
 
 	_pipelineObj.CreatePipelineCache();
 
-	const bool depthPresent = true;
+	// The drawables with identical states share their pipeline, the new
+	// states are compiled in the background
+	const VkBool32 depthPresent = VK_TRUE;
 	for (VulkanDrawable* drawableObj : _drawableList)
 	{
-	    auto* pipeline = static_cast<VkPipeline*>(malloc(sizeof(VkPipeline)));
-		if (_pipelineObj.CreatePipeline(drawableObj, pipeline, &_shaderObj, depthPresent))
+		// The material picks the variant, the shaders fold its constants instead of branching on uniforms
+		ShaderVariantKey variant = {};
+		variant.Set(SHADER_CONSTANT_TEXTURED, drawableObj->GetTextures() != nullptr);
+		drawableObj->SetShaderVariant(_shaderObj.RegisterVariant(variant));
+
+		PipelineState state;
+		_pipelineObj.DescribePipeline(drawableObj, &_shaderObj, depthPresent, VK_TRUE, &state);
+		drawableObj->SetPipeline(_pipelineManager.GetPipeline(state));
+	}
+}
+
+void VulkanRenderer::CreateTexture(const char* filename, TextureData* texture)
+{
+	// Usable at once through a placeholder, the levels are streamed in during the next frames
+	_textureStreamer.StreamTexture(filename, texture);
+}
+
+void VulkanRenderer::CreateTextures()
+{
+	// The textures survive the resizes, only the drawables without one get theirs
+	std::vector<VulkanDrawable*> drawables;
+	std::vector<std::string> filenames;
+	for (VulkanDrawable* drawableObj : _drawableList)
+	{
+		const std::string& filename = drawableObj->GetTextureFile();
+		if (drawableObj->GetTextures() || filename.empty())
 		{
-			_pipelineList.push_back(pipeline);
-			drawableObj->SetPipeline(pipeline);
+			continue;
+		}
+		drawables.push_back(drawableObj);
+		if (std::find(filenames.begin(), filenames.end(), filename) == filenames.end())
+		{
+			filenames.push_back(filename);
+		}
+	}
+	if (drawables.empty())
+	{
+		return;
+	}
+
+	BeginTextureUploads();
+
+	// The small images of the drawables are packed once. The drawables in the atlas share
+	// its texture, so their draws bind the same image.
+	std::vector<uint32_t> regions;
+	if (!_atlasTexture)
+	{
+		auto* texture = new TextureData();
+		if (CreateTextureAtlas(filenames, texture, &_textureAtlas, &regions))
+		{
+			_atlasTexture = texture;
+			for (VulkanDrawable* drawableObj : drawables)
+			{
+				const auto it = std::find(filenames.begin(), filenames.end(), drawableObj->GetTextureFile());
+				const uint32_t region = regions[it - filenames.begin()];
+				if (region != ATLAS_NO_REGION)
+				{
+					drawableObj->SetAtlasRegion(region);
+					drawableObj->SetTextures(_atlasTexture);
+				}
+			}
 		}
 		else
 		{
-			free(pipeline);
-			pipeline = nullptr;
+			delete texture;
+			_textureAtlas = VulkanTextureAtlas();
+		}
+	}
+
+	// The other images are streamed, the drawables showing the same one share its texture
+	for (VulkanDrawable* drawableObj : drawables)
+	{
+		if (!drawableObj->GetTextures())
+		{
+			drawableObj->SetTextures(_textureManager.Acquire(drawableObj->GetTextureFile().c_str()));
 		}
 	}
+
+	EndTextureUploads();
+}
+
+void VulkanRenderer::BeginTextureUploads()
+{
+	_uploader.Begin();
+}
+
+void VulkanRenderer::EndTextureUploads()
+{
+	_uploader.End();
 }
 
 void VulkanRenderer::SetImageLayout(VkImage image,
@@ -1125,77 +1808,15 @@ void VulkanRenderer::SetImageLayout(VkImage image,
 	// The deviceObj->queue must be initialized
 	assert(_deviceObj->_queue != VK_NULL_HANDLE);
 
-	VkImageMemoryBarrier imgMemoryBarrier = {};
-	imgMemoryBarrier.sType			  = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	imgMemoryBarrier.pNext			  = nullptr;
-	imgMemoryBarrier.srcAccessMask	  = 0;
-	imgMemoryBarrier.dstAccessMask	  = 0;
-	imgMemoryBarrier.oldLayout		  = oldImageLayout;
-	imgMemoryBarrier.newLayout		  = newImageLayout;
-	imgMemoryBarrier.image			  = image;
-	imgMemoryBarrier.subresourceRange = subresourceRange;
-
-	if (oldImageLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-    {
-		imgMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	}
-
-	// Source layouts (old)
-	switch (oldImageLayout)
-	{
-		case VK_IMAGE_LAYOUT_UNDEFINED:
-			imgMemoryBarrier.srcAccessMask = 0;
-			break;
-		case VK_IMAGE_LAYOUT_PREINITIALIZED:
-			imgMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-			break;
-		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-			imgMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			break;
-		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-			imgMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	}
-
-	switch (newImageLayout)
-	{
-	    // Ensure that anything that was copying from this image has completed
-	    // An image in this layout can only be used as the destination operand of the commands
-	    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-	    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
-	    	imgMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	    	break;
-
-	    // Ensure any Copy or CPU writes to image are flushed
-	    // An image in this layout can only be used as a read-only shader resource
-	    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-	    	imgMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	    	imgMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	    	break;
-
-	    // An image in this layout can only be used as a framebuffer color attachment
-	    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-	    	imgMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-	    	break;
-
-	    // An image in this layout can only be used as a framebuffer depth/stencil attachment
-	    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-	    	imgMemoryBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	    	break;
-	}
-
-    const VkPipelineStageFlags srcStages	= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    const VkPipelineStageFlags destStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-
-	vkCmdPipelineBarrier(cmd, srcStages, destStages, 0, 0, nullptr, 0, nullptr, 1, &imgMemoryBarrier);
+	// The stage and access masks are deduced from the layouts. Callers transitioning
+	// many images should queue them on the batcher and flush once instead.
+	_barrierBatcher.AddImageTransition(image, subresourceRange, oldImageLayout, newImageLayout);
+	_barrierBatcher.Flush(cmd);
 }
 
 // Destroy each pipeline object existing in the renderer
 void VulkanRenderer::DestroyPipeline()
 {
-	for (VkPipeline* pipeline : _pipelineList)
-	{
-		vkDestroyPipeline(_deviceObj->_device, *pipeline, nullptr);
-		free(pipeline);
-	}
-	_pipelineList.clear();
+	_pipelineManager.DestroyPipelines();
+	DestroyRetiredShaderModules();
 }
@@ -0,0 +1,102 @@
+#include "VulkanSamplerCache.h"
+#include "Wrappers.h"
+
+VulkanSamplerCache::VulkanSamplerCache() :
+	_device(VK_NULL_HANDLE),
+	_anisotropySupported(false)
+{
+}
+
+VulkanSamplerCache::~VulkanSamplerCache()
+{
+}
+
+void VulkanSamplerCache::Initialize(VkDevice device, bool anisotropySupported)
+{
+	_device					= device;
+	_anisotropySupported	= anisotropySupported;
+}
+
+void VulkanSamplerCache::Destroy()
+{
+	for (auto& sampler : _samplers)
+	{
+		vkDestroySampler(_device, sampler.second, nullptr);
+	}
+	_samplers.clear();
+}
+
+VkSampler VulkanSamplerCache::GetSampler(const VkSamplerCreateInfo& samplerCI)
+{
+	assert(samplerCI.pNext == nullptr);
+	const SamplerKey key = BuildKey(samplerCI);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _samplers.find(key);
+	if (it != _samplers.end())
+	{
+		return it->second;
+	}
+
+	VkSampler sampler;
+	const VkResult result = vkCreateSampler(_device, &samplerCI, nullptr, &sampler);
+	assert(result == VK_SUCCESS);
+
+	_samplers[key] = sampler;
+	return sampler;
+}
+
+VkSampler VulkanSamplerCache::GetDefaultSampler()
+{
+	return GetSampler(GetDefaultSamplerInfo());
+}
+
+VkSamplerCreateInfo VulkanSamplerCache::GetDefaultSamplerInfo() const
+{
+	VkSamplerCreateInfo samplerCI = {};
+	samplerCI.sType						= VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCI.pNext						= nullptr;
+	samplerCI.magFilter					= VK_FILTER_LINEAR;
+	samplerCI.minFilter					= VK_FILTER_LINEAR;
+	samplerCI.mipmapMode				= VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerCI.addressModeU				= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCI.addressModeV				= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCI.addressModeW				= VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCI.mipLodBias				= 0.0f;
+	samplerCI.anisotropyEnable			= _anisotropySupported ? VK_TRUE : VK_FALSE;
+	samplerCI.maxAnisotropy				= _anisotropySupported ? 8.0f : 1.0f;
+	samplerCI.compareOp					= VK_COMPARE_OP_NEVER;
+	samplerCI.minLod					= 0.0f;
+	samplerCI.maxLod					= VK_LOD_CLAMP_NONE;
+	samplerCI.borderColor				= VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerCI.unnormalizedCoordinates	= VK_FALSE;
+	return samplerCI;
+}
+
+VulkanSamplerCache::SamplerKey VulkanSamplerCache::BuildKey(const VkSamplerCreateInfo& samplerCI)
+{
+	// The fields are copied one by one, the padding of the structure is not part of the key
+	SamplerKey key;
+	key[0]	= samplerCI.flags;
+	key[1]	= samplerCI.magFilter;
+	key[2]	= samplerCI.minFilter;
+	key[3]	= samplerCI.mipmapMode;
+	key[4]	= samplerCI.addressModeU;
+	key[5]	= samplerCI.addressModeV;
+	key[6]	= samplerCI.addressModeW;
+	memcpy(&key[7], &samplerCI.mipLodBias, sizeof(float));
+	key[8]	= samplerCI.anisotropyEnable;
+	memcpy(&key[9], &samplerCI.maxAnisotropy, sizeof(float));
+	key[10]	= samplerCI.compareEnable;
+	key[11]	= samplerCI.compareOp;
+	memcpy(&key[12], &samplerCI.minLod, sizeof(float));
+	memcpy(&key[13], &samplerCI.maxLod, sizeof(float));
+	key[14]	= samplerCI.borderColor;
+	key[15]	= samplerCI.unnormalizedCoordinates;
+	return key;
+}
+
+size_t VulkanSamplerCache::SamplerKeyHash::operator()(const SamplerKey& key) const
+{
+	return static_cast<size_t>(HashBytes(key.data(), sizeof(SamplerKey)));
+}
@@ -2,7 +2,8 @@
 #include "VulkanDevice.h"
 
 VulkanShader::VulkanShader(VkDevice* device) :
-	_device(device)
+	_device(device),
+	_variants(1, ShaderVariantKey())
 {
 }
 
@@ -41,6 +42,98 @@ void VulkanShader::BuildShaderModuleWithSpv(uint32_t *vertShaderText, size_t ver
 	moduleCreateInfo.pCode    = fragShaderText;
 	result = vkCreateShaderModule(*_device, &moduleCreateInfo, nullptr, &_shaderStages[1].module);
 	assert(result == VK_SUCCESS);
+
+	ReflectStage(0, vertShaderText, vertexSPVSize);
+	ReflectStage(1, fragShaderText, fragmentSPVSize);
+}
+
+void VulkanShader::ReflectStage(uint32_t stageIndex, const uint32_t* spirv, size_t spirvSize)
+{
+	const bool reflected = _stageReflections[stageIndex].Reflect(spirv, spirvSize, _shaderStages[stageIndex].stage);
+	assert(reflected);
+
+	_reflection = _stageReflections[0];
+	_reflection.Merge(_stageReflections[1]);
+}
+
+bool VulkanShader::ReplaceShaderModule(uint32_t stageIndex, const uint32_t* spirv, size_t spirvSize, VkShaderModule* previous)
+{
+	assert(stageIndex < 2);
+
+	// The descriptor sets, pipeline layouts and vertex buffers were made for the current
+	// interface, a shader reading other resources would not fit them
+	VulkanShaderReflection stageReflection;
+	if (!stageReflection.Reflect(spirv, spirvSize, _shaderStages[stageIndex].stage))
+	{
+		return false;
+	}
+	VulkanShaderReflection reflection = stageIndex == 0 ? stageReflection : _stageReflections[0];
+	reflection.Merge(stageIndex == 0 ? _stageReflections[1] : stageReflection);
+	if (!reflection.IsCompatible(_reflection))
+	{
+		return false;
+	}
+
+	// The pipeline states hold the constants GetSpecialization() kept for the declarations of
+	// the current SPIR-V, the new one would keep compiling with them
+	const std::vector<ShaderSpecializationConstant>& constants			= stageReflection._specializationConstants;
+	const std::vector<ShaderSpecializationConstant>& currentConstants	= _stageReflections[stageIndex]._specializationConstants;
+	const auto sameConstant = [](const ShaderSpecializationConstant& a, const ShaderSpecializationConstant& b) { return a._constantId == b._constantId && a._size == b._size; };
+	if (constants.size() != currentConstants.size() || !std::equal(constants.begin(), constants.end(), currentConstants.begin(), sameConstant))
+	{
+		return false;
+	}
+
+	_stageReflections[stageIndex]	= stageReflection;
+	_reflection						= reflection;
+	*previous						= _shaderStages[stageIndex].module;
+
+	VkShaderModuleCreateInfo moduleCreateInfo;
+	moduleCreateInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleCreateInfo.pNext    = nullptr;
+	moduleCreateInfo.flags    = 0;
+	moduleCreateInfo.codeSize = spirvSize;
+	moduleCreateInfo.pCode    = spirv;
+	VkResult result = vkCreateShaderModule(*_device, &moduleCreateInfo, nullptr, &_shaderStages[stageIndex].module);
+	assert(result == VK_SUCCESS);
+
+	return true;
+}
+
+uint32_t VulkanShader::RegisterVariant(const ShaderVariantKey& key)
+{
+	auto it = std::find(_variants.begin(), _variants.end(), key);
+	if (it != _variants.end())
+	{
+		return static_cast<uint32_t>(it - _variants.begin());
+	}
+	_variants.push_back(key);
+	return static_cast<uint32_t>(_variants.size() - 1);
+}
+
+void VulkanShader::GetSpecialization(uint32_t variant, uint32_t stageIndex, ShaderVariantKey* key) const
+{
+	assert(variant < _variants.size() && stageIndex < 2);
+	const ShaderVariantKey& variantKey = _variants[variant];
+	memset(key, 0, sizeof(ShaderVariantKey));
+
+	for (const ShaderSpecializationConstant& constant : _stageReflections[stageIndex]._specializationConstants)
+	{
+		const uint32_t id = constant._constantId;
+		if (id >= SHADER_MAX_SPECIALIZATION_CONSTANTS || !(variantKey._mask & (1u << id)))
+		{
+			continue;
+		}
+
+		// The values are given as 32 bit words, the 64 bit and 16 bit types would read them wrong
+		if (constant._size != sizeof(uint32_t))
+		{
+			std::cout << "Error: the specialization constant " << id << " takes " << constant._size << " bytes, it keeps its default" << std::endl;
+			continue;
+		}
+		key->_mask			|= 1u << id;
+		key->_values[id]	= variantKey._values[id];
+	}
 }
 
 void VulkanShader::DestroyShaders()
@@ -51,27 +144,41 @@ void VulkanShader::DestroyShaders()
 
 #ifdef AUTO_COMPILE_GLSL_TO_SPV
 
+namespace
+{
+	std::once_flag compilerInitialized;
+}
+
+void VulkanShader::InitializeCompiler()
+{
+	std::call_once(compilerInitialized, []() { glslang::InitializeProcess(); });
+}
+
+void VulkanShader::FinalizeCompiler()
+{
+	glslang::FinalizeProcess();
+}
+
 // Helper function intaking the GLSL vertex and fragment shader. 
 // It prepares the shaders to be consumed in the SPIR-V format 
 // with the help of glslang library helper functions.
 void VulkanShader::buildShader(const char *vertShaderText, const char *fragShaderText)
 {
-	VulkanDevice* deviceObj = VulkanApplication::GetInstance()->deviceObj;
-
 	VkResult  result;
 	bool  retVal;
 
 	// Fill in the control structure to push the necessary
 	// details of the shader.
 	std::vector<unsigned int> vertexSPV;
-	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	shaderStages[0].pNext = NULL;
-	shaderStages[0].pSpecializationInfo = NULL;
-	shaderStages[0].flags = 0;
-	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-	shaderStages[0].pName = "main";
+	_shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	_shaderStages[0].pNext = NULL;
+	_shaderStages[0].pSpecializationInfo = NULL;
+	_shaderStages[0].flags = 0;
+	_shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	_shaderStages[0].pName = "main";
 
-	glslang::InitializeProcess();
+	// Kept initialized for the shaders reloaded later
+	InitializeCompiler();
 
 	retVal = GLSLtoSPV(VK_SHADER_STAGE_VERTEX_BIT, vertShaderText, vertexSPV);
 	assert(retVal);
@@ -82,16 +189,16 @@ void VulkanShader::buildShader(const char *vertShaderText, const char *fragShade
 	moduleCreateInfo.flags = 0;
 	moduleCreateInfo.codeSize = vertexSPV.size() * sizeof(unsigned int);
 	moduleCreateInfo.pCode = vertexSPV.data();
-	result = vkCreateShaderModule(deviceObj->device, &moduleCreateInfo, NULL, &shaderStages[0].module);
+	result = vkCreateShaderModule(*_device, &moduleCreateInfo, NULL, &_shaderStages[0].module);
 	assert(result == VK_SUCCESS);
 
 	std::vector<unsigned int> fragSPV;
-	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	shaderStages[1].pNext = NULL;
-	shaderStages[1].pSpecializationInfo = NULL;
-	shaderStages[1].flags = 0;
-	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	shaderStages[1].pName = "main";
+	_shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	_shaderStages[1].pNext = NULL;
+	_shaderStages[1].pSpecializationInfo = NULL;
+	_shaderStages[1].flags = 0;
+	_shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	_shaderStages[1].pName = "main";
 
 	retVal = GLSLtoSPV(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderText, fragSPV);
 	assert(retVal);
@@ -101,17 +208,18 @@ void VulkanShader::buildShader(const char *vertShaderText, const char *fragShade
 	moduleCreateInfo.flags = 0;
 	moduleCreateInfo.codeSize = fragSPV.size() * sizeof(unsigned int);
 	moduleCreateInfo.pCode = fragSPV.data();
-	result = vkCreateShaderModule(deviceObj->device, &moduleCreateInfo, NULL, &shaderStages[1].module);
+	result = vkCreateShaderModule(*_device, &moduleCreateInfo, NULL, &_shaderStages[1].module);
 	assert(result == VK_SUCCESS);
 
-	glslang::FinalizeProcess();
+	ReflectStage(0, vertexSPV.data(), vertexSPV.size() * sizeof(unsigned int));
+	ReflectStage(1, fragSPV.data(), fragSPV.size() * sizeof(unsigned int));
 }
 
 //
 // Compile a given string containing GLSL into SPV for use by VK
 // Return value of false means an error was encountered.
 //
-bool VulkanShader::GLSLtoSPV(const VkShaderStageFlagBits shaderType, const char *pshader, std::vector<unsigned int> &spirv)
+bool VulkanShader::GLSLtoSPV(const VkShaderStageFlagBits shaderType, const char *pshader, std::vector<unsigned int> &spirv, const char* preamble)
 {
 	glslang::TProgram* program = new glslang::TProgram;
 	const char *shaderStrings[1];
@@ -126,6 +234,10 @@ bool VulkanShader::GLSLtoSPV(const VkShaderStageFlagBits shaderType, const char
 
 	shaderStrings[0] = pshader;
 	shader->setStrings(shaderStrings, 1);
+	if (preamble)
+	{
+		shader->setPreamble(preamble);
+	}
 
 	if (!shader->parse(&Resources, 100, false, messages)) {
 		puts(shader->getInfoLog());
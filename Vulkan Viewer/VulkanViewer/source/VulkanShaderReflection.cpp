@@ -0,0 +1,630 @@
+#include "VulkanShaderReflection.h"
+
+// First word of every SPIR-V module, followed by the version, generator, ID bound and schema
+#define SPIRV_MAGIC_NUMBER	0x07230203
+#define SPIRV_HEADER_SIZE	5
+
+namespace
+{
+	// Opcodes, storage classes, decorations and dimensions of the SPIR-V specification
+	enum SpirvOp
+	{
+		SPIRV_OP_TYPE_BOOL				= 20,
+		SPIRV_OP_TYPE_INT				= 21,
+		SPIRV_OP_TYPE_FLOAT				= 22,
+		SPIRV_OP_TYPE_VECTOR			= 23,
+		SPIRV_OP_TYPE_MATRIX			= 24,
+		SPIRV_OP_TYPE_IMAGE				= 25,
+		SPIRV_OP_TYPE_SAMPLER			= 26,
+		SPIRV_OP_TYPE_SAMPLED_IMAGE		= 27,
+		SPIRV_OP_TYPE_ARRAY				= 28,
+		SPIRV_OP_TYPE_RUNTIME_ARRAY		= 29,
+		SPIRV_OP_TYPE_STRUCT			= 30,
+		SPIRV_OP_TYPE_POINTER			= 32,
+		SPIRV_OP_CONSTANT				= 43,
+		SPIRV_OP_SPEC_CONSTANT_TRUE		= 48,
+		SPIRV_OP_SPEC_CONSTANT_FALSE	= 49,
+		SPIRV_OP_SPEC_CONSTANT			= 50,
+		SPIRV_OP_VARIABLE				= 59,
+		SPIRV_OP_DECORATE				= 71,
+		SPIRV_OP_MEMBER_DECORATE		= 72
+	};
+
+	enum SpirvStorageClass
+	{
+		SPIRV_STORAGE_UNIFORM_CONSTANT	= 0,
+		SPIRV_STORAGE_INPUT				= 1,
+		SPIRV_STORAGE_UNIFORM			= 2,
+		SPIRV_STORAGE_PUSH_CONSTANT		= 9,
+		SPIRV_STORAGE_STORAGE_BUFFER	= 12
+	};
+
+	enum SpirvDecoration
+	{
+		SPIRV_DECORATION_SPEC_ID		= 1,
+		SPIRV_DECORATION_BLOCK			= 2,
+		SPIRV_DECORATION_BUFFER_BLOCK	= 3,
+		SPIRV_DECORATION_ARRAY_STRIDE	= 6,
+		SPIRV_DECORATION_MATRIX_STRIDE	= 7,
+		SPIRV_DECORATION_BUILT_IN		= 11,
+		SPIRV_DECORATION_LOCATION		= 30,
+		SPIRV_DECORATION_BINDING		= 33,
+		SPIRV_DECORATION_DESCRIPTOR_SET	= 34,
+		SPIRV_DECORATION_OFFSET			= 35
+	};
+
+	enum SpirvDim
+	{
+		SPIRV_DIM_BUFFER				= 5,
+		SPIRV_DIM_SUBPASS_DATA			= 6
+	};
+
+	// Decorations the reflection needs, and the operands of the instruction defining the ID
+	struct SpirvId
+	{
+		uint32_t				_opcode;
+		std::vector<uint32_t>	_operands;		// Without the result ID
+		int64_t					_set;			// -1 when not decorated
+		int64_t					_binding;
+		int64_t					_location;
+		int64_t					_specId;
+		uint32_t				_arrayStride;
+		bool					_builtIn;
+		bool					_block;
+		bool					_bufferBlock;
+		std::vector<uint32_t>	_memberOffsets;
+		std::vector<uint32_t>	_memberMatrixStrides;
+
+		SpirvId() : _opcode(0), _set(-1), _binding(-1), _location(-1), _specId(-1), _arrayStride(0), _builtIn(false), _block(false), _bufferBlock(false) {}
+	};
+
+	class SpirvModule
+	{
+	public:
+		bool Parse(const uint32_t* spirv, size_t wordCount)
+		{
+			if (wordCount < SPIRV_HEADER_SIZE || spirv[0] != SPIRV_MAGIC_NUMBER)
+			{
+				return false;
+			}
+			_ids.resize(spirv[3]);
+
+			size_t position = SPIRV_HEADER_SIZE;
+			while (position < wordCount)
+			{
+				const uint32_t instructionSize	= spirv[position] >> 16;
+				const uint32_t opcode			= spirv[position] & 0xffff;
+				if (instructionSize == 0 || position + instructionSize > wordCount)
+				{
+					return false;
+				}
+				const uint32_t* operands = spirv + position + 1;
+				if (!ParseInstruction(opcode, operands, instructionSize - 1))
+				{
+					return false;
+				}
+				position += instructionSize;
+			}
+			return true;
+		}
+
+		const SpirvId& Get(uint32_t id) const
+		{
+			static const SpirvId undefined;
+			return id < _ids.size() ? _ids[id] : undefined;
+		}
+
+		const std::vector<SpirvId>& GetIds() const { return _ids; }
+
+		// Size in bytes of a value of the type, as laid out in a block
+		uint32_t GetTypeSize(uint32_t typeId) const
+		{
+			const SpirvId& type = Get(typeId);
+			switch (type._opcode)
+			{
+			case SPIRV_OP_TYPE_BOOL:
+				return sizeof(VkBool32);
+			case SPIRV_OP_TYPE_INT:
+			case SPIRV_OP_TYPE_FLOAT:
+				return type._operands[0] / 8;
+			case SPIRV_OP_TYPE_VECTOR:
+			case SPIRV_OP_TYPE_MATRIX:
+				return type._operands[1] * GetTypeSize(type._operands[0]);
+			case SPIRV_OP_TYPE_ARRAY:
+				return GetConstant(type._operands[1]) * (type._arrayStride ? type._arrayStride : GetTypeSize(type._operands[0]));
+			case SPIRV_OP_TYPE_STRUCT:
+			{
+				// The members may be padded, the end of the last one gives the size
+				uint32_t size = 0;
+				for (size_t i = 0; i < type._operands.size(); i++)
+				{
+					const SpirvId& member	= Get(type._operands[i]);
+					const uint32_t offset	= i < type._memberOffsets.size() ? type._memberOffsets[i] : 0;
+					const uint32_t stride	= i < type._memberMatrixStrides.size() ? type._memberMatrixStrides[i] : 0;
+					const uint32_t end		= offset + (member._opcode == SPIRV_OP_TYPE_MATRIX && stride ? member._operands[1] * stride : GetTypeSize(type._operands[i]));
+					size = std::max(size, end);
+				}
+				return size;
+			}
+			default:
+				return 0;
+			}
+		}
+
+		uint32_t GetConstant(uint32_t id) const
+		{
+			const SpirvId& constant = Get(id);
+			return constant._opcode == SPIRV_OP_CONSTANT && constant._operands.size() >= 2 ? constant._operands[1] : 0;
+		}
+
+	private:
+		bool ParseInstruction(uint32_t opcode, const uint32_t* operands, uint32_t operandCount)
+		{
+			switch (opcode)
+			{
+			case SPIRV_OP_DECORATE:
+				if (operandCount < 2 || operands[0] >= _ids.size())
+				{
+					return false;
+				}
+				Decorate(_ids[operands[0]], operands[1], operandCount > 2 ? operands[2] : 0);
+				return true;
+
+			case SPIRV_OP_MEMBER_DECORATE:
+				if (operandCount < 3 || operands[0] >= _ids.size())
+				{
+					return false;
+				}
+				DecorateMember(_ids[operands[0]], operands[1], operands[2], operandCount > 3 ? operands[3] : 0);
+				return true;
+
+			case SPIRV_OP_TYPE_BOOL:
+			case SPIRV_OP_TYPE_INT:
+			case SPIRV_OP_TYPE_FLOAT:
+			case SPIRV_OP_TYPE_VECTOR:
+			case SPIRV_OP_TYPE_MATRIX:
+			case SPIRV_OP_TYPE_IMAGE:
+			case SPIRV_OP_TYPE_SAMPLER:
+			case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+			case SPIRV_OP_TYPE_ARRAY:
+			case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+			case SPIRV_OP_TYPE_STRUCT:
+			case SPIRV_OP_TYPE_POINTER:
+				// The result ID comes first
+				if (operandCount < 1)
+				{
+					return false;
+				}
+				return Define(operands[0], opcode, operands + 1, operandCount - 1);
+
+			case SPIRV_OP_CONSTANT:
+			case SPIRV_OP_SPEC_CONSTANT_TRUE:
+			case SPIRV_OP_SPEC_CONSTANT_FALSE:
+			case SPIRV_OP_SPEC_CONSTANT:
+			case SPIRV_OP_VARIABLE:
+				// The result type comes first, then the result ID, which is moved in front. The
+				// variables also need their storage class.
+				if (operandCount < (opcode == SPIRV_OP_VARIABLE ? 3u : 2u))
+				{
+					return false;
+				}
+				{
+					std::vector<uint32_t> reordered(operands, operands + operandCount);
+					reordered.erase(reordered.begin() + 1);
+					return Define(operands[1], opcode, reordered.data(), operandCount - 1);
+				}
+
+			default:
+				return true;
+			}
+		}
+
+		bool Define(uint32_t id, uint32_t opcode, const uint32_t* operands, uint32_t operandCount)
+		{
+			if (id >= _ids.size())
+			{
+				return false;
+			}
+			_ids[id]._opcode = opcode;
+			_ids[id]._operands.assign(operands, operands + operandCount);
+
+			// Every type the reflection reads has its operands, a truncated one would be read out of bounds
+			static const uint32_t minOperands[] = { 0, 2, 1, 2, 2, 7, 0, 1, 2, 1, 0, 0, 2 };
+			return opcode < SPIRV_OP_TYPE_BOOL || opcode > SPIRV_OP_TYPE_POINTER || operandCount >= minOperands[opcode - SPIRV_OP_TYPE_BOOL];
+		}
+
+		static void Decorate(SpirvId& id, uint32_t decoration, uint32_t value)
+		{
+			switch (decoration)
+			{
+			case SPIRV_DECORATION_SPEC_ID:			id._specId		= value; break;
+			case SPIRV_DECORATION_BLOCK:			id._block		= true; break;
+			case SPIRV_DECORATION_BUFFER_BLOCK:		id._bufferBlock	= true; break;
+			case SPIRV_DECORATION_ARRAY_STRIDE:		id._arrayStride	= value; break;
+			case SPIRV_DECORATION_BUILT_IN:			id._builtIn		= true; break;
+			case SPIRV_DECORATION_LOCATION:			id._location	= value; break;
+			case SPIRV_DECORATION_BINDING:			id._binding		= value; break;
+			case SPIRV_DECORATION_DESCRIPTOR_SET:	id._set			= value; break;
+			default: break;
+			}
+		}
+
+		static void DecorateMember(SpirvId& id, uint32_t member, uint32_t decoration, uint32_t value)
+		{
+			if (decoration == SPIRV_DECORATION_OFFSET)
+			{
+				id._memberOffsets.resize(std::max<size_t>(id._memberOffsets.size(), member + 1), 0);
+				id._memberOffsets[member] = value;
+			}
+			else if (decoration == SPIRV_DECORATION_MATRIX_STRIDE)
+			{
+				id._memberMatrixStrides.resize(std::max<size_t>(id._memberMatrixStrides.size(), member + 1), 0);
+				id._memberMatrixStrides[member] = value;
+			}
+			else if (decoration == SPIRV_DECORATION_BUILT_IN)
+			{
+				// The gl_PerVertex blocks are built in through their members
+				id._builtIn = true;
+			}
+		}
+
+		std::vector<SpirvId> _ids;
+	};
+
+	// Descriptor type of a resource variable, from its storage class and the type it points to
+	bool GetDescriptorType(const SpirvModule& module, uint32_t storageClass, const SpirvId& type, VkDescriptorType* descriptorType)
+	{
+		switch (type._opcode)
+		{
+		case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+		{
+			const SpirvId& image = module.Get(type._operands[0]);
+			*descriptorType = image._opcode == SPIRV_OP_TYPE_IMAGE && image._operands[1] == SPIRV_DIM_BUFFER ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			return true;
+		}
+		case SPIRV_OP_TYPE_IMAGE:
+		{
+			// Operands: sampled type, dim, depth, arrayed, multisampled, sampled (1 with a sampler, 2 for storage)
+			const bool storage = type._operands[5] == 2;
+			if (type._operands[1] == SPIRV_DIM_SUBPASS_DATA)
+			{
+				*descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			}
+			else if (type._operands[1] == SPIRV_DIM_BUFFER)
+			{
+				*descriptorType = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			}
+			else
+			{
+				*descriptorType = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			}
+			return true;
+		}
+		case SPIRV_OP_TYPE_SAMPLER:
+			*descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			return true;
+		case SPIRV_OP_TYPE_STRUCT:
+			if (storageClass == SPIRV_STORAGE_STORAGE_BUFFER || type._bufferBlock)
+			{
+				*descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				return true;
+			}
+			*descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			return storageClass == SPIRV_STORAGE_UNIFORM && type._block;
+		default:
+			return false;
+		}
+	}
+
+	VkFormat GetVertexFormat(const SpirvModule& module, const SpirvId& type, uint32_t* size)
+	{
+		const bool vector				= type._opcode == SPIRV_OP_TYPE_VECTOR;
+		const SpirvId& component		= vector ? module.Get(type._operands[0]) : type;
+		const uint32_t componentCount	= vector ? type._operands[1] : 1;
+		if ((component._opcode != SPIRV_OP_TYPE_FLOAT && component._opcode != SPIRV_OP_TYPE_INT) ||
+			component._operands[0] != 32 || componentCount < 1 || componentCount > 4)
+		{
+			return VK_FORMAT_UNDEFINED;
+		}
+		*size = componentCount * 4;
+
+		static const VkFormat floatFormats[]	= { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat sintFormats[]		= { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat uintFormats[]		= { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+		if (component._opcode == SPIRV_OP_TYPE_FLOAT)
+		{
+			return floatFormats[componentCount - 1];
+		}
+		return component._operands[1] ? sintFormats[componentCount - 1] : uintFormats[componentCount - 1];
+	}
+
+	void AddPushConstantRange(std::vector<VkPushConstantRange>& ranges, const VkPushConstantRange& range)
+	{
+		for (VkPushConstantRange& existing : ranges)
+		{
+			if (existing.offset == range.offset && existing.size == range.size)
+			{
+				existing.stageFlags |= range.stageFlags;
+				return;
+			}
+		}
+		ranges.push_back(range);
+	}
+}
+
+bool VulkanShaderReflection::Reflect(const uint32_t* spirv, size_t spirvSize, VkShaderStageFlagBits stage)
+{
+	Clear();
+
+	SpirvModule module;
+	if (spirvSize % sizeof(uint32_t) != 0 || !module.Parse(spirv, spirvSize / sizeof(uint32_t)))
+	{
+		return false;
+	}
+
+	const std::vector<SpirvId>& ids = module.GetIds();
+	for (uint32_t id = 0; id < ids.size(); id++)
+	{
+		const SpirvId& object = ids[id];
+		if ((object._opcode == SPIRV_OP_SPEC_CONSTANT || object._opcode == SPIRV_OP_SPEC_CONSTANT_TRUE || object._opcode == SPIRV_OP_SPEC_CONSTANT_FALSE) &&
+			object._specId >= 0)
+		{
+			ShaderSpecializationConstant constant;
+			constant._constantId	= static_cast<uint32_t>(object._specId);
+			constant._size			= module.GetTypeSize(object._operands[0]);
+			_specializationConstants.push_back(constant);
+			continue;
+		}
+
+		if (object._opcode != SPIRV_OP_VARIABLE || object._builtIn)
+		{
+			continue;
+		}
+		const uint32_t storageClass	= object._operands[1];
+		const SpirvId& pointer		= module.Get(object._operands[0]);
+		if (pointer._opcode != SPIRV_OP_TYPE_POINTER)
+		{
+			return false;
+		}
+		uint32_t typeId = pointer._operands[1];
+
+		if (storageClass == SPIRV_STORAGE_PUSH_CONSTANT)
+		{
+			const SpirvId& block = module.Get(typeId);
+			uint32_t offset = UINT32_MAX;
+			for (uint32_t memberOffset : block._memberOffsets)
+			{
+				offset = std::min(offset, memberOffset);
+			}
+
+			VkPushConstantRange range;
+			range.stageFlags	= stage;
+			range.offset		= block._memberOffsets.empty() ? 0 : offset;
+			range.size			= module.GetTypeSize(typeId) - range.offset;
+			AddPushConstantRange(_pushConstantRanges, range);
+			continue;
+		}
+
+		if (storageClass == SPIRV_STORAGE_INPUT && stage == VK_SHADER_STAGE_VERTEX_BIT && object._location >= 0)
+		{
+			// The matrices take one location per column
+			const SpirvId& type				= module.Get(typeId);
+			const bool matrix				= type._opcode == SPIRV_OP_TYPE_MATRIX;
+			const uint32_t locationCount	= matrix ? type._operands[1] : 1;
+			for (uint32_t i = 0; i < locationCount; i++)
+			{
+				ShaderVertexInput input;
+				input._location	= static_cast<uint32_t>(object._location) + i;
+				input._size		= 0;
+				input._format	= GetVertexFormat(module, matrix ? module.Get(type._operands[0]) : type, &input._size);
+				if (input._format == VK_FORMAT_UNDEFINED)
+				{
+					std::cout << "Error: the vertex input at location " << input._location << " has a type without vertex format" << std::endl;
+					return false;
+				}
+				_vertexInputs.push_back(input);
+			}
+			continue;
+		}
+
+		if (storageClass != SPIRV_STORAGE_UNIFORM_CONSTANT && storageClass != SPIRV_STORAGE_UNIFORM && storageClass != SPIRV_STORAGE_STORAGE_BUFFER)
+		{
+			continue;
+		}
+
+		ShaderBinding binding;
+		binding._set		= object._set >= 0 ? static_cast<uint32_t>(object._set) : 0;
+		binding._binding	= object._binding >= 0 ? static_cast<uint32_t>(object._binding) : 0;
+		binding._count		= 1;
+		binding._stages		= stage;
+
+		// The arrays of resources are bound as one binding of several descriptors
+		while (module.Get(typeId)._opcode == SPIRV_OP_TYPE_ARRAY || module.Get(typeId)._opcode == SPIRV_OP_TYPE_RUNTIME_ARRAY)
+		{
+			const SpirvId& array = module.Get(typeId);
+			binding._count	= array._opcode == SPIRV_OP_TYPE_ARRAY ? binding._count * module.GetConstant(array._operands[1]) : 0;
+			typeId			= array._operands[0];
+		}
+
+		if (!GetDescriptorType(module, storageClass, module.Get(typeId), &binding._type))
+		{
+			continue;
+		}
+		_bindings.push_back(binding);
+	}
+
+	std::sort(_bindings.begin(), _bindings.end(), [](const ShaderBinding& a, const ShaderBinding& b)
+	{
+		return a._set != b._set ? a._set < b._set : a._binding < b._binding;
+	});
+	std::sort(_vertexInputs.begin(), _vertexInputs.end(), [](const ShaderVertexInput& a, const ShaderVertexInput& b) { return a._location < b._location; });
+	std::sort(_specializationConstants.begin(), _specializationConstants.end(), [](const ShaderSpecializationConstant& a, const ShaderSpecializationConstant& b)
+	{
+		return a._constantId < b._constantId;
+	});
+	return true;
+}
+
+void VulkanShaderReflection::Merge(const VulkanShaderReflection& other)
+{
+	for (const ShaderBinding& binding : other._bindings)
+	{
+		auto it = std::find_if(_bindings.begin(), _bindings.end(), [&binding](const ShaderBinding& existing)
+		{
+			return existing._set == binding._set && existing._binding == binding._binding;
+		});
+		if (it == _bindings.end())
+		{
+			_bindings.push_back(binding);
+			continue;
+		}
+		if (it->_type != binding._type || it->_count != binding._count)
+		{
+			std::cout << "Error: the stages declare set " << binding._set << " binding " << binding._binding << " differently" << std::endl;
+		}
+		it->_stages |= binding._stages;
+	}
+	std::sort(_bindings.begin(), _bindings.end(), [](const ShaderBinding& a, const ShaderBinding& b)
+	{
+		return a._set != b._set ? a._set < b._set : a._binding < b._binding;
+	});
+
+	for (const VkPushConstantRange& range : other._pushConstantRanges)
+	{
+		AddPushConstantRange(_pushConstantRanges, range);
+	}
+
+	_vertexInputs.insert(_vertexInputs.end(), other._vertexInputs.begin(), other._vertexInputs.end());
+	std::sort(_vertexInputs.begin(), _vertexInputs.end(), [](const ShaderVertexInput& a, const ShaderVertexInput& b) { return a._location < b._location; });
+
+	// The stages may share specialization constants, one value is given for both
+	for (const ShaderSpecializationConstant& constant : other._specializationConstants)
+	{
+		auto it = std::find_if(_specializationConstants.begin(), _specializationConstants.end(), [&constant](const ShaderSpecializationConstant& existing)
+		{
+			return existing._constantId == constant._constantId;
+		});
+		if (it == _specializationConstants.end())
+		{
+			_specializationConstants.push_back(constant);
+		}
+	}
+	std::sort(_specializationConstants.begin(), _specializationConstants.end(), [](const ShaderSpecializationConstant& a, const ShaderSpecializationConstant& b)
+	{
+		return a._constantId < b._constantId;
+	});
+}
+
+void VulkanShaderReflection::Clear()
+{
+	_bindings.clear();
+	_pushConstantRanges.clear();
+	_vertexInputs.clear();
+	_specializationConstants.clear();
+}
+
+bool VulkanShaderReflection::IsCompatible(const VulkanShaderReflection& other) const
+{
+	if (_bindings.size() != other._bindings.size() ||
+		_pushConstantRanges.size() != other._pushConstantRanges.size() ||
+		_vertexInputs.size() != other._vertexInputs.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < _bindings.size(); i++)
+	{
+		const ShaderBinding& a = _bindings[i];
+		const ShaderBinding& b = other._bindings[i];
+		if (a._set != b._set || a._binding != b._binding || a._type != b._type || a._count != b._count || a._stages != b._stages)
+		{
+			return false;
+		}
+	}
+	for (size_t i = 0; i < _pushConstantRanges.size(); i++)
+	{
+		const VkPushConstantRange& a = _pushConstantRanges[i];
+		const VkPushConstantRange& b = other._pushConstantRanges[i];
+		if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size)
+		{
+			return false;
+		}
+	}
+	for (size_t i = 0; i < _vertexInputs.size(); i++)
+	{
+		if (_vertexInputs[i]._location != other._vertexInputs[i]._location || _vertexInputs[i]._format != other._vertexInputs[i]._format)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t VulkanShaderReflection::GetSetCount() const
+{
+	return _bindings.empty() ? 0 : _bindings.back()._set + 1;
+}
+
+const ShaderBinding* VulkanShaderReflection::FindBinding(VkDescriptorType type) const
+{
+	for (const ShaderBinding& binding : _bindings)
+	{
+		if (binding._type == type)
+		{
+			return &binding;
+		}
+	}
+	return nullptr;
+}
+
+void VulkanShaderReflection::GetSetLayoutBindings(uint32_t set, const VkSampler* immutableSampler, std::vector<VkDescriptorSetLayoutBinding>* bindings) const
+{
+	bindings->clear();
+	for (const ShaderBinding& binding : _bindings)
+	{
+		if (binding._set != set)
+		{
+			continue;
+		}
+
+		// The size of the runtime arrays is chosen by the application, they get one descriptor here
+		VkDescriptorSetLayoutBinding layoutBinding;
+		layoutBinding.binding				= binding._binding;
+		layoutBinding.descriptorType		= binding._type;
+		layoutBinding.descriptorCount		= std::max(binding._count, 1u);
+		layoutBinding.stageFlags			= binding._stages;
+		layoutBinding.pImmutableSamplers	= binding._type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER && layoutBinding.descriptorCount == 1 ? immutableSampler : nullptr;
+		bindings->push_back(layoutBinding);
+	}
+}
+
+void VulkanShaderReflection::GetPoolSizes(std::vector<VkDescriptorPoolSize>* poolSizes) const
+{
+	poolSizes->clear();
+	for (const ShaderBinding& binding : _bindings)
+	{
+		auto it = std::find_if(poolSizes->begin(), poolSizes->end(), [&binding](const VkDescriptorPoolSize& size) { return size.type == binding._type; });
+		if (it == poolSizes->end())
+		{
+			poolSizes->push_back(VkDescriptorPoolSize{ binding._type, 0 });
+			it = poolSizes->end() - 1;
+		}
+		it->descriptorCount += std::max(binding._count, 1u);
+	}
+}
+
+uint32_t VulkanShaderReflection::GetVertexAttributes(uint32_t binding, std::vector<VkVertexInputAttributeDescription>* attributes) const
+{
+	attributes->clear();
+	uint32_t offset = 0;
+	for (const ShaderVertexInput& input : _vertexInputs)
+	{
+		VkVertexInputAttributeDescription attribute;
+		attribute.location	= input._location;
+		attribute.binding	= binding;
+		attribute.format	= input._format;
+		attribute.offset	= offset;
+		attributes->push_back(attribute);
+		offset += input._size;
+	}
+	return offset;
+}
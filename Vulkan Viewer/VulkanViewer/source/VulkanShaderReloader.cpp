@@ -0,0 +1,296 @@
+#include "VulkanShaderReloader.h"
+#include "VulkanShader.h"
+#include "Wrappers.h"
+
+// First word of every SPIR-V module
+#define SPIRV_MAGIC_NUMBER	0x07230203
+
+namespace
+{
+	void CreateCacheDirectory()
+	{
+#ifdef _WIN32
+		CreateDirectoryA(SHADER_CACHE_DIRECTORY, nullptr);
+#else
+		mkdir(SHADER_CACHE_DIRECTORY, 0755);
+#endif
+	}
+
+#ifndef AUTO_COMPILE_GLSL_TO_SPV
+	std::string GetValidatorPath()
+	{
+		// The SDK sets its location at install, otherwise the validator is looked for in the path
+		const char* sdk = getenv("VULKAN_SDK");
+#ifdef _WIN32
+		return sdk ? std::string("\"") + sdk + "\\Bin\\glslangValidator.exe\"" : std::string("glslangValidator.exe");
+#else
+		return sdk ? std::string("\"") + sdk + "/bin/glslangValidator\"" : std::string("glslangValidator");
+#endif
+	}
+#endif
+}
+
+VulkanShaderReloader::VulkanShaderReloader() :
+	_pendingCount(0),
+	_compileThread(1)
+{
+}
+
+VulkanShaderReloader::~VulkanShaderReloader()
+{
+	WaitIdle();
+}
+
+void VulkanShaderReloader::Watch(uint32_t stageIndex, VkShaderStageFlagBits stage, const char* sourceFile, const std::vector<std::string>& defines)
+{
+	WatchedShader shader;
+	shader._stageIndex			= stageIndex;
+	shader._stage				= stage;
+	shader._sourceFile			= sourceFile;
+	shader._defines				= defines;
+	shader._modificationTime	= 0;
+	shader._hash				= 0;
+
+	// A source missing now is compiled once it appears
+	std::string source;
+	if (GetModificationTime(shader._sourceFile, &shader._modificationTime) && ReadSource(shader._sourceFile, &source))
+	{
+		shader._hash = HashSource(shader, source);
+	}
+	_shaders.push_back(shader);
+
+	_lastPoll = std::chrono::steady_clock::now();
+}
+
+void VulkanShaderReloader::Clear()
+{
+	WaitIdle();
+	_shaders.clear();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_reloads.clear();
+}
+
+void VulkanShaderReloader::Update()
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (_shaders.empty() || now - _lastPoll < std::chrono::milliseconds(SHADER_RELOAD_POLL_INTERVAL))
+	{
+		return;
+	}
+	_lastPoll = now;
+
+	for (WatchedShader& shader : _shaders)
+	{
+		int64_t modificationTime;
+		if (!GetModificationTime(shader._sourceFile, &modificationTime) || modificationTime == shader._modificationTime)
+		{
+			continue;
+		}
+		shader._modificationTime = modificationTime;
+
+		// The editors saving without changes, or the changes reverted, need no compile
+		std::string source;
+		if (!ReadSource(shader._sourceFile, &source))
+		{
+			continue;
+		}
+		const uint64_t hash = HashSource(shader, source);
+		if (hash == shader._hash)
+		{
+			continue;
+		}
+		shader._hash = hash;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_pendingCount++;
+		}
+
+		// The source read here is compiled, a later save while compiling is seen by the next check
+		_compileThread.Enqueue([this, shader, source, hash]()
+		{
+			ShaderReload reload;
+			reload._stageIndex = shader._stageIndex;
+			reload._sourceFile = shader._sourceFile;
+			const bool compiled = LoadSpirv(GetCacheFilename(hash), &reload._spirv) || Compile(shader, source, hash, &reload._spirv);
+			if (!compiled)
+			{
+				std::cout << "Error: failed to compile " << shader._sourceFile << ", the previous version is kept" << std::endl;
+			}
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (compiled)
+			{
+				_reloads.push_back(std::move(reload));
+			}
+			if (--_pendingCount == 0)
+			{
+				_compileDone.notify_all();
+			}
+		});
+	}
+}
+
+bool VulkanShaderReloader::GetReload(ShaderReload* reload)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_reloads.empty())
+	{
+		return false;
+	}
+	*reload = std::move(_reloads.front());
+	_reloads.pop_front();
+	return true;
+}
+
+void VulkanShaderReloader::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_compileDone.wait(lock, [this]() { return _pendingCount == 0; });
+}
+
+bool VulkanShaderReloader::GetModificationTime(const std::string& filename, int64_t* time)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &attributes))
+	{
+		return false;
+	}
+	*time = (static_cast<int64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat status;
+	if (stat(filename.c_str(), &status) != 0)
+	{
+		return false;
+	}
+	*time = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+bool VulkanShaderReloader::ReadSource(const std::string& filename, std::string* source)
+{
+	size_t size;
+	char* data = static_cast<char*>(readFile(filename.c_str(), &size));
+	if (!data)
+	{
+		return false;
+	}
+	source->assign(data, size);
+	free(data);
+	return true;
+}
+
+uint64_t VulkanShaderReloader::HashSource(const WatchedShader& shader, const std::string& source)
+{
+	// Hash of the stage, the defines and the source
+	uint64_t hash = HashBytes(&shader._stage, sizeof(shader._stage));
+	for (const std::string& define : shader._defines)
+	{
+		// Separated, so that moving characters between two defines changes the hash
+		hash = HashBytes(define.c_str(), define.size() + 1, hash);
+	}
+	return HashBytes(source.data(), source.size(), hash);
+}
+
+std::string VulkanShaderReloader::GetCacheFilename(uint64_t hash)
+{
+	std::ostringstream filename;
+	filename << SHADER_CACHE_DIRECTORY << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".spv";
+	return filename.str();
+}
+
+bool VulkanShaderReloader::LoadSpirv(const std::string& filename, std::vector<uint32_t>* spirv)
+{
+	size_t size;
+	void* data = readFile(filename.c_str(), &size);
+	if (!data)
+	{
+		return false;
+	}
+
+	// A file cut short, e.g. by a crash while it was written, is compiled again
+	const bool valid = size >= sizeof(uint32_t) && (size % sizeof(uint32_t)) == 0 && *static_cast<uint32_t*>(data) == SPIRV_MAGIC_NUMBER;
+	if (valid)
+	{
+		spirv->assign(static_cast<uint32_t*>(data), static_cast<uint32_t*>(data) + size / sizeof(uint32_t));
+	}
+	free(data);
+	return valid;
+}
+
+bool VulkanShaderReloader::Compile(const WatchedShader& shader, const std::string& source, uint64_t hash, std::vector<uint32_t>* spirv)
+{
+	CreateCacheDirectory();
+	const std::string cacheFilename = GetCacheFilename(hash);
+
+#ifdef AUTO_COMPILE_GLSL_TO_SPV
+	// The defines are written NAME or NAME=VALUE, like for the validator
+	std::string preamble;
+	for (std::string define : shader._defines)
+	{
+		const size_t equal = define.find('=');
+		if (equal != std::string::npos)
+		{
+			define[equal] = ' ';
+		}
+		preamble += "#define " + define + "\n";
+	}
+
+	VulkanShader::InitializeCompiler();
+	std::vector<unsigned int> compiled;
+	if (!VulkanShader::GLSLtoSPV(shader._stage, source.c_str(), compiled, preamble.c_str()))
+	{
+		return false;
+	}
+	spirv->assign(compiled.begin(), compiled.end());
+
+	FILE* fp = fopen(cacheFilename.c_str(), "wb");
+	if (fp)
+	{
+		const bool written = fwrite(spirv->data(), sizeof(uint32_t), spirv->size(), fp) == spirv->size();
+		if (fclose(fp) != 0 || !written)
+		{
+			remove(cacheFilename.c_str());
+		}
+	}
+	return true;
+#else
+	// The source that was hashed is compiled, not the file which may have changed since. It
+	// keeps the extension of the source, the validator deduces the stage from it.
+	const std::string sourceFilename = cacheFilename.substr(0, cacheFilename.size() - 4) + shader._sourceFile.substr(shader._sourceFile.rfind('.'));
+	FILE* fp = fopen(sourceFilename.c_str(), "wb");
+	if (!fp)
+	{
+		return false;
+	}
+	const bool written = fwrite(source.data(), 1, source.size(), fp) == source.size();
+	if (fclose(fp) != 0 || !written)
+	{
+		remove(sourceFilename.c_str());
+		return false;
+	}
+
+	std::string command = GetValidatorPath() + " -V";
+	for (const std::string& define : shader._defines)
+	{
+		command += " -D" + define;
+	}
+	command += " -o \"" + cacheFilename + "\" \"" + sourceFilename + "\"";
+#ifdef _WIN32
+	// cmd.exe strips the outer quotes of a command starting with one
+	command = "\"" + command + "\"";
+#endif
+
+	const bool compiled = system(command.c_str()) == 0;
+	remove(sourceFilename.c_str());
+	if (!compiled)
+	{
+		remove(cacheFilename.c_str());
+		return false;
+	}
+	return LoadSpirv(cacheFilename, spirv);
+#endif
+}
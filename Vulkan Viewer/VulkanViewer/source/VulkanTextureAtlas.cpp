@@ -0,0 +1,161 @@
+#include "VulkanTextureAtlas.h"
+#include "VulkanThreadPool.h"
+
+// The packer is vendored with imgui, its functions are kept private to this file
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "stb_rect_pack.h"
+
+VulkanTextureAtlas::VulkanTextureAtlas()
+{
+	_atlas._format		= VK_FORMAT_UNDEFINED;
+	_atlas._width		= 0;
+	_atlas._height		= 0;
+	_atlas._mipLevels	= 0;
+}
+
+VulkanTextureAtlas::~VulkanTextureAtlas()
+{
+}
+
+bool VulkanTextureAtlas::Add(const TextureImage& image, uint32_t* index)
+{
+	// The mip chain of the atlas is generated on the CPU, from 8 bit texels
+	bool isSRGB;
+	if (!VulkanTextureLoader::Is8BitFormat(image._format, &isSRGB) || (!_images.empty() && image._format != _images[0]._format))
+	{
+		return false;
+	}
+
+	// Only the small images share the atlas, the others are better off streamed
+	if (image._width > ATLAS_MAX_IMAGE_SIZE || image._height > ATLAS_MAX_IMAGE_SIZE)
+	{
+		return false;
+	}
+
+	// Only the base level is kept, the atlas has mips of its own
+	TextureImage baseLevel;
+	baseLevel._format		= image._format;
+	baseLevel._width		= image._width;
+	baseLevel._height		= image._height;
+	baseLevel._mipLevels	= 1;
+	baseLevel._data.assign(image.GetLevelData(0), image.GetLevelData(0) + image._levelSizes[0]);
+	baseLevel._levelOffsets.push_back(0);
+	baseLevel._levelSizes.push_back(image._levelSizes[0]);
+
+	*index = static_cast<uint32_t>(_images.size());
+	_images.push_back(std::move(baseLevel));
+	_regions.push_back(AtlasRegion());
+	return true;
+}
+
+bool VulkanTextureAtlas::Pack(VulkanThreadPool& threadPool)
+{
+	if (_images.empty())
+	{
+		return false;
+	}
+
+	// The rectangles are packed in units of the alignment, so every image starts on a texel
+	// of each mip level. The gutter surrounds the image on every side.
+	const uint32_t alignment = 1u << (ATLAS_MIP_LEVELS - 1);
+	std::vector<stbrp_rect> rects(_images.size());
+	uint64_t area = 0;
+	for (size_t i = 0; i < _images.size(); i++)
+	{
+		rects[i].id	= static_cast<int>(i);
+		rects[i].w	= static_cast<stbrp_coord>((_images[i]._width + 2 * ATLAS_GUTTER + alignment - 1) / alignment);
+		rects[i].h	= static_cast<stbrp_coord>((_images[i]._height + 2 * ATLAS_GUTTER + alignment - 1) / alignment);
+		area += static_cast<uint64_t>(rects[i].w) * rects[i].h;
+	}
+
+	// Smallest power of two square which holds every rectangle
+	uint32_t size = alignment;
+	bool packed = false;
+	for (; size <= ATLAS_MAX_SIZE && !packed; size *= 2)
+	{
+		const uint32_t units = size / alignment;
+		if (static_cast<uint64_t>(units) * units < area)
+		{
+			continue;
+		}
+
+		stbrp_context context;
+		std::vector<stbrp_node> nodes(units);
+		stbrp_init_target(&context, units, units, nodes.data(), static_cast<int>(nodes.size()));
+		stbrp_pack_rects(&context, rects.data(), static_cast<int>(rects.size()));
+
+		packed = std::all_of(rects.begin(), rects.end(), [](const stbrp_rect& rect) { return rect.was_packed != 0; });
+	}
+	if (!packed)
+	{
+		std::cout << "The " << _images.size() << " images do not fit in a " << ATLAS_MAX_SIZE << " texture atlas" << std::endl;
+		return false;
+	}
+	size /= 2;
+
+	uint32_t unused, texelSize;
+	VulkanTextureLoader::GetFormatBlockInfo(_images[0]._format, &unused, &unused, &texelSize);
+
+	_atlas._format		= _images[0]._format;
+	_atlas._width		= size;
+	_atlas._height		= size;
+	_atlas._mipLevels	= 1;
+	_atlas._file.reset();
+	_atlas._data.assign(static_cast<size_t>(size) * size * texelSize, 0);
+	_atlas._levelOffsets.assign(1, 0);
+	_atlas._levelSizes.assign(1, _atlas._data.size());
+
+	for (const stbrp_rect& rect : rects)
+	{
+		const TextureImage& image = _images[rect.id];
+		Blit(image, rect.x * alignment, rect.y * alignment, texelSize);
+
+		AtlasRegion& region = _regions[rect.id];
+		region._uvOffset	= glm::vec2(rect.x * alignment + ATLAS_GUTTER, rect.y * alignment + ATLAS_GUTTER) / static_cast<float>(size);
+		region._uvScale		= glm::vec2(image._width, image._height) / static_cast<float>(size);
+	}
+
+	// Only the levels where the gutter is at least one texel wide
+	const uint32_t levelCount = std::min(static_cast<uint32_t>(ATLAS_MIP_LEVELS), VulkanTextureLoader::GetFullMipLevelCount(size, size));
+	const bool generated = VulkanTextureLoader::GenerateMipmaps(&_atlas, threadPool, levelCount);
+	assert(generated);
+
+	// The atlas holds its own copy of every image
+	_images.clear();
+	return true;
+}
+
+void VulkanTextureAtlas::Blit(const TextureImage& image, uint32_t x, uint32_t y, uint32_t texelSize)
+{
+	// The whole aligned rectangle is covered, the texels outside the image repeat its
+	// nearest edge texel, so the coarser levels only ever average texels of this image
+	const uint32_t alignment	= 1u << (ATLAS_MIP_LEVELS - 1);
+	const uint32_t rectWidth	= (image._width + 2 * ATLAS_GUTTER + alignment - 1) / alignment * alignment;
+	const uint32_t rectHeight	= (image._height + 2 * ATLAS_GUTTER + alignment - 1) / alignment * alignment;
+	const uint8_t* source		= image.GetLevelData(0);
+
+	for (uint32_t ty = 0; ty < rectHeight; ty++)
+	{
+		const int32_t sy = std::min(std::max(static_cast<int32_t>(ty) - ATLAS_GUTTER, 0), static_cast<int32_t>(image._height) - 1);
+		uint8_t* destination = _atlas._data.data() + (static_cast<size_t>(y + ty) * _atlas._width + x) * texelSize;
+		for (uint32_t tx = 0; tx < rectWidth; tx++)
+		{
+			const int32_t sx = std::min(std::max(static_cast<int32_t>(tx) - ATLAS_GUTTER, 0), static_cast<int32_t>(image._width) - 1);
+			memcpy(destination + static_cast<size_t>(tx) * texelSize, source + (static_cast<size_t>(sy) * image._width + sx) * texelSize, texelSize);
+		}
+	}
+}
+
+void VulkanTextureAtlas::RewriteUVs(uint32_t index, void* vertices, uint32_t vertexCount, uint32_t stride, uint32_t uvOffset) const
+{
+	// The coordinates must be in [0, 1], the atlas cannot repeat an image
+	const AtlasRegion& region = _regions[index];
+	uint8_t* vertex = static_cast<uint8_t*>(vertices) + uvOffset;
+	for (uint32_t i = 0; i < vertexCount; i++, vertex += stride)
+	{
+		float* uv	= reinterpret_cast<float*>(vertex);
+		uv[0]		= region._uvOffset.x + uv[0] * region._uvScale.x;
+		uv[1]		= region._uvOffset.y + uv[1] * region._uvScale.y;
+	}
+}
@@ -0,0 +1,848 @@
+#include "VulkanTextureLoader.h"
+#include "VulkanThreadPool.h"
+#include "VulkanPixelConverter.h"
+
+namespace
+{
+	struct FormatInfo
+	{
+		gli::format	_gliFormat;
+		VkFormat	_format;
+		uint32_t	_blockWidth;
+		uint32_t	_blockHeight;
+		uint32_t	_blockSize;
+	};
+
+	// The formats gli can load and their Vulkan equivalent. PVRTC and ATC have none in core Vulkan.
+	const FormatInfo formatTable[] =
+	{
+		{ gli::FORMAT_R8_UNORM,			VK_FORMAT_R8_UNORM,				1, 1, 1 },
+		{ gli::FORMAT_RG8_UNORM,		VK_FORMAT_R8G8_UNORM,			1, 1, 2 },
+		{ gli::FORMAT_RGB8_UNORM,		VK_FORMAT_R8G8B8_UNORM,			1, 1, 3 },
+		{ gli::FORMAT_RGBA8_UNORM,		VK_FORMAT_R8G8B8A8_UNORM,		1, 1, 4 },
+		{ gli::FORMAT_R16_UNORM,		VK_FORMAT_R16_UNORM,			1, 1, 2 },
+		{ gli::FORMAT_RG16_UNORM,		VK_FORMAT_R16G16_UNORM,			1, 1, 4 },
+		{ gli::FORMAT_RGBA16_UNORM,		VK_FORMAT_R16G16B16A16_UNORM,	1, 1, 8 },
+		{ gli::FORMAT_R16_SFLOAT,		VK_FORMAT_R16_SFLOAT,			1, 1, 2 },
+		{ gli::FORMAT_RG16_SFLOAT,		VK_FORMAT_R16G16_SFLOAT,		1, 1, 4 },
+		{ gli::FORMAT_RGBA16_SFLOAT,	VK_FORMAT_R16G16B16A16_SFLOAT,	1, 1, 8 },
+		{ gli::FORMAT_R32_SFLOAT,		VK_FORMAT_R32_SFLOAT,			1, 1, 4 },
+		{ gli::FORMAT_RG32_SFLOAT,		VK_FORMAT_R32G32_SFLOAT,		1, 1, 8 },
+		{ gli::FORMAT_RGBA32_SFLOAT,	VK_FORMAT_R32G32B32A32_SFLOAT,	1, 1, 16 },
+		{ gli::FORMAT_R8_SRGB,			VK_FORMAT_R8_SRGB,				1, 1, 1 },
+		{ gli::FORMAT_RG8_SRGB,			VK_FORMAT_R8G8_SRGB,			1, 1, 2 },
+		{ gli::FORMAT_RGB8_SRGB,		VK_FORMAT_R8G8B8_SRGB,			1, 1, 3 },
+		{ gli::FORMAT_RGBA8_SRGB,		VK_FORMAT_R8G8B8A8_SRGB,		1, 1, 4 },
+		{ gli::FORMAT_BGRA8_UNORM,		VK_FORMAT_B8G8R8A8_UNORM,		1, 1, 4 },
+		{ gli::FORMAT_BGRA8_SRGB,		VK_FORMAT_B8G8R8A8_SRGB,		1, 1, 4 },
+
+		// BC1 to BC7
+		{ gli::FORMAT_RGB_DXT1_UNORM,	VK_FORMAT_BC1_RGB_UNORM_BLOCK,	4, 4, 8 },
+		{ gli::FORMAT_RGBA_DXT1_UNORM,	VK_FORMAT_BC1_RGBA_UNORM_BLOCK,	4, 4, 8 },
+		{ gli::FORMAT_RGBA_DXT3_UNORM,	VK_FORMAT_BC2_UNORM_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_RGBA_DXT5_UNORM,	VK_FORMAT_BC3_UNORM_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_R_ATI1N_UNORM,	VK_FORMAT_BC4_UNORM_BLOCK,		4, 4, 8 },
+		{ gli::FORMAT_R_ATI1N_SNORM,	VK_FORMAT_BC4_SNORM_BLOCK,		4, 4, 8 },
+		{ gli::FORMAT_RG_ATI2N_UNORM,	VK_FORMAT_BC5_UNORM_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_RG_ATI2N_SNORM,	VK_FORMAT_BC5_SNORM_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_RGB_BP_UFLOAT,	VK_FORMAT_BC6H_UFLOAT_BLOCK,	4, 4, 16 },
+		{ gli::FORMAT_RGB_BP_SFLOAT,	VK_FORMAT_BC6H_SFLOAT_BLOCK,	4, 4, 16 },
+		{ gli::FORMAT_RGB_BP_UNORM,		VK_FORMAT_BC7_UNORM_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_RGB_DXT1_SRGB,	VK_FORMAT_BC1_RGB_SRGB_BLOCK,	4, 4, 8 },
+		{ gli::FORMAT_RGBA_DXT1_SRGB,	VK_FORMAT_BC1_RGBA_SRGB_BLOCK,	4, 4, 8 },
+		{ gli::FORMAT_RGBA_DXT3_SRGB,	VK_FORMAT_BC2_SRGB_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_RGBA_DXT5_SRGB,	VK_FORMAT_BC3_SRGB_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_RGB_BP_SRGB,		VK_FORMAT_BC7_SRGB_BLOCK,		4, 4, 16 },
+
+		// ETC2 and EAC, ETC1 is a subset of ETC2
+		{ gli::FORMAT_RGB_ETC_UNORM,						VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK,		4, 4, 8 },
+		{ gli::FORMAT_RGB_ETC2_UNORM,						VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK,		4, 4, 8 },
+		{ gli::FORMAT_RGBA_ETC2_PUNCHTHROUGH_UNORM,			VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK,	4, 4, 8 },
+		{ gli::FORMAT_RGBA_ETC2_UNORM,						VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK,	4, 4, 16 },
+		{ gli::FORMAT_R11_EAC_UNORM,						VK_FORMAT_EAC_R11_UNORM_BLOCK,			4, 4, 8 },
+		{ gli::FORMAT_R11_EAC_SNORM,						VK_FORMAT_EAC_R11_SNORM_BLOCK,			4, 4, 8 },
+		{ gli::FORMAT_RG11_EAC_UNORM,						VK_FORMAT_EAC_R11G11_UNORM_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_RG11_EAC_SNORM,						VK_FORMAT_EAC_R11G11_SNORM_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_RGB_ETC_SRGB,							VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK,		4, 4, 8 },
+		{ gli::FORMAT_RGBA_ETC2_PUNCHTHROUGH_SRGB,			VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK,		4, 4, 8 },
+		{ gli::FORMAT_RGBA_ETC2_SRGB,						VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK,		4, 4, 16 },
+
+		// ASTC, every block is 16 bytes whatever its footprint
+		{ gli::FORMAT_RGBA_ASTC_4X4_UNORM,		VK_FORMAT_ASTC_4x4_UNORM_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_RGBA_ASTC_5X4_UNORM,		VK_FORMAT_ASTC_5x4_UNORM_BLOCK,		5, 4, 16 },
+		{ gli::FORMAT_RGBA_ASTC_5X5_UNORM,		VK_FORMAT_ASTC_5x5_UNORM_BLOCK,		5, 5, 16 },
+		{ gli::FORMAT_RGBA_ASTC_6X5_UNORM,		VK_FORMAT_ASTC_6x5_UNORM_BLOCK,		6, 5, 16 },
+		{ gli::FORMAT_RGBA_ASTC_6X6_UNORM,		VK_FORMAT_ASTC_6x6_UNORM_BLOCK,		6, 6, 16 },
+		{ gli::FORMAT_RGBA_ASTC_8X5_UNORM,		VK_FORMAT_ASTC_8x5_UNORM_BLOCK,		8, 5, 16 },
+		{ gli::FORMAT_RGBA_ASTC_8X6_UNORM,		VK_FORMAT_ASTC_8x6_UNORM_BLOCK,		8, 6, 16 },
+		{ gli::FORMAT_RGBA_ASTC_8X8_UNORM,		VK_FORMAT_ASTC_8x8_UNORM_BLOCK,		8, 8, 16 },
+		{ gli::FORMAT_RGBA_ASTC_10X5_UNORM,		VK_FORMAT_ASTC_10x5_UNORM_BLOCK,	10, 5, 16 },
+		{ gli::FORMAT_RGBA_ASTC_10X6_UNORM,		VK_FORMAT_ASTC_10x6_UNORM_BLOCK,	10, 6, 16 },
+		{ gli::FORMAT_RGBA_ASTC_10X8_UNORM,		VK_FORMAT_ASTC_10x8_UNORM_BLOCK,	10, 8, 16 },
+		{ gli::FORMAT_RGBA_ASTC_10X10_UNORM,	VK_FORMAT_ASTC_10x10_UNORM_BLOCK,	10, 10, 16 },
+		{ gli::FORMAT_RGBA_ASTC_12X10_UNORM,	VK_FORMAT_ASTC_12x10_UNORM_BLOCK,	12, 10, 16 },
+		{ gli::FORMAT_RGBA_ASTC_12X12_UNORM,	VK_FORMAT_ASTC_12x12_UNORM_BLOCK,	12, 12, 16 },
+		{ gli::FORMAT_RGBA_ASTC_4X4_SRGB,		VK_FORMAT_ASTC_4x4_SRGB_BLOCK,		4, 4, 16 },
+		{ gli::FORMAT_RGBA_ASTC_5X4_SRGB,		VK_FORMAT_ASTC_5x4_SRGB_BLOCK,		5, 4, 16 },
+		{ gli::FORMAT_RGBA_ASTC_5X5_SRGB,		VK_FORMAT_ASTC_5x5_SRGB_BLOCK,		5, 5, 16 },
+		{ gli::FORMAT_RGBA_ASTC_6X5_SRGB,		VK_FORMAT_ASTC_6x5_SRGB_BLOCK,		6, 5, 16 },
+		{ gli::FORMAT_RGBA_ASTC_6X6_SRGB,		VK_FORMAT_ASTC_6x6_SRGB_BLOCK,		6, 6, 16 },
+		{ gli::FORMAT_RGBA_ASTC_8X5_SRGB,		VK_FORMAT_ASTC_8x5_SRGB_BLOCK,		8, 5, 16 },
+		{ gli::FORMAT_RGBA_ASTC_8X6_SRGB,		VK_FORMAT_ASTC_8x6_SRGB_BLOCK,		8, 6, 16 },
+		{ gli::FORMAT_RGBA_ASTC_8X8_SRGB,		VK_FORMAT_ASTC_8x8_SRGB_BLOCK,		8, 8, 16 },
+		{ gli::FORMAT_RGBA_ASTC_10X5_SRGB,		VK_FORMAT_ASTC_10x5_SRGB_BLOCK,		10, 5, 16 },
+		{ gli::FORMAT_RGBA_ASTC_10X6_SRGB,		VK_FORMAT_ASTC_10x6_SRGB_BLOCK,		10, 6, 16 },
+		{ gli::FORMAT_RGBA_ASTC_10X8_SRGB,		VK_FORMAT_ASTC_10x8_SRGB_BLOCK,		10, 8, 16 },
+		{ gli::FORMAT_RGBA_ASTC_10X10_SRGB,		VK_FORMAT_ASTC_10x10_SRGB_BLOCK,	10, 10, 16 },
+		{ gli::FORMAT_RGBA_ASTC_12X10_SRGB,		VK_FORMAT_ASTC_12x10_SRGB_BLOCK,	12, 10, 16 },
+		{ gli::FORMAT_RGBA_ASTC_12X12_SRGB,		VK_FORMAT_ASTC_12x12_SRGB_BLOCK,	12, 12, 16 },
+	};
+
+	const FormatInfo* FindFormatInfo(VkFormat format)
+	{
+		for (const FormatInfo& info : formatTable)
+		{
+			if (info._format == format)
+			{
+				return &info;
+			}
+		}
+		return nullptr;
+	}
+
+	// KTX file layout, the endianness field tells whether the fields need swapping
+	const uint8_t ktxIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+	const uint32_t ktxEndianness = 0x04030201;
+
+	struct KTXHeader
+	{
+		uint8_t		_identifier[12];
+		uint32_t	_endianness;
+		uint32_t	_glType;
+		uint32_t	_glTypeSize;
+		uint32_t	_glFormat;
+		uint32_t	_glInternalFormat;
+		uint32_t	_glBaseInternalFormat;
+		uint32_t	_pixelWidth;
+		uint32_t	_pixelHeight;
+		uint32_t	_pixelDepth;
+		uint32_t	_arrayElementCount;
+		uint32_t	_faceCount;
+		uint32_t	_levelCount;
+		uint32_t	_keyValueDataSize;
+	};
+
+	// Sized OpenGL internal formats of the KTX files and their Vulkan equivalent
+	const struct
+	{
+		uint32_t	_glInternalFormat;
+		VkFormat	_format;
+	} glFormatTable[] =
+	{
+		{ 0x8229, VK_FORMAT_R8_UNORM },						// GL_R8
+		{ 0x822B, VK_FORMAT_R8G8_UNORM },					// GL_RG8
+		{ 0x8051, VK_FORMAT_R8G8B8_UNORM },					// GL_RGB8
+		{ 0x8058, VK_FORMAT_R8G8B8A8_UNORM },				// GL_RGBA8
+		{ 0x8C41, VK_FORMAT_R8G8B8_SRGB },					// GL_SRGB8
+		{ 0x8C43, VK_FORMAT_R8G8B8A8_SRGB },				// GL_SRGB8_ALPHA8
+		{ 0x822D, VK_FORMAT_R16_SFLOAT },					// GL_R16F
+		{ 0x822F, VK_FORMAT_R16G16_SFLOAT },				// GL_RG16F
+		{ 0x881A, VK_FORMAT_R16G16B16A16_SFLOAT },			// GL_RGBA16F
+		{ 0x822E, VK_FORMAT_R32_SFLOAT },					// GL_R32F
+		{ 0x8230, VK_FORMAT_R32G32_SFLOAT },				// GL_RG32F
+		{ 0x8814, VK_FORMAT_R32G32B32A32_SFLOAT },			// GL_RGBA32F
+		{ 0x83F0, VK_FORMAT_BC1_RGB_UNORM_BLOCK },			// GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+		{ 0x83F1, VK_FORMAT_BC1_RGBA_UNORM_BLOCK },			// GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+		{ 0x83F2, VK_FORMAT_BC2_UNORM_BLOCK },				// GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+		{ 0x83F3, VK_FORMAT_BC3_UNORM_BLOCK },				// GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+		{ 0x8C4C, VK_FORMAT_BC1_RGB_SRGB_BLOCK },			// GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+		{ 0x8C4D, VK_FORMAT_BC1_RGBA_SRGB_BLOCK },			// GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+		{ 0x8C4E, VK_FORMAT_BC2_SRGB_BLOCK },				// GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+		{ 0x8C4F, VK_FORMAT_BC3_SRGB_BLOCK },				// GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+		{ 0x8DBB, VK_FORMAT_BC4_UNORM_BLOCK },				// GL_COMPRESSED_RED_RGTC1
+		{ 0x8DBC, VK_FORMAT_BC4_SNORM_BLOCK },				// GL_COMPRESSED_SIGNED_RED_RGTC1
+		{ 0x8DBD, VK_FORMAT_BC5_UNORM_BLOCK },				// GL_COMPRESSED_RG_RGTC2
+		{ 0x8DBE, VK_FORMAT_BC5_SNORM_BLOCK },				// GL_COMPRESSED_SIGNED_RG_RGTC2
+		{ 0x8E8C, VK_FORMAT_BC7_UNORM_BLOCK },				// GL_COMPRESSED_RGBA_BPTC_UNORM
+		{ 0x8E8D, VK_FORMAT_BC7_SRGB_BLOCK },				// GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+		{ 0x8E8E, VK_FORMAT_BC6H_SFLOAT_BLOCK },			// GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT
+		{ 0x8E8F, VK_FORMAT_BC6H_UFLOAT_BLOCK },			// GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT
+		{ 0x8D64, VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK },		// GL_ETC1_RGB8_OES
+		{ 0x9274, VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK },		// GL_COMPRESSED_RGB8_ETC2
+		{ 0x9275, VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK },		// GL_COMPRESSED_SRGB8_ETC2
+		{ 0x9276, VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK },	// GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2
+		{ 0x9277, VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK },		// GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2
+		{ 0x9278, VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK },	// GL_COMPRESSED_RGBA8_ETC2_EAC
+		{ 0x9279, VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK },		// GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC
+		{ 0x9270, VK_FORMAT_EAC_R11_UNORM_BLOCK },			// GL_COMPRESSED_R11_EAC
+		{ 0x9271, VK_FORMAT_EAC_R11_SNORM_BLOCK },			// GL_COMPRESSED_SIGNED_R11_EAC
+		{ 0x9272, VK_FORMAT_EAC_R11G11_UNORM_BLOCK },		// GL_COMPRESSED_RG11_EAC
+		{ 0x9273, VK_FORMAT_EAC_R11G11_SNORM_BLOCK },		// GL_COMPRESSED_SIGNED_RG11_EAC
+		{ 0x93B0, VK_FORMAT_ASTC_4x4_UNORM_BLOCK },			// GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+		{ 0x93B1, VK_FORMAT_ASTC_5x4_UNORM_BLOCK },
+		{ 0x93B2, VK_FORMAT_ASTC_5x5_UNORM_BLOCK },
+		{ 0x93B3, VK_FORMAT_ASTC_6x5_UNORM_BLOCK },
+		{ 0x93B4, VK_FORMAT_ASTC_6x6_UNORM_BLOCK },
+		{ 0x93B5, VK_FORMAT_ASTC_8x5_UNORM_BLOCK },
+		{ 0x93B6, VK_FORMAT_ASTC_8x6_UNORM_BLOCK },
+		{ 0x93B7, VK_FORMAT_ASTC_8x8_UNORM_BLOCK },
+		{ 0x93B8, VK_FORMAT_ASTC_10x5_UNORM_BLOCK },
+		{ 0x93B9, VK_FORMAT_ASTC_10x6_UNORM_BLOCK },
+		{ 0x93BA, VK_FORMAT_ASTC_10x8_UNORM_BLOCK },
+		{ 0x93BB, VK_FORMAT_ASTC_10x10_UNORM_BLOCK },
+		{ 0x93BC, VK_FORMAT_ASTC_12x10_UNORM_BLOCK },
+		{ 0x93BD, VK_FORMAT_ASTC_12x12_UNORM_BLOCK },
+		{ 0x93D0, VK_FORMAT_ASTC_4x4_SRGB_BLOCK },			// GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR
+		{ 0x93D1, VK_FORMAT_ASTC_5x4_SRGB_BLOCK },
+		{ 0x93D2, VK_FORMAT_ASTC_5x5_SRGB_BLOCK },
+		{ 0x93D3, VK_FORMAT_ASTC_6x5_SRGB_BLOCK },
+		{ 0x93D4, VK_FORMAT_ASTC_6x6_SRGB_BLOCK },
+		{ 0x93D5, VK_FORMAT_ASTC_8x5_SRGB_BLOCK },
+		{ 0x93D6, VK_FORMAT_ASTC_8x6_SRGB_BLOCK },
+		{ 0x93D7, VK_FORMAT_ASTC_8x8_SRGB_BLOCK },
+		{ 0x93D8, VK_FORMAT_ASTC_10x5_SRGB_BLOCK },
+		{ 0x93D9, VK_FORMAT_ASTC_10x6_SRGB_BLOCK },
+		{ 0x93DA, VK_FORMAT_ASTC_10x8_SRGB_BLOCK },
+		{ 0x93DB, VK_FORMAT_ASTC_10x10_SRGB_BLOCK },
+		{ 0x93DC, VK_FORMAT_ASTC_12x10_SRGB_BLOCK },
+		{ 0x93DD, VK_FORMAT_ASTC_12x12_SRGB_BLOCK },
+	};
+
+	// Size of a level whose blocks are tightly packed
+	VkDeviceSize GetPackedLevelSize(VkFormat format, uint32_t width, uint32_t height, uint32_t level)
+	{
+		const FormatInfo* info		= FindFormatInfo(format);
+		const VkDeviceSize blocksX	= (std::max(width >> level, 1u) + info->_blockWidth - 1) / info->_blockWidth;
+		const VkDeviceSize blocksY	= (std::max(height >> level, 1u) + info->_blockHeight - 1) / info->_blockHeight;
+		return blocksX * blocksY * info->_blockSize;
+	}
+
+	// KTX2 file layout, all the fields are little endian
+	const uint8_t ktx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	struct KTX2Header
+	{
+		uint8_t		_identifier[12];
+		uint32_t	_vkFormat;
+		uint32_t	_typeSize;
+		uint32_t	_pixelWidth;
+		uint32_t	_pixelHeight;
+		uint32_t	_pixelDepth;
+		uint32_t	_layerCount;
+		uint32_t	_faceCount;
+		uint32_t	_levelCount;
+		uint32_t	_supercompressionScheme;
+		uint32_t	_dfdByteOffset;
+		uint32_t	_dfdByteLength;
+		uint32_t	_kvdByteOffset;
+		uint32_t	_kvdByteLength;
+		uint64_t	_sgdByteOffset;
+		uint64_t	_sgdByteLength;
+	};
+
+	struct KTX2LevelIndex
+	{
+		uint64_t	_byteOffset;
+		uint64_t	_byteLength;
+		uint64_t	_uncompressedByteLength;
+	};
+
+	void Expand565(uint16_t color, uint8_t rgba[4])
+	{
+		const uint32_t r = (color >> 11) & 0x1F;
+		const uint32_t g = (color >> 5) & 0x3F;
+		const uint32_t b = color & 0x1F;
+		rgba[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+		rgba[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+		rgba[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+		rgba[3] = 255;
+	}
+
+	// Color part of BC1, BC2 and BC3. BC1 blocks with c0 <= c1 use the three color mode, whose
+	// index 3 is black, transparent for the BC1 formats with alpha. BC2 and BC3 always use the
+	// four color mode.
+	void DecodeColorBlock(const uint8_t* block, bool allowThreeColors, bool transparentBlack, uint8_t texels[16][4])
+	{
+		const uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+		const uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+
+		uint8_t palette[4][4];
+		Expand565(c0, palette[0]);
+		Expand565(c1, palette[1]);
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			if (c0 > c1 || !allowThreeColors)
+			{
+				palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+				palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+			}
+			else
+			{
+				palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+				palette[3][c] = 0;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = (c0 > c1 || !allowThreeColors || !transparentBlack) ? 255 : 0;
+
+		const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			memcpy(texels[i], palette[(indices >> (2 * i)) & 3], 4);
+		}
+	}
+
+	// Single channel block of BC3 alpha, BC4 and BC5
+	void DecodeChannelBlock(const uint8_t* block, uint32_t channel, uint8_t texels[16][4])
+	{
+		uint32_t values[8];
+		values[0] = block[0];
+		values[1] = block[1];
+		if (values[0] > values[1])
+		{
+			for (uint32_t i = 1; i < 7; i++)
+			{
+				values[i + 1] = ((7 - i) * values[0] + i * values[1]) / 7;
+			}
+		}
+		else
+		{
+			for (uint32_t i = 1; i < 5; i++)
+			{
+				values[i + 1] = ((5 - i) * values[0] + i * values[1]) / 5;
+			}
+			values[6] = 0;
+			values[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+		}
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			texels[i][channel] = static_cast<uint8_t>(values[(indices >> (3 * i)) & 7]);
+		}
+	}
+}
+
+bool VulkanTextureLoader::Load(const char* filename, TextureImage* image)
+{
+	std::shared_ptr<VulkanMappedFile> file(new VulkanMappedFile());
+	if (!file->Open(filename))
+	{
+		std::cout << "Unable to open the texture " << filename << std::endl;
+		return false;
+	}
+
+	const uint8_t* fileData	= file->GetData();
+	const size_t fileSize	= file->GetSize();
+	if (fileSize >= sizeof(ktx2Identifier) && memcmp(fileData, ktx2Identifier, sizeof(ktx2Identifier)) == 0)
+	{
+		return LoadKTX2(file, image);
+	}
+	if (fileSize >= sizeof(ktxIdentifier) && memcmp(fileData, ktxIdentifier, sizeof(ktxIdentifier)) == 0 && LoadKTX(file, image))
+	{
+		return true;
+	}
+
+	// DDS and the KTX files the reader above does not handle
+	gli::texture2D image2D(gli::load(reinterpret_cast<const char*>(fileData), fileSize));
+	if (image2D.empty())
+	{
+		std::cout << "Unsupported texture file " << filename << std::endl;
+		return false;
+	}
+
+	image->_format		= GetVulkanFormat(image2D.format());
+	image->_width		= uint32_t(image2D[0].dimensions().x);
+	image->_height		= uint32_t(image2D[0].dimensions().y);
+	image->_mipLevels	= uint32_t(image2D.levels());
+	image->_file.reset();
+	image->_data.assign(static_cast<const uint8_t*>(image2D.data()), static_cast<const uint8_t*>(image2D.data()) + image2D.size());
+
+	// The levels are stored one after the other
+	image->_levelOffsets.clear();
+	image->_levelSizes.clear();
+	VkDeviceSize offset = 0;
+	for (uint32_t i = 0; i < image->_mipLevels; i++)
+	{
+		image->_levelOffsets.push_back(offset);
+		image->_levelSizes.push_back(image2D[i].size());
+		offset += image2D[i].size();
+	}
+	return true;
+}
+
+bool VulkanTextureLoader::LoadKTX(const std::shared_ptr<VulkanMappedFile>& file, TextureImage* image)
+{
+	const uint8_t* data	= file->GetData();
+	const size_t size	= file->GetSize();
+
+	KTXHeader header;
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	// Files written on big endian machines, arrays, cube maps and 3D textures are left to gli
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	for (const auto& entry : glFormatTable)
+	{
+		if (entry._glInternalFormat == header._glInternalFormat)
+		{
+			format = entry._format;
+		}
+	}
+	if (header._endianness != ktxEndianness || format == VK_FORMAT_UNDEFINED || header._pixelDepth > 1 ||
+		header._arrayElementCount > 1 || header._faceCount != 1)
+	{
+		return false;
+	}
+
+	// A level count of 0 asks for the mip chain to be generated, only the base level is stored
+	const uint32_t levelCount	= std::max(header._levelCount, 1u);
+	const uint32_t width		= header._pixelWidth;
+	const uint32_t height		= std::max(header._pixelHeight, 1u);
+
+	std::vector<VkDeviceSize> levelOffsets;
+	std::vector<VkDeviceSize> levelSizes;
+	VkDeviceSize offset = sizeof(header) + header._keyValueDataSize;
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		// Each level is prefixed by its size and padded to 4 bytes
+		uint32_t imageSize;
+		if (offset + sizeof(imageSize) > size)
+		{
+			return false;
+		}
+		memcpy(&imageSize, data + offset, sizeof(imageSize));
+		offset += sizeof(imageSize);
+
+		// The rows of the uncompressed levels are padded to 4 bytes as well, those files go through gli
+		if (offset + imageSize > size || imageSize != GetPackedLevelSize(format, width, height, level))
+		{
+			return false;
+		}
+
+		levelOffsets.push_back(offset);
+		levelSizes.push_back(imageSize);
+		offset += (imageSize + 3) & ~3u;
+	}
+
+	image->_format		= format;
+	image->_width		= width;
+	image->_height		= height;
+	image->_mipLevels	= levelCount;
+	image->_file		= file;
+	image->_data.clear();
+	image->_levelOffsets.swap(levelOffsets);
+	image->_levelSizes.swap(levelSizes);
+	return true;
+}
+
+bool VulkanTextureLoader::LoadKTX2(const std::shared_ptr<VulkanMappedFile>& file, TextureImage* image)
+{
+	const uint8_t* data	= file->GetData();
+	const size_t size	= file->GetSize();
+
+	KTX2Header header;
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	// Basis Universal and zstd payloads need a transcoder which is not part of the viewer
+	if (header._supercompressionScheme != 0)
+	{
+		std::cout << "Supercompressed KTX2 textures are not supported, scheme " << header._supercompressionScheme << std::endl;
+		return false;
+	}
+
+	// Only the 2D textures without array layers or faces
+	if (header._pixelDepth > 1 || header._layerCount > 1 || header._faceCount != 1 || !FindFormatInfo(static_cast<VkFormat>(header._vkFormat)))
+	{
+		std::cout << "Unsupported KTX2 texture, format " << header._vkFormat << std::endl;
+		return false;
+	}
+
+	// A level count of 0 asks for the mip chain to be generated, only the base level is stored
+	const uint32_t levelCount = std::max(header._levelCount, 1u);
+	if (size < sizeof(header) + levelCount * sizeof(KTX2LevelIndex))
+	{
+		return false;
+	}
+
+	image->_format		= static_cast<VkFormat>(header._vkFormat);
+	image->_width		= header._pixelWidth;
+	image->_height		= std::max(header._pixelHeight, 1u);
+	image->_mipLevels	= levelCount;
+	image->_file		= file;
+	image->_data.clear();
+	image->_levelOffsets.clear();
+	image->_levelSizes.clear();
+
+	// The level index lists the base level first, the levels stay where they are in the file
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		KTX2LevelIndex levelIndex;
+		memcpy(&levelIndex, data + sizeof(header) + i * sizeof(KTX2LevelIndex), sizeof(levelIndex));
+		if (levelIndex._byteOffset + levelIndex._byteLength > size)
+		{
+			return false;
+		}
+
+		image->_levelOffsets.push_back(levelIndex._byteOffset);
+		image->_levelSizes.push_back(levelIndex._byteLength);
+	}
+	return true;
+}
+
+VkFormat VulkanTextureLoader::GetVulkanFormat(gli::format format)
+{
+	for (const FormatInfo& info : formatTable)
+	{
+		if (info._gliFormat == format)
+		{
+			return info._format;
+		}
+	}
+	return VK_FORMAT_UNDEFINED;
+}
+
+bool VulkanTextureLoader::IsFormatSampleable(VkPhysicalDevice gpu, VkFormat format)
+{
+	if (format == VK_FORMAT_UNDEFINED)
+	{
+		return false;
+	}
+
+	VkFormatProperties formatProps;
+	vkGetPhysicalDeviceFormatProperties(gpu, format, &formatProps);
+	return (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+void VulkanTextureLoader::GetFormatBlockInfo(VkFormat format, uint32_t* blockWidth, uint32_t* blockHeight, uint32_t* blockSize)
+{
+	const FormatInfo* info = FindFormatInfo(format);
+	assert(info);
+	*blockWidth		= info->_blockWidth;
+	*blockHeight	= info->_blockHeight;
+	*blockSize		= info->_blockSize;
+}
+
+VkDeviceSize VulkanTextureLoader::GetStagingLayout(const TextureImage& image, uint32_t firstLevel, uint32_t endLevel, std::vector<VkDeviceSize>* offsets)
+{
+	// The buffer offset of a copy is a multiple of the texel block size and of 4
+	uint32_t unused, blockSize;
+	GetFormatBlockInfo(image._format, &unused, &unused, &blockSize);
+	const VkDeviceSize alignment = (blockSize % 4 == 0) ? blockSize : (blockSize % 2 == 0 ? 2 * blockSize : 4 * blockSize);
+
+	offsets->clear();
+	VkDeviceSize size = 0;
+	for (uint32_t level = firstLevel; level < endLevel; level++)
+	{
+		size = (size + alignment - 1) / alignment * alignment;
+		offsets->push_back(size);
+		size += image._levelSizes[level];
+	}
+	return size;
+}
+
+void VulkanTextureLoader::CopyLevels(const TextureImage& image, uint32_t firstLevel, uint32_t endLevel, const std::vector<VkDeviceSize>& offsets, uint8_t* staging)
+{
+	for (uint32_t level = firstLevel; level < endLevel; level++)
+	{
+		memcpy(staging + offsets[level - firstLevel], image.GetLevelData(level), static_cast<size_t>(image._levelSizes[level]));
+	}
+}
+
+uint32_t VulkanTextureLoader::GetFullMipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levelCount = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+	{
+		levelCount++;
+	}
+	return levelCount;
+}
+
+bool VulkanTextureLoader::Is8BitFormat(VkFormat format, bool* isSRGB)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8_UNORM:
+	case VK_FORMAT_R8G8_UNORM:
+	case VK_FORMAT_R8G8B8_UNORM:
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+		*isSRGB = false;
+		return true;
+	case VK_FORMAT_R8_SRGB:
+	case VK_FORMAT_R8G8_SRGB:
+	case VK_FORMAT_R8G8B8_SRGB:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		*isSRGB = true;
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool VulkanTextureLoader::GenerateMipmaps(TextureImage* image, VulkanThreadPool& threadPool, uint32_t levelCount)
+{
+	bool isSRGB;
+	if (!Is8BitFormat(image->_format, &isSRGB))
+	{
+		return false;
+	}
+	assert(image->_mipLevels == 1);
+
+	// The generated levels are appended to the base level, which moves out of the mapped file
+	if (image->_file)
+	{
+		const uint8_t* baseLevel = image->GetLevelData(0);
+		image->_data.assign(baseLevel, baseLevel + image->_levelSizes[0]);
+		image->_levelOffsets[0] = 0;
+		image->_file.reset();
+	}
+
+	uint32_t unused, channelCount;
+	GetFormatBlockInfo(image->_format, &unused, &unused, &channelCount);
+
+	// The alpha channel of the sRGB formats is stored linearly
+	const uint32_t srgbChannelCount = !isSRGB ? 0 : (channelCount == 4 ? 3 : channelCount);
+
+	float srgbToLinear[256];
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		const float c = i / 255.0f;
+		srgbToLinear[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	const uint32_t fullLevelCount = GetFullMipLevelCount(image->_width, image->_height);
+	levelCount = (levelCount == 0) ? fullLevelCount : std::min(levelCount, fullLevelCount);
+	for (uint32_t level = 1; level < levelCount; level++)
+	{
+		const uint32_t srcWidth		= std::max(image->_width >> (level - 1), 1u);
+		const uint32_t srcHeight	= std::max(image->_height >> (level - 1), 1u);
+		const uint32_t dstWidth		= std::max(image->_width >> level, 1u);
+		const uint32_t dstHeight	= std::max(image->_height >> level, 1u);
+
+		image->_levelOffsets.push_back(image->_data.size());
+		image->_levelSizes.push_back(static_cast<VkDeviceSize>(dstWidth) * dstHeight * channelCount);
+		image->_data.resize(image->_data.size() + static_cast<size_t>(image->_levelSizes.back()));
+
+		const uint8_t* source	= image->_data.data() + image->_levelOffsets[level - 1];
+		uint8_t* destination	= image->_data.data() + image->_levelOffsets[level];
+
+		// Every texel averages the source texels its footprint touches. With odd sizes
+		// the footprints overlap by one texel, so no row or column is dropped.
+		threadPool.ParallelFor(dstHeight, [&](uint32_t, uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; y++)
+			{
+				const uint32_t y0 = y * srcHeight / dstHeight;
+				const uint32_t y1 = ((y + 1) * srcHeight + dstHeight - 1) / dstHeight;
+				for (uint32_t x = 0; x < dstWidth; x++)
+				{
+					const uint32_t x0 = x * srcWidth / dstWidth;
+					const uint32_t x1 = ((x + 1) * srcWidth + dstWidth - 1) / dstWidth;
+					const float weight = 1.0f / ((y1 - y0) * (x1 - x0));
+
+					uint8_t* texel = destination + (static_cast<size_t>(y) * dstWidth + x) * channelCount;
+					for (uint32_t c = 0; c < channelCount; c++)
+					{
+						float sum = 0.0f;
+						for (uint32_t sy = y0; sy < y1; sy++)
+						{
+							for (uint32_t sx = x0; sx < x1; sx++)
+							{
+								const uint8_t value = source[(static_cast<size_t>(sy) * srcWidth + sx) * channelCount + c];
+								sum += (c < srgbChannelCount) ? srgbToLinear[value] : value / 255.0f;
+							}
+						}
+
+						float average = sum * weight;
+						if (c < srgbChannelCount)
+						{
+							average = (average <= 0.0031308f) ? average * 12.92f : 1.055f * powf(average, 1.0f / 2.4f) - 0.055f;
+						}
+						texel[c] = static_cast<uint8_t>(std::min(average, 1.0f) * 255.0f + 0.5f);
+					}
+				}
+			}
+		});
+	}
+
+	image->_mipLevels = levelCount;
+	return true;
+}
+
+VkFormat VulkanTextureLoader::GetDecodedFormat(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8_UNORM:
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+		return VK_FORMAT_R8G8B8A8_UNORM;
+	case VK_FORMAT_R8G8B8_SRGB:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		return VK_FORMAT_R8G8B8A8_SRGB;
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		return VK_FORMAT_R8_UNORM;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		return VK_FORMAT_R8G8_UNORM;
+	default:
+		// BC6H, BC7, ETC2 and ASTC have no CPU decoder
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+bool VulkanTextureLoader::SelectDeviceFormat(VkPhysicalDevice gpu, TextureImage* image, VulkanThreadPool& threadPool)
+{
+	if (IsFormatSampleable(gpu, image->_format))
+	{
+		return true;
+	}
+
+	const VkFormat decodedFormat = GetDecodedFormat(image->_format);
+	if (!IsFormatSampleable(gpu, decodedFormat))
+	{
+		std::cout << "Texture format " << image->_format << " is not supported by the device" << std::endl;
+		return false;
+	}
+
+	std::cout << "Decoding texture format " << image->_format << " into " << decodedFormat << " on the CPU" << std::endl;
+	Decode(image, decodedFormat, threadPool);
+	return true;
+}
+
+void VulkanTextureLoader::Decode(TextureImage* image, VkFormat decodedFormat, VulkanThreadPool& threadPool)
+{
+	uint32_t blockWidth, blockHeight, blockSize;
+	GetFormatBlockInfo(image->_format, &blockWidth, &blockHeight, &blockSize);
+
+	uint32_t unused, texelSize;
+	GetFormatBlockInfo(decodedFormat, &unused, &unused, &texelSize);
+
+	// Layout of the decoded levels
+	std::vector<VkDeviceSize> levelOffsets;
+	std::vector<VkDeviceSize> levelSizes;
+	VkDeviceSize decodedSize = 0;
+	for (uint32_t level = 0; level < image->_mipLevels; level++)
+	{
+		const VkDeviceSize width	= std::max(image->_width >> level, 1u);
+		const VkDeviceSize height	= std::max(image->_height >> level, 1u);
+		levelOffsets.push_back(decodedSize);
+		levelSizes.push_back(width * height * texelSize);
+		decodedSize += levelSizes.back();
+	}
+	std::vector<uint8_t> decoded(decodedSize);
+
+	const VkFormat format = image->_format;
+	for (uint32_t level = 0; level < image->_mipLevels; level++)
+	{
+		const uint32_t width		= std::max(image->_width >> level, 1u);
+		const uint32_t height		= std::max(image->_height >> level, 1u);
+		const uint32_t blocksX		= (width + blockWidth - 1) / blockWidth;
+		const uint32_t blocksY		= (height + blockHeight - 1) / blockHeight;
+		const uint8_t* source		= image->GetLevelData(level);
+		uint8_t* destination		= decoded.data() + levelOffsets[level];
+
+		// Every row of blocks is independent, the rows are spread across the worker threads
+		threadPool.ParallelFor(blocksY, [&](uint32_t, uint32_t begin, uint32_t end)
+		{
+			// RGB8 rows expanded to RGBA8 as a whole
+			if (blockWidth == 1)
+			{
+				for (uint32_t y = begin; y < end; y++)
+				{
+					VulkanPixelConverter::ConvertRow(PIXEL_RGB8_TO_RGBA8, source + static_cast<size_t>(y) * width * blockSize,
+						destination + static_cast<size_t>(y) * width * texelSize, width, false);
+				}
+				return;
+			}
+
+			uint8_t texels[16][4];
+			for (uint32_t by = begin; by < end; by++)
+			{
+				for (uint32_t bx = 0; bx < blocksX; bx++)
+				{
+					const uint8_t* block = source + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+					DecodeBlock(format, block, texels);
+
+					// The blocks on the right and bottom edges may overhang the level
+					for (uint32_t ty = 0; ty < blockHeight; ty++)
+					{
+						for (uint32_t tx = 0; tx < blockWidth; tx++)
+						{
+							const uint32_t x = bx * blockWidth + tx;
+							const uint32_t y = by * blockHeight + ty;
+							if (x < width && y < height)
+							{
+								memcpy(destination + (static_cast<size_t>(y) * width + x) * texelSize, texels[ty * blockWidth + tx], texelSize);
+							}
+						}
+					}
+				}
+			}
+		});
+	}
+
+	image->_format = decodedFormat;
+	image->_file.reset();
+	image->_data.swap(decoded);
+	image->_levelOffsets.swap(levelOffsets);
+	image->_levelSizes.swap(levelSizes);
+}
+
+void VulkanTextureLoader::DecodeBlock(VkFormat format, const uint8_t* block, uint8_t texels[16][4])
+{
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		DecodeColorBlock(block, true, false, texels);
+		break;
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		DecodeColorBlock(block, true, true, texels);
+		break;
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+		// Explicit 4 bit alpha followed by a BC1 color block
+		DecodeColorBlock(block + 8, false, false, texels);
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const uint32_t alpha = (block[i / 2] >> (4 * (i % 2))) & 0xF;
+			texels[i][3] = static_cast<uint8_t>(alpha * 17);
+		}
+		break;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		DecodeColorBlock(block + 8, false, false, texels);
+		DecodeChannelBlock(block, 3, texels);
+		break;
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		DecodeChannelBlock(block, 0, texels);
+		break;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		DecodeChannelBlock(block, 0, texels);
+		DecodeChannelBlock(block + 8, 1, texels);
+		break;
+	default:
+		assert(!"No CPU decoder for the format");
+		break;
+	}
+}
@@ -0,0 +1,132 @@
+#include "VulkanTextureManager.h"
+#include "VulkanDevice.h"
+
+VulkanTextureManager::VulkanTextureManager() :
+	_deviceObj(nullptr)
+{
+}
+
+VulkanTextureManager::~VulkanTextureManager()
+{
+}
+
+void VulkanTextureManager::Initialize(VulkanDevice* deviceObj, const CreateFunc& createFunc, const ReleaseFunc& releaseFunc)
+{
+	_deviceObj		= deviceObj;
+	_createFunc		= createFunc;
+	_releaseFunc	= releaseFunc;
+}
+
+void VulkanTextureManager::Destroy()
+{
+	for (auto& texture : _textures)
+	{
+		_releaseFunc(texture.first);
+		DestroyTexture(texture.first);
+		delete texture.second;
+	}
+	_textures.clear();
+	_pathLookup.clear();
+	_hashLookup.clear();
+}
+
+TextureData* VulkanTextureManager::Acquire(const char* filename)
+{
+	auto pathIt = _pathLookup.find(filename);
+	if (pathIt != _pathLookup.end())
+	{
+		pathIt->second->_refCount++;
+		return pathIt->second->_texture;
+	}
+
+	// Another path to the same image shares its texture
+	uint64_t hash = 0;
+	if (HashFile(filename, &hash))
+	{
+		auto hashIt = _hashLookup.find(hash);
+		if (hashIt != _hashLookup.end())
+		{
+			TextureEntry* entry = hashIt->second;
+			entry->_refCount++;
+			entry->_paths.push_back(filename);
+			_pathLookup[filename] = entry;
+			return entry->_texture;
+		}
+	}
+
+	auto* texture = new TextureData();
+	_createFunc(filename, texture);
+
+	auto* entry			= new TextureEntry();
+	entry->_texture		= texture;
+	entry->_hash		= hash;
+	entry->_refCount	= 1;
+	entry->_paths.push_back(filename);
+
+	_textures[texture]		= entry;
+	_pathLookup[filename]	= entry;
+	if (hash != 0)
+	{
+		_hashLookup[hash] = entry;
+	}
+	return texture;
+}
+
+void VulkanTextureManager::Release(TextureData* texture)
+{
+	auto it = _textures.find(texture);
+	assert(it != _textures.end());
+
+	TextureEntry* entry = it->second;
+	if (--entry->_refCount > 0)
+	{
+		return;
+	}
+
+	for (const std::string& path : entry->_paths)
+	{
+		_pathLookup.erase(path);
+	}
+	if (entry->_hash != 0)
+	{
+		_hashLookup.erase(entry->_hash);
+	}
+	_textures.erase(it);
+	delete entry;
+
+	// The frames already submitted may still sample the texture
+	_releaseFunc(texture);
+	VulkanTimeline& timeline = _deviceObj->_graphicsTimeline;
+	timeline.DeferUntil(timeline.GetLastSubmitted(), [this, texture]() { DestroyTexture(texture); });
+}
+
+bool VulkanTextureManager::HashFile(const char* filename, uint64_t* hash)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	uint64_t value = HASH_SEED;
+	uint8_t buffer[65536];
+	size_t readSize;
+	while ((readSize = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		value = HashBytes(buffer, readSize, value);
+	}
+	fclose(file);
+
+	// 0 is kept to mean no hash
+	*hash = value != 0 ? value : 1;
+	return true;
+}
+
+void VulkanTextureManager::DestroyTexture(TextureData* texture)
+{
+	// The sampler belongs to the sampler cache of the device
+	vkDestroyImageView(_deviceObj->_device, texture->view, nullptr);
+	vkDestroyImage(_deviceObj->_device, texture->image, nullptr);
+	vkFreeMemory(_deviceObj->_device, texture->mem, nullptr);
+	delete texture;
+}
@@ -0,0 +1,583 @@
+#include "VulkanTextureStreamer.h"
+#include "VulkanDevice.h"
+#include "VulkanDrawable.h"
+#include "VulkanUploader.h"
+
+namespace
+{
+	VkImageView CreateView(VkDevice device, VkImage image, VkFormat format, uint32_t baseLevel, uint32_t levelCount)
+	{
+		VkImageViewCreateInfo viewCI = {};
+		viewCI.sType							= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewCI.pNext							= nullptr;
+		viewCI.viewType							= VK_IMAGE_VIEW_TYPE_2D;
+		viewCI.format							= format;
+		viewCI.components.r						= VK_COMPONENT_SWIZZLE_R;
+		viewCI.components.g						= VK_COMPONENT_SWIZZLE_G;
+		viewCI.components.b						= VK_COMPONENT_SWIZZLE_B;
+		viewCI.components.a						= VK_COMPONENT_SWIZZLE_A;
+		viewCI.subresourceRange.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+		viewCI.subresourceRange.baseMipLevel	= baseLevel;
+		viewCI.subresourceRange.levelCount		= levelCount;
+		viewCI.subresourceRange.baseArrayLayer	= 0;
+		viewCI.subresourceRange.layerCount		= 1;
+		viewCI.image							= image;
+
+		VkImageView view;
+		const VkResult result = vkCreateImageView(device, &viewCI, nullptr, &view);
+		assert(result == VK_SUCCESS);
+		return view;
+	}
+}
+
+VulkanTextureStreamer::VulkanTextureStreamer() :
+	_deviceObj(nullptr),
+	_uploader(nullptr),
+	_threadPool(nullptr),
+	_loadThreads(STREAMING_LOAD_THREAD_COUNT),
+	_residencyChanged(false),
+	_jobsInFlight(0)
+{
+}
+
+VulkanTextureStreamer::~VulkanTextureStreamer()
+{
+}
+
+void VulkanTextureStreamer::Initialize(VulkanDevice* deviceObj, VulkanUploader* uploader, VulkanThreadPool* threadPool)
+{
+	_deviceObj	= deviceObj;
+	_uploader	= uploader;
+	_threadPool	= threadPool;
+}
+
+void VulkanTextureStreamer::Destroy()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_jobsDone.wait(lock, [this]() { return _jobsInFlight == 0; });
+	}
+
+	for (StreamedTexture& stream : _streams)
+	{
+		// Staged levels which were never handed to the uploader
+		if (stream._state == STREAM_STAGED)
+		{
+			vkDestroyBuffer(_deviceObj->_device, stream._stagingBuffer, nullptr);
+			vkFreeMemory(_deviceObj->_device, stream._stagingMemory, nullptr);
+		}
+
+		// Images which have not replaced the placeholder yet
+		if (stream._image != VK_NULL_HANDLE && stream._image != stream._texture->image)
+		{
+			vkDestroyImage(_deviceObj->_device, stream._image, nullptr);
+			vkFreeMemory(_deviceObj->_device, stream._memory, nullptr);
+		}
+	}
+	_streams.clear();
+	_residencyChanged = false;
+}
+
+void VulkanTextureStreamer::StreamTexture(const char* filename, TextureData* texture)
+{
+	CreatePlaceholder(texture);
+
+	_streams.push_back(StreamedTexture());
+	StreamedTexture* stream = &_streams.back();
+	stream->_filename		= filename;
+	stream->_texture		= texture;
+	stream->_image			= VK_NULL_HANDLE;
+	stream->_memory			= VK_NULL_HANDLE;
+	stream->_levelCount		= 0;
+	stream->_generateMips	= false;
+	stream->_state			= STREAM_LOADING;
+	stream->_residentLevel	= 0;
+	stream->_visibleLevel	= 0;
+	stream->_requestedLevel	= 0;
+	stream->_uploadLevel	= 0;
+	stream->_uploadEnd		= 0;
+	stream->_uploadTicket	= 0;
+	stream->_stagingBuffer	= VK_NULL_HANDLE;
+	stream->_stagingMemory	= VK_NULL_HANDLE;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobsInFlight++;
+	}
+	_loadThreads.Enqueue([this, stream]() { LoadTexture(stream); });
+}
+
+void VulkanTextureStreamer::Release(TextureData* texture)
+{
+	// The load threads hold pointers to the streams
+	std::unique_lock<std::mutex> lock(_mutex);
+	_jobsDone.wait(lock, [this]() { return _jobsInFlight == 0; });
+
+	for (auto it = _streams.begin(); it != _streams.end(); ++it)
+	{
+		if (it->_texture != texture)
+		{
+			continue;
+		}
+
+		if (it->_state == STREAM_STAGED)
+		{
+			vkDestroyBuffer(_deviceObj->_device, it->_stagingBuffer, nullptr);
+			vkFreeMemory(_deviceObj->_device, it->_stagingMemory, nullptr);
+		}
+
+		// Its levels may still be uploading
+		if (it->_image != VK_NULL_HANDLE && it->_image != texture->image)
+		{
+			VkDevice device			= _deviceObj->_device;
+			VkImage image			= it->_image;
+			VkDeviceMemory memory	= it->_memory;
+			VulkanTimeline& timeline = _deviceObj->_graphicsTimeline;
+			timeline.DeferUntil(timeline.GetLastSubmitted(), [device, image, memory]()
+			{
+				vkDestroyImage(device, image, nullptr);
+				vkFreeMemory(device, memory, nullptr);
+			});
+		}
+
+		_streams.erase(it);
+		break;
+	}
+}
+
+void VulkanTextureStreamer::LoadTexture(StreamedTexture* stream)
+{
+	TextureImage source;
+	const bool loaded = VulkanTextureLoader::Load(stream->_filename.c_str(), &source) &&
+		                VulkanTextureLoader::SelectDeviceFormat(*_deviceObj->_gpu, &source, *_threadPool);
+	if (!loaded)
+	{
+		std::cout << "Unable to stream the texture " << stream->_filename << std::endl;
+		FinishJob(stream, STREAM_FAILED);
+		return;
+	}
+
+	// The files without mips get their chain blitted by the uploader after the copy of the first
+	// level, all the levels become resident at once. The formats the device cannot blit with a
+	// linear filter are downsampled here, and stream like the others.
+	stream->_generateMips = false;
+	if (source._mipLevels == 1 && std::max(source._width, source._height) > 1)
+	{
+		const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		VkFormatProperties formatProps;
+		vkGetPhysicalDeviceFormatProperties(*_deviceObj->_gpu, source._format, &formatProps);
+		if ((formatProps.optimalTilingFeatures & blitFeatures) == blitFeatures)
+		{
+			stream->_generateMips = true;
+		}
+		else
+		{
+			VulkanTextureLoader::GenerateMipmaps(&source, *_threadPool);
+		}
+	}
+	stream->_levelCount = stream->_generateMips ? VulkanTextureLoader::GetFullMipLevelCount(source._width, source._height) : source._mipLevels;
+
+	if (stream->_generateMips)
+	{
+		stream->_source = std::move(source);
+		StageLevels(stream, 0, 1);
+		return;
+	}
+
+	// The tail holds the levels at most STREAMING_TAIL_SIZE large, and at least the last one
+	uint32_t tailLevel = source._mipLevels - 1;
+	while (tailLevel > 0 && std::max(source._width >> (tailLevel - 1), source._height >> (tailLevel - 1)) <= STREAMING_TAIL_SIZE)
+	{
+		tailLevel--;
+	}
+
+	// The main thread does not look at the stream until its state says it is staged
+	stream->_source = std::move(source);
+	StageLevels(stream, tailLevel, stream->_source._mipLevels);
+}
+
+void VulkanTextureStreamer::StageLevels(StreamedTexture* stream, uint32_t firstLevel, uint32_t endLevel)
+{
+	// The levels are copied straight from the mapped file into the staging memory
+	const TextureImage& source	= stream->_source;
+	const VkDeviceSize size		= VulkanTextureLoader::GetStagingLayout(source, firstLevel, endLevel, &stream->_stagingOffsets);
+
+	uint8_t* staging = CreateStagingBuffer(size, &stream->_stagingBuffer, &stream->_stagingMemory);
+	VulkanTextureLoader::CopyLevels(source, firstLevel, endLevel, stream->_stagingOffsets, staging);
+	vkUnmapMemory(_deviceObj->_device, stream->_stagingMemory);
+
+	// The blitted levels are uploaded with the first one
+	stream->_uploadLevel	= firstLevel;
+	stream->_uploadEnd		= stream->_generateMips ? stream->_levelCount : endLevel;
+	FinishJob(stream, STREAM_STAGED);
+}
+
+void VulkanTextureStreamer::FinishJob(StreamedTexture* stream, StreamState state)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	stream->_state = state;
+	if (--_jobsInFlight == 0)
+	{
+		_jobsDone.notify_all();
+	}
+}
+
+uint8_t* VulkanTextureStreamer::CreateStagingBuffer(VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* memory)
+{
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType			= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size			= size;
+	bufferCreateInfo.usage			= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferCreateInfo.sharingMode	= VK_SHARING_MODE_EXCLUSIVE;
+
+	VkResult result = vkCreateBuffer(_deviceObj->_device, &bufferCreateInfo, nullptr, buffer);
+	assert(result == VK_SUCCESS);
+
+	VkMemoryRequirements memRqrmnt;
+	vkGetBufferMemoryRequirements(_deviceObj->_device, *buffer, &memRqrmnt);
+
+	VkMemoryAllocateInfo memAllocInfo;
+	memAllocInfo.sType			= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memAllocInfo.pNext			= nullptr;
+	memAllocInfo.allocationSize	= memRqrmnt.size;
+	memAllocInfo.memoryTypeIndex= 0;
+	_deviceObj->MemoryTypeFromProperties(memRqrmnt.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &memAllocInfo.memoryTypeIndex);
+
+	result = vkAllocateMemory(_deviceObj->_device, &memAllocInfo, nullptr, memory);
+	assert(result == VK_SUCCESS);
+
+	result = vkBindBufferMemory(_deviceObj->_device, *buffer, *memory, 0);
+	assert(result == VK_SUCCESS);
+
+	void* mapped;
+	result = vkMapMemory(_deviceObj->_device, *memory, 0, size, 0, &mapped);
+	assert(result == VK_SUCCESS);
+	return static_cast<uint8_t*>(mapped);
+}
+
+void VulkanTextureStreamer::CreateImage(StreamedTexture* stream)
+{
+	const TextureImage& source = stream->_source;
+
+	VkImageCreateInfo imageCreateInfo = {};
+	imageCreateInfo.sType			= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.pNext			= nullptr;
+	imageCreateInfo.imageType		= VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format			= source._format;
+	imageCreateInfo.mipLevels		= stream->_levelCount;
+	imageCreateInfo.arrayLayers		= 1;
+	imageCreateInfo.samples			= VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling			= VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.sharingMode		= VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout	= VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.extent			= { source._width, source._height, 1 };
+	imageCreateInfo.usage			= VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	if (stream->_generateMips)
+	{
+		imageCreateInfo.usage		|= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
+
+	VkResult result = vkCreateImage(_deviceObj->_device, &imageCreateInfo, nullptr, &stream->_image);
+	assert(result == VK_SUCCESS);
+
+	VkMemoryRequirements memRqrmnt;
+	vkGetImageMemoryRequirements(_deviceObj->_device, stream->_image, &memRqrmnt);
+
+	VkMemoryAllocateInfo memAllocInfo;
+	memAllocInfo.sType			= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memAllocInfo.pNext			= nullptr;
+	memAllocInfo.allocationSize	= memRqrmnt.size;
+	memAllocInfo.memoryTypeIndex= 0;
+	_deviceObj->MemoryTypeFromProperties(memRqrmnt.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memAllocInfo.memoryTypeIndex);
+
+	result = vkAllocateMemory(_deviceObj->_device, &memAllocInfo, nullptr, &stream->_memory);
+	assert(result == VK_SUCCESS);
+
+	result = vkBindImageMemory(_deviceObj->_device, stream->_image, stream->_memory, 0);
+	assert(result == VK_SUCCESS);
+
+	// Nothing is resident yet, the drawables need the coarsest level until told otherwise
+	stream->_residentLevel	= stream->_levelCount;
+	stream->_visibleLevel	= stream->_levelCount;
+	stream->_requestedLevel	= stream->_levelCount - 1;
+}
+
+void VulkanTextureStreamer::CreatePlaceholder(TextureData* texture)
+{
+	// Grey 1x1 image, shown until the tail of the texture is resident
+	const uint8_t texel[4] = { 128, 128, 128, 255 };
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingMemory;
+	memcpy(CreateStagingBuffer(sizeof(texel), &stagingBuffer, &stagingMemory), texel, sizeof(texel));
+	vkUnmapMemory(_deviceObj->_device, stagingMemory);
+
+	VkImageCreateInfo imageCreateInfo = {};
+	imageCreateInfo.sType			= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.pNext			= nullptr;
+	imageCreateInfo.imageType		= VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format			= VK_FORMAT_R8G8B8A8_UNORM;
+	imageCreateInfo.mipLevels		= 1;
+	imageCreateInfo.arrayLayers		= 1;
+	imageCreateInfo.samples			= VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling			= VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.sharingMode		= VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout	= VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.extent			= { 1, 1, 1 };
+	imageCreateInfo.usage			= VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+	VkResult result = vkCreateImage(_deviceObj->_device, &imageCreateInfo, nullptr, &texture->image);
+	assert(result == VK_SUCCESS);
+
+	VkMemoryRequirements memRqrmnt;
+	vkGetImageMemoryRequirements(_deviceObj->_device, texture->image, &memRqrmnt);
+
+	VkMemoryAllocateInfo memAllocInfo;
+	memAllocInfo.sType			= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memAllocInfo.pNext			= nullptr;
+	memAllocInfo.allocationSize	= memRqrmnt.size;
+	memAllocInfo.memoryTypeIndex= 0;
+	_deviceObj->MemoryTypeFromProperties(memRqrmnt.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memAllocInfo.memoryTypeIndex);
+
+	result = vkAllocateMemory(_deviceObj->_device, &memAllocInfo, nullptr, &texture->mem);
+	assert(result == VK_SUCCESS);
+
+	result = vkBindImageMemory(_deviceObj->_device, texture->image, texture->mem, 0);
+	assert(result == VK_SUCCESS);
+
+	VkImageSubresourceRange subresourceRange = {};
+	subresourceRange.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+	subresourceRange.baseMipLevel	= 0;
+	subresourceRange.levelCount		= 1;
+	subresourceRange.layerCount		= 1;
+
+	VkBufferImageCopy copy = {};
+	copy.imageSubresource.aspectMask	= VK_IMAGE_ASPECT_COLOR_BIT;
+	copy.imageSubresource.mipLevel		= 0;
+	copy.imageSubresource.layerCount	= 1;
+	copy.imageExtent					= { 1, 1, 1 };
+
+	texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	const bool isBatched = _uploader->IsRecording();
+	if (!isBatched)
+	{
+		_uploader->Begin();
+	}
+	_uploader->UploadImage(texture->image, subresourceRange, stagingBuffer, stagingMemory, std::vector<VkBufferImageCopy>(1, copy), texture->imageLayout);
+	if (!isBatched)
+	{
+		_uploader->End();
+	}
+
+	// The sampler is kept when the streamed image replaces the placeholder, it does not clamp the levels
+	texture->sampler = _deviceObj->_samplerCache.GetDefaultSampler();
+
+	texture->view			= CreateView(_deviceObj->_device, texture->image, VK_FORMAT_R8G8B8A8_UNORM, 0, 1);
+	texture->textureWidth	= 1;
+	texture->textureHeight	= 1;
+	texture->mipMapLevels	= 1;
+	texture->layerCount		= 1;
+
+	texture->descsImgInfo.imageView		= texture->view;
+	texture->descsImgInfo.sampler		= texture->sampler;
+	texture->descsImgInfo.imageLayout	= texture->imageLayout;
+}
+
+void VulkanTextureStreamer::UpdateRequestedLevels(const std::vector<VulkanDrawable*>& drawables, uint32_t viewportHeight)
+{
+	for (StreamedTexture& stream : _streams)
+	{
+		if (stream._image == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		// Textures no drawable shows keep their coarsest level
+		const TextureImage& source	= stream._source;
+		const float textureSize		= static_cast<float>(std::max(source._width, source._height));
+		uint32_t requestedLevel		= stream._levelCount - 1;
+		for (VulkanDrawable* drawableObj : drawables)
+		{
+			if (!drawableObj->IsVisible() || drawableObj->GetTextures() != stream._texture)
+			{
+				continue;
+			}
+
+			// The level with about one texel per pixel, the finer ones would only be minified
+			const float screenSize	= std::max(drawableObj->GetProjectedSize(static_cast<float>(viewportHeight)), 1.0f);
+			const float level		= std::max(std::floor(std::log2(textureSize / screenSize)), 0.0f);
+			requestedLevel			= std::min(requestedLevel, static_cast<uint32_t>(level));
+		}
+		stream._requestedLevel = requestedLevel;
+	}
+}
+
+void VulkanTextureStreamer::Update(const std::vector<VulkanDrawable*>& drawables, uint32_t viewportHeight)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	UpdateRequestedLevels(drawables, viewportHeight);
+
+	VulkanTimeline& timeline	= _deviceObj->_graphicsTimeline;
+	uint32_t uploadsInFlight	= 0;
+	std::vector<StreamedTexture*> submitted;
+	std::vector<StreamedTexture*> candidates;
+	for (StreamedTexture& stream : _streams)
+	{
+		switch (stream._state)
+		{
+		case STREAM_LOADING:
+		case STREAM_STAGING:
+			uploadsInFlight++;
+			break;
+
+		case STREAM_STAGED:
+		{
+			if (stream._image == VK_NULL_HANDLE)
+			{
+				CreateImage(&stream);
+			}
+
+			VkImageSubresourceRange subresourceRange = {};
+			subresourceRange.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+			subresourceRange.baseMipLevel	= stream._uploadLevel;
+			subresourceRange.levelCount		= stream._uploadEnd - stream._uploadLevel;
+			subresourceRange.layerCount		= 1;
+
+			const TextureImage& source = stream._source;
+			// Only the staged levels are copied, the uploader blits the others of the range
+			std::vector<VkBufferImageCopy> copies;
+			for (uint32_t level = stream._uploadLevel; level < stream._uploadLevel + stream._stagingOffsets.size(); level++)
+			{
+				VkBufferImageCopy copy = {};
+				copy.imageSubresource.aspectMask		= VK_IMAGE_ASPECT_COLOR_BIT;
+				copy.imageSubresource.mipLevel			= level;
+				copy.imageSubresource.layerCount		= 1;
+				copy.imageSubresource.baseArrayLayer	= 0;
+				copy.imageExtent.width					= std::max(source._width >> level, 1u);
+				copy.imageExtent.height					= std::max(source._height >> level, 1u);
+				copy.imageExtent.depth					= 1;
+				copy.bufferOffset						= stream._stagingOffsets[level - stream._uploadLevel];
+				copies.push_back(copy);
+			}
+
+			// The levels of all the staged textures share one submission
+			if (submitted.empty())
+			{
+				_uploader->Begin();
+			}
+			_uploader->UploadImage(stream._image, subresourceRange, stream._stagingBuffer, stream._stagingMemory, copies, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			stream._stagingBuffer = VK_NULL_HANDLE;
+			stream._stagingMemory = VK_NULL_HANDLE;
+			stream._state = STREAM_UPLOADING;
+			submitted.push_back(&stream);
+			uploadsInFlight++;
+			break;
+		}
+
+		case STREAM_UPLOADING:
+			if (timeline.IsComplete(stream._uploadTicket))
+			{
+				stream._residentLevel	= stream._uploadLevel;
+				stream._state			= STREAM_IDLE;
+				_residencyChanged		= true;
+
+				// Every level is on the GPU, only the description of the image is kept
+				if (stream._residentLevel == 0)
+				{
+					stream._source.ReleaseData();
+				}
+			}
+			else
+			{
+				uploadsInFlight++;
+			}
+			break;
+
+		case STREAM_IDLE:
+			if (stream._residentLevel > stream._requestedLevel)
+			{
+				candidates.push_back(&stream);
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	if (!submitted.empty())
+	{
+		const uint64_t ticket = _uploader->End();
+		for (StreamedTexture* stream : submitted)
+		{
+			stream->_uploadTicket = ticket;
+		}
+	}
+
+	// The textures furthest from the level they need are staged first
+	std::sort(candidates.begin(), candidates.end(), [](const StreamedTexture* a, const StreamedTexture* b)
+	{
+		return a->_residentLevel - a->_requestedLevel > b->_residentLevel - b->_requestedLevel;
+	});
+
+	for (StreamedTexture* stream : candidates)
+	{
+		if (uploadsInFlight >= STREAMING_MAX_UPLOADS_IN_FLIGHT)
+		{
+			break;
+		}
+
+		const uint32_t level	= stream->_residentLevel - 1;
+		stream->_state			= STREAM_STAGING;
+		_jobsInFlight++;
+		_loadThreads.Enqueue([this, stream, level]() { StageLevels(stream, level, level + 1); });
+		uploadsInFlight++;
+	}
+}
+
+void VulkanTextureStreamer::ApplyResidencyChanges(std::vector<TextureData*>* changedTextures)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	VkDevice device				= _deviceObj->_device;
+	VulkanTimeline& timeline	= _deviceObj->_graphicsTimeline;
+	const uint64_t lastUse		= timeline.GetLastSubmitted();
+	for (StreamedTexture& stream : _streams)
+	{
+		const uint32_t levelCount = stream._levelCount;
+		if (stream._image == VK_NULL_HANDLE || stream._residentLevel >= levelCount || stream._visibleLevel == stream._residentLevel)
+		{
+			continue;
+		}
+
+		TextureData* texture	= stream._texture;
+		VkImageView view		= texture->view;
+		timeline.DeferUntil(lastUse, [device, view]() { vkDestroyImageView(device, view, nullptr); });
+
+		// The first resident levels replace the placeholder
+		if (texture->image != stream._image)
+		{
+			VkImage image			= texture->image;
+			VkDeviceMemory memory	= texture->mem;
+			timeline.DeferUntil(lastUse, [device, image, memory]()
+			{
+				vkDestroyImage(device, image, nullptr);
+				vkFreeMemory(device, memory, nullptr);
+			});
+			texture->image			= stream._image;
+			texture->mem			= stream._memory;
+			texture->textureWidth	= stream._source._width;
+			texture->textureHeight	= stream._source._height;
+			texture->mipMapLevels	= levelCount;
+			texture->imageLayout	= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+
+		// The view starts at the finest resident level, the sampler never reaches the others
+		texture->view					= CreateView(_deviceObj->_device, stream._image, stream._source._format, stream._residentLevel, levelCount - stream._residentLevel);
+		texture->descsImgInfo.imageView		= texture->view;
+		texture->descsImgInfo.imageLayout	= texture->imageLayout;
+		stream._visibleLevel			= stream._residentLevel;
+		changedTextures->push_back(texture);
+	}
+	_residencyChanged = false;
+}
@@ -0,0 +1,109 @@
+#include "VulkanThreadPool.h"
+
+VulkanThreadPool::VulkanThreadPool(uint32_t threadCount) :
+	_stop(false)
+{
+	if (threadCount == 0)
+	{
+		// hardware_concurrency() is allowed to return 0 when it can't tell
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		_workers.push_back(std::thread(&VulkanThreadPool::WorkerLoop, this));
+	}
+}
+
+VulkanThreadPool::~VulkanThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_jobAvailable.notify_all();
+
+	for (auto& worker : _workers)
+	{
+		worker.join();
+	}
+	_workers.clear();
+}
+
+void VulkanThreadPool::Enqueue(const std::function<void()>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back(job);
+	}
+	_jobAvailable.notify_one();
+}
+
+void VulkanThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t chunkIndex, uint32_t begin, uint32_t end)>& func)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	const uint32_t chunkCount = std::min(count, GetThreadCount());
+	const uint32_t chunkSize  = count / chunkCount;
+	const uint32_t remainder  = count % chunkCount;
+
+	// Completion counter local to this call, so waiting here is not
+	// affected by the unrelated jobs queued by other users of the pool.
+	std::mutex              doneMutex;
+	std::condition_variable doneCondition;
+	uint32_t                pending = chunkCount - 1;
+
+	uint32_t begin = 0;
+	for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		// The first 'remainder' chunks take one extra item each
+		const uint32_t end = begin + chunkSize + (chunk < remainder ? 1 : 0);
+
+		// The calling thread records the last chunk itself
+		// instead of sleeping while the workers do all the work.
+		if (chunk == chunkCount - 1)
+		{
+			func(chunk, begin, end);
+			break;
+		}
+
+		Enqueue([&func, &doneMutex, &doneCondition, &pending, chunk, begin, end]()
+		{
+			func(chunk, begin, end);
+
+			std::lock_guard<std::mutex> lock(doneMutex);
+			if (--pending == 0)
+			{
+				doneCondition.notify_one();
+			}
+		});
+		begin = end;
+	}
+
+	std::unique_lock<std::mutex> lock(doneMutex);
+	doneCondition.wait(lock, [&pending]() { return pending == 0; });
+}
+
+void VulkanThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_jobAvailable.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+
+			if (_stop && _jobs.empty())
+			{
+				return;
+			}
+
+			job = _jobs.front();
+			_jobs.pop_front();
+		}
+		job();
+	}
+}
@@ -0,0 +1,290 @@
+#include "VulkanTimeline.h"
+#include "VulkanDevice.h"
+
+VulkanTimeline::VulkanTimeline() :
+	_deviceObj(nullptr),
+	_queue(VK_NULL_HANDLE),
+	_semaphore(VK_NULL_HANDLE),
+	_lastSubmitted(0),
+	_lastCompleted(0)
+{
+#ifdef VK_KHR_timeline_semaphore
+	fpGetSemaphoreCounterValueKHR	= nullptr;
+	fpWaitSemaphoresKHR				= nullptr;
+#endif
+}
+
+VulkanTimeline::~VulkanTimeline()
+{
+}
+
+void VulkanTimeline::Initialize(VulkanDevice* deviceObj, VkQueue queue)
+{
+	_deviceObj		= deviceObj;
+	_queue			= queue;
+	_lastSubmitted	= 0;
+	_lastCompleted	= 0;
+
+#ifdef VK_KHR_timeline_semaphore
+	if (_deviceObj->_timelineSemaphoreEnabled)
+	{
+		fpGetSemaphoreCounterValueKHR	= (PFN_vkGetSemaphoreCounterValueKHR) vkGetDeviceProcAddr(_deviceObj->_device, "vkGetSemaphoreCounterValueKHR");
+		fpWaitSemaphoresKHR				= (PFN_vkWaitSemaphoresKHR) vkGetDeviceProcAddr(_deviceObj->_device, "vkWaitSemaphoresKHR");
+	}
+
+	if (fpGetSemaphoreCounterValueKHR && fpWaitSemaphoresKHR)
+	{
+		VkSemaphoreTypeCreateInfoKHR semaphoreTypeInfo = {};
+		semaphoreTypeInfo.sType			= VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		semaphoreTypeInfo.pNext			= nullptr;
+		semaphoreTypeInfo.semaphoreType	= VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		semaphoreTypeInfo.initialValue	= 0;
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo;
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreCreateInfo.pNext = &semaphoreTypeInfo;
+		semaphoreCreateInfo.flags = 0;
+
+		const VkResult result = vkCreateSemaphore(_deviceObj->_device, &semaphoreCreateInfo, nullptr, &_semaphore);
+		assert(result == VK_SUCCESS);
+	}
+#endif
+}
+
+void VulkanTimeline::Destroy()
+{
+	if (!IsInitialized())
+	{
+		return;
+	}
+
+	WaitIdle();
+	CollectGarbage();
+
+	for (auto& fenceInFlight : _fencesInFlight)
+	{
+		vkDestroyFence(_deviceObj->_device, fenceInFlight.second, nullptr);
+	}
+	_fencesInFlight.clear();
+
+	for (VkFence fence : _freeFences)
+	{
+		vkDestroyFence(_deviceObj->_device, fence, nullptr);
+	}
+	_freeFences.clear();
+
+	if (_semaphore != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(_deviceObj->_device, _semaphore, nullptr);
+		_semaphore = VK_NULL_HANDLE;
+	}
+	_queue = VK_NULL_HANDLE;
+}
+
+uint64_t VulkanTimeline::Submit(VkCommandBuffer cmd)
+{
+	VkSubmitInfo submitInfo			= {};
+	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext				= nullptr;
+	submitInfo.commandBufferCount	= 1;
+	submitInfo.pCommandBuffers		= &cmd;
+	return Submit(submitInfo);
+}
+
+uint64_t VulkanTimeline::Submit(const VkSubmitInfo& submitInfo)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	const uint64_t ticket = ++_lastSubmitted;
+	VkResult result;
+
+#ifdef VK_KHR_timeline_semaphore
+	if (_semaphore != VK_NULL_HANDLE)
+	{
+		// The timeline signal goes after the binary semaphores of the caller,
+		// whose values are ignored but must still be present in the array.
+		std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+		std::vector<uint64_t>	 signalValues(submitInfo.signalSemaphoreCount, 0);
+		signalSemaphores.push_back(_semaphore);
+		signalValues.push_back(ticket);
+
+		VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+		timelineInfo.sType						= VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timelineInfo.pNext						= nullptr;
+		timelineInfo.waitSemaphoreValueCount	= 0;
+		timelineInfo.pWaitSemaphoreValues		= nullptr;
+		timelineInfo.signalSemaphoreValueCount	= static_cast<uint32_t>(signalValues.size());
+		timelineInfo.pSignalSemaphoreValues		= signalValues.data();
+
+		VkSubmitInfo timelineSubmitInfo			= submitInfo;
+		timelineSubmitInfo.pNext				= &timelineInfo;
+		timelineSubmitInfo.signalSemaphoreCount	= static_cast<uint32_t>(signalSemaphores.size());
+		timelineSubmitInfo.pSignalSemaphores	= signalSemaphores.data();
+
+		result = vkQueueSubmit(_queue, 1, &timelineSubmitInfo, VK_NULL_HANDLE);
+		assert(result == VK_SUCCESS);
+		return ticket;
+	}
+#endif
+
+	// Fence fallback, the fences are recycled once signaled
+	VkFence fence;
+	if (!_freeFences.empty())
+	{
+		fence = _freeFences.back();
+		_freeFences.pop_back();
+	}
+	else
+	{
+		VkFenceCreateInfo fenceCI	= {};
+		fenceCI.sType				= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceCI.flags				= 0;
+
+		result = vkCreateFence(_deviceObj->_device, &fenceCI, nullptr, &fence);
+		assert(result == VK_SUCCESS);
+	}
+
+	result = vkQueueSubmit(_queue, 1, &submitInfo, fence);
+	assert(result == VK_SUCCESS);
+	_fencesInFlight.push_back(std::make_pair(ticket, fence));
+	return ticket;
+}
+
+void VulkanTimeline::PollFences()
+{
+	// The fences signal in submission order
+	while (!_fencesInFlight.empty())
+	{
+		const VkFence fence = _fencesInFlight.front().second;
+		if (vkGetFenceStatus(_deviceObj->_device, fence) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		_lastCompleted = _fencesInFlight.front().first;
+		vkResetFences(_deviceObj->_device, 1, &fence);
+		_freeFences.push_back(fence);
+		_fencesInFlight.pop_front();
+	}
+}
+
+uint64_t VulkanTimeline::GetCompletedValue()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+#ifdef VK_KHR_timeline_semaphore
+	if (_semaphore != VK_NULL_HANDLE)
+	{
+		uint64_t value = 0;
+		const VkResult result = fpGetSemaphoreCounterValueKHR(_deviceObj->_device, _semaphore, &value);
+		assert(result == VK_SUCCESS);
+		_lastCompleted = value;
+		return _lastCompleted;
+	}
+#endif
+
+	PollFences();
+	return _lastCompleted;
+}
+
+bool VulkanTimeline::IsComplete(uint64_t ticket)
+{
+	// Cheap check first, the cached value only grows
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (ticket <= _lastCompleted)
+		{
+			return true;
+		}
+	}
+	return ticket <= GetCompletedValue();
+}
+
+void VulkanTimeline::Wait(uint64_t ticket)
+{
+	if (IsComplete(ticket))
+	{
+		return;
+	}
+
+#ifdef VK_KHR_timeline_semaphore
+	if (_semaphore != VK_NULL_HANDLE)
+	{
+		// The semaphore lives as long as the timeline, no lock is needed while waiting
+		VkSemaphoreWaitInfoKHR waitInfo = {};
+		waitInfo.sType			= VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.pNext			= nullptr;
+		waitInfo.flags			= 0;
+		waitInfo.semaphoreCount	= 1;
+		waitInfo.pSemaphores	= &_semaphore;
+		waitInfo.pValues		= &ticket;
+
+		const VkResult result = fpWaitSemaphoresKHR(_deviceObj->_device, &waitInfo, UINT64_MAX);
+		assert(result == VK_SUCCESS);
+		GetCompletedValue();
+		return;
+	}
+#endif
+
+	// The lock is not held while waiting, the other threads keep submitting and polling.
+	// A fence signaled meanwhile may be recycled by them, so the wait is bounded and the
+	// completion checked again.
+	while (!IsComplete(ticket))
+	{
+		VkFence fence = VK_NULL_HANDLE;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (auto& fenceInFlight : _fencesInFlight)
+			{
+				if (fenceInFlight.first == ticket)
+				{
+					fence = fenceInFlight.second;
+					break;
+				}
+			}
+		}
+
+		// Retired meanwhile, or never submitted
+		if (fence == VK_NULL_HANDLE)
+		{
+			break;
+		}
+
+		const VkResult result = vkWaitForFences(_deviceObj->_device, 1, &fence, VK_TRUE, TIMELINE_FENCE_WAIT_TIMEOUT);
+		assert(result == VK_SUCCESS || result == VK_TIMEOUT);
+	}
+}
+
+void VulkanTimeline::DeferUntil(uint64_t ticket, const std::function<void()>& func)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_deferred.push_back(std::make_pair(ticket, func));
+}
+
+void VulkanTimeline::CollectGarbage()
+{
+	const uint64_t completed = GetCompletedValue();
+
+	// Take the ready functions out first, they may defer further work
+	std::vector<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto it = _deferred.begin(); it != _deferred.end();)
+		{
+			if (it->first <= completed)
+			{
+				ready.push_back(it->second);
+				it = _deferred.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	for (auto& func : ready)
+	{
+		func();
+	}
+}
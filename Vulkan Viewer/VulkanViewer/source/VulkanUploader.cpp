@@ -0,0 +1,337 @@
+#include "VulkanUploader.h"
+#include "VulkanDevice.h"
+#include "Wrappers.h"
+
+VulkanUploader::VulkanUploader() :
+	_deviceObj(nullptr),
+	_cmdPool(VK_NULL_HANDLE),
+	_transferCmdPool(VK_NULL_HANDLE),
+	_barrierBatcher(nullptr),
+	_isRecording(false)
+{
+}
+
+void VulkanUploader::Initialize(VulkanDevice* deviceObj, VkCommandPool cmdPool, VulkanBarrierBatcher* barrierBatcher)
+{
+	_deviceObj		= deviceObj;
+	_cmdPool		= cmdPool;
+	_barrierBatcher	= barrierBatcher;
+
+	// Without a DMA family the copies stay on the graphics queue
+	if (_deviceObj->HasDedicatedTransferQueue())
+	{
+		VkCommandPoolCreateInfo cmdPoolInfo;
+		cmdPoolInfo.sType				= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		cmdPoolInfo.pNext				= nullptr;
+		cmdPoolInfo.queueFamilyIndex	= _deviceObj->_transferQueueIndex;
+		cmdPoolInfo.flags				= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		const VkResult result = vkCreateCommandPool(_deviceObj->_device, &cmdPoolInfo, nullptr, &_transferCmdPool);
+		assert(result == VK_SUCCESS);
+	}
+}
+
+void VulkanUploader::Destroy()
+{
+	if (_transferCmdPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(_deviceObj->_device, _transferCmdPool, nullptr);
+		_transferCmdPool = VK_NULL_HANDLE;
+	}
+}
+
+void VulkanUploader::Begin()
+{
+	assert(!_isRecording);
+	_isRecording = true;
+}
+
+void VulkanUploader::UploadImage(VkImage image, const VkImageSubresourceRange& subresourceRange,
+	                             VkBuffer stagingBuffer, VkDeviceMemory stagingMemory,
+	                             const std::vector<VkBufferImageCopy>& copies, VkImageLayout finalLayout)
+{
+	assert(_isRecording);
+
+	PendingUpload upload;
+	upload._image				= image;
+	upload._subresourceRange	= subresourceRange;
+	upload._stagingBuffer		= stagingBuffer;
+	upload._stagingMemory		= stagingMemory;
+	upload._copies				= copies;
+	upload._finalLayout			= finalLayout;
+	upload._extent				= copies[0].imageExtent;
+	upload._generateMips		= false;
+
+	// Number of levels of the range the copies fill
+	uint32_t copiedLevels = 0;
+	for (const VkBufferImageCopy& copy : copies)
+	{
+		copiedLevels = std::max(copiedLevels, copy.imageSubresource.mipLevel - subresourceRange.baseMipLevel + 1);
+	}
+	if (copiedLevels < subresourceRange.levelCount)
+	{
+		assert(copiedLevels == 1);
+		upload._generateMips = true;
+	}
+	_uploads.push_back(upload);
+}
+
+uint64_t VulkanUploader::End()
+{
+	assert(_isRecording);
+	_isRecording = false;
+
+	if (_uploads.empty())
+	{
+		return 0;
+	}
+
+	const uint64_t ticket = (_transferCmdPool != VK_NULL_HANDLE) ? SubmitOnTransferQueue() : SubmitOnGraphicsQueue();
+	_uploads.clear();
+	return ticket;
+}
+
+void VulkanUploader::RecordCopies(VkCommandBuffer cmd)
+{
+	// One barrier call moves every image to the transfer destination layout
+	for (const PendingUpload& upload : _uploads)
+	{
+		_barrierBatcher->AddImageTransition(upload._image, upload._subresourceRange, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	}
+	_barrierBatcher->Flush(cmd);
+
+	for (const PendingUpload& upload : _uploads)
+	{
+		vkCmdCopyBufferToImage(cmd,
+			                   upload._stagingBuffer,
+			                   upload._image,
+			                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			                   static_cast<uint32_t>(upload._copies.size()),
+			                   upload._copies.data());
+	}
+}
+
+void VulkanUploader::RecordMipGeneration(VkCommandBuffer cmd)
+{
+	uint32_t maxLevelCount = 0;
+	for (const PendingUpload& upload : _uploads)
+	{
+		if (upload._generateMips)
+		{
+			maxLevelCount = std::max(maxLevelCount, upload._subresourceRange.levelCount);
+		}
+	}
+
+	// Level by level for all the images, each level is blitted from the previous one once
+	// it has become a transfer source. Linear filtering of an sRGB format averages the
+	// texels in linear space, and the halved extents are rounded down for odd sizes.
+	for (uint32_t level = 1; level < maxLevelCount; level++)
+	{
+		for (const PendingUpload& upload : _uploads)
+		{
+			if (upload._generateMips && level < upload._subresourceRange.levelCount)
+			{
+				VkImageSubresourceRange sourceRange	= upload._subresourceRange;
+				sourceRange.baseMipLevel			+= level - 1;
+				sourceRange.levelCount				= 1;
+				_barrierBatcher->AddImageTransition(upload._image, sourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+			}
+		}
+		_barrierBatcher->Flush(cmd);
+
+		for (const PendingUpload& upload : _uploads)
+		{
+			if (!upload._generateMips || level >= upload._subresourceRange.levelCount)
+			{
+				continue;
+			}
+
+			VkImageBlit blit = {};
+			blit.srcSubresource.aspectMask		= upload._subresourceRange.aspectMask;
+			blit.srcSubresource.mipLevel		= upload._subresourceRange.baseMipLevel + level - 1;
+			blit.srcSubresource.baseArrayLayer	= upload._subresourceRange.baseArrayLayer;
+			blit.srcSubresource.layerCount		= upload._subresourceRange.layerCount;
+			blit.srcOffsets[1].x				= static_cast<int32_t>(std::max(upload._extent.width >> (level - 1), 1u));
+			blit.srcOffsets[1].y				= static_cast<int32_t>(std::max(upload._extent.height >> (level - 1), 1u));
+			blit.srcOffsets[1].z				= 1;
+			blit.dstSubresource					= blit.srcSubresource;
+			blit.dstSubresource.mipLevel		= upload._subresourceRange.baseMipLevel + level;
+			blit.dstOffsets[1].x				= static_cast<int32_t>(std::max(upload._extent.width >> level, 1u));
+			blit.dstOffsets[1].y				= static_cast<int32_t>(std::max(upload._extent.height >> level, 1u));
+			blit.dstOffsets[1].z				= 1;
+
+			vkCmdBlitImage(cmd,
+				           upload._image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				           upload._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				           1, &blit, VK_FILTER_LINEAR);
+		}
+	}
+}
+
+void VulkanUploader::AddFinalTransition(const PendingUpload& upload)
+{
+	if (!upload._generateMips)
+	{
+		_barrierBatcher->AddImageTransition(upload._image, upload._subresourceRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, upload._finalLayout);
+		return;
+	}
+
+	// The blits left every level but the last one as a transfer source
+	VkImageSubresourceRange sourceRange	= upload._subresourceRange;
+	sourceRange.levelCount				-= 1;
+	_barrierBatcher->AddImageTransition(upload._image, sourceRange, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, upload._finalLayout);
+
+	VkImageSubresourceRange lastRange	= upload._subresourceRange;
+	lastRange.baseMipLevel				+= lastRange.levelCount - 1;
+	lastRange.levelCount				= 1;
+	_barrierBatcher->AddImageTransition(upload._image, lastRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, upload._finalLayout);
+}
+
+uint64_t VulkanUploader::SubmitOnGraphicsQueue()
+{
+	VkCommandBuffer cmd;
+	CommandBufferMgr::allocCommandBuffer(&_deviceObj->_device, _cmdPool, &cmd);
+	CommandBufferMgr::beginCommandBuffer(cmd);
+
+	RecordCopies(cmd);
+	RecordMipGeneration(cmd);
+
+	// And a second one makes all of them readable
+	for (const PendingUpload& upload : _uploads)
+	{
+		AddFinalTransition(upload);
+	}
+	_barrierBatcher->Flush(cmd);
+
+	CommandBufferMgr::endCommandBuffer(cmd);
+
+	// The draws are submitted later on the same queue, so the barriers above already order
+	// them after the copies. The staging buffers are released once the ticket completes.
+	VulkanTimeline& timeline	= _deviceObj->_graphicsTimeline;
+	const uint64_t ticket		= timeline.Submit(cmd);
+
+	VkDevice device							= _deviceObj->_device;
+	VkCommandPool cmdPool					= _cmdPool;
+	const std::vector<PendingUpload> uploads = _uploads;
+	timeline.DeferUntil(ticket, [device, cmdPool, cmd, uploads]()
+	{
+		vkFreeCommandBuffers(device, cmdPool, 1, &cmd);
+		for (const PendingUpload& upload : uploads)
+		{
+			vkDestroyBuffer(device, upload._stagingBuffer, nullptr);
+			vkFreeMemory(device, upload._stagingMemory, nullptr);
+		}
+	});
+	return ticket;
+}
+
+uint64_t VulkanUploader::SubmitOnTransferQueue()
+{
+	const uint32_t transferFamily	= _deviceObj->_transferQueueIndex;
+	const uint32_t graphicsFamily	= _deviceObj->_graphicsQueueWithPresentIndex;
+
+	// The copies run on the DMA queue, which then releases the images to the graphics family
+	VkCommandBuffer transferCmd;
+	CommandBufferMgr::allocCommandBuffer(&_deviceObj->_device, _transferCmdPool, &transferCmd);
+	CommandBufferMgr::beginCommandBuffer(transferCmd);
+
+	RecordCopies(transferCmd);
+
+	// The transfer queue cannot blit, the images with mips to generate stay transfer
+	// destinations and the graphics queue builds their chain after the acquire.
+	for (const PendingUpload& upload : _uploads)
+	{
+		const VkImageLayout releaseLayout = upload._generateMips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : upload._finalLayout;
+		_barrierBatcher->AddImageBarrier(upload._image, upload._subresourceRange,
+			                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, releaseLayout,
+			                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			                             transferFamily, graphicsFamily);
+	}
+	_barrierBatcher->Flush(transferCmd);
+	CommandBufferMgr::endCommandBuffer(transferCmd);
+
+	// The graphics queue acquires them with the same layout transition. The release made
+	// the writes available, the acquire only has to wait for the semaphore.
+	VkPipelineStageFlags acquireStages	= 0;
+	VkAccessFlags acquireAccess			= 0;
+	VkPipelineStageFlags allStages		= 0;
+
+	VkCommandBuffer graphicsCmd;
+	CommandBufferMgr::allocCommandBuffer(&_deviceObj->_device, _cmdPool, &graphicsCmd);
+	CommandBufferMgr::beginCommandBuffer(graphicsCmd);
+	for (const PendingUpload& upload : _uploads)
+	{
+		const VkImageLayout releaseLayout = upload._generateMips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : upload._finalLayout;
+		VulkanBarrierBatcher::GetLayoutStageAccess(releaseLayout, false, &acquireStages, &acquireAccess);
+		if (upload._generateMips)
+		{
+			// The first level is read by the first blit
+			acquireAccess |= VK_ACCESS_TRANSFER_READ_BIT;
+		}
+		_barrierBatcher->AddImageBarrier(upload._image, upload._subresourceRange,
+			                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, releaseLayout,
+			                             acquireStages, 0,
+			                             acquireStages, acquireAccess,
+			                             transferFamily, graphicsFamily);
+		allStages |= acquireStages;
+	}
+	_barrierBatcher->Flush(graphicsCmd);
+
+	RecordMipGeneration(graphicsCmd);
+	for (const PendingUpload& upload : _uploads)
+	{
+		if (upload._generateMips)
+		{
+			AddFinalTransition(upload);
+		}
+	}
+	_barrierBatcher->Flush(graphicsCmd);
+	CommandBufferMgr::endCommandBuffer(graphicsCmd);
+
+	VkSemaphore transferCompleteSemaphore;
+	VkSemaphoreCreateInfo semaphoreCreateInfo;
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = nullptr;
+	semaphoreCreateInfo.flags = 0;
+
+	const VkResult result = vkCreateSemaphore(_deviceObj->_device, &semaphoreCreateInfo, nullptr, &transferCompleteSemaphore);
+	assert(result == VK_SUCCESS);
+
+	VkSubmitInfo submitInfo			= {};
+	submitInfo.sType				= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext				= nullptr;
+	submitInfo.commandBufferCount	= 1;
+	submitInfo.pCommandBuffers		= &transferCmd;
+	submitInfo.signalSemaphoreCount	= 1;
+	submitInfo.pSignalSemaphores	= &transferCompleteSemaphore;
+	_deviceObj->GetTransferTimeline().Submit(submitInfo);
+
+	submitInfo.waitSemaphoreCount	= 1;
+	submitInfo.pWaitSemaphores		= &transferCompleteSemaphore;
+	submitInfo.pWaitDstStageMask	= &allStages;
+	submitInfo.pCommandBuffers		= &graphicsCmd;
+	submitInfo.signalSemaphoreCount	= 0;
+	submitInfo.pSignalSemaphores	= nullptr;
+
+	// The acquire completes after the copies, so its ticket covers both submissions
+	VulkanTimeline& timeline	= _deviceObj->_graphicsTimeline;
+	const uint64_t ticket		= timeline.Submit(submitInfo);
+
+	VkDevice device							= _deviceObj->_device;
+	VkCommandPool cmdPool					= _cmdPool;
+	VkCommandPool transferCmdPool			= _transferCmdPool;
+	const std::vector<PendingUpload> uploads = _uploads;
+	timeline.DeferUntil(ticket, [device, cmdPool, transferCmdPool, graphicsCmd, transferCmd, transferCompleteSemaphore, uploads]()
+	{
+		vkFreeCommandBuffers(device, cmdPool, 1, &graphicsCmd);
+		vkFreeCommandBuffers(device, transferCmdPool, 1, &transferCmd);
+		vkDestroySemaphore(device, transferCompleteSemaphore, nullptr);
+		for (const PendingUpload& upload : uploads)
+		{
+			vkDestroyBuffer(device, upload._stagingBuffer, nullptr);
+			vkFreeMemory(device, upload._stagingMemory, nullptr);
+		}
+	});
+	return ticket;
+}
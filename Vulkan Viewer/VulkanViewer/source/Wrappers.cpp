@@ -25,6 +25,7 @@
 
 #include "Wrappers.h"
 #include "VulkanApplication.h"
+#include "VulkanPixelConverter.h"
 
 void CommandBufferMgr::allocCommandBuffer(const VkDevice* device, const VkCommandPool cmdPool, VkCommandBuffer* cmdBuf, const VkCommandBufferAllocateInfo* commandBufferInfo)
 {
@@ -152,25 +153,74 @@ int32_t PpmParser::getImageHeight()
 
 bool PpmParser::getHeaderInfo(const char *filename)
 {
-	tex2D = new gli::texture2D(gli::load(filename));
-	imageHeight = static_cast<uint32_t>(tex2D[0].dimensions().x);
-	imageWidth  = static_cast<uint32_t>(tex2D[0].dimensions().y);
-	return true;
+	isValid	= false;
+	ppmFile	= filename;
+	if (!file.Open(filename))
+	{
+		return false;
+	}
+
+	// "P6", width, height and maximum value separated by whitespace or comments,
+	// then a single whitespace character before the binary data
+	const char* data	= reinterpret_cast<const char*>(file.GetData());
+	const size_t size	= file.GetSize();
+	if (size < 2 || data[0] != 'P' || data[1] != '6')
+	{
+		return false;
+	}
+
+	size_t position = 2;
+	int32_t values[3];
+	for (int32_t& value : values)
+	{
+		while (position < size && (isspace(static_cast<unsigned char>(data[position])) || data[position] == '#'))
+		{
+			if (data[position] == '#')
+			{
+				while (position < size && data[position] != '\n')
+				{
+					position++;
+				}
+			}
+			else
+			{
+				position++;
+			}
+		}
+
+		value = 0;
+		if (position >= size || !isdigit(static_cast<unsigned char>(data[position])))
+		{
+			return false;
+		}
+		while (position < size && isdigit(static_cast<unsigned char>(data[position])) && value < 65536)
+		{
+			value = value * 10 + (data[position++] - '0');
+		}
+	}
+	position++;
+
+	imageWidth		= values[0];
+	imageHeight		= values[1];
+	dataPosition	= static_cast<int32_t>(position);
+
+	// Only the 8 bit channels are supported
+	isValid = values[2] == 255 && imageWidth > 0 && imageHeight > 0 &&
+		      position + static_cast<size_t>(imageWidth) * imageHeight * 3 <= size;
+	return isValid;
 }
 
 bool PpmParser::loadImageData(int rowPitch, uint8_t *data)
 {
-	uint8_t* dataTemp = (uint8_t*)tex2D->data();
-	for (int y = 0; y < imageHeight; y++)
+	if (!isValid)
 	{
-		size_t imageSize = imageWidth * 4;
-		memcpy(data, dataTemp, imageSize);
-		dataTemp += imageSize;
-
-		// Advance row by row pitch information
-		data += rowPitch;
+		return false;
 	}
 
+	// The RGB8 rows are expanded to RGBA8 at the row pitch of the destination
+	const uint8_t* source = file.GetData() + dataPosition;
+	VulkanPixelConverter::Convert(PIXEL_RGB8_TO_RGBA8, source, imageWidth * 3, data, rowPitch, imageWidth, imageHeight);
+
 	return true;
 }
 